@@ -63,6 +63,7 @@ Icon::Icon(Xd6ConfigFile *c, Xd6ConfigFileSection *s, Xd6ConfigFileSection *p,
 		VirtualWindow(100000, 10000, 32, 32)
 {
 	displayed = 0;
+	watcher = NULL;
 	is_drop = 0;
 	dragging = 0;
 	clear_border();
@@ -89,6 +90,7 @@ Icon::Icon(Xd6ConfigFile *c, Xd6ConfigFileSection *s, Xd6ConfigFileSection *p,
 
 Icon::~Icon()
 {
+	delete(watcher);
 	delete(ic1);
 	delete(ic2);
 	delete(sec);
@@ -355,6 +357,13 @@ void Icon::create()
 	default:
 		break;
 	}
+	if (type == TYPE_FSDevice) {
+		watcher = new Xd6FileWatcher("/etc/mtab", watch_cb, this);
+	} else if (type == TYPE_Trash && cfg) {
+		snprintf(buf, 1024, "%s", launch_name);
+		*(buf + strlen(buf) - 7) = '\0';
+		watcher = new Xd6FileWatcher(buf, watch_cb, this);
+	}
 	make_menu();
 	
 	X = 500;
@@ -431,6 +440,15 @@ void Icon::show()
 			Fl::check();
 		}
 	}
+	update_state();
+	VirtualWindow::show();
+}
+
+/*
+ *  Shows the icon of the current state of the device or of the trash.
+ */
+void Icon::update_state()
+{
 	if (type == TYPE_FSDevice) {
 		if (is_mounted()) {
 			if (ic2) {
@@ -465,7 +483,23 @@ void Icon::show()
 		}
 		if (ic1) ic1->show();
 	}
-	VirtualWindow::show();
+}
+
+/*
+ *  Called when the mount table or the trash directory has changed.
+ */
+void Icon::watch_cb(Xd6FileWatcher *w, const char *name, int what, void *d)
+{
+	Icon *ic = (Icon*) d;
+
+	if (!ic->displayed) return;
+	ic->update_state();
+	if (ic->ic1 && ic->ic1->shown()) {
+		XLowerWindow(fl_display, fl_xid(ic->ic1));
+	}
+	if (ic->ic2 && ic->ic2->shown()) {
+		XLowerWindow(fl_display, fl_xid(ic->ic2));
+	}
 }
 
 int Icon::is_mounted()
@@ -484,16 +518,23 @@ int Icon::is_mounted()
 	if (val) {
 		int fp;
 		char *buf;
-		struct stat s;
 		char *ptr;
+		long len = 0, size = 4096;
+		int r;
 
-		if (stat("/etc/mtab", &s)) return 0;
-		buf = (char*) malloc(s.st_size);
 		fp = open("/etc/mtab", O_RDONLY);
-		read(fp, buf, s.st_size);
+		if (fp < 0) return 0;
+		buf = (char*) malloc(size + 1);
+		while ((r = read(fp, buf + len, size - len)) > 0) {
+			len += r;
+			if (len == size) {
+				size *= 2;
+				buf = (char*) realloc(buf, size + 1);
+			}
+		}
 		close(fp);
 
-		buf[s.st_size - 1] = '\0';
+		buf[len] = '\0';
 		ptr = strstr(buf, val);	
 		if (ptr) {
 			ptr += strlen(val);
@@ -507,35 +548,33 @@ int Icon::is_mounted()
 	return 0;
 }
 
-static int sel_no_hide(const struct dirent *d)
-{
-	if (d->d_name[0] == '.') return 0;
-	return 1;
-}
-
+/*
+ *  The trash is empty when its directory has no visible file, the 
+ *  reading stops at the first one.
+ */
 int Icon::is_empty_trash()
 {
 	char *dir;
-	int nb;
-	struct dirent **namelist = NULL;
+	DIR *d;
+	struct dirent *e;
+	int empty = 1;
 
 	if (!cfg || !sec || !launch_name) return 0;
 
 	dir = strdup(launch_name);
 	
 	*(dir + strlen(dir) - 7) = '\0';
-	nb = scandir(dir, &namelist, sel_no_hide, alphasort);
-	
-	if (nb < 1) {
-		free(dir);
-		return 1;
-	}
-	while (nb > 0) {
-		nb--;
-		free(namelist[nb]);
+	d = opendir(dir);
+	free(dir);
+	if (!d) return 1;
+	while ((e = readdir(d))) {
+		if (e->d_name[0] != '.') {
+			empty = 0;
+			break;
+		}
 	}
-	free(namelist);
-	return 0;
+	closedir(d);
+	return empty;
 }
 
 void Icon::open_cb(Fl_Widget* w, void* d)
@@ -48,6 +48,7 @@
 #include <FL/Fl_Menu_Button.H>
 #include "xd640/Xd6IconWindow.h"
 #include "xd640/Xd6ConfigFile.h"
+#include "xd640/Xd6FileWatcher.h"
 
 enum {
 	TYPE_None = 0,
@@ -79,6 +80,7 @@ public:
 	char dragging;
 	char is_drop;
 	char displayed;
+	Xd6FileWatcher *watcher;
 
 	Icon(Xd6ConfigFile *cfg, Xd6ConfigFileSection *sec, Xd6ConfigFileSection *pos,
 		const char *pos_file_name, const char *launch_name);
@@ -88,6 +90,7 @@ public:
 	void create(void);
 	Xd6IconWindow *make_icon(const char *name);
 	void show(void);
+	void update_state(void);
 	int is_mounted(void);
 	int is_empty_trash(void);
 	void make_menu(void);
@@ -98,6 +101,8 @@ public:
 	static void edit_icon_cb(Fl_Widget* w, void* d);
 	static void remove_icon_cb(Fl_Widget* w, void* d);
 	static void empty_cb(Fl_Widget* w, void* d);
+	static void watch_cb(Xd6FileWatcher *w, const char *name, int what,
+		void *d);
 	int dnd_release(void);
 	int dnd_drag(void);
 };
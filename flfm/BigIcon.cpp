@@ -203,24 +203,11 @@ void BigIcon::create_drag_window()
 
 void reset_selection()
 {
-        int i;
-        Fl_Widget*const* a;
-        BigIcon *b;
-
-        if (!gui || !gui->icon_can || 
-		!((IconCanvas*)gui->icon_can)->group) return;
-
-        a = ((IconCanvas*)gui->icon_can)->group->array();
-        i = ((IconCanvas*)gui->icon_can)->group->children();
-
-        while (i > 0) {
-                i--;
-                b = (BigIcon*) a[i];
-                if (b && b->selected) {
-                        b->selected = 0;
-                }
-        }
-	((IconCanvas*)gui->icon_can)->group->redraw();
+	IconGroup *g;
+
+	if (!gui || !gui->icon_can || StatesValues.view_tree) return;
+	g = ((IconCanvas*)gui->icon_can)->group;
+	if (g) g->select_none();
 }
 
 static Fl_Pixmap *get_pixmap_by_name(const char *name) 
@@ -316,87 +303,101 @@ static Fl_Pixmap *get_pixmap_by_name(const char *name)
 	return pix;
 }
 
-void BigIcon::set_data(struct file_info *fi)
+/*
+ *  Finds the pixmap, the popup menu and the double click callback of a 
+ *  file. cb is NULL when the file can not be opened.
+ */
+void BigIcon::file_type(struct file_info *fi, Fl_Pixmap **pix, 
+	Fl_Menu_Item **m, Fl_Callback **cb)
 {
 	struct stat st;
 
-	fl_font(gui->font, gui->size);
-	width = (int) fl_width(fi->real_name) + 8;
-	if (width < 48) width = 48;
-	
-	height = labelsize() + 8 + 32;
-	
-	real_name = fi->real_name;
-	label(fi->real_name);	
-
 	if (!p_link) {
 		create_pixmaps();
 	}
 	if (!m_exec) {
 		create_menus();
 	}
-	if (!drag_window) {
-	//	window()->begin();
-		window()->end();
-		create_drag_window();
-		((Fl_Group*)parent())->begin();
-	}
 
+	*cb = NULL;
 	switch(fi->st.st_mode & S_IFMT) {
 	case S_IFSOCK:
-		menu(m_special);
-		pix = p_socket; break;
+		*m = m_special;
+		*pix = p_socket; break;
 	case S_IFLNK:
-		if (!stat(real_name, &st)) {
+		*m = m_special;
+		if (!stat(fi->real_name, &st)) {
 			switch(st.st_mode & S_IFMT) {
 			case S_IFREG:
 				if (st.st_mode & S_IXUSR) {
-					menu(m_exec);
-					callback(cb_exec);
+					*m = m_exec;
+					*cb = cb_exec;
 				} else {
-					menu(m_unknown);
-					callback(cb_open);
+					*m = m_unknown;
+					*cb = cb_open;
 				}
 				break;
 			case S_IFDIR:
-				callback(cb_change_dir);
-				menu(m_folder); break;
-			default:
-				menu(m_special);
+				*cb = cb_change_dir;
+				*m = m_folder; break;
 			}
-		} else {
-			menu(m_special);
 		}
-		pix = p_link; break;
+		*pix = p_link; break;
 	case S_IFREG:
 		if (fi->st.st_mode & S_IXUSR) {
-			menu(m_exec);
-			pix = p_exec; 
-			callback(cb_exec);
+			*m = m_exec;
+			*pix = p_exec; 
+			*cb = cb_exec;
 		} else {
-			menu(m_unknown);
-			pix = get_pixmap_by_name(real_name); // p_unknown;		
-			callback(cb_open);
+			*m = m_unknown;
+			*pix = get_pixmap_by_name(fi->real_name);
+			*cb = cb_open;
 		}
 		break;
 	case S_IFBLK:
-		menu(m_special);
-		pix = p_block; break;
+		*m = m_special;
+		*pix = p_block; break;
 	case S_IFDIR:
-		menu(m_folder);
-		callback(cb_change_dir);
-		pix = p_folder; break;
+		*m = m_folder;
+		*cb = cb_change_dir;
+		*pix = p_folder; break;
 	case S_IFCHR:
-		menu(m_special);
-		pix = p_character; break;
+		*m = m_special;
+		*pix = p_character; break;
 	case S_IFIFO:
-		menu(m_special);
-		pix = p_pipe; break;
+		*m = m_special;
+		*pix = p_pipe; break;
 	default:
-		menu(m_special);
-		pix = p_unknown;		
+		*m = m_special;
+		*pix = p_unknown;		
+	}
+}
+
+void BigIcon::set_data(struct file_info *fi)
+{
+	Fl_Menu_Item *m;
+	Fl_Callback *cb;
+
+	fl_font(gui->font, gui->size);
+	width = (int) fl_width(fi->real_name) + 8;
+	if (width < 48) width = 48;
+	
+	height = labelsize() + 8 + 32;
+	
+	real_name = fi->real_name;
+	label(fi->real_name);	
+
+	if (!drag_window) {
+	//	window()->begin();
+		window()->end();
+		create_drag_window();
+		((Fl_Group*)parent())->begin();
 	}
 
+	file_type(fi, &pix, &m, &cb);
+	menu(m);
+	if (cb) callback(cb);
+
 	resize(x(), y(), width, height);
 }
 
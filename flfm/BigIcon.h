@@ -65,6 +65,8 @@ public:
 	BigIcon(int X, int Y, int W, int H);
 	~BigIcon();
 	void set_data(struct file_info *fi);
+	static void file_type(struct file_info *fi, Fl_Pixmap **pix, 
+		Fl_Menu_Item **m, Fl_Callback **cb);
 	virtual int handle(int e);
 	virtual void draw(void);
 	virtual int is_inside(void);
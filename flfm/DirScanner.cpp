@@ -0,0 +1,298 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#include "DirScanner.h"
+#include "IconCanvas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define SCAN_BUFFER (256 * 1024)
+#define SCAN_CHUNK 512
+
+#ifdef __linux__
+struct linux_dirent64 {
+	unsigned long long d_ino;
+	long long d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+#endif
+
+DirScanner::DirScanner(const char *p, int hidden)
+{
+	int i;
+
+	path = strdup(p);
+	show_hidden = hidden;
+	todo = NULL;
+	done = NULL;
+	reading = 1;
+	busy = 0;
+	cancel = 0;
+	nb_threads = 0;
+	has_reader = 0;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+	pipe_fd[0] = pipe_fd[1] = -1;
+	if (!pipe(pipe_fd)) {
+		fcntl(pipe_fd[1], F_SETFL, O_NONBLOCK);
+		fcntl(pipe_fd[0], F_SETFL, O_NONBLOCK);
+	}
+	dir_fd = open(path, O_RDONLY);
+	if (dir_fd < 0) {
+		reading = 0;
+		write(pipe_fd[1], "", 1);
+		return;
+	}
+	for (i = 0; i < SCAN_WORKERS; i++) {
+		if (pthread_create(workers + i, NULL, stat_thread, this)) break;
+		nb_threads++;
+	}
+	if (nb_threads < 1 || pthread_create(&reader, NULL, read_thread, 
+		this)) 
+	{
+		/* no thread, read it all now */
+		read_dir();
+		stat_files();
+		has_reader = 0;
+		return;
+	}
+	has_reader = 1;
+}
+
+static void free_chunks(DirScanChunk *c)
+{
+	DirScanChunk *n;
+	int i;
+
+	while (c) {
+		n = c->next;
+		for (i = 0; i < c->nb; i++) free(c->info[i]);
+		free(c->info);
+		free(c);
+		c = n;
+	}
+}
+
+DirScanner::~DirScanner()
+{
+	int i;
+
+	pthread_mutex_lock(&mutex);
+	cancel = 1;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+	if (has_reader) pthread_join(reader, NULL);
+	for (i = 0; i < nb_threads; i++) pthread_join(workers[i], NULL);
+	if (dir_fd >= 0) close(dir_fd);
+	free_chunks(todo);
+	free_chunks(done);
+	if (pipe_fd[0] >= 0) close(pipe_fd[0]);
+	if (pipe_fd[1] >= 0) close(pipe_fd[1]);
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+	free(path);
+}
+
+/*
+ *  Returns the files stat'ed since the last call, or NULL.
+ */
+DirScanChunk *DirScanner::get()
+{
+	DirScanChunk *c;
+	char buf[256];
+
+	while (read(pipe_fd[0], buf, sizeof(buf)) > 0);
+	pthread_mutex_lock(&mutex);
+	c = done;
+	done = NULL;
+	pthread_mutex_unlock(&mutex);
+	return c;
+}
+
+/*
+ *  Returns 1 when all the files were given by get().
+ */
+int DirScanner::finished()
+{
+	int r;
+
+	pthread_mutex_lock(&mutex);
+	r = !reading && !busy && !todo && !done;
+	pthread_mutex_unlock(&mutex);
+	return r;
+}
+
+void DirScanner::put(DirScanChunk **list, DirScanChunk *c)
+{
+	pthread_mutex_lock(&mutex);
+	c->next = *list;
+	*list = c;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+}
+
+static DirScanChunk *new_chunk(void)
+{
+	DirScanChunk *c;
+
+	c = (DirScanChunk*) malloc(sizeof(DirScanChunk));
+	c->next = NULL;
+	c->nb = 0;
+	c->info = (struct file_info**) malloc(SCAN_CHUNK * 
+		sizeof(struct file_info*));
+	return c;
+}
+
+/*
+ *  Adds name to the chunk c, which is queued for the stat threads when
+ *  it is full. Returns the chunk to fill next.
+ */
+DirScanChunk *DirScanner::add(DirScanChunk *c, const char *name)
+{
+	struct file_info *fi;
+	int l;
+
+	if (name[0] == '.' && (!show_hidden || !name[1] ||
+		(name[1] == '.' && !name[2])))
+	{
+		return c;
+	}
+	l = strlen(name);
+	fi = (struct file_info*) malloc(sizeof(struct file_info) + l + 1);
+	memcpy(fi + 1, name, l + 1);
+	fi->real_name = (const char*) (fi + 1);
+	memset(&fi->st, 0, sizeof(fi->st));
+	c->info[c->nb++] = fi;
+	if (c->nb < SCAN_CHUNK) return c;
+	put(&todo, c);
+	return new_chunk();
+}
+
+/*
+ *  Reads the names of the directory a large block at a time.
+ */
+void DirScanner::read_dir()
+{
+	DirScanChunk *c = new_chunk();
+#ifdef __linux__
+	struct linux_dirent64 *d;
+	char *buf;
+	long n, i;
+
+	buf = (char*) malloc(SCAN_BUFFER);
+	while (!cancel && 
+		(n = syscall(SYS_getdents64, dir_fd, buf, SCAN_BUFFER)) > 0) 
+	{
+		for (i = 0; i < n; i += d->d_reclen) {
+			d = (struct linux_dirent64*) (buf + i);
+			c = add(c, d->d_name);
+		}
+	}
+	free(buf);
+#else
+	struct dirent *d;
+	DIR *dir;
+
+	dir = fdopendir(dup(dir_fd));
+	while (!cancel && dir && (d = readdir(dir))) c = add(c, d->d_name);
+	if (dir) closedir(dir);
+#endif
+	pthread_mutex_lock(&mutex);
+	c->next = todo;
+	todo = c;
+	reading = 0;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+}
+
+void DirScanner::stat_files()
+{
+	DirScanChunk *c;
+	struct file_info *fi;
+	int i;
+
+	pthread_mutex_lock(&mutex);
+	for (;;) {
+		while (!todo && reading && !cancel) {
+			pthread_cond_wait(&cond, &mutex);
+		}
+		if (cancel || !todo) break;
+		c = todo;
+		todo = c->next;
+		busy++;
+		pthread_mutex_unlock(&mutex);
+		for (i = 0; i < c->nb && !cancel; i++) {
+			fi = c->info[i];
+			if (fstatat(dir_fd, fi->real_name, &fi->st, 0)) {
+				fi->st.st_mode = 0;
+				fi->st.st_size = 0;
+			}
+		}
+		pthread_mutex_lock(&mutex);
+		busy--;
+		c->next = done;
+		done = c;
+		write(pipe_fd[1], "", 1);
+	}
+	pthread_mutex_unlock(&mutex);
+	write(pipe_fd[1], "", 1);
+}
+
+void *DirScanner::read_thread(void *d)
+{
+	((DirScanner*)d)->read_dir();
+	return NULL;
+}
+
+void *DirScanner::stat_thread(void *d)
+{
+	((DirScanner*)d)->stat_files();
+	return NULL;
+}
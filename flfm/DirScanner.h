@@ -0,0 +1,94 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#ifndef DirScanner_h
+#define DirScanner_h
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define SCAN_WORKERS 4
+
+struct file_info;
+
+struct DirScanChunk {
+	DirScanChunk *next;
+	int nb;
+	struct file_info **info;
+};
+
+/*
+ *  Reads a directory in the background. One thread reads the names, a 
+ *  few others stat them, chunks of file_info are handed to the GUI 
+ *  thread which is woken by a byte written to fd().
+ */
+class DirScanner {
+public:
+	char *path;
+	int show_hidden;
+	int dir_fd;
+	int pipe_fd[2];
+	pthread_t reader;
+	pthread_t workers[SCAN_WORKERS];
+	int nb_threads;
+	int has_reader;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	DirScanChunk *todo;
+	DirScanChunk *done;
+	int reading;
+	int busy;
+	int cancel;
+
+	DirScanner(const char *p, int hidden);
+	~DirScanner(void);
+	int fd(void) { return pipe_fd[0]; }
+	DirScanChunk *get(void);
+	int finished(void);
+	void put(DirScanChunk **list, DirScanChunk *c);
+	DirScanChunk *add(DirScanChunk *c, const char *name);
+	void read_dir(void);
+	void stat_files(void);
+	static void *read_thread(void *d);
+	static void *stat_thread(void *d);
+};
+
+#endif
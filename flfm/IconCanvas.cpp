@@ -39,13 +39,17 @@
 
 
 #include "IconCanvas.h"
-#include "BigIcon.h"
+#include "DirScanner.h"
+#include "Thumbnailer.h"
 #include "callbacks.h"
 #include <FL/fl_draw.H>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <libintl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define _(String) gettext((String))
 
@@ -53,13 +57,21 @@ int IconCanvas::onmover = 0;
 
 IconCanvas::IconCanvas(int X, int Y, int W, int H) : Fl_Scroll(X, Y, W, H)
 {
-	newlist = NULL;
-	list = NULL;
+	scanner = NULL;
+	thumbnailer = NULL;
 	newnbf = 0;
+	newsize = 0;
+	new_shown = 0;
 	nbf = 0;
+	total_size = 0;
+	pending = NULL;
+	nb_pending = 0;
+	oldnbf = 0;
 	group = NULL;
 	newinfo = NULL;
 	info = NULL;
+	oldinfo = NULL;
+	names = NULL;
 	oldgroup = NULL;
         drag_x = 0;
         drag_y = 0;
@@ -68,35 +80,39 @@ IconCanvas::IconCanvas(int X, int Y, int W, int H) : Fl_Scroll(X, Y, W, H)
 	box(FL_FLAT_BOX);
 }
 
-IconCanvas::~IconCanvas()
+static void free_files(struct file_info **fi, int nb)
 {
-	while (nbf > 0) {
-		nbf--;
-		free(list[nbf]);
-		free(info[nbf]);
+	while (nb > 0) {
+		nb--;
+		free(fi[nb]);
 	}
-	free(list);
-	free(info);
-	delete(oldgroup);
-	scrollbar.parent(0);
-	hscrollbar.parent(0);
-	clear();
+	free(fi);
 }
 
-static int sel_all(const struct dirent *d)
+static void free_pending(char **p, int nb)
 {
-	if (d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
-		(d->d_name[1] == '.' && d->d_name[2] == '\0')))
-	{
-		return 0;
+	while (nb > 0) {
+		nb--;
+		free(p[nb]);
 	}
-	return 1;
+	free(p);
 }
 
-static int sel_no_hide(const struct dirent *d)
+IconCanvas::~IconCanvas()
 {
-	if (d->d_name[0] == '.') return 0;
-	return 1;
+	if (scanner) Fl::remove_fd(scanner->fd());
+	delete(scanner);
+	if (thumbnailer) Fl::remove_fd(thumbnailer->fd());
+	delete(thumbnailer);
+	free_files(newinfo, newnbf);
+	free_files(oldinfo, oldnbf);
+	free(info);
+	free(names);
+	free_pending(pending, nb_pending);
+	delete(oldgroup);
+	scrollbar.parent(0);
+	hscrollbar.parent(0);
+	clear();
 }
 
 static int sizesort(const void *d1, const void *d2)
@@ -111,7 +127,8 @@ static int sizesort(const void *d1, const void *d2)
 	} else if (S_ISDIR(f2->st.st_mode)) {
 		return 0x7fffffff;
 	}
-	return (f2->st.st_size - f1->st.st_size);
+	if (f1->st.st_size == f2->st.st_size) return 0;
+	return f2->st.st_size > f1->st.st_size ? 1 : -1;
 }
 
 static int typesort(const void *d1, const void *d2)
@@ -128,69 +145,368 @@ static int typesort(const void *d1, const void *d2)
 	return ((f2->st.st_mode & S_IFMT) - (f1->st.st_mode & S_IFMT));
 }
 
+/*
+ *  The order of the icons, the files of the same kind or size are in
+ *  alphabetical order.
+ */
+static int filesort(const void *d1, const void *d2)
+{
+	struct file_info *f1 = *((struct file_info**) d1);
+	struct file_info *f2 = *((struct file_info**) d2);
+	int r = 0;
+
+	if (StatesValues.sort_type) {
+		r = typesort(d1, d2);
+	} else if (StatesValues.sort_size) {
+		r = sizesort(d1, d2);
+	}
+	if (r) return r;
+	return strcoll(f1->real_name, f2->real_name);
+}
+
+static int namesort(const void *d1, const void *d2)
+{
+	struct file_info *f1 = *((struct file_info**) d1);
+	struct file_info *f2 = *((struct file_info**) d2);
+
+	return strcmp(f1->real_name, f2->real_name);
+}
+
+/*
+ *  Returns the place of name in the files sorted by name.
+ */
+static int name_pos(struct file_info **names, int nb, const char *name)
+{
+	int lo = 0, hi = nb;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (strcmp(names[mid]->real_name, name) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+ *  Starts reading the directory in the background, the icons shown stay
+ *  until the first files are there.
+ */
 void IconCanvas::rescan()
 {
-	int i;
 	if (!StatesValues.url) return;
 
-	if (StatesValues.show_hide) {	
-		newnbf = scandir(StatesValues.url, &newlist, 
-				sel_all, alphasort);
+	if (scanner) Fl::remove_fd(scanner->fd());
+	delete(scanner);
+	if (new_shown) {
+		free_files(oldinfo, oldnbf);
+		oldinfo = newinfo;
+		oldnbf = newnbf;
 	} else {
-		newnbf = scandir(StatesValues.url, &newlist, 
-				sel_no_hide, alphasort);
+		free_files(newinfo, newnbf);
 	}
+	newinfo = NULL;
+	newnbf = 0;
+	newsize = 0;
+	new_shown = 0;
+	free_pending(pending, nb_pending);
+	pending = NULL;
+	nb_pending = 0;
+	if (thumbnailer) thumbnailer->drop_queue();
+
+	scanner = new DirScanner(StatesValues.url, StatesValues.show_hide);
+	Fl::add_fd(scanner->fd(), FL_READ, scan_cb, this);
+}
 
-	// prevent drop timeout callback
-	//gui->dnd()->init();
-
-	newinfo = (struct file_info **) 
-			malloc(sizeof(struct file_info *) * newnbf);
-	i = 0;
-	while (i < newnbf) {
-		newinfo[i] = (struct file_info *) 
-				malloc(sizeof(struct file_info));
-		newinfo[i]->real_name = newlist[i]->d_name;
-		if (stat(newinfo[i]->real_name, &(newinfo[i]->st))) {
-			newinfo[i]->st.st_mode = 0;
-			newinfo[i]->st.st_size = 0;
+void IconCanvas::scan_cb(int fd, void *d)
+{
+	IconCanvas *c = (IconCanvas*) d;
+	DirScanChunk *l, *n;
+	struct file_info **fi = NULL;
+	int nb = 0;
+	int i;
+
+	if (!c->scanner) return;
+	for (l = c->scanner->get(); l; l = n) {
+		n = l->next;
+		fi = (struct file_info**) realloc(fi, 
+			(nb + l->nb) * sizeof(struct file_info*));
+		memcpy(fi + nb, l->info, l->nb * sizeof(struct file_info*));
+		nb += l->nb;
+		free(l->info);
+		free(l);
+	}
+	c->add_files(fi, nb);
+	free(fi);
+	if (c->scanner->finished()) {
+		Fl::remove_fd(c->scanner->fd());
+		delete(c->scanner);
+		c->scanner = NULL;
+		c->show_files();
+		for (i = 0; i < c->nb_pending; i++) {
+			c->update_file(c->pending[i]);
 		}
-		i++;
+		free_pending(c->pending, c->nb_pending);
+		c->pending = NULL;
+		c->nb_pending = 0;
+	} else if (!c->new_shown ? c->newnbf > 0 : c->newnbf >= 2 * c->nbf) {
+		/* the layout is done again each time the number doubles */
+		c->show_files();
 	}
-	if (StatesValues.sort_type) {
-		qsort(newinfo, newnbf, sizeof(struct file_info*), typesort);
-	} else if (StatesValues.sort_size) {
-		qsort(newinfo, newnbf, sizeof(struct file_info*), sizesort);
+}
+
+/*
+ *  Returns the thumbnail of the image file i, or NULL while it is not
+ *  ready or when the file has none.
+ */
+Fl_Image *IconCanvas::thumb(int i)
+{
+	char *path;
+	Fl_Image *img;
+
+	if (!thumbnailer) {
+		thumbnailer = new Thumbnailer(cfg->home_dir);
+		if (thumbnailer->fd() >= 0) {
+			Fl::add_fd(thumbnailer->fd(), FL_READ, thumb_cb, this);
+		}
 	}
+	path = (char*) malloc(strlen(StatesValues.url) + 
+		strlen(info[i]->real_name) + 2);
+	sprintf(path, "%s/%s", StatesValues.url, info[i]->real_name);
+	img = thumbnailer->get(path, &info[i]->st);
+	free(path);
+	return img;
+}
 
-	remove(group);
-	delete(oldgroup);
-	oldgroup = group;
+void IconCanvas::thumb_cb(int fd, void *d)
+{
+	IconCanvas *c = (IconCanvas*) d;
+
+	if (c->thumbnailer->collect() > 0 && c->group) c->group->redraw();
+}
 
-	while (nbf > 0) {
-		nbf--;
-		free(list[nbf]);
-		free(info[nbf]);
+/*
+ *  Merges the nb files fi in the sorted files of the scan.
+ */
+void IconCanvas::add_files(struct file_info **fi, int nb)
+{
+	int i, j, lo, hi;
+
+	if (nb < 1) return;
+	qsort(fi, nb, sizeof(struct file_info*), filesort);
+	if (newnbf + nb > newsize) {
+		newsize = (newnbf + nb) * 2;
+		newinfo = (struct file_info **) realloc(newinfo,
+			sizeof(struct file_info *) * newsize);
 	}
-	free(list);
-	free(info);
+	i = newnbf;
+	for (j = nb - 1; j >= 0; j--) {
+		lo = 0;
+		hi = i;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (filesort(newinfo + mid, fi + j) > 0) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		memmove(newinfo + lo + j + 1, newinfo + lo, 
+			(i - lo) * sizeof(struct file_info*));
+		newinfo[lo + j] = fi[j];
+		i = lo;
+	}
+	newnbf += nb;
+}
+
+/*
+ *  Lays out the icons of the files of the scan found so far.
+ */
+void IconCanvas::show_files()
+{
+	int i;
 
+	if (!new_shown) {
+		free_files(oldinfo, oldnbf);
+		oldinfo = NULL;
+		oldnbf = 0;
+		new_shown = 1;
+		if (group) remove(group);
+		position(0, 0);
+	}
+	info = (struct file_info **) realloc(info,
+		sizeof(struct file_info *) * (newnbf + 1));
+	memcpy(info, newinfo, newnbf * sizeof(struct file_info *));
 	nbf = newnbf;
-	list = newlist;
-	info = newinfo;
+	names = (struct file_info **) realloc(names,
+		sizeof(struct file_info *) * (nbf + 1));
+	memcpy(names, info, nbf * sizeof(struct file_info *));
+	qsort(names, nbf, sizeof(struct file_info*), namesort);
+	total_size = 0;
+	for (i = 0; i < nbf; i++) total_size += info[i]->st.st_size;
+
+	remove(group);
+	delete(oldgroup);
+	oldgroup = group;
 
 	begin();
 	if (StatesValues.view_detail) {
-		group = new DetailGroup(x(), y(), w(), h(), this);	
+		group = new DetailGroup(x() - xposition(), y() - yposition(), 
+			w(), h(), this);	
 	} else {
-		group = new NormalGroup(x(), y(), w(), h(), this);	
+		group = new NormalGroup(x() - xposition(), y() - yposition(), 
+			w(), h(), this);	
 	}
 	end();
 	resizable(NULL);
+	fit_position();
+
+	update_status();
+	redraw();
+}
+
+/*
+ *  Shows the new state of the file name of the directory, told by the 
+ *  watcher. The changes coming while the directory is read are done 
+ *  once the scan is finished.
+ */
+void IconCanvas::update_file(const char *name)
+{
+	struct file_info *fi;
+	char *path;
+	int i, l;
+	int sel = 0;
 
+	if (name[0] == '.' && (!StatesValues.show_hide || !name[1] ||
+		(name[1] == '.' && !name[2])))
+	{
+		return;
+	}
+	if (scanner) {
+		pending = (char**) realloc(pending, 
+			(nb_pending + 1) * sizeof(char*));
+		pending[nb_pending++] = strdup(name);
+		return;
+	}
+	if (!group || !StatesValues.url) return;
+
+	i = find_file(name);
+	if (i >= 0) {
+		sel = group->entries[i].selected;
+		remove_file(i);
+	}
+	l = strlen(name);
+	fi = (struct file_info*) malloc(sizeof(struct file_info) + l + 1);
+	memcpy(fi + 1, name, l + 1);
+	fi->real_name = (const char*) (fi + 1);
+	path = (char*) malloc(strlen(StatesValues.url) + l + 2);
+	sprintf(path, "%s/%s", StatesValues.url, name);
+	if (stat(path, &fi->st)) {
+		if (lstat(path, &fi->st)) {
+			free(fi);
+			fi = NULL;
+		} else {
+			fi->st.st_mode = 0;
+			fi->st.st_size = 0;
+		}
+	}
+	free(path);
+	if (fi) insert_file(fi, sel);
+	fit_position();
 	update_status();
-	Fl::flush();
-	Fl::check();
+}
+
+/*
+ *  Returns the place of the file name in info, or -1. The name is looked
+ *  up in names, then the file in info by its sort order.
+ */
+int IconCanvas::find_file(const char *name)
+{
+	struct file_info *fi;
+	int lo = 0, hi = nbf;
+	int i;
+
+	i = name_pos(names, nbf, name);
+	if (i >= nbf || strcmp(names[i]->real_name, name)) return -1;
+	fi = names[i];
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (filesort(info + mid, &fi) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	/* strcoll() may find other names equal */
+	for (i = lo; i < nbf && !filesort(info + i, &fi); i++) {
+		if (info[i] == fi) return i;
+	}
+	/* the order changed since the files were sorted */
+	for (i = 0; i < nbf; i++) {
+		if (info[i] == fi) return i;
+	}
+	return -1;
+}
+
+/*
+ *  Puts fi at its place in the sorted files.
+ */
+void IconCanvas::insert_file(struct file_info *fi, int sel)
+{
+	int lo = 0, hi = nbf;
+	int n;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (filesort(info + mid, &fi) > 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	if (newnbf + 1 > newsize) {
+		newsize = (newnbf + 1) * 2;
+		newinfo = (struct file_info **) realloc(newinfo,
+			sizeof(struct file_info *) * newsize);
+	}
+	info = (struct file_info **) realloc(info,
+		sizeof(struct file_info *) * (nbf + 2));
+	memmove(info + lo + 1, info + lo, 
+		(nbf - lo) * sizeof(struct file_info*));
+	names = (struct file_info **) realloc(names,
+		sizeof(struct file_info *) * (nbf + 2));
+	n = name_pos(names, nbf, fi->real_name);
+	memmove(names + n + 1, names + n, 
+		(nbf - n) * sizeof(struct file_info*));
+	names[n] = fi;
+	memmove(newinfo + lo + 1, newinfo + lo, 
+		(newnbf - lo) * sizeof(struct file_info*));
+	info[lo] = fi;
+	newinfo[lo] = fi;
+	nbf++;
+	newnbf++;
+	total_size += fi->st.st_size;
+	group->insert_entry(lo, sel);
+}
+
+void IconCanvas::remove_file(int i)
+{
+	int n;
+
+	group->remove_entry(i);
+	total_size -= info[i]->st.st_size;
+	n = name_pos(names, nbf, info[i]->real_name);
+	memmove(names + n, names + n + 1, 
+		(nbf - n - 1) * sizeof(struct file_info*));
+	free(info[i]);
+	memmove(info + i, info + i + 1, 
+		(nbf - i - 1) * sizeof(struct file_info*));
+	memmove(newinfo + i, newinfo + i + 1, 
+		(newnbf - i - 1) * sizeof(struct file_info*));
+	nbf--;
+	newnbf--;
 }
 
 void IconCanvas::mover(void* data)
@@ -203,11 +519,8 @@ void IconCanvas::mover(void* data)
 
 void IconCanvas::draw_selector(int ev_x, int ev_y)
 {
-	int redr = 0;
-        const int numchildren = group->children();
-        BigIcon *b;
         int x=0, y=0, dx=0, dy=0;
-	int drag_dx, drag_dy, mx, my;
+	int drag_dx, drag_dy;
 
         drag_dx = ev_x - drag_x;
         drag_dy = ev_y - drag_y;
@@ -229,40 +542,14 @@ void IconCanvas::draw_selector(int ev_x, int ev_y)
 
 	x -= xposition();
 	y -= yposition();
-        mx = x + dx;
-        my = y + dy;
-
-        for (int i=0; i < numchildren; ++i) {
-                int bx, by, bw, bh;
-                b = (BigIcon *)group->child(i);
-                bx = b->x();
-                by = b->y();
-                bw = b->w();
-                bh = b->h();
-
-                if (bx + bw > x && bx < mx && by + bh > y && by < my) {
-			if (!b->selected) {
-				b->selected = 1;
-				b->damage(FL_DAMAGE_ALL);
-				redr = 1;
-			}
-                } else {
-			if (b->selected) {
-				b->selected = 0;
-				b->damage(FL_DAMAGE_ALL);
-				redr = 1;
-			}
-                }
-      }
 
-	group->damage(FL_DAMAGE_CHILD);
 	group->show_selector(x, y, dx, dy);
-	if (redr) {
+	if (group->select_rect(x, y, dx, dy)) {
 		update_status();
 		Fl::flush();
+	} else {
+		group->damage(FL_DAMAGE_USER1);
 	}
-	//redraw();
-	//Fl::flush();
 }
 
 int IconCanvas::handle(int event)
@@ -274,6 +561,8 @@ int IconCanvas::handle(int event)
        	int ev_y;
 	int mx, my;
 
+	/* nothing is shown before the first files of the directory */
+	if (!group) return Fl_Scroll::handle(event);
         if (!dragging) {
                 int ret = 0;
                 onmover = 0;
@@ -282,30 +571,20 @@ int IconCanvas::handle(int event)
 			!(Fl::get_key(FL_Control_L) ||
                         Fl::get_key(FL_Control_R)))
                 {
-                        int i = group->children();
-                        while (i) {
-                                i--;
-                                ((BigIcon*)group->child(i))->selected = 0;
-                        }
+			group->select_none();
 			update_status();
-			group->damage(FL_DAMAGE_CHILD);
                 }
                 if (event != FL_FOCUS) {
                         ret = Fl_Scroll::handle(event);
                 }
                 if (!ret && event == FL_PUSH) {
-			int i = group->children();
                         Fl::focus(this);
 			if (!(Fl::get_key(FL_Control_L) || 
 				Fl::get_key(FL_Control_R)))
 			{
-				while (i) {
-					i--;
-					((BigIcon*)group->child(i))->
-						selected = 0;
-				}
-				group->redraw();
+				group->select_none();
 			}
+			group->band = 0;
                         dragging = 1;
                         drag_x = Fl::event_x() + xposition();
                         drag_y = Fl::event_y() + yposition();
@@ -314,6 +593,7 @@ int IconCanvas::handle(int event)
                 return ret;
         } else if (event == FL_RELEASE) {
                 dragging = 0;
+                group->band = 0;
                 Fl::remove_timeout(mover);
 		group->hide_selector();
                 group->redraw();
@@ -380,56 +660,39 @@ int IconCanvas::handle(int event)
 
 void IconCanvas::update_status(void)
 {
-        const int numchildren = group->children();
 	static char buf[80];
-	unsigned long dsize = 0;	
-	unsigned long ssize = 0;	
-	int nbs = 0;
-
-        for (int i=0; i < numchildren; ++i) {
-		if (i >= nbf) break;
-		if (((BigIcon *)group->child(i))->selected) {
-			ssize += info[i]->st.st_size;
-			nbs++;
-		}
-		dsize += info[i]->st.st_size;
-	}
-	
-	if (nbs) {
+
+	if (group && group->nb_selected) {
 		snprintf(buf, 80, _(" %d selected files  /  %ld kb"), 
-			nbs, ssize / 1024);
+			group->nb_selected, group->sel_size / 1024);
 	} else {
 		snprintf(buf, 80, _(" %d files  /  %ld kb"), 
-			numchildren, dsize / 1024);
+			nbf, total_size / 1024);
 	}
 	gui->stat_bar->value(buf);
 }
 
-void IconCanvas::resize(int X, int Y, int W, int H) 
+/*
+ *  Keeps the scroll position inside the files.
+ */
+void IconCanvas::fit_position()
 {
-	int ww;
-	int hh;
-	int xp;
-	int yp;
+	int xp = xposition();
+	int yp = yposition();
+
+	if (xp > group->w() - w() + 16) xp = group->w() - w() + 16;
+	if (yp > group->h() - h() + 16) yp = group->h() - h() + 16;
+	if (xp < 0) xp = 0;
+	if (yp < 0) yp = 0;
+	position(xp, yp);
+}
 
+void IconCanvas::resize(int X, int Y, int W, int H) 
+{
 	Fl_Scroll::resize(X, Y, W, H);
 	if (!group) return;
-	ww = W - 16;
-	hh = H - 16;
-	if (group->w() > ww) ww = group->w();
-	if (group->h() > hh) hh = group->h();
-	group->resize(group->x(), group->y(), ww, hh);
-
-	yp = scrollbar.value();
-	xp = scrollbar.value();
-
-	if (yp + H > hh - 16) {
-		yp = hh - H + 16;
-	}
-	if (xp + W > ww - 16) {
-		xp = 0;
-	}
-	position(xp, yp);
+	group->layout();
+	fit_position();
 }
 
 void IconCanvas::draw() 
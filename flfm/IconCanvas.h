@@ -53,14 +53,25 @@ struct file_info {
 	struct stat st;
 };
 
+class DirScanner;
+class Thumbnailer;
+
 class IconCanvas : public Fl_Scroll {
 public:
-	struct dirent **newlist;
-	struct dirent **list;
+	DirScanner *scanner;
+	Thumbnailer *thumbnailer;
 	struct file_info **newinfo;
 	struct file_info **info;
+	struct file_info **oldinfo;
+	struct file_info **names;	/* info sorted by name */
 	int newnbf;
+	int newsize;
+	int new_shown;
 	int nbf;
+	unsigned long total_size;
+	char **pending;
+	int nb_pending;
+	int oldnbf;
 	IconGroup *group;
 	IconGroup *oldgroup;
 	static int onmover;
@@ -71,11 +82,21 @@ public:
 	IconCanvas(int X, int Y, int W, int H);
 	~IconCanvas();
 	void rescan(void);
+	void add_files(struct file_info **fi, int nb);
+	void show_files(void);
+	void update_file(const char *name);
+	int find_file(const char *name);
+	void insert_file(struct file_info *fi, int sel);
+	void remove_file(int i);
+	static void scan_cb(int fd, void *d);
+	Fl_Image *thumb(int i);
+	static void thumb_cb(int fd, void *d);
 	static void mover(void*);
 	void draw_selector(int, int);
 	int handle(int);
 	void resize(int, int, int, int);
 	void update_status(void);
+	void fit_position(void);
 	void draw(void);
 };
 
@@ -38,30 +38,296 @@
  ******************************************************************************/
 
 
+
 #include "IconCanvas.h"
 #include "IconGroup.h"
 #include "BigIcon.h"
 #include "SmallIcon.h"
+#include "Thumbnailer.h"
 #include "callbacks.h"
 #include <FL/fl_draw.H>
+#include <stdlib.h>
+#include <string.h>
 
 #define _(String) gettext((String))
 
+static int floor_div(int a, int b)
+{
+	if (a >= 0) return a / b;
+	return -((-a + b - 1) / b);
+}
+
+/*
+ *  Copies name in buf, shortened with "..." when it is wider than w.
+ */
+static const char *fit_label(const char *name, int w, char *buf, int len)
+{
+	int n;
+
+	if (fl_width(name) <= w) return name;
+	n = strlen(name);
+	if (n > len - 4) n = len - 4;
+	while (n > 0) {
+		n--;
+		while (n > 0 && (name[n] & 0xC0) == 0x80) n--;
+		memcpy(buf, name, n);
+		strcpy(buf + n, "...");
+		if (fl_width(buf) <= w) break;
+	}
+	return buf;
+}
 
 IconGroup::IconGroup(int X, int Y, int W, int H, IconCanvas *C) : 
-	Fl_Group(X, Y, W, H)
+	Fl_Widget(X, Y, W, H)
 {
 	canvas = C;
+	nb_entries = canvas->nbf;
+	entries = (struct icon_entry*) calloc(nb_entries + 1, 
+		sizeof(struct icon_entry));
+	nb_selected = 0;
+	sel_size = 0;
+	current = -1;
+	hover = -1;
+	cols = 1;
+	rows = 0;
+	ox = oy = 0;
+	cw = ch = bw = bh = 1;
+	band = 0;
+	br0 = br1 = bc0 = bc1 = 0;
 	draw_sel = 0;
 	sw = sh = sx = sy = 0;
 	lx = X;
 	ly = Y;
 	px = py = ph = pw = 0;
 	box(FL_FLAT_BOX);
+	selection_color(137);
 }
 
 IconGroup::~IconGroup()
 {
+	if (BigIcon::drag_widget == this) BigIcon::drag_widget = NULL;
+	free(entries);
+}
+
+const char *IconGroup::name(int i)
+{
+	return canvas->info[i]->real_name;
+}
+
+void IconGroup::file_type(int i, Fl_Pixmap **pix, Fl_Menu_Item **m,
+	Fl_Callback **cb)
+{
+	BigIcon::file_type(canvas->info[i], pix, m, cb);
+}
+
+/*
+ *  Puts as many cells as possible on a row of the canvas.
+ */
+void IconGroup::layout()
+{
+	int W = canvas->w() - 16;
+	int H = canvas->h() - 16;
+	int ww, hh;
+
+	cols = (W - ox) / cw;
+	if (cols < 1) cols = 1;
+	rows = (nb_entries + cols - 1) / cols;
+	ww = ox + cols * cw;
+	hh = oy + rows * ch + 80;
+	if (ww < W) ww = W;
+	if (hh < H) hh = H;
+	size(ww, hh);
+}
+
+/*
+ *  Finds the rows and columns of the cells touching the rectangle from 
+ *  x0, y0 to x1, y1 (relative to the widget). The range is empty when 
+ *  r0 > r1 or c0 > c1.
+ */
+void IconGroup::cell_range(int x0, int y0, int x1, int y1, 
+	int *r0, int *r1, int *c0, int *c1)
+{
+	*c0 = floor_div(x0 - ox - bw, cw) + 1;
+	*c1 = floor_div(x1 - ox - 1, cw);
+	*r0 = floor_div(y0 - oy - bh, ch) + 1;
+	*r1 = floor_div(y1 - oy - 1, ch);
+	if (*c0 < 0) *c0 = 0;
+	if (*c1 > cols - 1) *c1 = cols - 1;
+	if (*r0 < 0) *r0 = 0;
+	if (*r1 > rows - 1) *r1 = rows - 1;
+}
+
+/*
+ *  Returns the file under the window position ex, ey or -1.
+ */
+int IconGroup::entry_at(int ex, int ey)
+{
+	int rx = ex - x() - ox;
+	int ry = ey - y() - oy;
+	int r, c, i;
+
+	if (rx < 0 || ry < 0) return -1;
+	c = rx / cw;
+	r = ry / ch;
+	if (c >= cols || rx - c * cw >= bw || ry - r * ch >= bh) return -1;
+	i = r * cols + c;
+	if (i >= nb_entries) return -1;
+	return i;
+}
+
+void IconGroup::select(int i, int v)
+{
+	if (entries[i].selected == v) return;
+	entries[i].selected = v;
+	if (v) {
+		nb_selected++;
+		sel_size += canvas->info[i]->st.st_size;
+	} else {
+		nb_selected--;
+		sel_size -= canvas->info[i]->st.st_size;
+	}
+}
+
+void IconGroup::select_none()
+{
+	int i;
+
+	if (!nb_selected) return;
+	for (i = 0; i < nb_entries; i++) entries[i].selected = 0;
+	nb_selected = 0;
+	sel_size = 0;
+	redraw();
+}
+
+/*
+ *  Makes room for the file the canvas has put at info[i].
+ */
+void IconGroup::insert_entry(int i, int sel)
+{
+	entries = (struct icon_entry*) realloc(entries, 
+		(nb_entries + 2) * sizeof(struct icon_entry));
+	memmove(entries + i + 1, entries + i, 
+		(nb_entries - i) * sizeof(struct icon_entry));
+	entries[i].pix = NULL;
+	entries[i].selected = 0;
+	nb_entries++;
+	if (current >= i) current++;
+	if (hover >= i) hover++;
+	band = 0;
+	if (sel) select(i, 1);
+	layout();
+	redraw();
+}
+
+/*
+ *  Forgets the file at info[i], called before the canvas removes it.
+ */
+void IconGroup::remove_entry(int i)
+{
+	select(i, 0);
+	memmove(entries + i, entries + i + 1, 
+		(nb_entries - i - 1) * sizeof(struct icon_entry));
+	nb_entries--;
+	if (current == i) {
+		current = -1;
+	} else if (current > i) {
+		current--;
+	}
+	if (hover == i) {
+		hover = -1;
+	} else if (hover > i) {
+		hover--;
+	}
+	band = 0;
+	layout();
+	redraw();
+}
+
+/*
+ *  Selects the files touching the rubber band x, y, w, h (in window 
+ *  coordinates) and only them. While the band is moved, only the cells 
+ *  of the last band and of the new one are visited. Returns 1 if the 
+ *  selection has changed.
+ */
+int IconGroup::select_rect(int X, int Y, int W, int H)
+{
+	int r0, r1, c0, c1, r, c, i;
+	int nb = nb_selected;
+	unsigned long ss = sel_size;
+
+	cell_range(X - x(), Y - y(), X + W - x(), Y + H - y(), 
+		&r0, &r1, &c0, &c1);
+	if (!band) {
+		select_none();
+		band = 1;
+	} else {
+		for (r = br0; r <= br1; r++) {
+			for (c = bc0; c <= bc1; c++) {
+				i = r * cols + c;
+				if (i >= nb_entries) break;
+				if (r < r0 || r > r1 || c < c0 || c > c1) {
+					select(i, 0);
+				}
+			}
+		}
+	}
+	for (r = r0; r <= r1; r++) {
+		for (c = c0; c <= c1; c++) {
+			i = r * cols + c;
+			if (i >= nb_entries) break;
+			select(i, 1);
+		}
+	}
+	br0 = r0;
+	br1 = r1;
+	bc0 = c0;
+	bc1 = c1;
+	if (nb == nb_selected && ss == sel_size) return 0;
+	redraw();
+	return 1;
+}
+
+/*
+ *  The file the menu and command callbacks work on : the one clicked 
+ *  last if it is still selected, else the first selected one.
+ */
+int IconGroup::selection()
+{
+	int i;
+
+	if (current >= 0 && current < nb_entries && 
+		entries[current].selected) 
+	{
+		return current;
+	}
+	if (!nb_selected) return -1;
+	for (i = 0; i < nb_entries; i++) {
+		if (entries[i].selected) return i;
+	}
+	return -1;
+}
+
+/*
+ *  True while the dragged files are over one of themselves.
+ */
+int IconGroup::over_selection()
+{
+	return hover >= 0 && hover < nb_entries && entries[hover].selected;
+}
+
+/*
+ *  The folder under the mouse for a drop, "" for the canvas directory.
+ */
+const char *IconGroup::drop_dir()
+{
+	Fl_Pixmap *pix;
+	Fl_Menu_Item *m;
+	Fl_Callback *cb;
+
+	if (hover < 0 || hover >= nb_entries) return "";
+	file_type(hover, &pix, &m, &cb);
+	if (cb != cb_change_dir) return "";
+	return name(hover);
 }
 
 void IconGroup::show_selector(int x, int y, int w, int h)
@@ -93,68 +359,186 @@ void IconGroup::overlay_rect()
 
 void IconGroup::draw()
 {
+	int X, Y, W, H;
+	int r0, r1, c0, c1, r, c, i;
+
 	if (draw_sel && pw) {
 		overlay_rect(); 
 		pw = 0;
 	}
+	if (damage() == FL_DAMAGE_USER1) {
+		/* only the rubber band has moved */
+		px = sx; py = sy; pw = sw; ph = sh;
+		if (draw_sel && pw) overlay_rect();
+		return;
+	}
 	lx = x();
 	ly = y();
-	Fl_Group::draw();
+	fl_clip_box(x(), y(), w(), h(), X, Y, W, H);
+	fl_color(color());
+	fl_rectf(X, Y, W, H);
+	fl_font(gui->font, gui->size);
+	cell_range(X - x(), Y - y(), X + W - x(), Y + H - y(), 
+		&r0, &r1, &c0, &c1);
+	for (r = r0; r <= r1; r++) {
+		for (c = c0; c <= c1; c++) {
+			i = r * cols + c;
+			if (i >= nb_entries) break;
+			draw_entry(i, x() + ox + c * cw, y() + oy + r * ch);
+		}
+	}
 	if (draw_sel) {
 		px = sx; py = sy; pw = sw; ph = sh;
 		if (pw) overlay_rect();
 	}
 }
 
+void IconGroup::draw_entry(int i, int X, int Y)
+{
+}
+
 int IconGroup::handle(int e)
 {
-	return Fl_Group::handle(e);
+	static int push_x, push_y;
+	static int dragging = 0;
+	static char *buffer = NULL;
+	Fl_Menu_Item *m;
+	Fl_Callback *cb;
+	Fl_Pixmap *pix;
+	int i;
+
+	switch(e) {
+	case FL_PUSH:
+		i = entry_at(Fl::event_x(), Fl::event_y());
+		if (i < 0) {
+			canvas->update_status();
+			return 0;
+		}
+		if (Fl::event_state() & (FL_BUTTON1 | FL_BUTTON3) &&
+			!(Fl::get_key(FL_Control_L) || 
+				Fl::get_key(FL_Control_R))) 
+		{
+			select_none();
+		}
+		select(i, 1);
+		current = i;
+		canvas->update_status();
+		redraw();
+		if (Fl::event_state() & FL_BUTTON3) {
+			const Fl_Menu_Item *p;
+			Fl::event_clicks(0);
+			file_type(i, &pix, &m, &cb);
+			p = m->popup(Fl::event_x(), Fl::event_y());
+			if (p) p->do_callback(this);
+			return 1;
+		} else if (Fl::event_state() & FL_BUTTON1 && 
+			Fl::event_clicks() > 0) 
+		{
+			Fl::event_clicks(0);
+			Fl::flush();
+			file_type(i, &pix, &m, &cb);
+			if (cb) cb(this, NULL);
+			return 1;
+		}
+		push_x = Fl::event_x_root();
+		push_y = Fl::event_y_root();
+		return 1;
+	case FL_ENTER:
+	case FL_MOVE:
+		hover = entry_at(Fl::event_x(), Fl::event_y());
+		return 1;
+	case FL_LEAVE:
+		hover = -1;
+		return 1;
+	case FL_DRAG:
+		if (push_x - 5 < Fl::event_x_root() &&
+			push_x + 5 > Fl::event_x_root() &&
+			push_y - 5 < Fl::event_y_root() &&
+			push_y + 5 > Fl::event_y_root())
+		{
+			return current >= 0 && entries[current].selected;
+		}
+		push_x = -10;
+		if (current >= 0 && entries[current].selected && !dragging) {
+			if (!BigIcon::drag_window) {
+				Fl_Group *g = Fl_Group::current();
+				Fl_Group::current(NULL);
+				BigIcon::create_drag_window();
+				Fl_Group::current(g);
+			}
+			dragging = 1;
+			BigIcon::drag_window->position(Fl::event_x_root() + 2,
+				Fl::event_y_root() + 2);
+			BigIcon::drag_window->show();
+			free(buffer);
+			buffer = get_selected_urls();
+			Fl::copy(buffer, strlen(buffer), 0);
+			if (Fl::event_state() & FL_BUTTON1) {
+				fl_XdndActionCopy = XdndActionCopy;
+			} else {
+				fl_XdndActionCopy = XdndActionAsk;
+			}
+			BigIcon::drag_widget = this;
+			Fl::dnd();
+			BigIcon::drag_widget = NULL;
+			fl_XdndActionCopy = XdndActionCopy;
+			BigIcon::drag_window->handle(FL_HIDE);
+			XUnmapWindow(fl_display, BigIcon::drag_window->win);
+			select_none();
+			canvas->update_status();
+			dragging = 0;
+			return 1;
+		}
+		return 0;
+	case FL_RELEASE:
+		return 1;
+	case FL_DND_LEAVE:
+		return 1;
+	case 0:
+		if (!(Fl::event_state() & (FL_BUTTON1|FL_BUTTON2|FL_BUTTON3))) {
+			return 0;
+		}
+		if (!dragging) return 0;
+		BigIcon::drag_window->position(Fl::event_x_root() + 2,
+				Fl::event_y_root() + 2);
+		if (fl_xevent->type == ClientMessage) {
+			XClientMessageEvent message = fl_xevent->xclient;
+			if (message.message_type == fl_XdndStatus) {
+				if (!(message.data.l[1] & 0x1) ||
+					message.data.l[4] == 0) 
+				{
+					/* client reject drop */
+					Fl::first_window()->
+						cursor((Fl_Cursor)21);	
+					return 1;	
+				}
+				if (fl_XdndActionCopy == XdndActionAsk) {
+					Fl::first_window()->
+						cursor((Fl_Cursor)47);
+				} else {
+					Fl::first_window()->
+						cursor((Fl_Cursor)18);
+				}
+			}
+		}
+		return 0;
+	default:
+		break;
+	}
+	return Fl_Widget::handle(e);
 }
 
 NormalGroup::NormalGroup(int X, int Y, int W, int H, IconCanvas *C) : 
 	IconGroup(X, Y, W, H, C)
 {
-	int i;
-	BigIcon *b;
-	int xx = x() + 15;
-	int yy = y() + 15;
-	int mx;
-	int ww, hh;
-	int lineh = 0;
-	
-	mx = w() + x() - 30;
-
-	i = 0;
-	begin();	
-	while (i < canvas->nbf) {
-		b = new BigIcon(xx, yy, 32, 32);
-		b->labelfont(gui->font);
-		b->labelsize(gui->size);
-		b->set_data(canvas->info[i]);
-		if (b->height > lineh) lineh = b->height;
-		if (xx + b->width > mx) {
-			yy += lineh + 15;
-			lineh = 0;
-			xx = x() + 15;
-			b->resize(xx, yy, b->w(), b->h());
-			xx += b->width + 15;
-		} else {
-			xx += b->width + 15;
-		}
-		i++;
-	}
-	yy += lineh + 15;
-	end();	
-	resizable(NULL);
-	ww = w();
-	hh = yy - y() + 80;
-	if (ww < parent()->w() - 16) {
-		ww = parent()->w() - 16;
-	} 
-	if (hh < parent()->h() - 16) {
-		hh = parent()->h() - 16;
-	}
-	resize(x(), y(), ww, hh);
+	bw = gui->size * 6;
+	if (bw < 48) bw = 48;
+	bh = gui->size + 8 + 32;
+	ox = 15;
+	oy = 15;
+	cw = bw + 15;
+	ch = bh + 15;
+	layout();
 	redraw();
 }
 
@@ -162,34 +546,53 @@ NormalGroup::~NormalGroup()
 {
 }
 
+/*
+ *  The icon with the name under it, cut to the width of the cell.
+ */
+void NormalGroup::draw_entry(int i, int X, int Y)
+{
+	struct icon_entry *e = entries + i;
+	Fl_Image *t = NULL;
+	char buf[256];
+
+	if (!e->pix) {
+		Fl_Menu_Item *m;
+		Fl_Callback *cb;
+		file_type(i, &e->pix, &m, &cb);
+	}
+	if (S_ISREG(canvas->info[i]->st.st_mode) && 
+		Thumbnailer::handles(name(i)))
+	{
+		t = canvas->thumb(i);
+	}
+	if (e->selected) {
+		fl_color(selection_color());
+		fl_rectf(X + (bw / 2) - 16, Y, 32, 32);
+	}
+	if (t) {
+		t->draw(X + (bw - t->w()) / 2, Y + (32 - t->h()) / 2);
+	} else {
+		e->pix->draw(X + (bw / 2) - 16, Y);
+	}
+	fl_color(labelcolor());
+	fl_draw(fit_label(name(i), bw, buf, 256), X, Y + 32, bw, bh - 32,
+		FL_ALIGN_CENTER, (Fl_Image*) 0, 0);
+}
+
 DetailGroup::DetailGroup(int X, int Y, int W, int H, IconCanvas *C) : 
 	IconGroup(X, Y, W, H, C)
 {
-	int i;
-	SmallIcon *b;
-	int xx = x() + 5;
-	int yy = y() + 30;
 	int lineh = gui->size + 4;
-	int mw;
 
 	fl_font(gui->font, gui->size);
-	mw  = (int) fl_width("W") * 150;
-
 	if (lineh < 18) lineh = 18;
-
-	i = 0;
-	begin();	
-	while (i < canvas->nbf) {
-		b = new SmallIcon(xx, yy, mw, lineh);
-		b->labelfont(gui->font);
-		b->labelsize(gui->size);
-		b->set_data(canvas->info[i]);
-		yy += lineh + 4;
-		i++;
-	}
-	end();	
-	resizable(NULL);
-	resize(x(), y(), mw + 50, yy + 20);
+	bw = (int) fl_width("W") * 150;
+	bh = lineh;
+	ox = 5;
+	oy = 30;
+	cw = bw;
+	ch = lineh + 4;
+	layout();
 	redraw();
 }
 
@@ -197,4 +600,55 @@ DetailGroup::~DetailGroup()
 {
 }
 
+void DetailGroup::layout()
+{
+	int W = canvas->w() - 16;
+	int H = canvas->h() - 16;
+	int ww, hh;
+
+	cols = 1;
+	rows = nb_entries;
+	ww = ox + bw + 45;
+	hh = oy + rows * ch + 20;
+	if (ww < W) ww = W;
+	if (hh < H) hh = H;
+	size(ww, hh);
+}
+
+void DetailGroup::file_type(int i, Fl_Pixmap **pix, Fl_Menu_Item **m,
+	Fl_Callback **cb)
+{
+	SmallIcon::file_type(canvas->info[i], pix, m, cb);
+}
+
+/*
+ *  A line with the small icon, the name and the details of the file.
+ */
+void DetailGroup::draw_entry(int i, int X, int Y)
+{
+	struct icon_entry *e = entries + i;
+	Fl_Color col = labelcolor();
+	const char *n = name(i);
+	char info[256];
+	int offset;
+
+	if (!e->pix) {
+		Fl_Menu_Item *m;
+		Fl_Callback *cb;
+		file_type(i, &e->pix, &m, &cb);
+	}
+	if (e->selected) {
+		fl_color(selection_color());
+		fl_rectf(X + 20, Y, bw - 20, bh);
+		col = fl_contrast(col, selection_color());
+	}
+	fl_color(col);
+	fl_draw(n, X + 23, Y, bw - 26, bh, FL_ALIGN_LEFT, (Fl_Image*) 0, 0);
+	offset = (int) fl_width(n) + 30;
+	if (offset < 200) offset = 200;
+	SmallIcon::file_details(canvas->info[i], info, 256);
+	fl_draw(info, strlen(info), X + 20 + offset, 
+		Y + fl_height() - fl_descent() + 1);
+	e->pix->draw(X, Y + 1);
+}
 
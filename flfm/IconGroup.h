@@ -38,24 +38,71 @@
  ******************************************************************************/
 
 
+
 #ifndef IconGroup_h
 #define IconGroup_h
 
+#include <FL/Fl_Widget.H>
+#include <FL/Fl_Pixmap.H>
+#include <FL/Fl_Menu_Item.H>
 
 class IconCanvas;
+struct file_info;
+
+/*
+ *  What the view keeps for each file of IconCanvas::info, the pixmap is 
+ *  looked up the first time the file is drawn.
+ */
+struct icon_entry {
+	Fl_Pixmap *pix;
+	char selected;
+};
 
-class IconGroup : public Fl_Group {
+/*
+ *  Shows the files of the canvas in a grid of cells of the same size, 
+ *  only the cells inside the clip region are drawn. Cell c of row r is 
+ *  at ox + c * cw, oy + r * ch and is bw x bh.
+ */
+class IconGroup : public Fl_Widget {
 public:
 	IconCanvas *canvas;
+	struct icon_entry *entries;
+	int nb_entries;
+	int nb_selected;
+	unsigned long sel_size;
+	int current;
+	int hover;
+	int cols, rows;
+	int ox, oy;
+	int cw, ch;
+	int bw, bh;
+	int band;
+	int br0, br1, bc0, bc1;
 	int sx, sy, sw, sh;
 	int lx, ly;
 	int px, py , pw, ph;
 	int draw_sel;
 
 	IconGroup(int X, int Y, int W, int H, IconCanvas *C);
-	~IconGroup();
+	virtual ~IconGroup();
 	int handle(int e);
 	void draw(void);
+	virtual void layout(void);
+	virtual void draw_entry(int i, int X, int Y);
+	virtual void file_type(int i, Fl_Pixmap **pix, Fl_Menu_Item **m,
+		Fl_Callback **cb);
+	const char *name(int i);
+	int entry_at(int ex, int ey);
+	void cell_range(int x0, int y0, int x1, int y1, 
+		int *r0, int *r1, int *c0, int *c1);
+	void select(int i, int v);
+	void select_none(void);
+	void insert_entry(int i, int sel);
+	void remove_entry(int i);
+	int select_rect(int x, int y, int w, int h);
+	int selection(void);
+	int over_selection(void);
+	const char *drop_dir(void);
 	void show_selector(int x, int y, int w, int h);
 	void hide_selector(void);
 	void overlay_rect(void);
@@ -66,12 +113,18 @@ class NormalGroup : public IconGroup {
 public:
 	NormalGroup(int X, int Y, int W, int H, IconCanvas *C);
 	~NormalGroup();
+	void draw_entry(int i, int X, int Y);
 };
 
 class DetailGroup : public IconGroup {
 public:
 	DetailGroup(int X, int Y, int W, int H, IconCanvas *C);
 	~DetailGroup();
+	void layout(void);
+	void draw_entry(int i, int X, int Y);
+	void file_type(int i, Fl_Pixmap **pix, Fl_Menu_Item **m,
+		Fl_Callback **cb);
 };
 
 #endif
+
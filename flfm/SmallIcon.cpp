@@ -103,16 +103,13 @@ static void create_pixmaps()
 }
 
 
-void SmallIcon::set_data(struct file_info *fi)
+/*
+ *  Same as BigIcon::file_type() with the small pixmaps.
+ */
+void SmallIcon::file_type(struct file_info *fi, Fl_Pixmap **pix, 
+	Fl_Menu_Item **m, Fl_Callback **cb)
 {
 	struct stat st;
-	char perm[] = "----------";
-	struct passwd *pwp;
-	struct group *grp;
-	char *ptr;
-
-	real_name = fi->real_name;
-	label(fi->real_name);	
 
 	if (!p_link) {
 		create_pixmaps();
@@ -120,69 +117,70 @@ void SmallIcon::set_data(struct file_info *fi)
 	if (!m_exec) {
 		create_menus();
 	}
-	if (!drag_window) {
-		window()->begin();
-		create_drag_window();
-		((Fl_Group*)parent())->begin();
-	}
 
+	*cb = NULL;
 	switch(fi->st.st_mode & S_IFMT) {
 	case S_IFSOCK:
-		menu(m_special);
-		pix = p_socket; break;
+		*m = m_special;
+		*pix = p_socket; break;
 	case S_IFLNK:
-		if (!stat(real_name, &st)) {
+		*m = m_special;
+		if (!stat(fi->real_name, &st)) {
 			switch(st.st_mode & S_IFMT) {
 			case S_IFREG:
 				if (st.st_mode & S_IXUSR) {
-					menu(m_exec);
-					callback(cb_exec);
+					*m = m_exec;
+					*cb = cb_exec;
 				} else {
-					menu(m_unknown);
-					callback(cb_open);
+					*m = m_unknown;
+					*cb = cb_open;
 				}
 				break;
 			case S_IFDIR:
-				callback(cb_change_dir);
-				menu(m_folder); break;
-			default:
-				menu(m_special);
+				*cb = cb_change_dir;
+				*m = m_folder; break;
 			}
-		} else {
-			menu(m_special);
 		}
-		pix = p_link; break;
+		*pix = p_link; break;
 	case S_IFREG:
 		if (fi->st.st_mode & S_IXUSR) {
-			menu(m_exec);
-			pix = p_exec; 
-			callback(cb_exec);
+			*m = m_exec;
+			*pix = p_exec; 
+			*cb = cb_exec;
 		} else {
-			menu(m_unknown);
-			pix = p_unknown;		
-			callback(cb_open);
+			*m = m_unknown;
+			*pix = p_unknown;		
+			*cb = cb_open;
 		}
 		break;
 	case S_IFBLK:
-		menu(m_special);
-		pix = p_block; break;
+		*m = m_special;
+		*pix = p_block; break;
 	case S_IFDIR:
-		menu(m_folder);
-		callback(cb_change_dir);
-		pix = p_folder; break;
+		*m = m_folder;
+		*cb = cb_change_dir;
+		*pix = p_folder; break;
 	case S_IFCHR:
-		menu(m_special);
-		pix = p_character; break;
+		*m = m_special;
+		*pix = p_character; break;
 	case S_IFIFO:
-		menu(m_special);
-		pix = p_pipe; break;
+		*m = m_special;
+		*pix = p_pipe; break;
 	default:
-		menu(m_special);
-		pix = p_unknown;		
+		*m = m_special;
+		*pix = p_unknown;		
 	}
+}
 
-	offset = (int) fl_width(real_name) + 30;
-	if (offset < 200) offset = 200;
+/*
+ *  Writes the permissions, owner, date and size of a file in buf.
+ */
+void SmallIcon::file_details(struct file_info *fi, char *buf, int len)
+{
+	char perm[] = "----------";
+	struct passwd *pwp;
+	struct group *grp;
+	char *ptr;
 
                 if (fi->st.st_mode & S_IRUSR) perm[1] = 'r';
                 if (fi->st.st_mode & S_IWUSR) perm[2] = 'w';
@@ -237,10 +235,34 @@ void SmallIcon::set_data(struct file_info *fi)
 	grp = getgrgid(fi->st.st_gid);
 	ptr = ctime(&fi->st.st_ctime);
 	if (ptr) *(ptr + strlen(ptr) - 1) = '\0';
-	snprintf(info, 256, _("%s    %s / %s  (%s)  %ld bytes"),
+	snprintf(buf, len, _("%s    %s / %s  (%s)  %ld bytes"),
 			perm, pwp ? pwp->pw_name : "?", 
 			grp ? grp->gr_name : "?", 
 			ptr ? ptr : "?", fi->st.st_size);
+}
+
+void SmallIcon::set_data(struct file_info *fi)
+{
+	Fl_Menu_Item *m;
+	Fl_Callback *cb;
+
+	real_name = fi->real_name;
+	label(fi->real_name);	
+
+	if (!drag_window) {
+		window()->begin();
+		create_drag_window();
+		((Fl_Group*)parent())->begin();
+	}
+
+	file_type(fi, &pix, &m, &cb);
+	menu(m);
+	if (cb) callback(cb);
+
+	offset = (int) fl_width(real_name) + 30;
+	if (offset < 200) offset = 200;
+
+	file_details(fi, info, 256);
 	info_len = strlen(info);
 }
 
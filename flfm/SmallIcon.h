@@ -55,6 +55,9 @@ public:
 	SmallIcon(int X, int Y, int W, int H);
 	~SmallIcon();
 	void set_data(struct file_info *fi);
+	static void file_type(struct file_info *fi, Fl_Pixmap **pix, 
+		Fl_Menu_Item **m, Fl_Callback **cb);
+	static void file_details(struct file_info *fi, char *buf, int len);
 	virtual void draw(void);
 	virtual int is_inside(void);
 };
@@ -0,0 +1,1195 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+
+#include "Thumbnailer.h"
+#include "xd640/Xd6ImageScale.h"
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <setjmp.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <time.h>
+
+extern "C"
+{
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+#  include <zlib.h>
+#  ifdef HAVE_PNG_H
+#    include <png.h>
+#  else
+#    include <libpng/png.h>
+#  endif // HAVE_PNG_H
+#endif // HAVE_LIBPNG ** HAVE_LIBZ
+#ifdef HAVE_LIBJPEG
+#  include <jpeglib.h>
+#endif // HAVE_LIBJPEG
+}
+
+#define THUMB_TABLE 1024
+#define THUMB_PIXELS (64L * 1024 * 1024)
+
+static unsigned int md5_k[64];
+static const int md5_r[64] = {
+	7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+	5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+	4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+	6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void md5_block(unsigned int *h, const unsigned char *b)
+{
+	unsigned int w[16];
+	unsigned int a = h[0], x = h[1], c = h[2], d = h[3];
+	unsigned int f, t;
+	int i, g;
+
+	for (i = 0; i < 16; i++) {
+		w[i] = b[i * 4] | (b[i * 4 + 1] << 8) | (b[i * 4 + 2] << 16) |
+			((unsigned int) b[i * 4 + 3] << 24);
+	}
+	for (i = 0; i < 64; i++) {
+		if (i < 16) {
+			f = (x & c) | (~x & d);
+			g = i;
+		} else if (i < 32) {
+			f = (d & x) | (~d & c);
+			g = (5 * i + 1) & 15;
+		} else if (i < 48) {
+			f = x ^ c ^ d;
+			g = (3 * i + 5) & 15;
+		} else {
+			f = c ^ (x | ~d);
+			g = (7 * i) & 15;
+		}
+		t = d;
+		d = c;
+		c = x;
+		f += a + md5_k[i] + w[g];
+		x += (f << md5_r[i]) | (f >> (32 - md5_r[i]));
+		a = t;
+	}
+	h[0] += a;
+	h[1] += x;
+	h[2] += c;
+	h[3] += d;
+}
+
+/*
+ *  Writes the MD5 of s in hexadecimal to out (33 bytes).
+ */
+static void md5_hex(const char *s, char *out)
+{
+	unsigned int h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+	unsigned char b[64];
+	unsigned long long bits;
+	long len = strlen(s);
+	long i, n;
+
+	for (i = 0; i + 64 <= len; i += 64) {
+		md5_block(h, (const unsigned char*) s + i);
+	}
+	n = len - i;
+	memcpy(b, s + i, n);
+	b[n++] = 0x80;
+	if (n > 56) {
+		memset(b + n, 0, 64 - n);
+		md5_block(h, b);
+		n = 0;
+	}
+	memset(b + n, 0, 56 - n);
+	bits = (unsigned long long) len * 8;
+	for (i = 0; i < 8; i++) b[56 + i] = (unsigned char) (bits >> (8 * i));
+	md5_block(h, b);
+	for (i = 0; i < 16; i++) {
+		sprintf(out + i * 2, "%02x", (h[i / 4] >> (8 * (i % 4))) & 255);
+	}
+}
+
+/*
+ *  The file:// URI of path, escaped as the other freedesktop programs
+ *  do it so they find the same thumbnails.
+ */
+static char *file_uri(const char *path)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	const unsigned char *p;
+	char *uri, *o;
+
+	uri = (char*) malloc(strlen(path) * 3 + 8);
+	strcpy(uri, "file://");
+	o = uri + 7;
+	for (p = (const unsigned char*) path; *p; p++) {
+		if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+			(*p >= '0' && *p <= '9') || 
+			strchr("-._~!$&'()*+,;=:@/", *p))
+		{
+			*o++ = *p;
+		} else {
+			*o++ = '%';
+			*o++ = hex[*p >> 4];
+			*o++ = hex[*p & 15];
+		}
+	}
+	*o = '\0';
+	return uri;
+}
+
+static void fit(int w, int h, int max, int *fw, int *fh)
+{
+	if (w <= max && h <= max) {
+		*fw = w;
+		*fh = h;
+	} else if (w >= h) {
+		*fw = max;
+		*fh = (int) (((long) h * max + w / 2) / w);
+	} else {
+		*fh = max;
+		*fw = (int) (((long) w * max + h / 2) / h);
+	}
+	if (*fw < 1) *fw = 1;
+	if (*fh < 1) *fh = 1;
+}
+
+/*
+ *  Scales the pixels down to fit in max x max, p is freed if a new 
+ *  array is returned.
+ */
+static unsigned char *shrink(unsigned char *p, int *w, int *h, int d, 
+	int max)
+{
+	unsigned char *n;
+	int fw, fh;
+
+	fit(*w, *h, max, &fw, &fh);
+	if (fw == *w && fh == *h) return p;
+	n = new unsigned char[fw * fh * d];
+	Xd6ScalePixels(p, *w, *h, *w * d, n, fw, fh, d);
+	delete[] p;
+	*w = fw;
+	*h = fh;
+	return n;
+}
+
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+/*
+ *  Stale thumbnails and broken images are expected, keep libpng quiet.
+ */
+static void png_quiet_error(png_structp png, png_const_charp msg)
+{
+	longjmp(png_jmpbuf(png), 1);
+}
+
+static void png_quiet_warning(png_structp png, png_const_charp msg)
+{
+}
+
+/*
+ *  Reads a PNG file. With check, it must be the thumbnail of the file 
+ *  of the job : its Thumb::MTime and Thumb::Size must match.
+ */
+static unsigned char *read_png(const char *file, int *w, int *h, int *d,
+	ThumbJob *check)
+{
+	FILE *fp;
+	png_structp png;
+	png_infop info;
+	png_textp text;
+	unsigned char * volatile pixels = NULL;
+	png_bytep * volatile rows = NULL;
+	int nb_text = 0;
+	int i, y, ok;
+
+	fp = fopen(file, "rb");
+	if (!fp) return NULL;
+	png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,
+		png_quiet_error, png_quiet_warning);
+	info = png ? png_create_info_struct(png) : NULL;
+	if (!info || setjmp(png_jmpbuf(png))) {
+		png_destroy_read_struct(&png, &info, NULL);
+		delete[] pixels;
+		free(rows);
+		fclose(fp);
+		return NULL;
+	}
+	png_init_io(png, fp);
+	png_read_info(png, info);
+	if (check) {
+		ok = 0;
+		png_get_text(png, info, &text, &nb_text);
+		for (i = 0; i < nb_text; i++) {
+			if (!strcmp(text[i].key, "Thumb::MTime")) {
+				if (strtol(text[i].text, NULL, 10) != 
+					(long) check->mtime) 
+				{
+					ok = -1;
+					break;
+				}
+				ok = 1;
+			} else if (!strcmp(text[i].key, "Thumb::Size")) {
+				if (strtoll(text[i].text, NULL, 10) != 
+					(long long) check->size)
+				{
+					ok = -1;
+					break;
+				}
+			}
+		}
+		if (ok != 1) png_error(png, "stale thumbnail");
+	}
+	png_set_expand(png);
+	png_set_strip_16(png);
+	png_set_packing(png);
+	png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+	*w = png_get_image_width(png, info);
+	*h = png_get_image_height(png, info);
+	*d = png_get_channels(png, info);
+	if (*w < 1 || *h < 1 || (long) *w * *h > THUMB_PIXELS) {
+		png_error(png, "bad size");
+	}
+	pixels = new unsigned char[*w * *h * *d];
+	rows = (png_bytep*) malloc(sizeof(png_bytep) * *h);
+	for (y = 0; y < *h; y++) rows[y] = pixels + y * *w * *d;
+	png_read_image(png, rows);
+	png_read_end(png, NULL);
+	png_destroy_read_struct(&png, &info, NULL);
+	free(rows);
+	fclose(fp);
+	return pixels;
+}
+
+/*
+ *  Writes a thumbnail of the file of the job, under a temporary name 
+ *  first so the other programs never see a partial file. Returns its 
+ *  size, 0 on failure.
+ */
+static long write_png(const char *file, unsigned char *p, int w, int h, 
+	int d, const char *uri, ThumbJob *j)
+{
+	FILE *fp;
+	png_structp png;
+	png_infop info;
+	png_text txt[4];
+	png_bytep * volatile rows = NULL;
+	char mtime[32], size[32];
+	char *tmp;
+	struct stat st;
+	int fd, y, type;
+
+	tmp = (char*) malloc(strlen(file) + 8);
+	sprintf(tmp, "%s.XXXXXX", file);
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		free(tmp);
+		return 0;
+	}
+	fp = fdopen(fd, "wb");
+	png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL,
+		png_quiet_error, png_quiet_warning);
+	info = png ? png_create_info_struct(png) : NULL;
+	if (!fp || !info || setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		if (fp) fclose(fp); else close(fd);
+		unlink(tmp);
+		free(tmp);
+		free(rows);
+		return 0;
+	}
+	png_init_io(png, fp);
+	switch (d) {
+	case 1: type = PNG_COLOR_TYPE_GRAY; break;
+	case 2: type = PNG_COLOR_TYPE_GRAY_ALPHA; break;
+	case 3: type = PNG_COLOR_TYPE_RGB; break;
+	default: type = PNG_COLOR_TYPE_RGB_ALPHA;
+	}
+	png_set_IHDR(png, info, w, h, 8, type, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	snprintf(mtime, 32, "%ld", (long) j->mtime);
+	snprintf(size, 32, "%lld", (long long) j->size);
+	memset(txt, 0, sizeof(txt));
+	txt[0].key = (png_charp) "Thumb::URI";
+	txt[0].text = (png_charp) uri;
+	txt[1].key = (png_charp) "Thumb::MTime";
+	txt[1].text = mtime;
+	txt[2].key = (png_charp) "Thumb::Size";
+	txt[2].text = size;
+	txt[3].key = (png_charp) "Software";
+	txt[3].text = (png_charp) "flfm";
+	for (y = 0; y < 4; y++) {
+		txt[y].compression = PNG_TEXT_COMPRESSION_NONE;
+		txt[y].text_length = strlen(txt[y].text);
+	}
+	png_set_text(png, info, txt, 4);
+	png_write_info(png, info);
+	rows = (png_bytep*) malloc(sizeof(png_bytep) * h);
+	for (y = 0; y < h; y++) rows[y] = p + y * w * d;
+	png_write_image(png, rows);
+	png_write_end(png, NULL);
+	png_destroy_write_struct(&png, &info);
+	free(rows);
+	if (fclose(fp) || rename(tmp, file)) {
+		unlink(tmp);
+		free(tmp);
+		return 0;
+	}
+	free(tmp);
+	if (stat(file, &st)) return 0;
+	return st.st_size;
+}
+#else
+static unsigned char *read_png(const char *file, int *w, int *h, int *d,
+	ThumbJob *check)
+{
+	return NULL;
+}
+
+static long write_png(const char *file, unsigned char *p, int w, int h, 
+	int d, const char *uri, ThumbJob *j)
+{
+	return 0;
+}
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+
+#ifdef HAVE_LIBJPEG
+struct jpeg_fail_mgr {
+	struct jpeg_error_mgr pub;
+	jmp_buf jmp;
+};
+
+static void jpeg_fail(j_common_ptr c)
+{
+	longjmp(((struct jpeg_fail_mgr*) c->err)->jmp, 1);
+}
+
+static void jpeg_quiet(j_common_ptr c, int level)
+{
+}
+
+/*
+ *  Decodes a JPEG file at the smallest of 1/8, 1/4, 1/2 or full scale
+ *  which is still larger than a max x max thumbnail. The DCT scaling of
+ *  libjpeg skips most of the work of the full decoding.
+ */
+static unsigned char *read_jpeg(const char *file, int max, int *w, int *h,
+	int *d)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_fail_mgr err;
+	unsigned char * volatile pixels = NULL;
+	JSAMPROW row;
+	FILE *fp;
+	int fw, fh, denom;
+
+	fp = fopen(file, "rb");
+	if (!fp) return NULL;
+	cinfo.err = jpeg_std_error(&err.pub);
+	err.pub.error_exit = jpeg_fail;
+	err.pub.emit_message = jpeg_quiet;
+	if (setjmp(err.jmp)) {
+		jpeg_destroy_decompress(&cinfo);
+		delete[] pixels;
+		fclose(fp);
+		return NULL;
+	}
+	jpeg_create_decompress(&cinfo);
+	jpeg_stdio_src(&cinfo, fp);
+	jpeg_read_header(&cinfo, TRUE);
+	if (cinfo.jpeg_color_space == JCS_GRAYSCALE) {
+		cinfo.out_color_space = JCS_GRAYSCALE;
+	} else {
+		cinfo.out_color_space = JCS_RGB;
+	}
+	fit(cinfo.image_width, cinfo.image_height, max, &fw, &fh);
+	for (denom = 8; denom > 1; denom /= 2) {
+		if ((int) (cinfo.image_width + denom - 1) / denom >= fw &&
+			(int) (cinfo.image_height + denom - 1) / denom >= fh)
+		{
+			break;
+		}
+	}
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = denom;
+	cinfo.dct_method = JDCT_IFAST;
+	cinfo.do_fancy_upsampling = FALSE;
+	jpeg_start_decompress(&cinfo);
+	*w = cinfo.output_width;
+	*h = cinfo.output_height;
+	*d = cinfo.output_components;
+	if ((long) *w * *h > THUMB_PIXELS) jpeg_fail((j_common_ptr) &cinfo);
+	pixels = new unsigned char[*w * *h * *d];
+	while (cinfo.output_scanline < cinfo.output_height) {
+		row = pixels + cinfo.output_scanline * *w * *d;
+		jpeg_read_scanlines(&cinfo, &row, 1);
+	}
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	fclose(fp);
+	return pixels;
+}
+#else
+static unsigned char *read_jpeg(const char *file, int max, int *w, int *h,
+	int *d)
+{
+	return NULL;
+}
+#endif // HAVE_LIBJPEG
+
+/*
+ *  The LZW codes of a GIF image, read from its data sub-blocks.
+ */
+struct gif_reader {
+	FILE *fp;
+	int left;
+	unsigned long acc;
+	int bits;
+};
+
+static int gif_code(struct gif_reader *r, int size)
+{
+	int c;
+
+	while (r->bits < size) {
+		if (!r->left) {
+			r->left = getc(r->fp);
+			if (r->left <= 0) {
+				r->left = 0;
+				return -1;
+			}
+		}
+		c = getc(r->fp);
+		if (c == EOF) return -1;
+		r->left--;
+		r->acc |= (unsigned long) c << r->bits;
+		r->bits += 8;
+	}
+	c = (int) (r->acc & ((1 << size) - 1));
+	r->acc >>= size;
+	r->bits -= size;
+	return c;
+}
+
+static const int gif_start[4] = {0, 4, 2, 1};
+static const int gif_step[4] = {8, 8, 4, 2};
+
+static void gif_skip(FILE *fp)
+{
+	int n;
+
+	while ((n = getc(fp)) > 0) fseek(fp, n, SEEK_CUR);
+}
+
+/*
+ *  Decodes the LZW data into the nb color indexes of the frame, in the
+ *  order of the file. A truncated image keeps what was decoded.
+ */
+static void gif_lzw(FILE *fp, unsigned char *out, long nb)
+{
+	struct gif_reader r;
+	unsigned short prefix[4096];
+	unsigned char suffix[4096];
+	unsigned char stack[4097];
+	int min, clear, next, size, code, in, old, first, sp;
+	long o = 0;
+
+	min = getc(fp);
+	if (min < 1 || min > 11) return;
+	r.fp = fp;
+	r.left = 0;
+	r.acc = 0;
+	r.bits = 0;
+	clear = 1 << min;
+	for (code = 0; code < clear; code++) {
+		prefix[code] = 0;
+		suffix[code] = (unsigned char) code;
+	}
+	next = clear + 2;
+	size = min + 1;
+	old = -1;
+	first = 0;
+	while (o < nb && (code = gif_code(&r, size)) >= 0) {
+		if (code == clear) {
+			next = clear + 2;
+			size = min + 1;
+			old = -1;
+			continue;
+		}
+		if (code == clear + 1) break;
+		if (old < 0) {
+			if (code > clear) break;
+			out[o++] = suffix[code];
+			first = code;
+			old = code;
+			continue;
+		}
+		in = code;
+		sp = 0;
+		if (code >= next) {
+			if (code > next) break;
+			stack[sp++] = (unsigned char) first;
+			code = old;
+		}
+		while (code >= clear) {
+			stack[sp++] = suffix[code];
+			code = prefix[code];
+		}
+		first = code;
+		stack[sp++] = (unsigned char) first;
+		if (next < 4096) {
+			prefix[next] = (unsigned short) old;
+			suffix[next] = (unsigned char) first;
+			next++;
+			if (next == 1 << size && size < 12) size++;
+		}
+		old = in;
+		while (sp > 0 && o < nb) out[o++] = stack[--sp];
+	}
+}
+
+/*
+ *  Decodes the first frame of a GIF file. FLTK's GIF reader is not 
+ *  safe in the workers, this one only uses its own stack and buffers.
+ *  The pixels around the frame and those of the transparent color get 
+ *  an alpha of 0.
+ */
+static unsigned char *read_gif(const char *file, int *w, int *h, int *d)
+{
+	unsigned char head[13], desc[9], gce[6];
+	unsigned char global[256 * 3], local[256 * 3];
+	unsigned char *map, *idx, *pixels, *o;
+	FILE *fp;
+	int nb_global = 0, nb_map;
+	int trans = -1;
+	int fx, fy, fw, fh;
+	int c, i, x, y, pass, step;
+
+	fp = fopen(file, "rb");
+	if (!fp) return NULL;
+	if (fread(head, 1, 13, fp) != 13) {
+		fclose(fp);
+		return NULL;
+	}
+	if (head[10] & 0x80) {
+		nb_global = 2 << (head[10] & 7);
+		if ((int) fread(global, 3, nb_global, fp) != nb_global) {
+			fclose(fp);
+			return NULL;
+		}
+	}
+	for (;;) {
+		c = getc(fp);
+		if (c == ',') break;
+		if (c != '!') {
+			fclose(fp);
+			return NULL;
+		}
+		c = getc(fp);
+		if (c == 0xF9 && fread(gce, 1, 6, fp) == 6) {
+			if (gce[1] & 1) trans = gce[4];
+			if (gce[5]) {
+				fseek(fp, gce[5], SEEK_CUR);
+				gif_skip(fp);
+			}
+		} else {
+			gif_skip(fp);
+		}
+	}
+	if (fread(desc, 1, 9, fp) != 9) {
+		fclose(fp);
+		return NULL;
+	}
+	fx = desc[0] | (desc[1] << 8);
+	fy = desc[2] | (desc[3] << 8);
+	fw = desc[4] | (desc[5] << 8);
+	fh = desc[6] | (desc[7] << 8);
+	*w = head[6] | (head[7] << 8);
+	*h = head[8] | (head[9] << 8);
+	if (*w < fx + fw || *h < fy + fh) {
+		/* a broken screen size, the frame is the image */
+		fx = fy = 0;
+		*w = fw;
+		*h = fh;
+	}
+	if (fw < 1 || fh < 1 || (long) *w * *h > THUMB_PIXELS) {
+		fclose(fp);
+		return NULL;
+	}
+	map = global;
+	nb_map = nb_global;
+	if (desc[8] & 0x80) {
+		nb_map = 2 << (desc[8] & 7);
+		map = local;
+		if ((int) fread(local, 3, nb_map, fp) != nb_map) {
+			fclose(fp);
+			return NULL;
+		}
+	}
+	if (!nb_map) {
+		/* no colormap at all, shades of gray */
+		for (i = 0; i < 256; i++) {
+			global[i * 3] = global[i * 3 + 1] = global[i * 3 + 2] = i;
+		}
+		map = global;
+		nb_map = 256;
+	}
+	for (i = nb_map; i < 256; i++) {
+		map[i * 3] = map[i * 3 + 1] = map[i * 3 + 2] = 0;
+	}
+
+	idx = new unsigned char[fw * fh];
+	memset(idx, trans >= 0 ? trans : 0, fw * fh);
+	gif_lzw(fp, idx, (long) fw * fh);
+	fclose(fp);
+
+	*d = (trans >= 0 || fw != *w || fh != *h) ? 4 : 3;
+	pixels = new unsigned char[*w * *h * *d];
+	memset(pixels, 0, *w * *h * *d);
+	/* interlaced rows come in four passes : 0, 4, 2 and 1 mod 8 */
+	y = 0;
+	pass = 0;
+	step = (desc[8] & 0x40) ? 8 : 1;
+	for (i = 0; i < fh && y < fh; i++) {
+		const unsigned char *s = idx + i * fw;
+		o = pixels + ((fy + y) * *w + fx) * *d;
+		for (x = 0; x < fw; x++, o += *d) {
+			memcpy(o, map + s[x] * 3, 3);
+			if (*d == 4) o[3] = s[x] == trans ? 0 : 255;
+		}
+		y += step;
+		while (y >= fh && step > 1 && pass < 3) {
+			pass++;
+			y = gif_start[pass];
+			step = gif_step[pass];
+		}
+	}
+	delete[] idx;
+	return pixels;
+}
+
+/*
+ *  Decodes the image, the kind is found from its first bytes.
+ */
+static unsigned char *read_image(const char *file, int *w, int *h, int *d)
+{
+	unsigned char head[8];
+	FILE *fp;
+	int n;
+
+	fp = fopen(file, "rb");
+	if (!fp) return NULL;
+	n = fread(head, 1, 8, fp);
+	fclose(fp);
+	if (n >= 6 && (!memcmp(head, "GIF87a", 6) || 
+		!memcmp(head, "GIF89a", 6))) 
+	{
+		return read_gif(file, w, h, d);
+	} else if (n >= 4 && !memcmp(head, "\211PNG", 4)) {
+		return read_png(file, w, h, d, NULL);
+	} else if (n >= 2 && head[0] == 0xFF && head[1] == 0xD8) {
+		return read_jpeg(file, THUMB_SIZE, w, h, d);
+	}
+	return NULL;
+}
+
+static void make_dir(char *path)
+{
+	char *p;
+
+	for (p = path + 1; *p; p++) {
+		if (*p != '/') continue;
+		*p = '\0';
+		mkdir(path, 0700);
+		*p = '/';
+	}
+	mkdir(path, 0700);
+}
+
+Thumbnailer::Thumbnailer(const char *home)
+{
+	int i;
+
+	normal_dir = (char*) malloc(strlen(home) + 64);
+	sprintf(normal_dir, "%s/.xd640/thumbnails/normal", home);
+	fail_dir = (char*) malloc(strlen(home) + 64);
+	sprintf(fail_dir, "%s/.xd640/thumbnails/fail/flfm", home);
+	make_dir(normal_dir);
+	make_dir(fail_dir);
+	if (!md5_k[0]) {
+		for (i = 0; i < 64; i++) {
+			md5_k[i] = (unsigned int) (fabs(sin(i + 1.0)) * 
+				4294967296.0);
+		}
+	}
+
+	todo = NULL;
+	todo_last = &todo;
+	done = NULL;
+	cancel = 0;
+	disk_bytes = -1;
+	trimming = 0;
+	nb_threads = 0;
+	table_size = THUMB_TABLE;
+	table = (ThumbEntry**) calloc(table_size, sizeof(ThumbEntry*));
+	nb_entries = 0;
+	clock = 0;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+	pipe_fd[0] = pipe_fd[1] = -1;
+	if (!pipe(pipe_fd)) {
+		fcntl(pipe_fd[1], F_SETFL, O_NONBLOCK);
+		fcntl(pipe_fd[0], F_SETFL, O_NONBLOCK);
+	}
+	for (i = 0; i < THUMB_WORKERS; i++) {
+		if (pthread_create(workers + i, NULL, work_thread, this)) break;
+		nb_threads++;
+	}
+}
+
+static void free_jobs(ThumbJob *j)
+{
+	ThumbJob *n;
+
+	while (j) {
+		n = j->next;
+		delete[] j->pixels;
+		free(j->path);
+		free(j);
+		j = n;
+	}
+}
+
+Thumbnailer::~Thumbnailer()
+{
+	int i;
+
+	pthread_mutex_lock(&mutex);
+	cancel = 1;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+	for (i = 0; i < nb_threads; i++) pthread_join(workers[i], NULL);
+	free_jobs(todo);
+	free_jobs(done);
+	for (i = 0; i < table_size; i++) {
+		while (table[i]) remove(table[i]);
+	}
+	free(table);
+	if (pipe_fd[0] >= 0) close(pipe_fd[0]);
+	if (pipe_fd[1] >= 0) close(pipe_fd[1]);
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+	free(normal_dir);
+	free(fail_dir);
+}
+
+/*
+ *  True for the names of the images which get a thumbnail.
+ */
+int Thumbnailer::handles(const char *name)
+{
+	const char *ext = strrchr(name, '.');
+
+	if (!ext) return 0;
+	ext++;
+	return !strcasecmp(ext, "png") || !strcasecmp(ext, "jpg") ||
+		!strcasecmp(ext, "jpeg") || !strcasecmp(ext, "jpe") ||
+		!strcasecmp(ext, "gif");
+}
+
+static unsigned int hash(const char *s)
+{
+	unsigned int h = 2166136261U;
+
+	while (*s) {
+		h ^= (unsigned char) *s++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+ThumbEntry *Thumbnailer::find(const char *path)
+{
+	ThumbEntry *e = table[hash(path) & (table_size - 1)];
+
+	while (e && strcmp(e->path, path)) e = e->next;
+	return e;
+}
+
+void Thumbnailer::remove(ThumbEntry *e)
+{
+	ThumbEntry **p;
+
+	p = &table[hash(e->path) & (table_size - 1)];
+	while (*p && *p != e) p = &(*p)->next;
+	if (*p) *p = e->next;
+	delete(e->image);
+	free(e->path);
+	free(e);
+	nb_entries--;
+}
+
+/*
+ *  Returns the thumbnail of the file at path, or NULL if it is not
+ *  ready yet (it is then asked to the workers) or can not be made.
+ */
+Fl_Image *Thumbnailer::get(const char *path, struct stat *st)
+{
+	ThumbEntry *e;
+	ThumbJob *j;
+	int i;
+
+	clock++;
+	e = find(path);
+	if (e && (e->mtime != st->st_mtime || e->size != st->st_size)) {
+		remove(e);
+		e = NULL;
+	}
+	if (e) {
+		e->last_use = clock;
+		return e->image;
+	}
+
+	e = (ThumbEntry*) malloc(sizeof(ThumbEntry));
+	e->path = strdup(path);
+	e->mtime = st->st_mtime;
+	e->size = st->st_size;
+	e->image = NULL;
+	e->state = THUMB_PENDING;
+	e->last_use = clock;
+	i = hash(path) & (table_size - 1);
+	e->next = table[i];
+	table[i] = e;
+	nb_entries++;
+
+	j = (ThumbJob*) malloc(sizeof(ThumbJob));
+	j->next = NULL;
+	j->path = strdup(path);
+	j->mtime = st->st_mtime;
+	j->size = st->st_size;
+	j->pixels = NULL;
+	j->w = j->h = j->d = 0;
+	if (!nb_threads) {
+		/* no thread, make it now */
+		make(j);
+		pthread_mutex_lock(&mutex);
+		j->next = done;
+		done = j;
+		pthread_mutex_unlock(&mutex);
+		write(pipe_fd[1], "", 1);
+		return NULL;
+	}
+	pthread_mutex_lock(&mutex);
+	*todo_last = j;
+	todo_last = &j->next;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&mutex);
+	return NULL;
+}
+
+/*
+ *  Takes the thumbnails made since the last call. Returns how many
+ *  files got theirs.
+ */
+int Thumbnailer::collect()
+{
+	ThumbJob *list, *j;
+	ThumbEntry *e;
+	Fl_RGB_Image *img;
+	char buf[256];
+	int nb = 0;
+
+	while (read(pipe_fd[0], buf, sizeof(buf)) > 0);
+	pthread_mutex_lock(&mutex);
+	list = done;
+	done = NULL;
+	pthread_mutex_unlock(&mutex);
+	for (j = list; j; j = j->next) {
+		e = find(j->path);
+		if (!e || e->state != THUMB_PENDING || 
+			e->mtime != j->mtime || e->size != j->size) 
+		{
+			continue;
+		}
+		if (j->pixels) {
+			img = new Fl_RGB_Image(j->pixels, j->w, j->h, j->d);
+			img->alloc_array = 1;
+			j->pixels = NULL;
+			e->image = img;
+			e->state = THUMB_DONE;
+		} else {
+			e->state = THUMB_FAILED;
+		}
+		nb++;
+	}
+	free_jobs(list);
+	purge();
+	return nb;
+}
+
+/*
+ *  Forgets the files not started yet, when the directory shown changes.
+ */
+void Thumbnailer::drop_queue()
+{
+	ThumbJob *j, *n;
+	ThumbEntry *e;
+
+	pthread_mutex_lock(&mutex);
+	j = todo;
+	todo = NULL;
+	todo_last = &todo;
+	pthread_mutex_unlock(&mutex);
+	for (n = j; n; n = n->next) {
+		e = find(n->path);
+		if (e && e->state == THUMB_PENDING) remove(e);
+	}
+	free_jobs(j);
+}
+
+/*
+ *  Keeps the thumbnails of the THUMB_MEMORY * 3 / 4 files seen last 
+ *  when there are more than THUMB_MEMORY.
+ */
+void Thumbnailer::purge()
+{
+	ThumbEntry *e, *old;
+	int i;
+
+	if (nb_entries <= THUMB_MEMORY) return;
+	while (nb_entries > THUMB_MEMORY * 3 / 4) {
+		old = NULL;
+		for (i = 0; i < table_size; i++) {
+			for (e = table[i]; e; e = e->next) {
+				if (e->state != THUMB_PENDING && (!old ||
+					e->last_use < old->last_use))
+				{
+					old = e;
+				}
+			}
+		}
+		if (!old) return;
+		remove(old);
+	}
+}
+
+/*
+ *  Runs in a worker : reads the thumbnail of the cache, else decodes 
+ *  the image and stores its thumbnail (or a failure mark) in the cache.
+ */
+void Thumbnailer::make(ThumbJob *j)
+{
+	unsigned char px[4] = {0, 0, 0, 0};
+	unsigned char *p;
+	char md5[33];
+	char *uri, *normal, *fail;
+	int w = 0, h = 0, d = 0;
+
+	uri = file_uri(j->path);
+	md5_hex(uri, md5);
+	normal = (char*) malloc(strlen(normal_dir) + 40);
+	sprintf(normal, "%s/%s.png", normal_dir, md5);
+	fail = (char*) malloc(strlen(fail_dir) + 40);
+	sprintf(fail, "%s/%s.png", fail_dir, md5);
+
+	p = read_png(normal, &w, &h, &d, j);
+	if (p) {
+		/* the modification time orders the cache for trim_disk() */
+		utime(normal, NULL);
+	} else if ((p = read_png(fail, &w, &h, &d, j))) {
+		utime(fail, NULL);
+		delete[] p;
+		p = NULL;
+	} else {
+		p = read_image(j->path, &w, &h, &d);
+		if (p) {
+			p = shrink(p, &w, &h, d, THUMB_SIZE);
+			account(write_png(normal, p, w, h, d, uri, j));
+		} else {
+			write_png(fail, px, 1, 1, 4, uri, j);
+			/* the marks are trimmed with the thumbnails */
+			account(0);
+		}
+	}
+	if (p) p = shrink(p, &w, &h, d, THUMB_ICON);
+	j->pixels = p;
+	j->w = w;
+	j->h = h;
+	j->d = d;
+	free(uri);
+	free(normal);
+	free(fail);
+}
+
+/*
+ *  Counts the bytes written to the cache. The first time, and each 
+ *  time the cache grows over THUMB_DISK_MAX, the cache directory is 
+ *  counted again by the worker which gets there first.
+ */
+void Thumbnailer::account(long bytes)
+{
+	int trim = 0;
+
+	pthread_mutex_lock(&mutex);
+	if (disk_bytes >= 0) disk_bytes += bytes;
+	if ((disk_bytes < 0 || disk_bytes > THUMB_DISK_MAX) && !trimming) {
+		trimming = 1;
+		disk_bytes = 0;
+		trim = 1;
+	}
+	pthread_mutex_unlock(&mutex);
+	if (trim) trim_disk();
+}
+
+struct thumb_file {
+	char *name;
+	time_t mtime;
+	long size;
+};
+
+static int oldest_first(const void *a, const void *b)
+{
+	time_t t1 = ((struct thumb_file*) a)->mtime;
+	time_t t2 = ((struct thumb_file*) b)->mtime;
+
+	if (t1 == t2) return 0;
+	return t1 < t2 ? -1 : 1;
+}
+
+/*
+ *  Removes the files of the cache directory path not used since old, 
+ *  then those used the longest time ago until the directory is under 
+ *  3/4 of max. Returns the bytes left.
+ */
+static long trim_dir(const char *path, long max, time_t old)
+{
+	struct thumb_file *files = NULL;
+	struct dirent *de;
+	struct stat st;
+	DIR *dir;
+	long total = 0;
+	int nb = 0, size = 0;
+	int i;
+
+	dir = opendir(path);
+	while (dir && (de = readdir(dir))) {
+		if (de->d_name[0] == '.') continue;
+		if (fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) ||
+			!S_ISREG(st.st_mode))
+		{
+			continue;
+		}
+		if (st.st_mtime < old && !unlinkat(dirfd(dir), de->d_name, 0)) {
+			continue;
+		}
+		if (nb >= size) {
+			size = size * 2 + 256;
+			files = (struct thumb_file*) realloc(files, 
+				sizeof(struct thumb_file) * size);
+		}
+		files[nb].name = strdup(de->d_name);
+		files[nb].mtime = st.st_mtime;
+		files[nb].size = st.st_size;
+		total += st.st_size;
+		nb++;
+	}
+	if (total > max) {
+		qsort(files, nb, sizeof(struct thumb_file), oldest_first);
+		for (i = 0; i < nb && total > max / 4 * 3; i++) {
+			if (!unlinkat(dirfd(dir), files[i].name, 0)) {
+				total -= files[i].size;
+			}
+		}
+	}
+	if (dir) closedir(dir);
+	for (i = 0; i < nb; i++) free(files[i].name);
+	free(files);
+	return total;
+}
+
+/*
+ *  Trims the thumbnails to THUMB_DISK_MAX. The failure marks are
+ *  forgotten after THUMB_FAIL_AGE without use and kept under 
+ *  THUMB_FAIL_MAX, a file which could not be read is tried again.
+ */
+void Thumbnailer::trim_disk()
+{
+	long total;
+
+	total = trim_dir(normal_dir, THUMB_DISK_MAX, 0);
+	trim_dir(fail_dir, THUMB_FAIL_MAX, time(NULL) - THUMB_FAIL_AGE);
+	pthread_mutex_lock(&mutex);
+	disk_bytes += total;
+	trimming = 0;
+	pthread_mutex_unlock(&mutex);
+}
+
+void Thumbnailer::work()
+{
+	ThumbJob *j;
+
+	pthread_mutex_lock(&mutex);
+	for (;;) {
+		while (!todo && !cancel) pthread_cond_wait(&cond, &mutex);
+		if (cancel) break;
+		j = todo;
+		todo = j->next;
+		if (!todo) todo_last = &todo;
+		pthread_mutex_unlock(&mutex);
+		j->next = NULL;
+		make(j);
+		pthread_mutex_lock(&mutex);
+		j->next = done;
+		done = j;
+		write(pipe_fd[1], "", 1);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void *Thumbnailer::work_thread(void *d)
+{
+	((Thumbnailer*)d)->work();
+	return NULL;
+}
@@ -0,0 +1,133 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+
+#ifndef Thumbnailer_h
+#define Thumbnailer_h
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <FL/Fl_Image.H>
+
+#define THUMB_WORKERS 2
+#define THUMB_SIZE 128
+#define THUMB_ICON 32
+#define THUMB_MEMORY 2048
+#define THUMB_DISK_MAX (32L * 1024 * 1024)
+#define THUMB_FAIL_MAX (1024L * 1024)
+#define THUMB_FAIL_AGE (30L * 24 * 3600)
+
+enum {
+	THUMB_PENDING = 0,
+	THUMB_DONE,
+	THUMB_FAILED
+};
+
+/*
+ *  A file to make the thumbnail of. The workers fill pixels with the 
+ *  icon sized image, NULL if the file can not be read.
+ */
+struct ThumbJob {
+	ThumbJob *next;
+	char *path;
+	time_t mtime;
+	off_t size;
+	unsigned char *pixels;
+	int w, h, d;
+};
+
+struct ThumbEntry {
+	ThumbEntry *next;
+	char *path;
+	time_t mtime;
+	off_t size;
+	Fl_Image *image;
+	int state;
+	unsigned int last_use;
+};
+
+/*
+ *  Makes the thumbnails of PNG, JPEG and GIF files in background threads.
+ *  They are stored in ~/.xd640/thumbnails in the freedesktop layout 
+ *  (normal/<md5 of the URI>.png, tagged with the mtime and size of the 
+ *  file) so an image is decoded only once. The GUI thread keeps the 
+ *  icon sized images of the last THUMB_MEMORY files and is woken by a 
+ *  byte written to fd() when new ones are ready.
+ */
+class Thumbnailer {
+public:
+	char *normal_dir;
+	char *fail_dir;
+	int pipe_fd[2];
+	pthread_t workers[THUMB_WORKERS];
+	int nb_threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	ThumbJob *todo;
+	ThumbJob **todo_last;
+	ThumbJob *done;
+	int cancel;
+	long disk_bytes;
+	int trimming;
+	ThumbEntry **table;
+	int table_size;
+	int nb_entries;
+	unsigned int clock;
+
+	Thumbnailer(const char *home);
+	~Thumbnailer(void);
+	int fd(void) { return pipe_fd[0]; }
+	static int handles(const char *name);
+	Fl_Image *get(const char *path, struct stat *st);
+	int collect(void);
+	void drop_queue(void);
+	ThumbEntry *find(const char *path);
+	void remove(ThumbEntry *e);
+	void purge(void);
+	void make(ThumbJob *j);
+	void account(long bytes);
+	void trim_disk(void);
+	void work(void);
+	static void *work_thread(void *d);
+};
+
+#endif
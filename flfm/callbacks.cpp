@@ -39,7 +39,6 @@
 
 
 #include "callbacks.h"
-#include "BigIcon.h"
 #include "IconTree.h"
 #include <stdio.h>
 #include <string.h>
@@ -53,7 +52,6 @@
 #define _(String) gettext((String))
 
 struct states_struct StatesValues;
-static time_t mod_time;
 
 static void save_state()
 {
@@ -141,8 +139,8 @@ static char *get_tree_selected()
 char *get_selected_urls()
 {
 	int i;
-	Fl_Widget*const* a;
-	BigIcon *b;
+	IconGroup *g;
+	const char *name;
 	char *buf;
 	int index;
 	int alloc;
@@ -153,8 +151,8 @@ char *get_selected_urls()
 	if (!gui || !gui->icon_can || 
 		!((IconCanvas*)gui->icon_can)->group) return NULL;
 
-	a = ((IconCanvas*)gui->icon_can)->group->array();
-	i = ((IconCanvas*)gui->icon_can)->group->children();
+	g = ((IconCanvas*)gui->icon_can)->group;
+	i = g->nb_entries;
 
 	alloc = 4096;
 	buf = (char*) malloc(alloc);
@@ -162,19 +160,19 @@ char *get_selected_urls()
 	index = 0;
 	while (i > 0) {
 		i--;
-		b = (BigIcon*) a[i];
-		if (b && b->selected) {
+		if (g->entries[i].selected) {
 			char *b1;
 			char *b2;
+			name = g->name(i);
 			if (index > alloc - 4096) {
 				alloc = alloc * 2;
 				buf = (char*) realloc(buf, alloc);
 			}
 			b1 = (char*) malloc(strlen(StatesValues.url) * 3 + 1);
-			b2 = (char*) malloc(strlen(b->label()) * 3 + 1);
+			b2 = (char*) malloc(strlen(name) * 3 + 1);
 			latin12url(StatesValues.url, 
 				strlen(StatesValues.url), b1);
-			latin12url(b->label(), strlen(b->label()), b2);
+			latin12url(name, strlen(name), b2);
 			snprintf(buf + index, 4096, "file://%s/%s\r\n", b1, b2);
 			index += strlen(buf + index);
 			free(b1);
@@ -185,11 +183,10 @@ char *get_selected_urls()
 }
 
 
-static const BigIcon *get_selected_icon()
+static const char *get_selected_name()
 {
+	IconGroup *g;
 	int i;
-	Fl_Widget*const* a;
-	BigIcon *b;
 
         if (StatesValues.view_tree) {
                 return NULL;
@@ -198,17 +195,10 @@ static const BigIcon *get_selected_icon()
 	if (!gui || !gui->icon_can || 
 		!((IconCanvas*)gui->icon_can)->group) return NULL;
 
-	a = ((IconCanvas*)gui->icon_can)->group->array();
-	i = ((IconCanvas*)gui->icon_can)->group->children();
-
-	while (i > 0) {
-		i--;
-		b = (BigIcon*) a[i];
-		if (b && b->selected) {
-			return b;
-		}
-	}
-	return NULL;
+	g = ((IconCanvas*)gui->icon_can)->group;
+	i = g->selection();
+	if (i < 0) return NULL;
+	return g->name(i);
 }
 
 static char *url2dir(char *url)
@@ -260,9 +250,9 @@ void cb_rescan(Fl_Widget*, void*)
 {
 	char *dir;
 	char buf[1024];
-	struct stat st;
 
-	Fl::remove_timeout(cb_directory, 0);
+	delete(StatesValues.watcher);
+	StatesValues.watcher = NULL;
 
 	if (!StatesValues.newurl) {
 		if (StatesValues.url) {
@@ -284,7 +274,8 @@ void cb_rescan(Fl_Widget*, void*)
 	free(StatesValues.url);
 	StatesValues.url = strdup(buf);
 	gui->loc_inp->value(StatesValues.url);
-	stat(StatesValues.url, &st);
+	StatesValues.watcher = new Xd6FileWatcher(StatesValues.url, 
+		cb_directory, NULL);
 
 	if (StatesValues.view_tree) {
 		((IconTree*)gui->icon_can)->rescan();
@@ -296,9 +287,6 @@ void cb_rescan(Fl_Widget*, void*)
 	StatesValues.newurl = NULL;
 	free(dir);
 	Fl::redraw();
-
-	mod_time = st.st_mtime;
-	Fl::add_timeout(1, cb_directory, 0);
 }
 
 void cb_newdir(Fl_Widget*, void*)
@@ -422,7 +410,7 @@ void cb_help(Fl_Widget*, void*)
 
 void cb_exec(Fl_Widget*, void  *d)
 {
-	const BigIcon *b;
+	const char *b;
 	char buf[2048];
 	char *b1, *b2;
 
@@ -434,13 +422,13 @@ void cb_exec(Fl_Widget*, void  *d)
 		system(buf);
 		return;
 	}
-	b = get_selected_icon();
+	b = get_selected_name();
 	if (!b) return;
 	
 	b1 = (char*) malloc(strlen(StatesValues.url) * 3 + 1);
-	b2 = (char*) malloc(strlen(b->label()) * 3 + 1);
+	b2 = (char*) malloc(strlen(b) * 3 + 1);
 	latin12url(StatesValues.url, strlen(StatesValues.url), b1);
-	latin12url(b->label(), strlen(b->label()), b2);
+	latin12url(b, strlen(b), b2);
 	snprintf(buf, 2048, "flfile --exec \"file://%s/%s\r\n\" &", b1, b2);
 	free(b1);
 	free(b2);
@@ -449,7 +437,7 @@ void cb_exec(Fl_Widget*, void  *d)
 
 void cb_open(Fl_Widget*, void  *d)
 {
-	const BigIcon *b;
+	const char *b;
 	char buf[2048];
 	char *b1, *b2;
 
@@ -461,12 +449,12 @@ void cb_open(Fl_Widget*, void  *d)
 		return;
 	}
 	
-	b = get_selected_icon();
+	b = get_selected_name();
 	if (!b) return;
 	b1 = (char*) malloc(strlen(StatesValues.url) * 3 + 1);
-	b2 = (char*) malloc(strlen(b->label()) * 3 + 1);
+	b2 = (char*) malloc(strlen(b) * 3 + 1);
 	latin12url(StatesValues.url, strlen(StatesValues.url), b1);
-	latin12url(b->label(), strlen(b->label()), b2);
+	latin12url(b, strlen(b), b2);
 	
 	snprintf(buf, 2048, "flfile --open \"file://%s/%s\" &", b1, b2);
 	system(buf);
@@ -476,7 +464,7 @@ void cb_open(Fl_Widget*, void  *d)
 
 void cb_open_width(Fl_Widget*, void*)
 {
-	const BigIcon *b = NULL;
+	const char *b = NULL;
 	char buf[2048];
 	static char *last_cmd = NULL; 
 	char *b1 = get_tree_sel();
@@ -491,10 +479,10 @@ void cb_open_width(Fl_Widget*, void*)
 		r = (char *)fl_input(_("Open \"%s\" with :"), last_cmd, 
 			 b1 + 7);
 	} else {
-		b = get_selected_icon();
+		b = get_selected_name();
 		if (!b) return;
 		r = (char *)fl_input(_("Open \"%s%s\" with :"), last_cmd, 
-			StatesValues.url, b->label());
+			StatesValues.url, b);
 	}
 
 	if (!r) return;
@@ -508,7 +496,7 @@ void cb_open_width(Fl_Widget*, void*)
 	}
 
 	snprintf(buf, 2048, "%s \"%s/%s\" &", r, 
-			StatesValues.url, b->label());
+			StatesValues.url, b);
 	system(buf);
 }
 
@@ -522,14 +510,14 @@ void cb_new_fm(Fl_Widget*, void*)
 
 void cb_open_dir(Fl_Widget*, void*)
 {
-	const BigIcon *b;
+	const char *b;
 	char buf[2048];
 
-	b = get_selected_icon();
+	b = get_selected_name();
 	
 	if (b) {
 		snprintf(buf, 2048, "flfm \"%s/%s\" &",  
-			StatesValues.url, b->label());
+			StatesValues.url, b);
 	} else {
 		snprintf(buf, 2048, "flfm \"%s\" &",  
 			StatesValues.url);
@@ -539,15 +527,15 @@ void cb_open_dir(Fl_Widget*, void*)
 
 void cb_change_dir(Fl_Widget*, void*)
 {
-	const BigIcon *b;
+	const char *b;
 	char buf[2048];
 	char *b1, *b2;
-	b = get_selected_icon();
+	b = get_selected_name();
 	if (!b) return;  
 	b1 = (char*) malloc(strlen(StatesValues.url) * 3 + 1);
-	b2 = (char*) malloc(strlen(b->label()) * 3 + 1);
+	b2 = (char*) malloc(strlen(b) * 3 + 1);
 	latin12url(StatesValues.url, strlen(StatesValues.url), b1);
-	latin12url(b->label(), strlen(b->label()), b2);
+	latin12url(b, strlen(b), b2);
 	snprintf(buf, 2048, "file://%s/%s\r\n", b1, b2);
 	StatesValues.newurl = strdup(buf);
 	cb_rescan(NULL, NULL);
@@ -678,11 +666,9 @@ void cb_move_link_copy(Fl_Widget*, void *d)
 			return;
 		}
 	} else {
-		if (w == ((IconCanvas*)gui->icon_can)->group) {
-			dir = "";
-		} else if (((IconCanvas*)gui->icon_can)->group->contains(w)) {
-			BigIcon *b = (BigIcon*) w;
-			dir = b->label();
+		IconGroup *g = ((IconCanvas*)gui->icon_can)->group;
+		if (g && w == g) {
+			dir = g->drop_dir();
 		} else {
 			return;
 		}
@@ -732,17 +718,15 @@ void cb_loc_input(Fl_Widget*, void *d)
 	}
 }
 
-void cb_directory(void*) 
+/*
+ *  Called by the watcher of the current directory. The icon views patch
+ *  the changed file, the tree is read again.
+ */
+void cb_directory(Xd6FileWatcher*, const char *name, int what, void*) 
 {
-	struct stat st;
-	if (!StatesValues.url) {
-		Fl::add_timeout(.5, cb_directory, 0);
-		return;
-	}
-	stat(StatesValues.url, &st);
-	if (st.st_mtime != mod_time) {
+	if (!name || (what & XD6_WATCH_RESCAN) || StatesValues.view_tree) {
 		cb_rescan(NULL, NULL);
 		return;
 	}
-	Fl::add_timeout(.5, cb_directory, 0);
+	((IconCanvas*)gui->icon_can)->update_file(name);
 }
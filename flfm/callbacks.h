@@ -44,6 +44,7 @@
 #include <FL/Fl_Widget.H>
 #include "gui.h"
 #include "xd640/Xd6ConfigFile.h"
+#include "xd640/Xd6FileWatcher.h"
 
 struct states_struct {
 	char sort_size;
@@ -57,6 +58,7 @@ struct states_struct {
 	char *newurl;
 	char *status;
 	char *history[10];
+	Xd6FileWatcher *watcher;
 };
 
 extern struct states_struct StatesValues;
@@ -89,6 +91,6 @@ void cb_up(Fl_Widget*, void*);
 void cb_new_fm(Fl_Widget*, void*);
 void cb_loc_input(Fl_Widget*, void*);
 
-void cb_directory(void*);
+void cb_directory(Xd6FileWatcher*, const char*, int, void*);
 
 #endif
@@ -86,11 +86,13 @@ GUI::GUI(int X, int Y, int W, int H) : Fl_Window(W, H)
 	StatesValues.history[7] = 0;
 	StatesValues.history[8] = 0;
 	StatesValues.history[9] = 0;
+	StatesValues.watcher = NULL;
 }
 
 GUI::~GUI()
 {
-	Fl::remove_timeout(cb_directory, 0);
+	delete(StatesValues.watcher);
+	StatesValues.watcher = NULL;
 	delete(mnu_bar);
 	delete(mnu);
 	delete(loc_inp);
@@ -250,9 +252,10 @@ int GUI::handle(int e)
 		fl_local_grab = 0;
 		Fl::belowmouse(this);
 		fl_local_grab = og;
-			if (Fl::belowmouse_ == BigIcon::drag_widget ||
-				(Fl::belowmouse_ && BigIcon::drag_widget ==
-				Fl::belowmouse_->parent())) 
+			if (Fl::belowmouse_ && Fl::belowmouse_ == 
+				BigIcon::drag_widget && 
+				((IconGroup*)BigIcon::drag_widget)->
+				over_selection()) 
 			{
 				 Fl::first_window()->
 					cursor((Fl_Cursor)21);
@@ -627,6 +627,7 @@ static void scan_dir(const char *dir, Xd6ConfigFileSection *sec)
 	char **launched;
 
 	// read the directory
+	current_button->watch(dir);
 	chdir(dir);
 	nb = scandir(dir, &namelist, sel_launch, alphasort);
 	if (nb < 1) return;
@@ -752,6 +753,7 @@ void UserInterface::make_items(My_Menu_Button* btn, const char* path)
 	item_count = 0;
 	ftw(buf1, ftw_count, 10);
 	if (item_count < 2) {
+		btn->watch(buf1);
 		free(buf1);
 		return;
 	}
@@ -809,6 +811,7 @@ void UserInterface::make_button(Xd6ConfigFileSection* sec, const char* path)
 		btn->labelsize(font_size);
 		btn->labelfont(font);
 		btn->sec = sec;
+		btn->path = strdup(path);
 		btn->callback(callback);
 		btn->user_data((void*) sec);
 
@@ -1001,9 +1004,65 @@ My_Menu_Button::~My_Menu_Button()
 			delete((Xd6ConfigFileSection*)items[i].user_data_);
 		}
 	}
+	while (nb_watchers > 0) {
+		nb_watchers--;
+		delete(watchers[nb_watchers]);
+	}
+	free(watchers);
+	free(path);
 	delete(sec);
 }
 
+/*
+ *  forget the menu items and the watched directories before the menu
+ *  is created again
+ */
+void My_Menu_Button::clear_items()
+{
+	if (items) {
+		for (int i = size(); i--;) {
+			if (items[i].user_data_) {
+				delete((Xd6ConfigFileSection*)
+					items[i].user_data_);
+			}
+			if (items[i].text && 
+				items[i].labeltype_ == _FL_MULTI_LABEL) 
+			{
+				Fl_Multi_Label *m = (Fl_Multi_Label*) 
+					items[i].text;
+				free((char*) m->labelb);
+				delete(m);
+			}
+		}
+		menu(NULL);
+		delete[] items;
+		items = NULL;
+	}
+	while (nb_watchers > 0) {
+		nb_watchers--;
+		delete(watchers[nb_watchers]);
+	}
+}
+
+/*
+ *  the menu is created again at the next click when a ".launch" file
+ *  or a sub-directory of dir changes
+ */
+void My_Menu_Button::watch(const char *dir)
+{
+	watchers = (Xd6FileWatcher**) realloc(watchers, 
+		sizeof(Xd6FileWatcher*) * (nb_watchers + 1));
+	watchers[nb_watchers] = new Xd6FileWatcher(dir, watch_cb, this);
+	nb_watchers++;
+}
+
+void My_Menu_Button::watch_cb(Xd6FileWatcher *w, const char *name, 
+	int what, void *d)
+{
+	if (name && name[0] == '.' && strcmp(name, ".launch")) return;
+	((My_Menu_Button*)d)->dirty = 1;
+}
+
 /*
  *  set the menu button pixmap
  */
@@ -1056,6 +1115,13 @@ int My_Menu_Button::handle(int e)
     	case FL_PUSH:
 		redraw();
       	J1:
+		// the directories have changed -> read them again
+		if (dirty && path) {
+			dirty = 0;
+			clear_items();
+			UserInterface::self->make_items(this, path);
+		}
+
 		// simple button -> execute it
         	if (!menu() || !menu()->text) {
 			//if (Fl::event_clicks() > 0) {
@@ -49,6 +49,7 @@
 #include <FL/Fl_Menu_Button.H>
 #include <FL/Fl_Box.H>
 #include "xd640/Xd6ConfigFile.h"
+#include "xd640/Xd6FileWatcher.h"
 
 class UserInterface;
 class My_Menu_Button;
@@ -110,12 +111,20 @@ public:
 	Fl_Pixmap *pixmap;
 	Fl_Menu_Item *items;
 	Xd6ConfigFileSection *sec;
+	char *path;
+	Xd6FileWatcher **watchers;
+	int nb_watchers;
+	int dirty;
 
 	My_Menu_Button(int x, int y, int w, int h, const char *c) : 
 		Fl_Menu_Button(x,y,w,h,c) { 
 		verti = 0; 
 		pixmap = NULL;
 		items = NULL;
+		path = NULL;
+		watchers = NULL;
+		nb_watchers = 0;
+		dirty = 0;
 		align(FL_ALIGN_LEFT|FL_ALIGN_INSIDE);
 		selection_color(137);
 		down_box(FL_FLAT_BOX);
@@ -123,6 +132,10 @@ public:
 	}; 
 	~My_Menu_Button();
 	int handle(int);
+	void clear_items(void);
+	void watch(const char *dir);
+	static void watch_cb(Xd6FileWatcher *w, const char *name, int what,
+		void *d);
 	void image(Fl_Pixmap *pix);
 	void draw();
 };
@@ -0,0 +1,259 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#include "MailIndex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC "XD6MBOX1"
+#define INDEX_GROW (1024 * sizeof(MailIndexRecord))
+#define POOL_GROW (64 * 1024)
+
+/*
+ *  Maps size bytes of fd in place of old, the file is grown as needed.
+ */
+void *MailIndex::map(int fd, int old_size, void *old, int size)
+{
+	struct stat s;
+	void *ptr;
+
+	if (old) munmap(old, old_size);
+	if (fstat(fd, &s)) return NULL;
+	if (s.st_size < size && ftruncate(fd, size)) return NULL;
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) return NULL;
+	return ptr;
+}
+
+MailIndex::MailIndex(const char *d)
+{
+	struct stat s;
+	char buf[1024];
+
+	dir = strdup(d);
+	header = NULL;
+	records = NULL;
+	pool = NULL;
+	map_size = 0;
+	pool_map_size = 0;
+
+	snprintf(buf, 1024, "%s/index.bin", dir);
+	fd = open(buf, O_RDWR | O_CREAT, 0600);
+	snprintf(buf, 1024, "%s/index.str", dir);
+	pool_fd = open(buf, O_RDWR | O_CREAT, 0600);
+	if (fd < 0 || pool_fd < 0) return;
+
+	if (fstat(fd, &s)) return;
+	map_size = s.st_size;
+	if (map_size < (int) (sizeof(MailIndexHeader) + INDEX_GROW)) {
+		map_size = sizeof(MailIndexHeader) + INDEX_GROW;
+	}
+	header = (MailIndexHeader*) map(fd, 0, NULL, map_size);
+	if (fstat(pool_fd, &s)) return;
+	pool_map_size = s.st_size;
+	if (pool_map_size < POOL_GROW) pool_map_size = POOL_GROW;
+	pool = (char*) map(pool_fd, 0, NULL, pool_map_size);
+	if (!header || !pool) {
+		if (header) munmap(header, map_size);
+		if (pool) munmap(pool, pool_map_size);
+		header = NULL;
+		pool = NULL;
+		return;
+	}
+	records = (MailIndexRecord*) (header + 1);
+	if (memcmp(header->magic, INDEX_MAGIC, 8) || 
+		sizeof(MailIndexHeader) + header->nb_records * 
+		sizeof(MailIndexRecord) > (unsigned int) map_size ||
+		header->pool_size > (unsigned int) pool_map_size) 
+	{
+		clear();
+	}
+}
+
+MailIndex::~MailIndex()
+{
+	if (header) munmap(header, map_size);
+	if (pool) munmap(pool, pool_map_size);
+	if (fd >= 0) close(fd);
+	if (pool_fd >= 0) close(pool_fd);
+	free(dir);
+}
+
+void MailIndex::clear()
+{
+	memset(header, 0, sizeof(MailIndexHeader));
+	memcpy(header->magic, INDEX_MAGIC, 8);
+}
+
+MailIndexRecord *MailIndex::get(int i)
+{
+	if (i < 0 || i >= size()) return NULL;
+	return records + i;
+}
+
+const char *MailIndex::string(unsigned int offset)
+{
+	if (!pool || offset >= header->pool_size) return "";
+	return pool + offset;
+}
+
+/*
+ *  Makes room for one more record and len bytes of strings. The 
+ *  records and strings got before may move.
+ */
+int MailIndex::reserve(int len)
+{
+	int need;
+	int sz;
+
+	if (!header) return 0;
+	need = sizeof(MailIndexHeader) + 
+		(header->nb_records + 1) * sizeof(MailIndexRecord);
+	if (need > map_size) {
+		sz = map_size;
+		while (sz < need) sz += sz / 2 + INDEX_GROW;
+		header = (MailIndexHeader*) map(fd, map_size, header, sz);
+		if (!header) {
+			records = NULL;
+			return 0;
+		}
+		map_size = sz;
+		records = (MailIndexRecord*) (header + 1);
+	}
+	need = header->pool_size + len;
+	if (need > pool_map_size) {
+		sz = pool_map_size;
+		while (sz < need) sz += sz / 2 + POOL_GROW;
+		pool = (char*) map(pool_fd, pool_map_size, pool, sz);
+		if (!pool) return 0;
+		pool_map_size = sz;
+	}
+	return 1;
+}
+
+unsigned int MailIndex::put_string(const char *s)
+{
+	unsigned int offset = header->pool_size;
+	int l;
+
+	if (!s) s = "";
+	l = strlen(s) + 1;
+	memcpy(pool + offset, s, l);
+	header->pool_size += l;
+	return offset;
+}
+
+/*
+ *  Appends a mail and returns its number. The record is counted last, 
+ *  so a crash cannot leave a half written one in the index.
+ */
+int MailIndex::add(const char *from, const char *subject, const char *file,
+	unsigned int sz, time_t date, unsigned int flags, unsigned int id)
+{
+	MailIndexRecord *r;
+
+	if (!from) from = "";
+	if (!subject) subject = "";
+	if (!file) file = "";
+	if (!reserve(strlen(from) + strlen(subject) + strlen(file) + 3)) {
+		return -1;
+	}
+	r = records + header->nb_records;
+	r->from = put_string(from);
+	r->subject = put_string(subject);
+	r->file = put_string(file);
+	r->date = date;
+	r->size = sz;
+	r->flags = flags;
+	r->id = id;
+	header->nb_records++;
+	return header->nb_records - 1;
+}
+
+/*
+ *  Adds the mails of an index.txt written by an older flmail.
+ */
+void MailIndex::import_txt(const char *path)
+{
+	FILE *fp;
+	char buf[4096];
+
+	fp = fopen(path, "r");
+	if (!fp) return;
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *col[4];
+		char *ptr = buf;
+		struct tm tm;
+		unsigned int flags = 0;
+		int i;
+
+		if (ptr[0] != '\v') continue;
+		if (ptr[1] == 'b') flags |= MAIL_UNREAD;
+		ptr += 2;
+		for (i = 0; i < 4; i++) {
+			if (i > 0) {
+				if (*ptr == '\v') ptr += 2;
+				if (i == 3) ptr++;
+			}
+			col[i] = ptr;
+			while (*ptr && *ptr != '\f' && *ptr != '\n') ptr++;
+			if (i < 3 && *ptr != '\f') break;
+			*ptr = '\0';
+			ptr++;
+		}
+		if (i < 4) continue;
+		memset(&tm, 0, sizeof(tm));
+		tm.tm_isdst = -1;
+		strptime(col[2], "%a %b %d %H:%M:%S %Y", &tm);
+		add(col[1], col[0], col[3], 0, mktime(&tm), flags, 0);
+	}
+	fclose(fp);
+}
+
+/*
+ * "$Id: $"
+ */
@@ -0,0 +1,109 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#ifndef MailIndex_h
+#define MailIndex_h
+
+#include <time.h>
+
+enum {
+	MAIL_UNREAD = 1,
+};
+
+/*
+ *  One mail of the index. The strings are offsets in the string pool.
+ */
+struct MailIndexRecord {
+	long long date;
+	unsigned int from;
+	unsigned int subject;
+	unsigned int file;
+	unsigned int size;
+	unsigned int flags;
+	unsigned int id;
+};
+
+struct MailIndexHeader {
+	char magic[8];
+	unsigned int nb_records;
+	unsigned int pool_size;
+	unsigned int pad[2];
+};
+
+/*
+ *  List of the mails of a folder. The records and the string pool are
+ *  two append-only files mapped in memory : opening a folder reads 
+ *  nothing and the mails of a fetch are added one by one. The files are
+ *  grown by large steps, nb_records and pool_size tell how much of them
+ *  is used.
+ */
+class MailIndex {
+public:
+	char *dir;
+	int fd;
+	int pool_fd;
+	int map_size;
+	int pool_map_size;
+	MailIndexHeader *header;
+	MailIndexRecord *records;
+	char *pool;
+
+	MailIndex(const char *d);
+	~MailIndex(void);
+
+	int size(void) { return header ? (int) header->nb_records : 0; }
+	MailIndexRecord *get(int i);
+	const char *string(unsigned int offset);
+	int add(const char *from, const char *subject, const char *file,
+		unsigned int size, time_t date, unsigned int flags, 
+		unsigned int id);
+	void import_txt(const char *path);
+	void clear(void);
+	int reserve(int len);
+	unsigned int put_string(const char *s);
+	static void *map(int fd, int old_size, void *old, int size);
+};
+
+#endif
+
+/*
+ * "$Id: $"
+ */
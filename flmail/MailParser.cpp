@@ -48,6 +48,9 @@
 #include <libintl.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
 #include "xd640/Xd6XmlUtils.h"
 #include "MailParser.h"
 
@@ -57,14 +60,36 @@
 extern char **environ;
 extern time_t mutt_parse_date(const char *s);
 
-static unsigned char fromhex(char cc)
+#define IN_BLOCK (64 * 1024)
+#define TEXT_FLUSH (64 * 1024)
+
+static int hexval(int c)
 {
-	unsigned char c = (unsigned char) cc;
-	if (c >= 0x41 && c <= 0x46) {
-		return c - 0x41 + 10;
-	} else {
-		return c - 0x30;
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+/*
+ *  Decodes the =XX escapes of a quoted-printable line in place.
+ */
+static int decode_quoted(char *s, int len)
+{
+	int i = 0;
+	int n = 0;
+
+	while (i < len) {
+		if (s[i] == '=' && i + 2 < len && hexval(s[i + 1]) >= 0 &&
+			hexval(s[i + 2]) >= 0)
+		{
+			s[n++] = (hexval(s[i + 1]) << 4) | hexval(s[i + 2]);
+			i += 3;
+		} else {
+			s[n++] = s[i++];
+		}
 	}
+	return n;
 }
 
 MailParser::MailParser()
@@ -83,12 +108,52 @@ MailParser::MailParser()
 	Date = NULL;
 	Content_Type = NULL;
 	Content_Transfer_Encoding = NULL;
+	Content_Disposition = NULL;
+	charset = C_UTF8;
+	date_time = 0;
+
+	in = NULL;
+	page = NULL;
+	in_size = IN_BLOCK;
+	in_buf = (char*)malloc(in_size + 1);
+	in_pos = 0;
+	in_end = 0;
+	in_eof = 1;
+
+	bounds = NULL;
+	nb_bounds = 0;
+	last_bound = -1;
+	last_close = 0;
+
+	text_size = 1024;
+	text = (char*)malloc(text_size + 1);
+	text_len = 0;
+	search = NULL;
+
+	parts_dir = NULL;
+	part_fp = NULL;
+	part_tmp = NULL;
+	part_key = 0;
+	dec = NULL;
+	dec_size = 0;
 }
 
 MailParser::~MailParser()
 {
+	reset();
 	free(xml);
 	free(buf);
+	free(in_buf);
+	free(bounds);
+	free(text);
+	free(dec);
+}
+
+/*
+ *  Forgets the headers of the previous mail.
+ */
+void MailParser::reset()
+{
 	free(Message_ID);
 	free(Subject);
 	free(To);
@@ -98,19 +163,52 @@ MailParser::~MailParser()
 	free(Date);
 	free(Content_Type);
 	free(Content_Transfer_Encoding);
+	free(Content_Disposition);
+	Message_ID = NULL;
+	Subject = NULL;
+	To = NULL;
+	Reply_To = NULL;
+	Cc = NULL;
+	From = NULL;
+	Date = NULL;
+	Content_Type = NULL;
+	Content_Transfer_Encoding = NULL;
+	Content_Disposition = NULL;
+	charset = C_UTF8;
+	date_time = 0;
+
+	while (nb_bounds > 0) free(bounds[--nb_bounds]);
+	last_bound = -1;
+	last_close = 0;
+	in_pos = 0;
+	in_end = 0;
+	in_eof = 0;
+	text_len = 0;
+	free(parts_dir);
+	parts_dir = NULL;
 }
 
 static int selfile(const struct dirent *d)
 {
-	int i;
-	return sscanf(d->d_name, "download.%d.txt", &i);
+	int i, l;
+	l = strlen(d->d_name);
+	return l > 4 && !strcmp(d->d_name + l - 4, ".txt") &&
+		sscanf(d->d_name, "download.%d.txt", &i) == 1;
 }
 
 void MailParser::double_buffer()
 {
 	buf_len *= 2;
-	xml_len *= 2;
 	buf = (char*) realloc(buf, buf_len);
+}
+
+/*
+ *  Makes xml big enough for the conversion of len chars.
+ */
+void MailParser::grow_xml(int len)
+{
+	if (xml_len > 6 * len) return;
+	while (xml_len <= 6 * len) xml_len *= 2;
 	xml = (char*) realloc(xml, xml_len);
 }
 
@@ -182,47 +280,116 @@ int MailParser::decode_header()
 	return n;
 }
 
-int MailParser::get_header_line(FILE *fp) 
+/*
+ *  Reads the next block of the mail after what is left in in_buf.
+ */
+int MailParser::fill()
+{
+	int r;
+
+	if (in_eof) return 0;
+	if (in_pos > 0) {
+		memmove(in_buf, in_buf + in_pos, in_end - in_pos);
+		in_end -= in_pos;
+		in_pos = 0;
+	}
+	if (in_end == in_size) {
+		in_size *= 2;
+		in_buf = (char*) realloc(in_buf, in_size + 1);
+	}
+	r = fread(in_buf + in_end, 1, in_size - in_end, in);
+	if (r <= 0) {
+		in_eof = 1;
+		return 0;
+	}
+	in_end += r;
+	return r;
+}
+
+int MailParser::peek()
 {
-	int c;
+	if (in_pos >= in_end && !fill()) return EOF;
+	return (unsigned char) in_buf[in_pos];
+}
+
+/*
+ *  Points line to the next line in the input buffer and returns its 
+ *  length, '\n' included. Returns 0 at the end of the mail. The line 
+ *  may be modified in place and is valid until the next call.
+ */
+int MailParser::read_line(char **line)
+{
+	char *nl;
+	int scanned = 0;
+	int l;
+
+	for (;;) {
+		nl = (char*) memchr(in_buf + in_pos + scanned, '\n', 
+			in_end - in_pos - scanned);
+		if (nl) break;
+		scanned = in_end - in_pos;
+		if (!fill()) break;
+	}
+	if (nl) {
+		l = nl - (in_buf + in_pos) + 1;
+	} else {
+		l = in_end - in_pos;
+	}
+	*line = in_buf + in_pos;
+	in_pos += l;
+	return l;
+}
+
+/*
+ *  Reads a header in buf, joining its folded lines. Returns 0 on the
+ *  empty line that ends the headers.
+ */
+int MailParser::get_header_line() 
+{
+	char *line;
+	int l;
 	int i = 0;
+	int c;
+
 	buf[0] = '\0';
-	while ((c = fgetc(fp)) != EOF) {
-		if (buf_len < i + 10) {
-			double_buffer();
+	for (;;) {
+		l = read_line(&line);
+		if (l < 1) break;
+		while (l > 0 && (line[l - 1] == '\n' || line[l - 1] == '\r')) {
+			l--;
 		}
-		if (c == '\n') {
-			if (i == 0) return 0;
-			if ((c = fgetc(fp)) == '\t' || c == ' ') {
-				buf[i] = ' ';
-			} else {
-				ungetc(c, fp);
-				break;
-			}
-		} else {
-			buf[i] = (unsigned char) c;
+		if (i == 0 && l == 0) return 0;
+		if (i > 0) {
+			line++;
+			l--;
 		}
-		i++;
+		while (buf_len < i + l + 10) {
+			double_buffer();
+		}
+		if (i > 0) buf[i++] = ' ';
+		memcpy(buf + i, line, l);
+		i += l;
+		c = peek();
+		if (c != ' ' && c != '\t') break;
 	}
 	buf[i] = '\0';
+	if (i == 0) return 0;
 	return decode_header();
 }
 
-void MailParser::mail2html(const char *f, const char *p, FILE *index)
+/*
+ *  Reads the headers of a MIME part.
+ */
+void MailParser::read_headers()
 {
-	FILE *file_fp;
-	FILE *box_fp;
-	int l;
-	char *t;
-	snprintf(buf, 1024, "%s/%s", p, f);
-	box_fp = fopen(buf, "r");
-	if (!box_fp) return;
-	//unlink(buf);
-	snprintf(buf, 1024, "%s/%s.html", p, f);
-	file_fp = fopen(buf, "w");
-	fprintf(file_fp, "<html><head></head><body><form>\n");
+	free(Content_Type);
+	free(Content_Transfer_Encoding);
+	free(Content_Disposition);
+	Content_Type = NULL;
+	Content_Transfer_Encoding = NULL;
+	Content_Disposition = NULL;
 
-	while ((l = get_header_line(box_fp)) > 0) {
+	while (get_header_line() > 0) {
 		char *ptr;
 	
 		ptr = buf;
@@ -232,330 +399,534 @@ void MailParser::mail2html(const char *f, const char *p, FILE *index)
 			ptr++;
 			if (*ptr) ptr++;
 		}
-
-		if (!strcmp("Message-ID", buf)) {
-			Message_ID = strdup(ptr);
-		} else if (!strcmp("Subject", buf)) {
-			Subject = strdup(ptr);
-		} else if (!strcmp("To", buf)) {
-			To = strdup(ptr);
-		} else if (!strcmp("Reply-To", buf)) {
-			Reply_To = strdup(ptr);
-		} else if (!strcmp("Cc", buf)) {
-			Cc = strdup(ptr);
-		} else if (!strcmp("From", buf)) {
-			From = strdup(ptr);
-		} else if (!strcmp("Date", buf)) {
-			Date = strdup(ptr);
-		} else if (!strcmp("Content-Type", buf)) {
+		if (!strcasecmp("Content-Type", buf)) {
+			free(Content_Type);
 			Content_Type = strdup(ptr);
-		} else if (!strcmp("Content-Transfer-Encoding", buf)) {
+		} else if (!strcasecmp("Content-Transfer-Encoding", buf)) {
+			free(Content_Transfer_Encoding);
 			Content_Transfer_Encoding = strdup(ptr);
+		} else if (!strcasecmp("Content-Disposition", buf)) {
+			free(Content_Disposition);
+			Content_Disposition = strdup(ptr);
 		}
-		fprintf(file_fp, "<input type=\"hidden\"");
-		utf2xml(buf, strlen(buf), xml);
-		fprintf(file_fp, " name=\"%s", xml);
-		utf2xml(ptr, strlen(ptr), xml);
-		fprintf(file_fp, "\" value=\"%s\" >\n", xml);
 	}
+}
 
-	if (Subject) {
-		utf2xml(Subject, strlen(Subject), xml);
-		fprintf(file_fp, _("<b>Subject:</b> %s <br/>\n"), xml);		
-	}
-	if (From) {
-		utf2xml(From, strlen(From), xml);
-		fprintf(file_fp, _("<b>From:</b> %s <br/>\n"), xml);		
+/*
+ *  Returns the value of the parameter name of a header such as
+ *  'text/plain; charset="utf-8"', or NULL.
+ */
+char *MailParser::get_param(const char *header, const char *name)
+{
+	const char *ptr;
+	const char *v;
+	char *ret;
+	int nl;
+
+	if (!header) return NULL;
+	nl = strlen(name);
+	ptr = header;
+	while ((ptr = strchr(ptr, ';'))) {
+		ptr++;
+		while (*ptr == ' ' || *ptr == '\t') ptr++;
+		if (strncasecmp(ptr, name, nl)) continue;
+		v = ptr + nl;
+		while (*v == ' ') v++;
+		if (*v != '=') continue;
+		v++;
+		while (*v == ' ') v++;
+		if (*v == '"') {
+			v++;
+			ptr = v;
+			while (*ptr && *ptr != '"') ptr++;
+		} else {
+			ptr = v;
+			while (*ptr && *ptr != ';' && *ptr != ' ' && 
+				*ptr != '\t') 
+			{
+				ptr++;
+			}
+		}
+		ret = (char*) malloc(ptr - v + 1);
+		memcpy(ret, v, ptr - v);
+		ret[ptr - v] = '\0';
+		return ret;
 	}
-	if (To) {
-		utf2xml(To, strlen(To), xml);
-		fprintf(file_fp, _("<b>To:</b> %s <br/>\n"), xml);		
+	return NULL;
+}
+
+int MailParser::get_encoding(const char *header)
+{
+	if (!header) return E_IDENTITY;
+	while (*header == ' ') header++;
+	if (!strncasecmp(header, "base64", 6)) return E_BASE64;
+	if (!strncasecmp(header, "quoted-printable", 16)) return E_QUOTED;
+	return E_IDENTITY;
+}
+
+/*
+ *  Checks if line is the boundary of one of the enclosing multiparts.
+ *  last_bound is set to its depth and last_close if it ends the 
+ *  multipart.
+ */
+int MailParser::is_boundary(const char *line, int len)
+{
+	int i, bl;
+
+	if (len < 3 || line[0] != '-' || line[1] != '-') return 0;
+	for (i = nb_bounds - 1; i >= 0; i--) {
+		bl = strlen(bounds[i]);
+		if (len < bl || memcmp(line, bounds[i], bl)) continue;
+		last_bound = i;
+		last_close = (len >= bl + 2 && line[bl] == '-' && 
+			line[bl + 1] == '-');
+		return 1;
 	}
-	if (Cc) {
-		utf2xml(Cc, strlen(Cc), xml);
-		fprintf(file_fp, _("<b>Cc:</b> %s <br/>\n"), xml);		
+	return 0;
+}
+
+/*
+ *  Decodes the body of the current part up to the next boundary and 
+ *  sends it to the page or to the part file. Returns 1 if it ended on
+ *  a boundary, 0 at the end of the mail.
+ */
+int MailParser::read_body(int encoding, int to_text)
+{
+	char *line;
+	char *data;
+	int l, n;
+	int nl = 0;
+
+	b64 = Xd6Base64();
+	last_bound = -1;
+	last_close = 0;
+	while ((l = read_line(&line)) > 0) {
+		if (nb_bounds > 0 && is_boundary(line, l)) return 1;
+		n = l;
+		if (line[n - 1] == '\n') {
+			n--;
+			if (n > 0 && line[n - 1] == '\r') n--;
+		}
+		data = line;
+		if (encoding == E_BASE64) {
+			if (dec_size < Xd6Base64::decode_size(n)) {
+				dec_size = Xd6Base64::decode_size(n) + 4096;
+				dec = (unsigned char*) realloc(dec, dec_size);
+			}
+			n = b64.decode(line, n, dec);
+			data = (char*) dec;
+		} else {
+			/* the last line break belongs to the boundary */
+			if (nl) {
+				if (to_text) put_text("\n", 1);
+				else put_part("\n", 1);
+			}
+			nl = 1;
+			if (encoding == E_QUOTED) {
+				while (n > 0 && (line[n - 1] == ' ' || 
+					line[n - 1] == '\t')) 
+				{
+					n--;
+				}
+				if (n > 0 && line[n - 1] == '=') {
+					n--;
+					nl = 0;
+				}
+				n = decode_quoted(line, n);
+			}
+		}
+		if (to_text) put_text(data, n);
+		else put_part(data, n);
 	}
-	if (Reply_To) {
-		utf2xml(Reply_To, strlen(Reply_To), xml);
-		fprintf(file_fp, _("<b>Reply-To:</b> %s <br/>\n"), xml);
+	return 0;
+}
+
+void MailParser::put_text(const char *data, int len)
+{
+	if (len < 1) return;
+	if (text_len + len > text_size) {
+		while (text_len + len > text_size) text_size *= 2;
+		text = (char*) realloc(text, text_size + 1);
 	}
-	if (Date) {
-		utf2xml(Date, strlen(Date), xml);
-		fprintf(file_fp, _("<b>Date:</b> %s <br/><hr/>\n"), xml);
-		date_time = mutt_parse_date(Date);
+	memcpy(text + text_len, data, len);
+	text_len += len;
+	if (text[text_len - 1] == '\n' || text_len >= TEXT_FLUSH) {
+		flush_text(0);
 	}
-	
-	fprintf(file_fp, "</form>\n");
+}
 
-	if (!Content_Type) {
-		while (fgets(buf, buf_len, box_fp)) {
-			utf2xml(buf, strlen(buf), xml);
-			fprintf(file_fp, "%s", xml);
+/*
+ *  Writes the complete lines of text to the page, or all of it.
+ */
+void MailParser::flush_text(int all)
+{
+	int l = text_len;
+	int n;
+
+	if (!all) {
+		while (l > 0 && text[l - 1] != '\n') l--;
+		if (l == 0) {
+			if (text_len < TEXT_FLUSH) return;
+			/* a very long line, do not cut an utf-8 char */
+			l = text_len;
+			while (l > 0 && (text[l - 1] & 0xC0) == 0x80) l--;
+			if (l > 0 && (text[l - 1] & 0xC0) == 0xC0) l--;
+			if (l == 0) l = text_len;
 		}
-	} else if (strstr(Content_Type, "multipart/alternative;")) {
-		print_multipart(box_fp, file_fp);
-	} else if (strstr(Content_Type, "multipart/mixed;")) {
-		print_multipart(box_fp, file_fp);
-	} else if (strstr(Content_Type, "text/plain;") ||
-		strstr(Content_Type, "TEXT/PLAIN;")) 
-	{
-		print_text_plain(box_fp, file_fp);
-	} else if (strstr(Content_Type, "text/html;")) {
-
+	}
+	if (l < 1) return;
+	grow_xml(l);
+	if (charset == C_ISO) {
+		if (search) search->add_text(text, l, 1);
+		n = latin12xml(text, l, xml);
+	} else if (charset == C_UTF7) {
+		char c = text[l];
+		int ul = utf72utf8(text, l);
+		if (search) search->add_text(text, ul, 0);
+		n = utf2xml(text, ul, xml);
+		text[l] = c;
 	} else {
-		while (fgets(buf, buf_len, box_fp)) {
-			utf2xml(buf, strlen(buf), xml);
-			fprintf(file_fp, "%s", xml);
-		}
+		if (search) search->add_text(text, l, 0);
+		n = utf2xml(text, l, xml);
 	}
-	fprintf(file_fp, "</body></html>\n");
-	fclose(box_fp);
-	fclose(file_fp);
-	t = ctime(&date_time);
-	t[strlen(t) - 1] = '\0';
-	fprintf(index, "\vb%s\f\vi%s\f%s\f\vC7%s\n", Subject, From, 
-		t, Message_ID);
-	snprintf(buf, 1024, "%s/%s.html", p, f);
-	snprintf(xml, 1024, "%s/%s", p, Message_ID);
-	rename(buf, xml);
+	fwrite(xml, 1, n, page);
+	memmove(text, text + l, text_len - l);
+	text_len -= l;
 }
 
-int MailParser::get_quoted_line(FILE *fp, char *b, int bl)
+void MailParser::put_part(const char *data, int len)
 {
-	int c;
-	int i = 0;
-	buf[0] = '\0';
-	int bound = 1;
+	int i;
 
-	while ((c = fgetc(fp)) != EOF) {
-		if (buf_len < i + 10) {
-			double_buffer();
-		}
-		
-		if (b && bound && i < bl) {
-			if (b[i] != c) bound = 0;
-		}
-		if (!bound && c == '=') {
-			if ((c = fgetc(fp)) && c == '\n') {
-				continue;
-			} else {
-				buf[i] = fromhex(c) << 4;
-				c = fgetc(fp);
-				buf[i] |= fromhex(c);
-			}
-		} else if (c == '\n') {
-			buf[i++] = c;
-			break;
-		} else {
-			buf[i] = (unsigned char) c;
-		}
-		i++;
+	if (!part_fp || len < 1) return;
+	fwrite(data, 1, len, part_fp);
+	for (i = 0; i < len; i++) {
+		part_key ^= (unsigned char) data[i];
+		part_key *= 1099511628211ULL;
 	}
-	buf[i] = '\0';
-	if (bound && i >= bl) return 0;
-	return i;
 }
 
-char *MailParser::get_boundary()
+/*
+ *  Starts a side file for the body of the current part.
+ */
+int MailParser::open_part()
 {
-	char *boundary = NULL;
-	char *ptr;
-	char *c;
-	char *b;
-
-	c = strdup(Content_Type);
-	ptr = strstr(c, "boundary");
-	if (!ptr) {
-		free(c);
-		return NULL;
-	}
-	while (*ptr && *ptr != '"') ptr++;
-	if (*ptr) ptr++;
-	b = ptr;
-	while (*ptr && *ptr != '"') ptr++;
-	*ptr = '\0';
-	boundary = (char*) malloc(strlen(b) + 10);
-	sprintf(boundary, "--%s", b);
-	free(c);
-	return boundary;
+	if (!parts_dir) return 0;
+	part_tmp = (char*) malloc(strlen(parts_dir) + 16);
+	sprintf(part_tmp, "%s/part.tmp", parts_dir);
+	part_fp = fopen(part_tmp, "wb");
+	if (!part_fp) {
+		free(part_tmp);
+		part_tmp = NULL;
+		return 0;
+	}
+	part_key = 14695981039346656037ULL;
+	return 1;
 }
 
-void MailParser::print_multipart(FILE *in, FILE *out)
+/*
+ *  Names the side file after the hash of its content, keeping the 
+ *  extension of the attachment. An attachment already received is not
+ *  stored twice. Returns the path of the file.
+ */
+char *MailParser::close_part(const char *name)
 {
-	char *b = get_boundary();
-	int bl;
-	int l;
+	const char *ext = "";
+	const char *ptr;
+	char *file;
+	struct stat st;
+
+	fclose(part_fp);
+	part_fp = NULL;
+
+	ptr = strrchr(name, '.');
+	if (ptr && strlen(ptr) < 8 && !strchr(ptr, '/')) ext = ptr;
+	file = (char*) malloc(strlen(parts_dir) + strlen(ext) + 20);
+	sprintf(file, "%s/%016llx%s", parts_dir, part_key, ext);
+	if (!stat(file, &st)) {
+		unlink(part_tmp);
+	} else {
+		rename(part_tmp, file);
+	}
+	free(part_tmp);
+	part_tmp = NULL;
+	return file;
+}
+
+/*
+ *  Prints the body of a message or of a MIME part.
+ */
+void MailParser::print_part()
+{
+	const char *t = Content_Type ? Content_Type : "text/plain";
+	
+	while (*t == ' ') t++;
+	if (!strncasecmp(t, "multipart/", 10)) {
+		print_multipart();
+	} else if (!strncasecmp(t, "text/plain", 10) && (!Content_Disposition
+		|| strncasecmp(Content_Disposition, "attachment", 10)))
+	{
+		print_text_plain();
+	} else {
+		print_application();
+	}
+}
+
+void MailParser::print_multipart()
+{
+	char *b = get_param(Content_Type, "boundary");
+	int depth;
 	
-	if (!b) return;
-	bl = strlen(b);
+	if (!b) {
+		read_body(E_IDENTITY, 0);
+		return;
+	}
+	bounds = (char**) realloc(bounds, (nb_bounds + 1) * sizeof(char*));
+	bounds[nb_bounds] = (char*) malloc(strlen(b) + 3);
+	sprintf(bounds[nb_bounds], "--%s", b);
+	free(b);
+	depth = nb_bounds++;
+
+	/* skip the preamble */
+	read_body(E_IDENTITY, 0);
+	while (last_bound == depth && !last_close) {
+		read_headers();
+		print_part();
+	}
+	nb_bounds--;
+	free(bounds[depth]);
 
-	while (fgets(buf, buf_len, in)) {
-		if (!strncmp(buf, b, bl)) {
-			if (buf[bl] == '-' && buf[bl + 1] == '-') return;
-			break;
-		}
+	/* skip the epilogue */
+	if (last_bound == depth) read_body(E_IDENTITY, 0);
+}
+
+void MailParser::print_application()
+{
+	char *name;
+	char *file = NULL;
+	const char *t = Content_Type ? Content_Type : "text/plain";
+
+	name = get_param(Content_Type, "name");
+	if (!name) name = get_param(Content_Disposition, "filename");
+	if (!name) {
+		while (*t == ' ') t++;
+		if (!strncasecmp(t, "text/html", 9)) name = strdup("data.html");
+		else name = strdup("data.bin");
 	}
 
-	while (!feof(in)) {
-		while ((l = get_header_line(in)) > 0) {
-			char *ptr;
-		
-			ptr = buf;
-			while (*ptr && *ptr != ':') ptr++;
-			if (*ptr) {
-				*ptr = '\0';
-				ptr++;
-				if (*ptr) ptr++;
-			}
-			if (!strcmp("Content-Type", buf)) {
-				free(Content_Type);
-				Content_Type = strdup(ptr);
-			} else if (!strcmp("Content-Transfer-Encoding", buf)) {
-				free(Content_Transfer_Encoding);
-				Content_Transfer_Encoding = strdup(ptr);
-			}
-		}
-		if (strstr(Content_Type, "text/plain;") ||
-			strstr(Content_Type, "TEXT/PLAIN;")) 
+	if (open_part()) {
+		read_body(get_encoding(Content_Transfer_Encoding), 0);
+		file = close_part(name);
+	} else {
+		read_body(E_IDENTITY, 0);
+	}
+
+	fprintf(page, _("<br />Attachment: "));
+	if (file) {
+		grow_xml(strlen(file));
+		utf2xml(file, strlen(file), xml);
+		while (*t == ' ') t++;
+		if (!strncasecmp(t, "image/png", 9) || 
+			!strncasecmp(t, "image/gif", 9) ||
+			!strncasecmp(t, "image/jpeg", 10))
 		{
-			print_text_plain(in, out, b);
-		} else {
-			print_application(in, out, b);
+			fprintf(page, "<br />\n<img src=\"file://%s\" />"
+				"<br />\n", xml);
 		}
-		if (buf[bl] == '-' && buf[bl + 1] == '-') return;
+		fprintf(page, " <a href=\"file://%s\" ", xml);
+	} else {
+		fprintf(page, " <a ");
 	}
+	grow_xml(strlen(name));
+	utf2xml(name, strlen(name), xml);
+	fprintf(page, "name=\"%s\">\n %s</a>", xml, xml);
+	grow_xml(strlen(t));
+	utf2xml(t, strlen(t), xml);
+	fprintf(page, " (%s)\n", xml);
+	free(name);
+	free(file);
 }
 
-void MailParser::print_application(FILE *in, FILE *out, char *b = NULL)
+void MailParser::print_text_plain()
 {
-	int bl = 0;
-	char *ptr;
-	char *name = "data.bin";
+	char *cs = get_param(Content_Type, "charset");
+
+	charset = C_UTF8;
+	if (cs) {
+		if (!strncasecmp(cs, "iso-8859-", 9)) {
+			// we only support iso-8859-1 !
+			charset = C_ISO;
+		} else if (!strcasecmp(cs, "utf-7")) {
+			charset = C_UTF7;
+		}
+		free(cs);
+	}
+	fprintf(page, "<pre\n>");
+	text_len = 0;
+	read_body(get_encoding(Content_Transfer_Encoding), 1);
+	flush_text(1);
+	fprintf(page, "</pre\n>");
+}
 
-	if (b) {
-		bl = strlen(b);
+void MailParser::mail2html(const char *f, const char *p, MailIndex *index)
+{
+	struct stat st;
+	unsigned int size = 0;
+	int l, n;
+	char *id;
+
+	reset();
+	snprintf(buf, 1024, "%s/%s", p, f);
+	in = fopen(buf, "r");
+	if (!in) return;
+	if (!fstat(fileno(in), &st)) size = st.st_size;
+	//unlink(buf);
+	snprintf(buf, 1024, "%s/%s.html", p, f);
+	page = fopen(buf, "w");
+	if (!page) {
+		fclose(in);
+		return;
 	}
+	parts_dir = (char*) malloc(strlen(p) + 10);
+	sprintf(parts_dir, "%s/parts", p);
+	mkdir(parts_dir, S_IRWXU);
+	fprintf(page, "<html><head></head><body><form>\n");
+
+	while ((l = get_header_line()) > 0) {
+		char *ptr;
 	
-	ptr = strstr(Content_Type, "name");
-	if (ptr) {	
-		while (*ptr && *ptr != '"') ptr++;
-		if (*ptr) ptr++;
+		ptr = buf;
+		while (*ptr && *ptr != ':') ptr++;
 		if (*ptr) {
-			name = ptr;
-			while (*ptr && *ptr != '"') ptr++;
 			*ptr = '\0';
+			ptr++;
+			if (*ptr) ptr++;
 		}
-	}
-	utf2xml(name, strlen(name), xml);
-	fprintf(out, _("<br />Attachment: "));
-	fprintf(out, " <a name=\"%s\" ", xml);
-	fprintf(out, "\nhref=\"data:application/octet-stream;base64,\n");
 
-	if (strstr(Content_Transfer_Encoding, "quoted-printable")) {
-		while (fgets(buf, buf_len, in)) {
-			if (b && !strncmp(buf, b, bl)) break;
-		}
-	} else if (strstr(Content_Transfer_Encoding, "base64")) {
-		while (fgets(buf, buf_len, in)) {
-			if (b && !strncmp(buf, b, bl)) break;
-			fprintf(out, "%s", buf);
-		}
-	} else {
-		while (fgets(buf, buf_len, in)) {
-			if (b && !strncmp(buf, b, bl)) break;
+		if (!strcasecmp("Message-ID", buf)) {
+			Message_ID = strdup(ptr);
+		} else if (!strcasecmp("Subject", buf)) {
+			Subject = strdup(ptr);
+		} else if (!strcasecmp("To", buf)) {
+			To = strdup(ptr);
+		} else if (!strcasecmp("Reply-To", buf)) {
+			Reply_To = strdup(ptr);
+		} else if (!strcasecmp("Cc", buf)) {
+			Cc = strdup(ptr);
+		} else if (!strcasecmp("From", buf)) {
+			From = strdup(ptr);
+		} else if (!strcasecmp("Date", buf)) {
+			Date = strdup(ptr);
+		} else if (!strcasecmp("Content-Type", buf)) {
+			Content_Type = strdup(ptr);
+		} else if (!strcasecmp("Content-Transfer-Encoding", buf)) {
+			Content_Transfer_Encoding = strdup(ptr);
+		} else if (!strcasecmp("Content-Disposition", buf)) {
+			Content_Disposition = strdup(ptr);
 		}
-
+		grow_xml(l);
+		fprintf(page, "<input type=\"hidden\"");
+		utf2xml(buf, strlen(buf), xml);
+		fprintf(page, " name=\"%s", xml);
+		utf2xml(ptr, strlen(ptr), xml);
+		fprintf(page, "\" value=\"%s\" >\n", xml);
 	}
-	utf2xml(name, strlen(name), xml);
-	fprintf(out, "\">\n %s</a> (%s)\n", xml, Content_Type);
-}
 
-void MailParser::print_text_plain(FILE *in, FILE *out, char *b = NULL)
-{
-	int bl = 0;
-	
-	if (b) {
-		bl = strlen(b);
+	if (Subject) {
+		grow_xml(strlen(Subject));
+		utf2xml(Subject, strlen(Subject), xml);
+		fprintf(page, _("<b>Subject:</b> %s <br/>\n"), xml);		
 	}
-	fprintf(out, "<pre\n>");
-	if (strstr(Content_Type, "ISO-8859-") ||
-		strstr(Content_Type, "iso-8859-"))
-	{
-		// we only support iso-8859-1 !
-		charset = C_ISO;
-	} else if (strstr(Content_Type, "utf-7") ||
-		strstr(Content_Type, "UTF-7")) {
-		charset = C_UTF7;
-	} else {
-		charset = C_UTF8;
-	}
-	if (strstr(Content_Transfer_Encoding, "quoted-printable")) {
-		int l;
-		if (charset == C_UTF8) {
-			while ((l = get_quoted_line(in, b, bl))) {
-				utf2xml(buf, strlen(buf), xml);
-				fprintf(out, "%s", xml);
-			}
-		} else if (charset == C_ISO) {
-			while ((l = get_quoted_line(in, b, bl))) {
-				latin12xml(buf, strlen(buf), xml);
-				fprintf(out, "%s", xml);
-			}
-		} else {
-			while ((l = get_quoted_line(in, b, bl))) {
-				utf72utf8(buf, buf_len);
-				utf2xml(buf, strlen(buf), xml);
-				fprintf(out, "%s", xml);
-			}
+	if (From) {
+		grow_xml(strlen(From));
+		utf2xml(From, strlen(From), xml);
+		fprintf(page, _("<b>From:</b> %s <br/>\n"), xml);		
+	}
+	if (To) {
+		grow_xml(strlen(To));
+		utf2xml(To, strlen(To), xml);
+		fprintf(page, _("<b>To:</b> %s <br/>\n"), xml);		
+	}
+	if (Cc) {
+		grow_xml(strlen(Cc));
+		utf2xml(Cc, strlen(Cc), xml);
+		fprintf(page, _("<b>Cc:</b> %s <br/>\n"), xml);		
+	}
+	if (Reply_To) {
+		grow_xml(strlen(Reply_To));
+		utf2xml(Reply_To, strlen(Reply_To), xml);
+		fprintf(page, _("<b>Reply-To:</b> %s <br/>\n"), xml);
+	}
+	if (Date) {
+		grow_xml(strlen(Date));
+		utf2xml(Date, strlen(Date), xml);
+		fprintf(page, _("<b>Date:</b> %s <br/><hr/>\n"), xml);
+		date_time = mutt_parse_date(Date);
+	}
+	
+	fprintf(page, "</form>\n");
+
+	if (search) {
+		search->begin(index->size());
+		if (Subject) {
+			search->start_field(SEARCH_SUBJECT);
+			search->add_text(Subject, strlen(Subject), 0);
 		}
-	} else if (strstr(Content_Transfer_Encoding, "base64")) {
-			while (fgets(buf, buf_len, in)) {
-				if (b && !strncmp(buf, b, bl)) break;
-			}
-	} else {
-		if (charset == C_UTF8) {
-			while (fgets(buf, buf_len, in)) {
-				if (b && !strncmp(buf, b, bl)) break;
-				utf2xml(buf, strlen(buf), xml);
-				fprintf(out, "%s", xml);
-			}
-		} else if (charset == C_ISO) {
-			while (fgets(buf, buf_len, in)) {
-				if (b && !strncmp(buf, b, bl)) break;
-				latin12xml(buf, strlen(buf), xml);
-				fprintf(out, "%s", xml);
-			}
-		} else {
-			while (fgets(buf, buf_len, in)) {
-				if (b && !strncmp(buf, b, bl)) break;
-				utf72utf8(buf, buf_len);
-				utf2xml(buf, strlen(buf), xml);
-				fprintf(out, "%s", xml);
-			}
+		if (From) {
+			search->start_field(SEARCH_FROM);
+			search->add_text(From, strlen(From), 0);
 		}
+		search->start_field(SEARCH_BODY);
+	}
+	print_part();
+	if (search) search->end();
+
+	fprintf(page, "</body></html>\n");
+	fclose(in);
+	fclose(page);
+	in = NULL;
+	page = NULL;
+	n = index->size();
+	if (Message_ID) {
+		id = strdup(Message_ID);
+	} else {
+		id = (char*) malloc(32);
+		sprintf(id, "mail.%d.html", n);
 	}
-	fprintf(out, "</pre\n>");
-		
+	snprintf(buf, 1024, "%s/%s.html", p, f);
+	snprintf(xml, 1024, "%s/%s", p, id);
+	rename(buf, xml);
+
+	/* keep the mail out of the next scans */
+	snprintf(buf, 1024, "%s/%s", p, f);
+	snprintf(xml, 1024, "%s/mail.%d.txt", p, n);
+	rename(buf, xml);
+	
+	sscanf(f, "download.%d.txt", &n);
+	index->add(From, Subject, id, size, date_time, MAIL_UNREAD, n);
+	free(id);
 }
 
-void MailParser::mailbox2html(const char *path)
+/*
+ *  Converts the mails fetched since the last call and adds them to the
+ *  index of the folder, and to its full text index s if not NULL.
+ */
+void MailParser::mailbox2html(const char *path, MailIndex *index, 
+	MailSearch *s)
 {
-	char buf[1024];
-	FILE *index_fp;
 	int nbd;
 	struct dirent **namelist = NULL;
 	int i;
 	
+	search = s;
 	nbd = scandir(path, &namelist, selfile, alphasort);
-	snprintf(buf, 1024, "%s/index.txt", path);
-	index_fp = fopen(buf, "a");
-
 	for (i = 0; i < nbd; i++) {
-		mail2html(namelist[i]->d_name, path, index_fp);
+		mail2html(namelist[i]->d_name, path, index);
 		free(namelist[i]);
 	}
 	free(namelist);
-	fclose(index_fp);
+	if (search) search->flush();
+	search = NULL;
 }
 
 /*
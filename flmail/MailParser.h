@@ -38,10 +38,15 @@
  ******************************************************************************/
 
 
+
 #ifndef Xd6HtmlMailParser_h
 #define Xd6HtmlMailParser_h
 
+#include <stdio.h>
 #include <time.h>
+#include "xd640/Xd6Base64.h"
+#include "MailIndex.h"
+#include "MailSearch.h"
 
 enum {
 	C_UTF8,
@@ -49,6 +54,20 @@ enum {
 	C_ISO,
 };
 
+enum {
+	E_IDENTITY,
+	E_QUOTED,
+	E_BASE64,
+};
+
+/*
+ *  Converts the mails downloaded to a folder to HTML in a single pass.
+ *  The mail is read through a large buffer a line at a time, the body 
+ *  of each MIME part is decoded as it goes by : text is written to the 
+ *  page and attachments to side files named by a hash of their content
+ *  in the "parts" directory of the folder, the page links to them. The
+ *  subject, sender and text go to the full text index on the way.
+ */
 class MailParser {
 public:
 	char *xml;
@@ -64,23 +83,63 @@ public:
 	char *Date;
 	char *Content_Type;
 	char *Content_Transfer_Encoding;
+	char *Content_Disposition;
 	int charset;
 	time_t date_time;
 
+	FILE *in;
+	FILE *page;
+	char *in_buf;
+	int in_size;
+	int in_pos;
+	int in_end;
+	int in_eof;
+
+	char **bounds;
+	int nb_bounds;
+	int last_bound;
+	int last_close;
+
+	char *text;
+	int text_len;
+	int text_size;
+
+	char *parts_dir;
+	FILE *part_fp;
+	char *part_tmp;
+	unsigned long long part_key;
+	Xd6Base64 b64;
+	unsigned char *dec;
+	int dec_size;
+	MailSearch *search;
+
 	MailParser();
 	~MailParser();
-	void mailbox2html(const char *path);
-	void mail2html(const char *f, const char *p, FILE *index);
+	void mailbox2html(const char *path, MailIndex *index, 
+		MailSearch *s);
+	void mail2html(const char *f, const char *p, MailIndex *index);
+	void reset(void);
 	void double_buffer(void);
+	void grow_xml(int len);
 	int decode_header(void);
-	int get_header_line(FILE *fp);
-	int get_quoted_line(FILE *fp, char *b, int bl);
-	void print_text_plain(FILE *in, FILE *out, char *b = NULL);
-	void print_application(FILE *in, FILE *out, char *b = NULL);
-	void print_multipart(FILE *in, FILE *out);
-	void print_mixed(FILE *in, FILE *out);
-	char *get_boundary(void);
-	
+	int fill(void);
+	int peek(void);
+	int read_line(char **line);
+	int get_header_line(void);
+	void read_headers(void);
+	int is_boundary(const char *line, int len);
+	int read_body(int encoding, int to_text);
+	void put_text(const char *data, int len);
+	void flush_text(int all);
+	void put_part(const char *data, int len);
+	int open_part(void);
+	char *close_part(const char *name);
+	void print_part(void);
+	void print_text_plain(void);
+	void print_application(void);
+	void print_multipart(void);
+	static char *get_param(const char *header, const char *name);
+	static int get_encoding(const char *header);
 };
 
 #endif
@@ -0,0 +1,942 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+
+#include "MailSearch.h"
+#include <FL/fl_utf8.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#define SEARCH_MAGIC "XD6SRCH1"
+#define SEARCH_TABLE 4096
+#define SEARCH_MAX_SEGMENTS 8
+#define SEARCH_PENDING (32 * 1024 * 1024)
+
+struct SegmentWriter {
+	FILE *fp;
+	unsigned int data_len;
+	unsigned char *dict;
+	int dict_len;
+	int dict_size;
+	unsigned int *index;
+	int nb;
+	int index_size;
+};
+
+static int put_varint(unsigned char *p, unsigned int v)
+{
+	int l = 0;
+
+	while (v >= 0x80) {
+		p[l++] = (v & 0x7F) | 0x80;
+		v >>= 7;
+	}
+	p[l++] = v;
+	return l;
+}
+
+static unsigned int get_varint(const unsigned char **p, 
+	const unsigned char *e)
+{
+	unsigned int v = 0;
+	int s = 0;
+
+	while (*p < e) {
+		unsigned char c = **p;
+		(*p)++;
+		v |= (c & 0x7F) << s;
+		if (!(c & 0x80) || s > 28) break;
+		s += 7;
+	}
+	return v;
+}
+
+static unsigned int hash(const char *w, int len)
+{
+	unsigned int h = 2166136261U;
+
+	while (len-- > 0) {
+		h ^= (unsigned char) *w++;
+		h *= 16777619;
+	}
+	return h;
+}
+
+static int compare(const unsigned char *a, int al, const char *b, int bl)
+{
+	int r = memcmp(a, b, al < bl ? al : bl);
+
+	if (r) return r;
+	return al - bl;
+}
+
+static int sort_terms(const void *a, const void *b)
+{
+	return strcmp((*(MailSearchTerm**)a)->word, 
+		(*(MailSearchTerm**)b)->word);
+}
+
+static int sort_hits(const void *a, const void *b)
+{
+	const MailSearchHit *x = (const MailSearchHit*) a;
+	const MailSearchHit *y = (const MailSearchHit*) b;
+
+	if (x->doc != y->doc) return x->doc < y->doc ? -1 : 1;
+	if (x->hit != y->hit) return x->hit < y->hit ? -1 : 1;
+	return 0;
+}
+
+static int selseg(const struct dirent *d)
+{
+	int l = strlen(d->d_name);
+
+	return l > 11 && !strncmp(d->d_name, "search.", 7) && 
+		!strcmp(d->d_name + l - 4, ".seg");
+}
+
+/*
+ *  Decodes the word i of segment s.
+ */
+static const unsigned char *entry(MailSearchSegment *s, int i, int *wl,
+	unsigned int *off, unsigned int *len, unsigned int *last)
+{
+	const unsigned char *e = s->map + s->size;
+	const unsigned char *p = s->map + s->index[i];
+	const unsigned char *w;
+
+	*wl = get_varint(&p, e);
+	w = p;
+	if (*wl > e - p) *wl = e - p;
+	p += *wl;
+	*off = get_varint(&p, e);
+	*len = get_varint(&p, e);
+	*last = get_varint(&p, e);
+	if (*off > s->header->terms_offset - sizeof(MailSearchHeader) ||
+		*len > s->header->terms_offset - sizeof(MailSearchHeader) - 
+		*off)
+	{
+		*len = 0;
+	}
+	return w;
+}
+
+static int writer_open(SegmentWriter *w, const char *file)
+{
+	MailSearchHeader h;
+
+	memset(w, 0, sizeof(SegmentWriter));
+	w->fp = fopen(file, "w");
+	if (!w->fp) return -1;
+	memset(&h, 0, sizeof(h));
+	fwrite(&h, 1, sizeof(h), w->fp);
+	return 0;
+}
+
+static void writer_data(SegmentWriter *w, const unsigned char *p, int len)
+{
+	if (len < 1) return;
+	fwrite(p, 1, len, w->fp);
+	w->data_len += len;
+}
+
+static void writer_term(SegmentWriter *w, const char *word, int wl, 
+	unsigned int off, unsigned int last)
+{
+	if (w->dict_len + wl + 20 > w->dict_size) {
+		w->dict_size = (w->dict_size + wl + 20) * 2;
+		w->dict = (unsigned char*) realloc(w->dict, w->dict_size);
+	}
+	if (w->nb >= w->index_size) {
+		w->index_size = w->index_size * 2 + 1024;
+		w->index = (unsigned int*) realloc(w->index, 
+			w->index_size * sizeof(unsigned int));
+	}
+	w->index[w->nb++] = w->dict_len;
+	w->dict_len += put_varint(w->dict + w->dict_len, wl);
+	memcpy(w->dict + w->dict_len, word, wl);
+	w->dict_len += wl;
+	w->dict_len += put_varint(w->dict + w->dict_len, off);
+	w->dict_len += put_varint(w->dict + w->dict_len, w->data_len - off);
+	w->dict_len += put_varint(w->dict + w->dict_len, last);
+}
+
+/*
+ *  Writes the words and the header and moves the segment in place.
+ */
+static int writer_close(SegmentWriter *w, const char *tmp, const char *file,
+	int first, int last)
+{
+	MailSearchHeader h;
+	int i, ok;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, SEARCH_MAGIC, 8);
+	h.nb_terms = w->nb;
+	h.first_doc = first;
+	h.last_doc = last;
+	h.terms_offset = sizeof(MailSearchHeader) + w->data_len;
+	h.index_offset = h.terms_offset + w->dict_len;
+	fwrite(w->dict, 1, w->dict_len, w->fp);
+	for (i = 0; i < w->nb; i++) w->index[i] += h.terms_offset;
+	fwrite(w->index, sizeof(unsigned int), w->nb, w->fp);
+	fseek(w->fp, 0, SEEK_SET);
+	fwrite(&h, 1, sizeof(h), w->fp);
+	ok = !ferror(w->fp);
+	if (fclose(w->fp)) ok = 0;
+	free(w->dict);
+	free(w->index);
+	if (!ok || rename(tmp, file)) {
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+MailSearch::MailSearch(const char *d, int nb_docs)
+{
+	struct dirent **namelist = NULL;
+	char buf[1024];
+	int i, nbd;
+
+	dir = strdup(d);
+	segs = NULL;
+	nb_segs = 0;
+	table_size = SEARCH_TABLE;
+	table = (MailSearchTerm**) calloc(table_size, sizeof(MailSearchTerm*));
+	nb_terms = 0;
+	pending = 0;
+	first_doc = -1;
+	doc = -1;
+	pos = 0;
+	field = SEARCH_BODY;
+	word_len = 0;
+
+	nbd = scandir(dir, &namelist, selseg, alphasort);
+	for (i = 0; i < nbd; i++) {
+		snprintf(buf, 1024, "%s/%s", dir, namelist[i]->d_name);
+		free(namelist[i]);
+		if (open_segment(buf)) continue;
+		MailSearchSegment *s = segs + nb_segs - 1;
+		/* left by an interrupted merge, or older than the index */
+		if ((int) s->header->first_doc >= nb_docs || (nb_segs > 1 &&
+			s->header->first_doc <= s[-1].header->last_doc))
+		{
+			munmap(s->map, s->size);
+			unlink(s->name);
+			free(s->name);
+			nb_segs--;
+		}
+	}
+	free(namelist);
+}
+
+MailSearch::~MailSearch()
+{
+	int i;
+	MailSearchTerm *t, *n;
+
+	close_segments();
+	for (i = 0; i < table_size; i++) {
+		for (t = table[i]; t; t = n) {
+			n = t->next;
+			free(t->word);
+			free(t->data);
+			free(t);
+		}
+	}
+	free(table);
+	free(dir);
+}
+
+int MailSearch::open_segment(const char *file)
+{
+	MailSearchSegment *s;
+	MailSearchHeader *h;
+	struct stat st;
+	void *m;
+	int fd;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) return -1;
+	if (fstat(fd, &st) || st.st_size < (long) sizeof(MailSearchHeader)) {
+		close(fd);
+		return -1;
+	}
+	m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (m == MAP_FAILED) return -1;
+	h = (MailSearchHeader*) m;
+	if (memcmp(h->magic, SEARCH_MAGIC, 8) || 
+		h->terms_offset < sizeof(MailSearchHeader) ||
+		h->index_offset < h->terms_offset ||
+		h->index_offset > st.st_size ||
+		h->nb_terms > (st.st_size - h->index_offset) / 
+			sizeof(unsigned int))
+	{
+		munmap(m, st.st_size);
+		return -1;
+	}
+	segs = (MailSearchSegment*) realloc(segs, 
+		(nb_segs + 1) * sizeof(MailSearchSegment));
+	s = segs + nb_segs;
+	s->name = strdup(file);
+	s->map = (unsigned char*) m;
+	s->size = st.st_size;
+	s->header = h;
+	s->index = (unsigned int*) (s->map + h->index_offset);
+	for (fd = 0; fd < (int) h->nb_terms; fd++) {
+		if (s->index[fd] < h->terms_offset || 
+			s->index[fd] >= h->index_offset) 
+		{
+			free(s->name);
+			munmap(m, st.st_size);
+			return -1;
+		}
+	}
+	nb_segs++;
+	return 0;
+}
+
+void MailSearch::close_segments()
+{
+	int i;
+
+	for (i = 0; i < nb_segs; i++) {
+		munmap(segs[i].map, segs[i].size);
+		free(segs[i].name);
+	}
+	free(segs);
+	segs = NULL;
+	nb_segs = 0;
+}
+
+/*
+ *  Writes the case folded UTF-8 of ucs to out and returns its length, 
+ *  or 0 if ucs is not part of a word.
+ */
+int MailSearch::fold(unsigned int ucs, char *out)
+{
+	if (ucs < 0x80) {
+		if (ucs >= 'A' && ucs <= 'Z') {
+			ucs += 'a' - 'A';
+		} else if (!(ucs >= 'a' && ucs <= 'z') && 
+			!(ucs >= '0' && ucs <= '9')) 
+		{
+			return 0;
+		}
+		out[0] = ucs;
+		return 1;
+	}
+	if ((ucs < 0xC0 && ucs != 0xAA && ucs != 0xB5 && ucs != 0xBA) ||
+		ucs == 0xD7 || ucs == 0xF7 || 
+		(ucs >= 0x2000 && ucs < 0x2070) ||
+		(ucs >= 0x3000 && ucs < 0x3040) || ucs == 0xFEFF)
+	{
+		return 0;
+	}
+	return fl_ucs2utf(fl_tolower(ucs), out);
+}
+
+int MailSearch::next_char(const char **s, const char *e, int latin1,
+	unsigned int *ucs)
+{
+	int l;
+
+	if (latin1 || !(**s & 0x80)) {
+		*ucs = (unsigned char) **s;
+		(*s)++;
+		return 1;
+	}
+	l = fl_utf2ucs((const unsigned char*) *s, e - *s, ucs);
+	if (l < 1) {
+		*ucs = (unsigned char) **s;
+		l = 1;
+	}
+	*s += l;
+	return l;
+}
+
+/*
+ *  Starts the indexing of the mail d.
+ */
+void MailSearch::begin(int d)
+{
+	end_word();
+	if (first_doc < 0) first_doc = d;
+	doc = d;
+	pos = 0;
+	field = SEARCH_BODY;
+}
+
+void MailSearch::start_field(int f)
+{
+	end_word();
+	field = f;
+}
+
+/*
+ *  Indexes the words of s. A word may continue in the next call.
+ */
+void MailSearch::add_text(const char *s, int len, int latin1)
+{
+	const char *e = s + len;
+	unsigned int ucs;
+	char u[8];
+	int l;
+
+	while (s < e) {
+		next_char(&s, e, latin1, &ucs);
+		l = fold(ucs, u);
+		if (l < 1) {
+			end_word();
+		} else if (word_len + l <= SEARCH_WORD_LEN) {
+			memcpy(word + word_len, u, l);
+			word_len += l;
+		}
+	}
+}
+
+void MailSearch::end_word()
+{
+	if (word_len < 1) return;
+	add_hit(word, word_len);
+	word_len = 0;
+	pos++;
+}
+
+void MailSearch::end()
+{
+	end_word();
+	if (pending > SEARCH_PENDING) flush();
+}
+
+void MailSearch::add_hit(const char *w, int len)
+{
+	MailSearchTerm *t;
+	unsigned int h, delta;
+	int i;
+
+	if (doc < 0) return;
+	i = hash(w, len) & (table_size - 1);
+	for (t = table[i]; t; t = t->next) {
+		if (!t->word[len] && !memcmp(t->word, w, len)) break;
+	}
+	if (!t) {
+		t = (MailSearchTerm*) malloc(sizeof(MailSearchTerm));
+		t->word = (char*) malloc(len + 1);
+		memcpy(t->word, w, len);
+		t->word[len] = '\0';
+		t->size = 16;
+		t->data = (unsigned char*) malloc(t->size);
+		t->len = 0;
+		t->last_doc = -1;
+		t->last_hit = 0;
+		t->last_hit_pos = 0;
+		t->next = table[i];
+		table[i] = t;
+		nb_terms++;
+		pending += len + sizeof(MailSearchTerm) + t->size;
+	}
+	if (t->len + 10 > t->size) {
+		pending += t->size;
+		t->size *= 2;
+		t->data = (unsigned char*) realloc(t->data, t->size);
+	}
+	h = pos * 4 + field;
+	if (t->last_doc != doc) {
+		if (t->last_doc >= 0) t->data[t->last_hit_pos] |= 1;
+		t->len += put_varint(t->data + t->len, t->last_doc < 0 ? 
+			doc : doc - t->last_doc);
+		t->last_doc = doc;
+		delta = h;
+	} else {
+		delta = h - t->last_hit;
+	}
+	t->last_hit_pos = t->len;
+	t->len += put_varint(t->data + t->len, delta << 1);
+	t->last_hit = h;
+}
+
+/*
+ *  Writes the mails indexed since the last call as a new segment.
+ */
+void MailSearch::flush()
+{
+	MailSearchTerm **terms, *t;
+	SegmentWriter w;
+	char file[1024], tmp[1024];
+	int i, nb = 0;
+
+	end_word();
+	if (nb_terms < 1) return;
+	terms = (MailSearchTerm**) malloc(nb_terms * sizeof(MailSearchTerm*));
+	for (i = 0; i < table_size; i++) {
+		for (t = table[i]; t; t = t->next) terms[nb++] = t;
+		table[i] = NULL;
+	}
+	qsort(terms, nb, sizeof(MailSearchTerm*), sort_terms);
+
+	snprintf(file, 1024, "%s/search.%08x.seg", dir, first_doc);
+	snprintf(tmp, 1024, "%s/search.tmp", dir);
+	if (!writer_open(&w, tmp)) {
+		for (i = 0; i < nb; i++) {
+			unsigned int off = w.data_len;
+			t = terms[i];
+			t->data[t->last_hit_pos] |= 1;
+			writer_data(&w, t->data, t->len);
+			writer_term(&w, t->word, strlen(t->word), off, 
+				t->last_doc);
+		}
+		if (!writer_close(&w, tmp, file, first_doc, doc)) {
+			open_segment(file);
+		}
+	}
+	for (i = 0; i < nb; i++) {
+		t = terms[i];
+		free(t->word);
+		free(t->data);
+		free(t);
+	}
+	free(terms);
+	nb_terms = 0;
+	pending = 0;
+	first_doc = -1;
+	if (nb_segs > SEARCH_MAX_SEGMENTS) merge();
+}
+
+/*
+ *  Merges all the segments in one. The postings of a word are copied 
+ *  one segment after the other, only the first mail of each is stored
+ *  again relative to the last mail of the previous segment.
+ */
+void MailSearch::merge()
+{
+	SegmentWriter w;
+	char file[1024], tmp[1024];
+	const unsigned char *best, *word, *p, *e;
+	unsigned char v[8];
+	unsigned int off, len, last, start, prev = 0;
+	int *cur;
+	int i, bl, wl, have;
+
+	if (nb_segs < 2) return;
+	snprintf(file, 1024, "%s", segs[0].name);
+	snprintf(tmp, 1024, "%s/search.tmp", dir);
+	if (writer_open(&w, tmp)) return;
+	cur = (int*) calloc(nb_segs, sizeof(int));
+	for (;;) {
+		best = NULL;
+		bl = 0;
+		for (i = 0; i < nb_segs; i++) {
+			if (cur[i] >= (int) segs[i].header->nb_terms) continue;
+			word = entry(segs + i, cur[i], &wl, &off, &len, &last);
+			if (!best || compare(word, wl, (const char*) best, 
+				bl) < 0) 
+			{
+				best = word;
+				bl = wl;
+			}
+		}
+		if (!best) break;
+		start = w.data_len;
+		have = 0;
+		for (i = 0; i < nb_segs; i++) {
+			if (cur[i] >= (int) segs[i].header->nb_terms) continue;
+			word = entry(segs + i, cur[i], &wl, &off, &len, &last);
+			if (compare(word, wl, (const char*) best, bl)) continue;
+			p = segs[i].map + sizeof(MailSearchHeader) + off;
+			e = p + len;
+			if (have && p < e) {
+				unsigned int d = get_varint(&p, e);
+				writer_data(&w, v, put_varint(v, d - prev));
+			}
+			writer_data(&w, p, e - p);
+			prev = last;
+			have = 1;
+			cur[i]++;
+		}
+		writer_term(&w, (const char*) best, bl, start, prev);
+	}
+	free(cur);
+	if (writer_close(&w, tmp, file, segs[0].header->first_doc, 
+		segs[nb_segs - 1].header->last_doc)) 
+	{
+		return;
+	}
+	for (i = 1; i < nb_segs; i++) unlink(segs[i].name);
+	close_segments();
+	open_segment(file);
+}
+
+/*
+ *  Returns the first word of s not before w.
+ */
+int MailSearch::find(MailSearchSegment *s, const char *w, int len)
+{
+	int lo = 0, hi = s->header->nb_terms;
+	unsigned int off, l, last;
+	const unsigned char *word;
+	int wl;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		word = entry(s, mid, &wl, &off, &l, &last);
+		if (compare(word, wl, w, len) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+ *  Returns the hits of the word w, or of all the words starting with w,
+ *  sorted by mail and position. Only the mails set in the bitmap cand
+ *  are kept.
+ */
+int MailSearch::hits(const char *w, int len, int prefix, 
+	const unsigned char *cand, int max, MailSearchHit **h)
+{
+	MailSearchHit *r = NULL;
+	const unsigned char *word, *p, *e;
+	unsigned int off, l, last, v, hit;
+	int nb = 0, size = 0, nb_words = 0;
+	int i, j, wl, d, keep;
+
+	for (i = 0; i < nb_segs; i++) {
+		MailSearchSegment *s = segs + i;
+		for (j = find(s, w, len); j < (int) s->header->nb_terms; j++) {
+			word = entry(s, j, &wl, &off, &l, &last);
+			if (prefix) {
+				if (wl < len || memcmp(word, w, len)) break;
+			} else if (compare(word, wl, w, len)) {
+				break;
+			}
+			nb_words++;
+			p = s->map + sizeof(MailSearchHeader) + off;
+			e = p + l;
+			d = 0;
+			while (p < e) {
+				d += get_varint(&p, e);
+				hit = 0;
+				keep = d < max && (cand[d >> 3] & (1 << (d & 7)));
+				do {
+					v = get_varint(&p, e);
+					hit += v >> 1;
+					if (!keep) continue;
+					if (nb >= size) {
+						size = size * 2 + 1024;
+						r = (MailSearchHit*) realloc(r, 
+							size * sizeof(MailSearchHit));
+					}
+					r[nb].doc = d;
+					r[nb].hit = hit;
+					nb++;
+				} while (!(v & 1) && p < e);
+			}
+		}
+	}
+	if (nb_words > 1) qsort(r, nb, sizeof(MailSearchHit), sort_hits);
+	*h = r;
+	return nb;
+}
+
+/*
+ *  Same as hits() when only the mails are needed : the hits are read 
+ *  for their field and not kept. The mails of several words are merged
+ *  in a bitmap.
+ */
+int MailSearch::docs(const char *w, int len, int prefix, int fields, int **r)
+{
+	const unsigned char *word, *p, *e;
+	unsigned char *seen = NULL;
+	unsigned int off, l, last, v, hit;
+	int nb = 0, size = 0, max = 0;
+	int i, j, wl, d, in;
+
+	*r = NULL;
+	if (nb_segs < 1) return 0;
+	if (prefix) {
+		max = segs[nb_segs - 1].header->last_doc + 1;
+		seen = (unsigned char*) calloc(max / 8 + 1, 1);
+	}
+	for (i = 0; i < nb_segs; i++) {
+		MailSearchSegment *s = segs + i;
+		for (j = find(s, w, len); j < (int) s->header->nb_terms; j++) {
+			word = entry(s, j, &wl, &off, &l, &last);
+			if (prefix) {
+				if (wl < len || memcmp(word, w, len)) break;
+			} else if (compare(word, wl, w, len)) {
+				break;
+			}
+			p = s->map + sizeof(MailSearchHeader) + off;
+			e = p + l;
+			d = 0;
+			while (p < e) {
+				d += get_varint(&p, e);
+				hit = 0;
+				in = 0;
+				do {
+					v = get_varint(&p, e);
+					hit += v >> 1;
+					if (fields & (1 << (hit & 3))) in = 1;
+				} while (!(v & 1) && p < e);
+				if (!in) continue;
+				if (seen) {
+					if (d < max) seen[d >> 3] |= 1 << (d & 7);
+					continue;
+				}
+				if (nb >= size) {
+					size = size * 2 + 1024;
+					*r = (int*) realloc(*r, size * sizeof(int));
+				}
+				(*r)[nb++] = d;
+			}
+		}
+	}
+	if (seen) {
+		for (d = 0; d < max; d++) {
+			if (!(seen[d >> 3] & (1 << (d & 7)))) continue;
+			if (nb >= size) {
+				size = size * 2 + 1024;
+				*r = (int*) realloc(*r, size * sizeof(int));
+			}
+			(*r)[nb++] = d;
+		}
+		free(seen);
+	}
+	return nb;
+}
+
+/*
+ *  Keeps in a the mails also in b, both are sorted.
+ */
+static int intersect(int *a, int na, const int *b, int nb)
+{
+	int i, j, k;
+
+	for (i = j = k = 0; i < na && j < nb;) {
+		if (a[i] < b[j]) {
+			i++;
+		} else if (a[i] > b[j]) {
+			j++;
+		} else {
+			a[k++] = a[i++];
+			j++;
+		}
+	}
+	return k;
+}
+
+static int has_hit(MailSearchHit *h, int nb, int doc, unsigned int hit)
+{
+	int lo = 0, hi = nb;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (h[mid].doc < doc || (h[mid].doc == doc && h[mid].hit < hit)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo < nb && h[lo].doc == doc && h[lo].hit == hit;
+}
+
+/*
+ *  Returns the mails where the nb words, each followed by a '\0', are in
+ *  a row in one of the fields. The last word may be a prefix. The hits
+ *  are only collected in the mails having all the words.
+ */
+int MailSearch::clause(const char *words, int nb, int fields, int prefix,
+	int **out)
+{
+	MailSearchHit **h;
+	const char *w = words;
+	unsigned char *cand;
+	int *nh, *r = NULL, *c;
+	int i, j, n = 0, max;
+
+	*out = NULL;
+	if (nb < 1) return 0;
+	if (nb == 1) return docs(words, strlen(words), prefix, fields, out);
+	for (j = 0; j < nb; j++) {
+		i = docs(w, strlen(w), prefix && j == nb - 1, fields, &c);
+		if (j == 0) {
+			r = c;
+			n = i;
+		} else {
+			n = intersect(r, n, c, i);
+			free(c);
+		}
+		w += strlen(w) + 1;
+		if (n == 0) {
+			free(r);
+			return 0;
+		}
+	}
+	max = r[n - 1] + 1;
+	cand = (unsigned char*) calloc(max / 8 + 1, 1);
+	for (i = 0; i < n; i++) cand[r[i] >> 3] |= 1 << (r[i] & 7);
+	free(r);
+	n = 0;
+
+	w = words;
+	h = (MailSearchHit**) malloc(nb * sizeof(MailSearchHit*));
+	nh = (int*) malloc(nb * sizeof(int));
+	for (j = 0; j < nb; j++) {
+		nh[j] = hits(w, strlen(w), prefix && j == nb - 1, cand, max, 
+			h + j);
+		w += strlen(w) + 1;
+	}
+	free(cand);
+	r = (int*) malloc((nh[0] + 1) * sizeof(int));
+	for (i = 0; i < nh[0]; i++) {
+		MailSearchHit *a = h[0] + i;
+		if (!(fields & (1 << (a->hit & 3)))) continue;
+		if (n > 0 && r[n - 1] == a->doc) continue;
+		for (j = 1; j < nb; j++) {
+			if (!has_hit(h[j], nh[j], a->doc, a->hit + 4 * j)) break;
+		}
+		if (j == nb) r[n++] = a->doc;
+	}
+	for (j = 0; j < nb; j++) free(h[j]);
+	free(h);
+	free(nh);
+	*out = r;
+	return n;
+}
+
+/*
+ *  Returns the number of mails matching all the terms of q, and the
+ *  mails in docs. A term is a word, a "phrase", a prefix* and may be 
+ *  limited to a field with subject:, from: or body:. Returns -1 when q
+ *  has no word.
+ */
+int MailSearch::query(const char *q, int **docs)
+{
+	const char *p = q, *s, *e;
+	char *words, *w;
+	char u[8];
+	unsigned int ucs;
+	int *res = NULL, *c;
+	int nb = -1, n, nw, wl, l, fields, prefix;
+
+	words = (char*) malloc(strlen(q) * 3 + 2);
+	while (*p) {
+		while (*p && isspace((unsigned char) *p)) p++;
+		if (!*p) break;
+		fields = 7;
+		if (!strncasecmp(p, "subject:", 8)) {
+			fields = 1 << SEARCH_SUBJECT;
+			p += 8;
+		} else if (!strncasecmp(p, "from:", 5)) {
+			fields = 1 << SEARCH_FROM;
+			p += 5;
+		} else if (!strncasecmp(p, "body:", 5)) {
+			fields = 1 << SEARCH_BODY;
+			p += 5;
+		}
+		if (*p == '"') {
+			s = ++p;
+			while (*p && *p != '"') p++;
+			e = p;
+			if (*p) p++;
+		} else {
+			s = p;
+			while (*p && !isspace((unsigned char) *p)) p++;
+			e = p;
+		}
+		prefix = e > s && e[-1] == '*';
+
+		w = words;
+		nw = 0;
+		wl = 0;
+		while (s <= e) {
+			l = 0;
+			if (s < e) {
+				next_char(&s, e, 0, &ucs);
+				l = fold(ucs, u);
+			} else {
+				s++;
+			}
+			if (l > 0) {
+				if (wl + l <= SEARCH_WORD_LEN) {
+					memcpy(w + wl, u, l);
+					wl += l;
+				}
+			} else if (wl > 0) {
+				w[wl] = '\0';
+				w += wl + 1;
+				wl = 0;
+				nw++;
+			}
+		}
+		if (nw < 1) continue;
+
+		n = clause(words, nw, fields, prefix, &c);
+		if (nb < 0) {
+			res = c;
+			nb = n;
+		} else {
+			nb = intersect(res, nb, c, n);
+			free(c);
+		}
+		if (nb == 0) break;
+	}
+	free(words);
+	*docs = res;
+	return nb;
+}
+
+/*
+ * "$Id: $"
+ */
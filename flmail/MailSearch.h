@@ -0,0 +1,155 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+
+#ifndef MailSearch_h
+#define MailSearch_h
+
+enum {
+	SEARCH_SUBJECT = 0,
+	SEARCH_FROM = 1,
+	SEARCH_BODY = 2,
+};
+
+#define SEARCH_WORD_LEN 64
+
+/*
+ *  Postings of a word not yet written to disk. Each mail is stored as 
+ *  the varint of its distance to the previous mail followed by the
+ *  varints of its hits. A hit is the position of the word in the mail
+ *  times 4 plus the field, each hit is stored as its distance to the
+ *  previous one times 2, plus 1 for the last hit of the mail.
+ */
+struct MailSearchTerm {
+	MailSearchTerm *next;
+	char *word;
+	unsigned char *data;
+	int len;
+	int size;
+	int last_doc;
+	unsigned int last_hit;
+	int last_hit_pos;
+};
+
+struct MailSearchHeader {
+	char magic[8];
+	unsigned int nb_terms;
+	unsigned int first_doc;
+	unsigned int last_doc;
+	unsigned int terms_offset;
+	unsigned int index_offset;
+	unsigned int pad;
+};
+
+/*
+ *  A segment file : the header, the postings, the words in order each
+ *  followed by the varints of the offset and length of its postings and
+ *  of its last mail, then the offsets of the words.
+ */
+struct MailSearchSegment {
+	char *name;
+	unsigned char *map;
+	long size;
+	MailSearchHeader *header;
+	unsigned int *index;
+};
+
+struct MailSearchHit {
+	int doc;
+	unsigned int hit;
+};
+
+/*
+ *  Full text index of the subject, sender and text of the mails of a 
+ *  folder, the mails are the record numbers of the MailIndex. The mails
+ *  converted by a fetch are indexed in memory and written as a new 
+ *  segment by flush(), the segments are merged in one when there are 
+ *  too many of them. Words are case folded UTF-8.
+ */
+class MailSearch {
+public:
+	char *dir;
+	MailSearchSegment *segs;
+	int nb_segs;
+
+	MailSearchTerm **table;
+	int table_size;
+	int nb_terms;
+	long pending;
+	int first_doc;
+	int doc;
+	int pos;
+	int field;
+	char word[SEARCH_WORD_LEN + 8];
+	int word_len;
+
+	MailSearch(const char *d, int nb_docs);
+	~MailSearch(void);
+
+	void begin(int d);
+	void start_field(int f);
+	void add_text(const char *s, int len, int latin1);
+	void end(void);
+	void flush(void);
+	int query(const char *q, int **docs);
+
+	void end_word(void);
+	void add_hit(const char *w, int len);
+	int write_segment(const char *file, MailSearchTerm **terms, int nb);
+	void merge(void);
+	int open_segment(const char *file);
+	void close_segments(void);
+	int find(MailSearchSegment *s, const char *w, int len);
+	int hits(const char *w, int len, int prefix, 
+		const unsigned char *cand, int max, MailSearchHit **h);
+	int docs(const char *w, int len, int prefix, int fields, int **d);
+	int clause(const char *words, int nb, int fields, int prefix, 
+		int **out);
+	static int fold(unsigned int ucs, char *out);
+	static int next_char(const char **s, const char *e, int latin1,
+		unsigned int *ucs);
+};
+
+#endif
+
+/*
+ * "$Id: $"
+ */
@@ -51,6 +51,8 @@
 #include <libintl.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <string.h>
+#include <strings.h>
 #include "xd640/Xd6XmlUtils.h"
 
 #define _(String) gettext((String))
@@ -63,12 +65,69 @@ static void l_cb(Fl_Widget *w, void *)
 	((Xd6HtmlBrowser*)w->parent())->list_cb();
 }
 
+/* translated in the constructor, the locale is not set before main() */
+static const char *list_titles[3];
+static const int list_widths[] = {350, 200, 200};
+
+static int list_count(void *d)
+{
+	Xd6HtmlBrowser *b = (Xd6HtmlBrowser*)d;
+
+	if (b->found) return b->nb_found;
+	return b->mail_index ? b->mail_index->size() : 0;
+}
+
+/*
+ *  Formats the mail i of the index for the list.
+ */
+static int list_row(int i, char *buf, int len, void *d)
+{
+	MailIndex *m = ((Xd6HtmlBrowser*)d)->mail_index;
+	MailIndexRecord *r;
+	char date[64];
+	time_t t;
+	int l;
+
+	r = m ? m->get(((Xd6HtmlBrowser*)d)->mail_at(i)) : NULL;
+	if (!r) return 0;
+	t = (time_t) r->date;
+	snprintf(date, 64, "%s", ctime(&t));
+	l = strlen(date);
+	if (l > 0) date[l - 1] = '\0';
+	snprintf(buf, len, "%s\t%s\t%s", m->string(r->subject), 
+		m->string(r->from), date);
+	return r->flags & MAIL_UNREAD ? XD6_ROW_BOLD : 0;
+}
+
+static int list_compare(int a, int b, int column, void *d)
+{
+	Xd6HtmlBrowser *br = (Xd6HtmlBrowser*)d;
+	MailIndex *m = br->mail_index;
+	MailIndexRecord *ra, *rb;
+
+	ra = m->get(br->mail_at(a));
+	rb = m->get(br->mail_at(b));
+	switch (column) {
+	case 0:
+		return strcasecmp(m->string(ra->subject), 
+			m->string(rb->subject));
+	case 1:
+		return strcasecmp(m->string(ra->from), m->string(rb->from));
+	}
+	if (ra->date < rb->date) return -1;
+	return ra->date > rb->date;
+}
+
 Xd6HtmlBrowser::Xd6HtmlBrowser(int X, int Y, int W, int H) : Fl_Group(X, Y, W, H)
 {
 	tool = new Xd6HtmlNavigation(this, X, Y, W, 25);
 	tool->end();
-	list = new Fl_Select_Browser(X, Y + 25, W, 80);
+	list = new Xd6VirtualList(X, Y + 25, W, 80);
 	list->callback(l_cb);
+	list_titles[0] = _("Subject");
+	list_titles[1] = _("From");
+	list_titles[2] = _("Date");
+	list->columns(list_titles, list_widths, 3);
 	view = new Xd6HtmlView(X, Y + 105, W, H - 105);
 	view->frame->editor = 0;
 	view->frame->wysiwyg = 0;
@@ -76,66 +135,71 @@ Xd6HtmlBrowser::Xd6HtmlBrowser(int X, int Y, int W, int H) : Fl_Group(X, Y, W, H
 	nb_folder = 0;
 	pid = 0;
 	upid = 0;
+	mail_index = NULL;
+	mail_search = NULL;
+	query = NULL;
+	found = NULL;
+	nb_found = 0;
 	init();
 }
 
 
 Xd6HtmlBrowser::~Xd6HtmlBrowser()
 {
+	delete(mail_index);
+	delete(mail_search);
+	free(query);
+	free(found);
 }
 
-void Xd6HtmlBrowser::save_list()
+/*
+ *  Returns the mail shown at row of the list.
+ */
+int Xd6HtmlBrowser::mail_at(int row)
 {
-	int i;
-	int size = list->size();
-	char path[1024];
-	FILE *index;
-	snprintf(path, 1024, "%s/%s/index.txt", 
-				cfg->user_paths->apps, 
-				current_folder->box->get_create_item(
-				"directory", NULL)->get_value());
-	index = fopen(path, "w");
-	if (!index) return;
-	for (i = 1; i <= size; i++) {
-		const char *d;
-		d = list->text(i);
-		if (*d == '\v') {
-			fprintf(index, "%s\n", d);
+	if (!found) return row;
+	if (row < 0 || row >= nb_found) return -1;
+	return found[row];
+}
 
-		}
+/*
+ *  Shows only the mails matching q in the list, or all the mails when q 
+ *  has no word.
+ */
+void Xd6HtmlBrowser::search(const char *q)
+{
+	int *r = NULL;
+	int n = -1;
+
+	if (q != query) {
+		free(query);
+		query = q ? strdup(q) : NULL;
 	}
-	fclose(index);
+	if (query && mail_search) n = mail_search->query(query, &r);
+	free(found);
+	found = n >= 0 ? r : NULL;
+	nb_found = n >= 0 ? n : 0;
+	if (!found && n >= 0) found = (int*) malloc(sizeof(int));
+	list->source(list_count, list_row, list_compare, this);
+	list->select_position(0);
+	list->do_callback();
 }
 
 void Xd6HtmlBrowser::list_cb(void)
 {
 	int v = list->value();
-	char *d;
-	if (v < 1) return;
-	d = (char*)list->text(v);
-	if (!current_folder) return;
-	if (d) {
-		int save = 0;
-		if (*d == '\v' && *(d +1) == 'b') {
-			d++;
-			*d = ' ';
-			save = 1;
-		}
-		while (*d && *d != '\f') d++; d++;
-		while (*d && *d != '\f') d++; d++;
-		while (*d && *d != '\f') d++; d++;
-		if (*d) d += 3;
-		snprintf(path, 1024, "%s/%s/%s", 
-				cfg->user_paths->apps, 
-				current_folder->box->get_create_item(
-				"directory", NULL)->get_value(),
-				d);
-		view->load(path);
-		if (save) {
-			Fl::check();
-			Fl::flush();
-			save_list();
-		}
+	MailIndexRecord *r;
+
+	if (v < 0) return;
+	if (!current_folder || !mail_index) return;
+	r = mail_index->get(mail_at(v));
+	if (!r) return;
+	snprintf(path, 1024, "%s/%s", mail_index->dir, 
+		mail_index->string(r->file));
+	view->load(path);
+	if (r->flags & MAIL_UNREAD) {
+		r->flags &= ~MAIL_UNREAD;
+		list->invalidate(v);
 	}
 }
 
@@ -220,22 +284,23 @@ static void cb_dnl(Xd6HtmlBrowser *b)
 }
 
 
+/*
+ *  Shows the mails of the folder at path. The index is only mapped, the
+ *  list reads the records it draws.
+ */
 void Xd6HtmlBrowser::load_mailbox(const char *path)
 {
 	char buf[1024];
-	static int w[4];
 	
-	snprintf(buf, 1024, "%s/index.txt", path);
-	w[0] = 350;
-	w[1] = 200;
-	w[2] = 200;
-	w[3] = 0;
-	list->format_char('\v');
-	list->column_char('\f');
-	list->column_widths(w);
-	list->load(buf);
-	list->select(1);
-	list->do_callback();
+	delete(mail_index);
+	delete(mail_search);
+	mail_index = new MailIndex(path);
+	if (mail_index->size() == 0) {
+		snprintf(buf, 1024, "%s/index.txt", path);
+		mail_index->import_txt(buf);
+	}
+	mail_search = new MailSearch(path, mail_index->size());
+	search(query);
 }
 
 void Xd6HtmlBrowser::check_mail_get()
@@ -273,9 +338,16 @@ void Xd6HtmlBrowser::check_mail_get()
 				current_folder->box->get_create_item(
 				"directory", NULL)->get_value());
 			
-			p->mailbox2html(path);
+			if (!mail_index || strcmp(mail_index->dir, path)) {
+				load_mailbox(path);
+			}
+			p->mailbox2html(path, mail_index, mail_search);
 			delete(p);
-			load_mailbox(path);
+			if (found) {
+				search(query);
+			} else {
+				list->update();
+			}
 		} else {
 			snprintf(path, 1024, "%s/%s/dnl.err", 
 				cfg->user_paths->apps, 
@@ -44,8 +44,10 @@
 
 #include "xd640/Xd6HtmlView.h"
 #include "Xd6HtmlNavigation.h"
+#include "xd640/Xd6VirtualList.h"
+#include "MailIndex.h"
+#include "MailSearch.h"
 #include <FL/Fl_Group.h>
-#include <FL/Fl_Select_Browser.H>
 #include <stdio.h>
 
 struct folder {
@@ -63,7 +65,7 @@ enum {
 class Xd6HtmlBrowser : public Fl_Group {
 public:
 	Xd6HtmlView *view;
-	Fl_Select_Browser *list;
+	Xd6VirtualList *list;
 	Xd6HtmlNavigation *tool;
 	int nb_folder;
 	struct folder *folders;
@@ -74,6 +76,11 @@ public:
 	FILE *reply_fp;
 	char from[256];
 	int upid;
+	MailIndex *mail_index;
+	MailSearch *mail_search;
+	char *query;
+	int *found;
+	int nb_found;
 
 	Xd6HtmlBrowser(int X, int Y, int W, int H);
 	~Xd6HtmlBrowser(void);
@@ -89,7 +96,8 @@ public:
 	void load_mailbox(const char *path);
 	void mail2html(const char *f, const char *p, FILE *index);
 	void list_cb(void);
-	void save_list(void);
+	void search(const char *q);
+	int mail_at(int row);
 	void mail_reply(void);	
 	void reply_cb(Xd6XmlTreeElement* e);
 	void write_reply(void);
@@ -84,6 +84,7 @@ Xd6HtmlNavigation::Xd6HtmlNavigation(Xd6HtmlBrowser *e, int X, int Y, int W, int
         fileprint = new Fl_Button(X, Y, W, H); X += W + 1;
         remove = new Fl_Button(X, Y, W, H); X += W + 1;
         stop = new Fl_Button(X, Y, W, H); X += W + 5;
+	search = new Fl_Input(X, Y, 150, H); X += 155;
 	folder = new Fl_Choice(X, Y, 10, H);
         end();
 	resizable(folder);
@@ -121,6 +122,10 @@ Xd6HtmlNavigation::Xd6HtmlNavigation(Xd6HtmlBrowser *e, int X, int Y, int W, int
 	remove->callback(cb_remove);
 	stop->callback(cb_stop);
 	folder->callback(cb_folder);
+	search->callback(cb_search);
+	search->when(FL_WHEN_ENTER_KEY_ALWAYS);
+	search->tooltip(_("Search: words, \"phrase\", prefix*, subject:, "
+		"from:, body:"));
 	
 
 }
@@ -175,6 +180,12 @@ void Xd6HtmlNavigation::cb_folder(Fl_Widget *w, void *data)
 {
 }
 
+void Xd6HtmlNavigation::cb_search(Fl_Widget *w, void *data)
+{
+	((Xd6HtmlBrowser*)w->parent()->parent())->search(
+		((Fl_Input*)w)->value());
+}
+
 void Xd6HtmlNavigation::cb_mail_compose(Fl_Widget *w, void *data)
 {
 	system("flmailer &");
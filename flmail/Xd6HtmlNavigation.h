@@ -67,6 +67,7 @@ public:
 	Fl_Button *fileprint;
 	Fl_Button *remove;
 	Fl_Button *stop;
+	Fl_Input *search;
 	Fl_Choice *folder;
 	
         Fl_Pixmap *p_mail_get;
@@ -94,6 +95,7 @@ public:
 	static void cb_remove(Fl_Widget*, void*);
 	static void cb_stop(Fl_Widget*, void*);
 	static void cb_folder(Fl_Widget*, void*);
+	static void cb_search(Fl_Widget*, void*);
 };
 
 #endif
@@ -50,13 +50,14 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <signal.h>
 #include <errno.h>
-#include <sys/wait.h>
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
 #include "xd640/Xd6Base64.h"
 #include "gui.h"
 
-extern char **environ;
+#define CACHE_MAX_SIZE (64 * 1024 * 1024)
 
 Xd6HtmlRequest::Xd6HtmlRequest()
 {
@@ -66,12 +67,33 @@ Xd6HtmlRequest::Xd6HtmlRequest()
 	anchor = NULL;
 	form = NULL;
 	frame = NULL;
-	pid = -1;
+	disp = NULL;
 	status = 0;
+	multi = NULL;
+	curl = NULL;
+	post = NULL;
+	data = NULL;
+	data_len = 0;
+	data_size = 0;
+	errorbuffer[0] = '\0';
+	cache = NULL;
+	cacheable = 0;
+	headers = NULL;
+	etag = NULL;
+	modified = NULL;
+	max_age = 0;
+	no_store = 0;
+	prefetch = 0;
+	scan = NULL;
+	found = NULL;
+	nb_found = 0;
 }
 
 Xd6HtmlRequest::~Xd6HtmlRequest()
 {
+	if (curl) stop_download();
+	free_transfer();
+	if (post) free(post);
 	if (href) free(href);
 	if (target) free(target);
 	if (file) free(file);
@@ -175,6 +197,9 @@ void Xd6HtmlRequest::fill_form(CURL *curl)
 		buf = (char*) malloc(1);
 		buf[0] = '\0';
 		fill_form_buffer(curl, &buf, "\r\n");
+		/* curl does not copy the fields, keep them with the request */
+		if (post) free(post);
+		post = buf;
 		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, buf);
 		curl_easy_setopt(curl, CURLOPT_POST, 1);
 	} else {
@@ -187,37 +212,158 @@ void Xd6HtmlRequest::fill_form(CURL *curl)
 	}
 }
 
-void Xd6HtmlRequest::start_curl()
+/*
+ *  Notes the images of a page while it is downloaded. curl does not 
+ *  allow to start transfers from its callbacks : Download::check_multi()
+ *  starts them.
+ */
+void Xd6HtmlRequest::scan_cb(Xd6XmlTreeElement *e, void *d)
 {
-	char errorbuffer[CURL_ERROR_SIZE];
-	FILE *fout;
-	CURL *curl;
-	int res;
+	Xd6HtmlRequest *req = (Xd6HtmlRequest*) d;
+	const char *src;
+
+	if (e->display != DISPLAY_IMG) return;
+	src = e->get_attr_value("src");
+	if (!src || !src[0]) return;
+	req->found = (char**) realloc(req->found, 
+		sizeof(char*) * (req->nb_found + 1));
+	req->found[req->nb_found] = strdup(src);
+	req->nb_found++;
+}
+
+static void scan_drop(Xd6XmlTreeElement *e, void *d)
+{
+}
+
+/*
+ *  Appends the received bytes to the memory buffer of the request. The
+ *  bytes of a page are also parsed to find its images.
+ */
+size_t Xd6HtmlRequest::write_cb(void *ptr, size_t size, size_t nmemb, void *d)
+{
+	Xd6HtmlRequest *req = (Xd6HtmlRequest*) d;
+	int l = size * nmemb;
+
+	if (req->scan) req->scan->scan_string((char*) ptr, l, scan_drop, NULL);
+
+	if (req->data_len + l > req->data_size) {
+		int s = req->data_size ? req->data_size * 2 : 16384;
+		while (s < req->data_len + l) s *= 2;
+		req->data = (char*) realloc(req->data, s);
+		req->data_size = s;
+	}
+	memcpy(req->data + req->data_len, ptr, l);
+	req->data_len += l;
+	return l;
+}
+
+static char *header_value(const char *h, int l)
+{
+	char *v;
+	while (l > 0 && (*h == ' ' || *h == '\t')) {
+		h++;
+		l--;
+	}
+	while (l > 0 && (h[l - 1] == '\r' || h[l - 1] == '\n' ||
+		h[l - 1] == ' ')) 
+	{
+		l--;
+	}
+	v = (char*) malloc(l + 1);
+	memcpy(v, h, l);
+	v[l] = '\0';
+	return v;
+}
 
+/*
+ *  Keeps the response headers which matter to the cache.
+ */
+size_t Xd6HtmlRequest::header_cb(void *ptr, size_t size, size_t nmemb, void *d)
+{
+	Xd6HtmlRequest *req = (Xd6HtmlRequest*) d;
+	int l = size * nmemb;
+	char *h = (char*) ptr;
+
+	if (l > 5 && !strncmp(h, "HTTP/", 5)) {
+		free(req->etag);
+		free(req->modified);
+		req->etag = NULL;
+		req->modified = NULL;
+		req->max_age = 0;
+		req->no_store = 0;
+	} else if (l > 13 && !strncasecmp(h, "Content-Type:", 13)) {
+		char *v = header_value(h + 13, l - 13);
+		if (!strstr(v, "html")) {
+			delete(req->scan);
+			req->scan = NULL;
+		}
+		free(v);
+	} else if (l > 5 && !strncasecmp(h, "ETag:", 5)) {
+		free(req->etag);
+		req->etag = header_value(h + 5, l - 5);
+	} else if (l > 14 && !strncasecmp(h, "Last-Modified:", 14)) {
+		free(req->modified);
+		req->modified = header_value(h + 14, l - 14);
+	} else if (l > 14 && !strncasecmp(h, "Cache-Control:", 14)) {
+		char *v = header_value(h + 14, l - 14);
+		char *p;
+		for (p = v; *p; p++) *p = tolower(*p);
+		if (strstr(v, "no-store")) req->no_store = 1;
+		p = strstr(v, "max-age=");
+		if (p) req->max_age = atoi(p + 8);
+		if (strstr(v, "no-cache")) req->max_age = 0;
+		free(v);
+	}
+	return l;
+}
+
+/*
+ *  Adds the transfer to the multi handle. The data is received in memory
+ *  and check_download() is called when it is complete. A response which
+ *  is in the cache is asked only if it changed.
+ */
+void Xd6HtmlRequest::start_curl()
+{
 	errorbuffer[0] = '\0';
 
-	fout = fopen(file, "w");
-	if (!fout) return;
 	curl = curl_easy_init();
-	if (!curl) return;
-
+	if (!curl) {
+		status = DNL_ERROR;
+		return;
+	}
 
 	curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errorbuffer);
 	if (form) {
 		fill_form(curl);	
 	}
-	curl_easy_setopt(curl, CURLOPT_FILE, fout);
-	curl_easy_setopt(curl, CURLOPT_URL, href);
-	res = curl_easy_perform(curl);
-	fclose(fout);
-	if (res != CURLE_OK) {
-		char buf[1024];
-		snprintf(buf, 1024, "%s.log", file);
-		fout = fopen(buf, "w");
-		fprintf(fout, errorbuffer);
-		fclose(fout);
-		_exit(127);
+	cacheable = cache && !form && (!strncasecmp(href, "http:", 5) ||
+		!strncasecmp(href, "https:", 6));
+	if (cacheable) {
+		HttpCacheEntry *e = cache->find(href);
+		char buf[256];
+		if (e && e->etag[0]) {
+			snprintf(buf, 256, "If-None-Match: %s", e->etag);
+			headers = curl_slist_append(headers, buf);
+		}
+		if (e && e->modified[0]) {
+			snprintf(buf, 256, "If-Modified-Since: %s", e->modified);
+			headers = curl_slist_append(headers, buf);
+		}
+		if (headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+		curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_cb);
+		curl_easy_setopt(curl, CURLOPT_HEADERDATA, this);
 	}
+	if (!disp && !prefetch) {
+		scan = new Xd6XmlParser();
+		scan->tree->open_callback = scan_cb;
+		scan->tree->open_data = this;
+	}
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, this);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_URL, href);
+	curl_multi_add_handle(multi, curl);
 }
 
 static int selfile(const struct dirent *)
@@ -259,49 +405,40 @@ int Xd6HtmlRequest::list_local_dir()
 	return 1;
 }
 
-void Xd6HtmlRequest::start_download()
-{
-//	char command[4096];
-//	char *argv[4];
-//	int filedes[2] = { -1, -1};
-
-//	if (pipe(filedes)) return;
-	pid = fork();
-	if (pid != 0) {
-		status = DNL_STARTED;
-		//kbd_fp = filedes[1];
-		return;
-	}
-//	close(STDIN_FILENO);
-//	dup(filedes[0]);
-//	close(filedes[0]);
 /*
-	snprintf(command, 4096, 
-		"curl -s -S  -o '%s' %s  2> %s.log ", 
-		file, href, file);
-	argv[0] = "sh";
-	argv[1] = "-c";
-	argv[2] = command;
-	argv[3] = 0;
-	execve("/bin/sh", argv, environ);
-*/
+ *  A local directory is listed at once and finished by the spooler,
+ *  anything else is handed to curl.
+ */
+void Xd6HtmlRequest::start_download(CURLM *m)
+{
+	multi = m;
+	status = DNL_STARTED;
 	if (!list_local_dir()) {
 		start_curl();
 	}
-	_exit(0);	
 }
 
+/*
+ *  A page of the browser view is shown while it is parsed, see
+ *  Xd6HtmlView::load(). There is no browser when Download is driven
+ *  by test/httptest.
+ */
 static void loader_cb(Xd6HtmlFrame *frame)
 {
-        frame->load();
+	if (GUI::self && frame == GUI::self->browser->view->frame) {
+		GUI::self->browser->load(frame->file, frame->url);
+	} else {
+		frame->load();
+	}
 }
 
 void Xd6HtmlRequest::finish_download()
 {
-	usleep(1000);
 	status = DNL_FINISHED;
-	if (disp) {
-		disp->load(file, href);
+	if (prefetch) {
+		/* kept until the page asks for it */
+	} else if (disp) {
+		disp->load(href, file);
 	} else {
 		free(frame->file);
 		free(frame->url);
@@ -312,58 +449,130 @@ void Xd6HtmlRequest::finish_download()
 	}
 }
 
-void Xd6HtmlRequest::check_download()
+/*
+ *  Called when curl is done with the request : the received data is
+ *  written to the file of the request which is then loaded.
+ */
+void Xd6HtmlRequest::write_file()
+{
+	FILE *fout;
+	fout = fopen(file, "w");
+	if (fout) {
+		if (data_len > 0) fwrite(data, 1, data_len, fout);
+		fclose(fout);
+	}
+}
+
+void Xd6HtmlRequest::free_transfer()
 {
-	int ret, stat;
+	free(data);
+	data = NULL;
+	data_len = 0;
+	data_size = 0;
+	free(etag);
+	free(modified);
+	etag = NULL;
+	modified = NULL;
+	if (headers) curl_slist_free_all(headers);
+	headers = NULL;
+	delete(scan);
+	scan = NULL;
+	while (nb_found > 0) free(found[--nb_found]);
+	free(found);
+	found = NULL;
+}
+
+void Xd6HtmlRequest::check_download(CURLcode res)
+{
+	HttpCacheEntry *e = NULL;
+	long code = 0;
+	char buf[1024];
+
 	if (status != DNL_STARTED) return;
 
-	ret = waitpid(pid, &stat, WNOHANG);
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+	curl_multi_remove_handle(multi, curl);
+	curl_easy_cleanup(curl);
+	curl = NULL;
 
-	if (ret == -1)	{
+	buf[0] = '\0';
+	if (res != CURLE_OK) {
+		snprintf(buf, 1024, "%s", errorbuffer[0] ? errorbuffer :
+			curl_easy_strerror(res));
+	} else if (cacheable && code == 304) {
+		e = cache->find(href);
+		if (!e && headers) {
+			/* the entry was dropped while the server was asked
+			   if it changed : ask again for the whole file */
+			free_transfer();
+			start_curl();
+			return;
+		}
+		if (e) {
+			cache->revalidated(e, max_age);
+		} else {
+			snprintf(buf, 1024, "%s : 304 Not Modified", href);
+		}
+	} else if (cacheable && code == 200 && !no_store) {
+		e = cache->store(href, data, data_len, etag, 
+			modified, max_age);
+	}
+
+	if (buf[0]) {
+		if (!disp && !prefetch) {
+			fl_alert(buf);
+		}
 		status = DNL_ERROR;
-	} if (ret == pid) {
-		if (WIFEXITED(stat) && WEXITSTATUS(stat) != 0) {
-			char buf[1024];
-			FILE *f;
-			snprintf(buf, 1024, "%s.log", file);
-			f = fopen(buf, "r");
-			if (f) {
-				int r;
-				r = fread(buf, 1, 1024, f);
-				if (r < 1) r = 1;
-				buf[r] = '\0';
-				fclose(f);
-			} else {
-				buf[0] = '\0';
-			}
-			if (!disp) {
-				fl_alert(buf);
-			}
-			status = DNL_ERROR;
+		if (GUI::self) {
 			GUI::self->stat_bar->value(buf);
 			GUI::self->stat_bar->redraw();
 			GUI::self->damage(FL_DAMAGE_CHILD);
 			Fl::flush();
-		} else {
-			finish_download();
 		}
+	} else {
+		if (!e || cache->copy_to(e, file)) {
+			write_file();
+		}
+		finish_download();
 	}
+	free_transfer();
 }
 
 void Xd6HtmlRequest::stop_download()
 {
-	int stat;
 	status = DNL_STOPED;
-	if (pid > 0) {
-		kill(pid, 9);
+	if (curl) {
+		curl_multi_remove_handle(multi, curl);
+		curl_easy_cleanup(curl);
+		curl = NULL;
 	}
-	waitpid(pid, &stat, WNOHANG);
+	free_transfer();
 }
 
 Download::Download() 
 {
+	char buf[1024];
+
 	nb_requests = 0;
 	requests = NULL;
+	running = 0;
+
+	/* one multi handle for all the requests : connections are kept 
+	   open between requests and its sockets are watched by Fl::wait() */
+	multi = curl_multi_init();
+	curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, socket_cb);
+	curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+	curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, timer_cb);
+	curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+#if LIBCURL_VERSION_NUM >= 0x071e00
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, 4L);
+	curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, 8L);
+#endif
+
+	snprintf(buf, 1024, "%s/.xd640", cfg->home_dir);
+	mkdir(buf, 0700);
+	snprintf(buf, 1024, "%s/.xd640/cache", cfg->home_dir);
+	cache = new HttpCache(buf, CACHE_MAX_SIZE);
 }
 
 Download::~Download()
@@ -371,7 +580,50 @@ Download::~Download()
 	while (nb_requests > 0) {
 		delete(requests[--nb_requests]);
 	}
-	delete(requests);
+	free(requests);
+	Fl::remove_timeout(timeout_cb, this);
+	curl_multi_cleanup(multi);
+	delete(cache);
+}
+
+int Download::socket_cb(CURL *e, curl_socket_t s, int what, void *d, void *sd)
+{
+	Fl::remove_fd(s);
+	if (what == CURL_POLL_REMOVE) return 0;
+	if (what & CURL_POLL_IN) Fl::add_fd(s, FL_READ, fd_read_cb, d);
+	if (what & CURL_POLL_OUT) Fl::add_fd(s, FL_WRITE, fd_write_cb, d);
+	return 0;
+}
+
+int Download::timer_cb(CURLM *m, long ms, void *d)
+{
+	Fl::remove_timeout(timeout_cb, d);
+	if (ms >= 0) Fl::add_timeout(ms / 1000.0, timeout_cb, d);
+	return 0;
+}
+
+void Download::fd_read_cb(int fd, void *d)
+{
+	Download *dl = (Download*) d;
+	curl_multi_socket_action(dl->multi, fd, CURL_CSELECT_IN, 
+		&dl->running);
+	dl->check_multi();
+}
+
+void Download::fd_write_cb(int fd, void *d)
+{
+	Download *dl = (Download*) d;
+	curl_multi_socket_action(dl->multi, fd, CURL_CSELECT_OUT, 
+		&dl->running);
+	dl->check_multi();
+}
+
+void Download::timeout_cb(void *d)
+{
+	Download *dl = (Download*) d;
+	curl_multi_socket_action(dl->multi, CURL_SOCKET_TIMEOUT, 0, 
+		&dl->running);
+	dl->check_multi();
 }
 
 
@@ -380,10 +632,35 @@ static void spool_cb(Download *d)
         d->spooler();
 }
 
+/*
+ *  Finishes the requests completed by curl. The spooler is run at once
+ *  when nothing is left to download.
+ */
+void Download::check_multi()
+{
+	CURLMsg *msg;
+	int left;
+
+	prefetch_found();
+	while ((msg = curl_multi_info_read(multi, &left))) {
+		Xd6HtmlRequest *req = NULL;
+		if (msg->msg != CURLMSG_DONE) continue;
+		curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, 
+			(char**) &req);
+		if (req) req->check_download(msg->data.result);
+	}
+	if (running == 0) {
+		Fl::remove_timeout((Fl_Timeout_Handler) spool_cb, 
+			(void*)this);
+		spooler();
+	}
+}
+
 static void progress()
 {
 	static int p = 0;
 	char *prog[4] = {"|", "/", "-", "\\"};
+	if (!GUI::self) return;
 	p++;
 	if (p > 3) p = 0;
 	GUI::self->stat_bar->value(prog[p]);
@@ -398,16 +675,19 @@ void Download::spooler()
 	empty = 1;
 	for (i = 0; i < nb_requests; i++) {
 		if (requests[i]->status == DNL_STARTED) {
+			if (!requests[i]->curl) {
+				/* local directory listing */
+				requests[i]->finish_download();
+				continue;
+			}
 			empty = 0;
 			progress();
-			requests[i]->check_download();
-			progress();
 		}
 	}
 	if (!empty) {
 		Fl::add_timeout(0.2, (Fl_Timeout_Handler) spool_cb, 
 			(void*)this);
-	} else {
+	} else if (GUI::self) {
 		GUI::self->browser->view->frame->measure();
 		GUI::self->browser->view->frame->create_pages();
 		GUI::self->browser->redraw();
@@ -420,7 +700,108 @@ void Download::stop()
 	for (i = 0; i < nb_requests; i++) {
 		if (requests[i]->status == DNL_STARTED) {
 			requests[i]->stop_download();
+		} else if (requests[i]->prefetch && 
+			requests[i]->status == DNL_FINISHED)
+		{
+			/* nobody asked for it */
+			fl_unlink(requests[i]->file);
 		}
+		requests[i]->prefetch = 0;
+	}
+}
+
+/*
+ *  Resolves u against base and cuts the anchor, which is returned in a.
+ */
+char *Download::real_url(const char *base, const char *u, char **a)
+{
+	char *r;
+	int i;
+
+	*a = "";
+	r = create_url(base, u);
+	i = 0;
+	while (r[i]) {
+		if (r[i] == '#') {
+			r[i] = '\0';
+			*a = r + i + 1;
+		}
+		i++;
+	}
+	return r;
+}
+
+Xd6HtmlRequest *Download::find_prefetch(const char *href)
+{
+	int i;
+	for (i = nb_requests - 1; i >= 0; i--) {
+		if (requests[i]->prefetch && !strcmp(requests[i]->href, href) &&
+			(requests[i]->status == DNL_STARTED ||
+			requests[i]->status == DNL_FINISHED))
+		{
+			return requests[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  Starts downloading an image of the page base while the page itself is
+ *  still downloaded. The request is handed to the display which asks for
+ *  the same url later, the number of connections opened at once is 
+ *  bounded by the multi handle.
+ */
+void Download::prefetch(const char *base, const char *url, 
+	Xd6HtmlFrame *frame)
+{
+	Xd6HtmlRequest *req;
+	HttpCacheEntry *e;
+	char *href;
+	char *a;
+
+	href = real_url(base, url, &a);
+	if ((strncasecmp(href, "http:", 5) && strncasecmp(href, "https:", 6))
+		|| find_prefetch(href)) 
+	{
+		free(href);
+		return;
+	}
+	e = cache->find(href);
+	if (e && cache->fresh(e)) {
+		free(href);
+		return;
+	}
+
+	req = new Xd6HtmlRequest();
+	requests = (Xd6HtmlRequest**) realloc(requests, 
+		sizeof(Xd6HtmlRequest*) * (nb_requests + 1));
+	requests[nb_requests] = req;
+	nb_requests++;
+	req->href = href;
+	req->anchor = strdup(a);
+	req->file = strdup(Xd6ConfigFile::temp());
+	req->target = strdup("");
+	req->frame = frame;
+	req->cache = cache;
+	req->prefetch = 1;
+	req->start_download(multi);
+}
+
+/*
+ *  Starts the images found in the pages being downloaded.
+ */
+void Download::prefetch_found()
+{
+	int i, j;
+
+	for (i = 0; i < nb_requests; i++) {
+		Xd6HtmlRequest *req = requests[i];
+		if (req->nb_found < 1) continue;
+		for (j = 0; j < req->nb_found; j++) {
+			prefetch(req->href, req->found[j], req->frame);
+			free(req->found[j]);
+		}
+		req->nb_found = 0;
 	}
 }
 
@@ -429,9 +810,22 @@ const char *Download::new_request(const char *url, const char *target,
 {
 	char *loc;
 	Xd6HtmlRequest *req;
-	int i;
-	char *real_url;
-	char *a = "";
+	char *href;
+	char *a;
+
+	href = real_url(frame->url, url, &a);
+	if (!form && wi) {
+		req = find_prefetch(href);
+		if (req) {
+			free(href);
+			req->prefetch = 0;
+			req->disp = wi;
+			if (req->status == DNL_FINISHED) {
+				req->finish_download();
+			}
+			return req->file;
+		}
+	}
 
 	req = new Xd6HtmlRequest();
 	requests = (Xd6HtmlRequest**) realloc(requests, 
@@ -439,52 +833,37 @@ const char *Download::new_request(const char *url, const char *target,
 	requests[nb_requests] = req;
 	nb_requests++;
 	
-
-	real_url = create_url(frame->url, url);
-	i = 0;
-	while (real_url[i]) {
-		if (real_url[i] == '#') {
-			real_url[i] = '\0';
-			a = real_url + i + 1;
-		}
-		i++;
-	}
 	loc = Xd6ConfigFile::temp();
-	req->href = real_url;
+	req->href = href;
 	req->anchor = strdup(a);
 	req->file = strdup(loc);
 	req->target = target ? strdup(target) : strdup("");
 	req->form = form;
 	req->frame = frame;
 	req->disp = wi; 
+	req->cache = cache;
 
 	if (!wi) {
 		stop();
-		GUI::self->browser->tool->new_url(req->href);
-		GUI::self->browser->redraw();
-		Fl::flush();
+		if (GUI::self) {
+			GUI::self->browser->tool->new_url(req->href);
+			GUI::self->browser->redraw();
+			Fl::flush();
+		}
 	}
 
 	if (!form) {
-		i = 0;
-		while (i < nb_requests - 1) {
-			if (requests[i]->form == NULL && 
-				requests[i]->status == DNL_FINISHED &&
-				!strcmp(req->href, requests[i]->href))
-			{
-				progress();
-				free(req->file);
-				req->file = strdup(requests[i]->file);
-				req->finish_download();
-				progress();
-				return requests[i]->file;
-			}
-			i++;
+		HttpCacheEntry *e = cache->find(req->href);
+		if (e && cache->fresh(e) && !cache->copy_to(e, req->file)) {
+			progress();
+			cache->touch(e);
+			req->finish_download();
+			progress();
+			return req->file;
 		}
-		req->start_download();
-	} else {
-		req->start_download();
 	}
+	req->start_download(multi);
+
 	
 	Fl::remove_timeout((Fl_Timeout_Handler) spool_cb, (void*)this);
 	Fl::add_timeout(0.1, (Fl_Timeout_Handler) spool_cb, (void*)this);
@@ -499,10 +878,7 @@ const char *Download::request(const char *url, const char *target,
 	if (!url) return NULL;
 
 	if (!strncmp("data:", url, 5)) {
-		ret = data_download(url);
-		if (ret && wi) {
-			wi->load(ret, NULL);
-		}
+		ret = data_request(url, wi);
 	} else {
 		ret = new_request(url, target, form, frame, wi);
 	}
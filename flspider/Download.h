@@ -44,6 +44,8 @@
 #include "xd640/Xd6ConfigFile.h"
 #include <curl/curl.h>
 #include "xd640/Xd6HtmlDownload.h"
+#include "xd640/Xd6XmlParser.h"
+#include "HttpCache.h"
 
 enum {
 	DNL_FINISHED = 0x0001,
@@ -61,16 +63,37 @@ public:
 	Xd6HtmlTagForm *form;
 	Xd6HtmlFrame *frame;
 	Xd6HtmlDisplay *disp;
-	int pid;
 	int status;
-	int kbd_fp;
+	CURLM *multi;
+	CURL *curl;
+	char *post;
+	char *data;
+	int data_len;
+	int data_size;
+	char errorbuffer[CURL_ERROR_SIZE];
+	HttpCache *cache;
+	int cacheable;
+	struct curl_slist *headers;
+	char *etag;
+	char *modified;
+	int max_age;
+	int no_store;
+	int prefetch;
+	Xd6XmlParser *scan;
+	char **found;
+	int nb_found;
 	Xd6HtmlRequest();
 	~Xd6HtmlRequest();
-	void start_download(void);
+	void start_download(CURLM *m);
 	void start_curl(void);
 	void finish_download(void);
-	void check_download(void);
+	void check_download(CURLcode res);
 	void stop_download(void);
+	static size_t write_cb(void *ptr, size_t size, size_t nmemb, void *d);
+	static size_t header_cb(void *ptr, size_t size, size_t nmemb, void *d);
+	static void scan_cb(Xd6XmlTreeElement *e, void *d);
+	void write_file(void);
+	void free_transfer(void);
 	void fill_form(CURL *curl);
 	void fill_form_buffer(CURL *curl, char **b, char *sep);
 	void form_bufferadd(char **b, char *sep, char *name, char *value);
@@ -84,6 +107,9 @@ public:
 	int nb_requests;
 	Xd6HtmlRequest **requests;
 	int empty;
+	CURLM *multi;
+	int running;
+	HttpCache *cache;
 
 	Download();
 	~Download();
@@ -92,8 +118,20 @@ public:
 		Xd6HtmlTagForm *form, Xd6HtmlFrame *frame, Xd6HtmlDisplay *wi = NULL);
 	const char *new_request(const char *href, const char *target,
 		Xd6HtmlTagForm *form, Xd6HtmlFrame *frame, Xd6HtmlDisplay *wi);
+	void prefetch(const char *base, const char *href, 
+		Xd6HtmlFrame *frame);
+	void prefetch_found(void);
+	Xd6HtmlRequest *find_prefetch(const char *href);
+	static char *real_url(const char *base, const char *u, char **a);
 	void spooler(void);
 	void stop(void);
+	void check_multi(void);
+	static int socket_cb(CURL *e, curl_socket_t s, int what, void *d, 
+		void *sd);
+	static int timer_cb(CURLM *m, long ms, void *d);
+	static void fd_read_cb(int fd, void *d);
+	static void fd_write_cb(int fd, void *d);
+	static void timeout_cb(void *d);
 };
 
 #endif
@@ -0,0 +1,339 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+#include "HttpCache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#define CACHE_MAGIC "XD6CACH2"
+#define CACHE_SLOTS 8192
+
+HttpCache::HttpCache(const char *d, unsigned int max)
+{
+	struct stat s;
+	char buf[1024];
+	void *ptr;
+
+	dir = strdup(d);
+	max_size = max;
+	started = time(NULL);
+	index = NULL;
+	entries = NULL;
+	map_size = sizeof(HttpCacheIndex) + 
+		CACHE_SLOTS * sizeof(HttpCacheEntry);
+
+	mkdir(dir, 0700);
+	snprintf(buf, 1024, "%s/index", dir);
+	fd = open(buf, O_RDWR | O_CREAT, 0600);
+	if (fd < 0) return;
+	if (fstat(fd, &s) || s.st_size != map_size) {
+		if (ftruncate(fd, 0) || ftruncate(fd, map_size)) {
+			close(fd);
+			fd = -1;
+			return;
+		}
+	}
+	ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		close(fd);
+		fd = -1;
+		return;
+	}
+	index = (HttpCacheIndex*) ptr;
+	entries = (HttpCacheEntry*) (index + 1);
+	if (memcmp(index->magic, CACHE_MAGIC, 8) || 
+		index->nb_slots != CACHE_SLOTS) 
+	{
+		clear();
+	}
+}
+
+HttpCache::~HttpCache()
+{
+	if (index) munmap(index, map_size);
+	if (fd >= 0) close(fd);
+	free(dir);
+}
+
+/*
+ *  Removes all the files of the cache and resets the index.
+ */
+void HttpCache::clear()
+{
+	DIR *dp;
+	struct dirent *de;
+
+	dp = opendir(dir);
+	while (dp && (de = readdir(dp))) {
+		if (de->d_name[0] == '.' || !strcmp(de->d_name, "index")) {
+			continue;
+		}
+		snprintf(path, 1024, "%s/%s", dir, de->d_name);
+		unlink(path);
+	}
+	if (dp) closedir(dp);
+	memset(index, 0, map_size);
+	memcpy(index->magic, CACHE_MAGIC, 8);
+	index->nb_slots = CACHE_SLOTS;
+}
+
+unsigned long long HttpCache::hash(const char *url)
+{
+	unsigned long long h = 14695981039346656037ULL;
+
+	while (*url) {
+		h ^= (unsigned char) *url++;
+		h *= 1099511628211ULL;
+	}
+	if (!h) h = 1;
+	return h;
+}
+
+/*
+ *  A hash computed another way than hash(), so that two URLs with the
+ *  same key are told apart.
+ */
+unsigned long long HttpCache::check_hash(const char *url)
+{
+	unsigned long long h = 0x9E3779B97F4A7C15ULL;
+
+	while (*url) {
+		h = (h ^ (unsigned char) *url++) * 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 29;
+	}
+	return h ^ (h >> 32);
+}
+
+HttpCacheEntry *HttpCache::slot(unsigned long long k)
+{
+	unsigned int mask = CACHE_SLOTS - 1;
+	unsigned int i = (unsigned int) k & mask;
+
+	while (entries[i].key && entries[i].key != k) {
+		i = (i + 1) & mask;
+	}
+	return entries + i;
+}
+
+/*
+ *  Returns the entry of url or NULL if it is not in the cache. The
+ *  entry of another URL with the same key is not returned.
+ */
+HttpCacheEntry *HttpCache::find(const char *url)
+{
+	HttpCacheEntry *e;
+
+	if (!index) return NULL;
+	e = slot(hash(url));
+	if (!e->key || e->check != check_hash(url)) return NULL;
+	return e;
+}
+
+const char *HttpCache::file(HttpCacheEntry *e)
+{
+	snprintf(path, 1024, "%s/%016llx", dir, e->key);
+	return path;
+}
+
+/*
+ *  An entry can be used without asking the server if it was fetched by
+ *  this process or if its max-age is not over.
+ */
+int HttpCache::fresh(HttpCacheEntry *e)
+{
+	unsigned int now = time(NULL);
+
+	if (e->fetched >= started) return 1;
+	if (e->max_age > 0 && now < e->fetched + e->max_age) return 1;
+	return 0;
+}
+
+void HttpCache::touch(HttpCacheEntry *e)
+{
+	e->last_use = ++index->clock;
+}
+
+/*
+ *  The server answered 304 : the entry is as good as new.
+ */
+void HttpCache::revalidated(HttpCacheEntry *e, int max_age)
+{
+	e->fetched = time(NULL);
+	e->max_age = max_age;
+	touch(e);
+}
+
+/*
+ *  Removes the least recently used entries until len bytes and one more
+ *  entry fit in the cache.
+ */
+void HttpCache::make_room(unsigned int len)
+{
+	while (index->nb_entries > 0 && 
+		(index->total_size + len > max_size ||
+		index->nb_entries + 1 > CACHE_SLOTS * 3 / 4))
+	{
+		HttpCacheEntry *old = NULL;
+		int i;
+		for (i = 0; i < CACHE_SLOTS; i++) {
+			if (entries[i].key && (!old || 
+				entries[i].last_use < old->last_use)) 
+			{
+				old = entries + i;
+			}
+		}
+		if (!old) break;
+		remove(old);
+	}
+}
+
+/*
+ *  Writes the data of url in the cache. Returns the new entry or NULL
+ *  if it could not be stored.
+ */
+HttpCacheEntry *HttpCache::store(const char *url, const char *data, int len,
+	const char *etag, const char *modified, int max_age)
+{
+	unsigned long long k;
+	HttpCacheEntry *e;
+	FILE *fp;
+
+	if (!index || len < 0 || (unsigned int) len > max_size / 4) return NULL;
+	k = hash(url);
+	e = slot(k);
+	if (e->key) remove(e);
+	make_room(len);
+	e = slot(k);
+
+	e->key = k;
+	e->check = check_hash(url);
+	e->size = len;
+	e->fetched = time(NULL);
+	e->max_age = max_age;
+	e->etag[0] = '\0';
+	e->modified[0] = '\0';
+	if (etag) strncat(e->etag, etag, sizeof(e->etag) - 1);
+	if (modified) strncat(e->modified, modified, sizeof(e->modified) - 1);
+	touch(e);
+	index->nb_entries++;
+	index->total_size += len;
+
+	fp = fopen(file(e), "wb");
+	if (!fp || (len > 0 && fwrite(data, 1, len, fp) != (size_t) len)) {
+		if (fp) fclose(fp);
+		remove(e);
+		return NULL;
+	}
+	fclose(fp);
+	return e;
+}
+
+/*
+ *  Gives a copy of the cached file to dest (a hard link when possible),
+ *  the users of downloaded files may delete them.
+ */
+int HttpCache::copy_to(HttpCacheEntry *e, const char *dest)
+{
+	char buf[8192];
+	int in, out, r;
+
+	file(e);
+	unlink(dest);
+	if (!link(path, dest)) return 0;
+
+	in = open(path, O_RDONLY);
+	if (in < 0) return -1;
+	out = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (out < 0) {
+		close(in);
+		return -1;
+	}
+	while ((r = read(in, buf, sizeof(buf))) > 0) {
+		if (write(out, buf, r) != r) {
+			r = -1;
+			break;
+		}
+	}
+	close(in);
+	close(out);
+	return r < 0 ? -1 : 0;
+}
+
+/*
+ *  Deletes an entry and its file, then moves back the following entries
+ *  of the probe sequence so that no lookup is broken by the hole.
+ */
+void HttpCache::remove(HttpCacheEntry *e)
+{
+	unsigned int mask = CACHE_SLOTS - 1;
+	unsigned int i, j;
+
+	unlink(file(e));
+	index->total_size -= e->size;
+	index->nb_entries--;
+	e->key = 0;
+
+	i = e - entries;
+	j = i;
+	for (;;) {
+		unsigned int h;
+		j = (j + 1) & mask;
+		if (!entries[j].key) break;
+		h = (unsigned int) entries[j].key & mask;
+		if ((j > i && (h <= i || h > j)) || 
+			(j < i && (h <= i && h > j))) 
+		{
+			entries[i] = entries[j];
+			entries[j].key = 0;
+			i = j;
+		}
+	}
+}
+
+/*
+ * "$Id: $"
+ */
@@ -0,0 +1,111 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+#ifndef HttpCache_h
+#define HttpCache_h
+
+#include <time.h>
+
+/*
+ *  One slot of the cache index. key is a 64 bit hash of the URL, 0 for
+ *  an empty slot, and check a second hash of it which must match too.
+ *  The data is in a file of the cache directory named after the key.
+ */
+struct HttpCacheEntry {
+	unsigned long long key;
+	unsigned long long check;
+	unsigned int size;
+	unsigned int last_use;
+	unsigned int fetched;
+	int max_age;
+	char etag[88];
+	char modified[40];
+};
+
+struct HttpCacheIndex {
+	char magic[8];
+	unsigned int nb_slots;
+	unsigned int nb_entries;
+	unsigned int clock;
+	unsigned int total_size;
+	unsigned int pad[2];
+};
+
+/*
+ *  Disk cache for the downloaded files. The index is a fixed size open
+ *  addressing hash table which is mapped in memory, so a lookup does not
+ *  read anything and the cache survives restarts. The least recently
+ *  used files are removed when the cache grows over max_size.
+ */
+class HttpCache {
+public:
+	char *dir;
+	int fd;
+	int map_size;
+	HttpCacheIndex *index;
+	HttpCacheEntry *entries;
+	unsigned int max_size;
+	unsigned int started;
+	char path[1024];
+
+	HttpCache(const char *d, unsigned int max);
+	~HttpCache(void);
+
+	static unsigned long long hash(const char *url);
+	static unsigned long long check_hash(const char *url);
+	HttpCacheEntry *find(const char *url);
+	const char *file(HttpCacheEntry *e);
+	int fresh(HttpCacheEntry *e);
+	void touch(HttpCacheEntry *e);
+	void revalidated(HttpCacheEntry *e, int max_age);
+	HttpCacheEntry *store(const char *url, const char *data, int len,
+		const char *etag, const char *modified, int max_age);
+	int copy_to(HttpCacheEntry *e, const char *dest);
+	void remove(HttpCacheEntry *e);
+	void clear(void);
+	HttpCacheEntry *slot(unsigned long long k);
+	void make_room(unsigned int len);
+};
+
+#endif
+
+/*
+ * "$Id: $"
+ */
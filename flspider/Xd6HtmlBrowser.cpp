@@ -51,6 +51,7 @@ Xd6HtmlBrowser::Xd6HtmlBrowser(int X, int Y, int W, int H) : Fl_Group(X, Y, W, H
 	view = new Xd6HtmlView(X, Y + 25, W, H - 25);
 	view->frame->editor = 0;
 	view->frame->wysiwyg = 0;
+	view->progressive = 1;
 	
 }
 
@@ -59,9 +60,14 @@ Xd6HtmlBrowser::~Xd6HtmlBrowser()
 {
 }
 
-void Xd6HtmlBrowser::load(const char *f)
+/*
+ *  Shows the page f, url is its address when f is a downloaded copy.
+ */
+void Xd6HtmlBrowser::load(const char *f, const char *url)
 {
-	view->load(f);
+	view->frame->hscroll = 0;
+	view->frame->vscroll = 0;
+	view->load(f, url);
 }
 
 void Xd6HtmlBrowser::resize(int X, int Y, int W, int H)
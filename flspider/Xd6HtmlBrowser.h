@@ -53,7 +53,7 @@ public:
 
 	Xd6HtmlBrowser(int X, int Y, int W, int H);
 	~Xd6HtmlBrowser(void);
-	void load(const char *f);
+	void load(const char *f, const char *url = NULL);
 	void resize(int X, int Y, int W, int H); 
 	int handle(int e);
 };
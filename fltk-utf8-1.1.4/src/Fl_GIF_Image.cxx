@@ -74,7 +74,20 @@
 
 typedef unsigned char uchar;
 
-#define NEXTBYTE (uchar)getc(GifFile)
+// The image is read from a file or from a memory buffer:
+struct Fl_GIF_Reader {
+  FILE *fp;
+  const uchar *data;
+  const uchar *end;
+};
+
+static int gif_getc(Fl_GIF_Reader &r) {
+  if (r.fp) return getc(r.fp);
+  if (r.data < r.end) return *r.data++;
+  return EOF;
+}
+
+#define NEXTBYTE (uchar)gif_getc(GifFile)
 #define GETSHORT(var) var = NEXTBYTE; var += NEXTBYTE << 8
 
 const char* fl_gif_unable_to_open = "Fl_GIF_Image: Unable to open %s!";
@@ -87,21 +100,42 @@ const char* fl_gif_unknown_code = "%s: unknown gif code 0x%02x";
 const char* fl_gif_lzw_barf = "Fl_GIF_Image: %s - LZW Barf!";
 
 Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
-  FILE *GifFile;	// File to read
-  char **new_data;	// Data array
+  Fl_GIF_Reader GifFile;	// File to read
 
-  if ((GifFile = fl_fopen(infname, "rb")) == NULL) {
+  if ((GifFile.fp = fl_fopen(infname, "rb")) == NULL) {
     Fl::error(fl_gif_unable_to_open, infname);
     return;
   }
+  load_gif_(GifFile, infname);
+  fclose(GifFile.fp);
+}
+
+//
+// 'Fl_GIF_Image::Fl_GIF_Image()' - Load a GIF image from memory.
+//
+// The name is only used in error messages.
+//
+
+Fl_GIF_Image::Fl_GIF_Image(const char *imagename, const unsigned char *data,
+                           int length) : Fl_Pixmap((char *const*)0) {
+  Fl_GIF_Reader GifFile;	// Buffer to read
+
+  GifFile.fp = NULL;
+  GifFile.data = data;
+  GifFile.end = data + length;
+  load_gif_(GifFile, imagename ? imagename : "<memory>");
+}
 
-  {char b[6];
-  if (fread(b,1,6,GifFile)<6) {
-    fclose(GifFile);
-    return; /* quit on eof */
+void Fl_GIF_Image::load_gif_(Fl_GIF_Reader &GifFile, const char *infname) {
+  char **new_data;	// Data array
+
+  {uchar b[6];
+  for (int n = 0; n < 6; n++) {
+    int c = gif_getc(GifFile);
+    if (c == EOF) return; /* quit on eof */
+    b[n] = (uchar)c;
   }
   if (b[0]!='G' || b[1]!='I' || b[2] != 'F') {
-    fclose(GifFile);
     Fl::error(fl_gif_is_not_gif, infname);
     return;
   }
@@ -144,7 +178,6 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
 
     int i = NEXTBYTE;
     if (i<0) {
-      fclose(GifFile);
       Fl::error(fl_gif_unexpected_eof,infname); 
       return;
     }
@@ -377,8 +410,6 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
   alloc_data = 1;
 
   delete[] Image;
-
-  fclose(GifFile);
 }
 
 
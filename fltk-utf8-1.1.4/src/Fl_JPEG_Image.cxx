@@ -26,6 +26,8 @@
 // Contents:
 //
 //   Fl_JPEG_Image::Fl_JPEG_Image() - Load a JPEG image file.
+//   Fl_JPEG_Image::Fl_JPEG_Image() - Load a JPEG image from memory.
+//   Fl_JPEG_Image::load_jpg_()     - Read the image with libjpeg.
 //
 
 //
@@ -55,24 +57,91 @@ extern "C"
 }
 
 
+#ifdef HAVE_LIBJPEG
+// Source manager reading the compressed data from a memory buffer.
+// A truncated image is ended with a fake EOI marker, as libjpeg's
+// stdio source does at the end of a file.
+
+static void fl_jpeg_init_source(j_decompress_ptr) {
+}
+
+static boolean fl_jpeg_fill_input_buffer(j_decompress_ptr cinfo) {
+  static JOCTET eoi[2] = { (JOCTET) 0xFF, (JOCTET) JPEG_EOI };
+
+  cinfo->src->next_input_byte = eoi;
+  cinfo->src->bytes_in_buffer = 2;
+  return TRUE;
+}
+
+static void fl_jpeg_skip_input_data(j_decompress_ptr cinfo, long num_bytes) {
+  if (num_bytes <= 0) return;
+  if ((size_t)num_bytes > cinfo->src->bytes_in_buffer) {
+    fl_jpeg_fill_input_buffer(cinfo);
+  } else {
+    cinfo->src->next_input_byte += num_bytes;
+    cinfo->src->bytes_in_buffer -= num_bytes;
+  }
+}
+
+static void fl_jpeg_term_source(j_decompress_ptr) {
+}
+
+static void fl_jpeg_mem_src(j_decompress_ptr cinfo, jpeg_source_mgr *src,
+                            const unsigned char *data, int length) {
+  src->init_source       = fl_jpeg_init_source;
+  src->fill_input_buffer = fl_jpeg_fill_input_buffer;
+  src->skip_input_data   = fl_jpeg_skip_input_data;
+  src->resync_to_restart = jpeg_resync_to_restart;
+  src->term_source       = fl_jpeg_term_source;
+  src->next_input_byte   = (const JOCTET*)data;
+  src->bytes_in_buffer   = length;
+  cinfo->src = src;
+}
+#endif // HAVE_LIBJPEG
+
+
 //
 // 'Fl_JPEG_Image::Fl_JPEG_Image()' - Load a JPEG image file.
 //
 
 Fl_JPEG_Image::Fl_JPEG_Image(const char *jpeg)	// I - File to load
   : Fl_RGB_Image(0,0,0) {
+  load_jpg_(jpeg, NULL, 0);
+}
+
+
+//
+// 'Fl_JPEG_Image::Fl_JPEG_Image()' - Load a JPEG image from memory.
+//
+
+Fl_JPEG_Image::Fl_JPEG_Image(const char *name,	// I - Name, unused
+                             const unsigned char *data, // I - JPEG data
+                             int length)	// I - Size of the data
+  : Fl_RGB_Image(0,0,0) {
+  load_jpg_(name, data, length);
+}
+
+
+//
+// 'Fl_JPEG_Image::load_jpg_()' - Read the image from a file or a buffer.
+//
+
+void Fl_JPEG_Image::load_jpg_(const char *jpeg, const unsigned char *data,
+                              int length) {
 #ifdef HAVE_LIBJPEG
-  FILE				*fp;		// File pointer
+  FILE				*fp = NULL;	// File pointer
   struct jpeg_decompress_struct	cinfo;		// Decompressor info
   struct jpeg_error_mgr		jerr;		// Error handler info
+  struct jpeg_source_mgr	src;		// Memory source
   JSAMPROW			row;		// Sample row pointer
 
 
-  if ((fp = fl_fopen(jpeg, "rb")) == NULL) return;
+  if (!data && (fp = fl_fopen(jpeg, "rb")) == NULL) return;
 
   cinfo.err = jpeg_std_error(&jerr);
   jpeg_create_decompress(&cinfo);
-  jpeg_stdio_src(&cinfo, fp);
+  if (data) fl_jpeg_mem_src(&cinfo, &src, data, length);
+  else jpeg_stdio_src(&cinfo, fp);
   jpeg_read_header(&cinfo, 1);
 
   cinfo.quantize_colors      = (boolean)FALSE;
@@ -102,7 +171,7 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *jpeg)	// I - File to load
   jpeg_finish_decompress(&cinfo);
   jpeg_destroy_decompress(&cinfo);
 
-  fclose(fp);
+  if (fp) fclose(fp);
 #endif // HAVE_LIBJPEG
 }
 
@@ -26,6 +26,8 @@
 // Contents:
 //
 //   Fl_PNG_Image::Fl_PNG_Image() - Load a PNG image file.
+//   Fl_PNG_Image::Fl_PNG_Image() - Load a PNG image from memory.
+//   Fl_PNG_Image::load_png_()    - Read the image with libpng.
 //
 
 //
@@ -37,6 +39,7 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 extern "C"
 {
@@ -51,15 +54,58 @@ extern "C"
 }
 
 
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+struct fl_png_memory {
+  const unsigned char *current;
+  const unsigned char *last;
+};
+
+static void png_read_data_from_mem(png_structp png_ptr, png_bytep data,
+                                   png_size_t length) {
+  fl_png_memory *png_mem = (fl_png_memory*)png_get_io_ptr(png_ptr);
+
+  if (png_mem->current + length > png_mem->last) {
+    png_error(png_ptr, "Fl_PNG_Image: premature end of data");
+    return;
+  }
+  memcpy(data, png_mem->current, length);
+  png_mem->current += length;
+}
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+
+
 //
 // 'Fl_PNG_Image::Fl_PNG_Image()' - Load a PNG image file.
 //
 
 Fl_PNG_Image::Fl_PNG_Image(const char *png) // I - File to read
   : Fl_RGB_Image(0,0,0) {
+  load_png_(png, NULL, 0);
+}
+
+
+//
+// 'Fl_PNG_Image::Fl_PNG_Image()' - Load a PNG image from memory.
+//
+
+Fl_PNG_Image::Fl_PNG_Image(const char *name,	// I - Name, unused
+                           const unsigned char *buffer, // I - PNG data
+                           int datasize)	// I - Size of the data
+  : Fl_RGB_Image(0,0,0) {
+  load_png_(name, buffer, datasize);
+}
+
+
+//
+// 'Fl_PNG_Image::load_png_()' - Read the image from a file or a buffer.
+//
+
+void Fl_PNG_Image::load_png_(const char *png, const unsigned char *buffer,
+                             int datasize) {
 #if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
   int		i;			// Looping var
-  FILE		*fp;			// File pointer
+  FILE		*fp = NULL;		// File pointer
+  fl_png_memory	png_mem;		// Memory reader
   int		channels;		// Number of color channels
   png_structp	pp;			// PNG read pointer
   png_infop	info;			// PNG info pointers
@@ -67,14 +113,20 @@ Fl_PNG_Image::Fl_PNG_Image(const char *png) // I - File to read
 
 
   // Open the PNG file...
-  if ((fp = fl_fopen(png, "rb")) == NULL) return;
+  if (!buffer && (fp = fl_fopen(png, "rb")) == NULL) return;
 
   // Setup the PNG data structures...
   pp   = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
   info = png_create_info_struct(pp);
 
   // Initialize the PNG read "engine"...
-  png_init_io(pp, fp);
+  if (buffer) {
+    png_mem.current = buffer;
+    png_mem.last = buffer + datasize;
+    png_set_read_fn(pp, (png_voidp)&png_mem, png_read_data_from_mem);
+  } else {
+    png_init_io(pp, fp);
+  }
 
   // Get the image dimensions and convert to grayscale or RGB...
   png_read_info(pp, info);
@@ -129,7 +181,7 @@ Fl_PNG_Image::Fl_PNG_Image(const char *png) // I - File to read
   png_read_end(pp, info);
   png_destroy_read_struct(&pp, &info, NULL);
 
-  fclose(fp);
+  if (fp) fclose(fp);
 #endif // HAVE_LIBPNG && HAVE_LIBZ
 }
 
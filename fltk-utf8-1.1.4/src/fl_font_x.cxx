@@ -29,6 +29,11 @@ Fl_FontSize::Fl_FontSize(const char* name) {
 //    Fl::warning("bad font: %s", name);
     font = XCreateUtf8FontStruct(fl_display, "fixed");
   }
+  int i;
+  for (i = 0; i < 64; i++) width[i] = NULL;
+  wide = NULL;
+  wide_size = 0;
+  nb_wide = 0;
 #  if HAVE_GL
   listbase = 0;
   for (int u = 0; u < 64; u++) glok[u] = 0;
@@ -51,6 +56,9 @@ Fl_FontSize::~Fl_FontSize() {
 #  endif
   if (this == fl_fontsize) fl_fontsize = 0;
   XFreeUtf8FontStruct(fl_display, font);
+  int i;
+  for (i = 0; i < 64; i++) free(width[i]);
+  free(wide);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -259,12 +267,78 @@ int Fl_Fltk::descent() {
   return fl_xfont->descent;
 }
 
+// Advance width of one char, the same as XUtf8TextWidth() would give
+// (non-spacing chars are drawn over the previous one).
+static int measure_ucs(unsigned int ucs) {
+  char buf[8];
+  int l;
+  if (XUtf8IsNonSpacing(ucs)) return 0;
+  l = XConvertUcsToUtf8(ucs, buf);
+  return XUtf8TextWidth(fl_xfont, buf, l);
+}
+
+// Cached advance width of a char in the current font. The widths of the
+// BMP are kept in pages of 0x400 chars, the others in a small hash table.
+static int ucs_width(unsigned int ucs) {
+  Fl_FontSize *f = fl_fontsize;
+  if (ucs < 0x10000) {
+    short *p = f->width[ucs >> 10];
+    if (!p) {
+      p = (short*) malloc(sizeof(short) * 0x0400);
+      for (int i = 0; i < 0x0400; i++) p[i] = -1;
+      f->width[ucs >> 10] = p;
+    }
+    if (p[ucs & 0x03FF] < 0) p[ucs & 0x03FF] = (short) measure_ucs(ucs);
+    return p[ucs & 0x03FF];
+  }
+  if ((f->nb_wide + 1) * 2 > f->wide_size) {
+    unsigned int *o = f->wide;
+    int os = f->wide_size;
+    f->wide_size = os ? os * 2 : 64;
+    f->wide = (unsigned int*) calloc(f->wide_size * 2, sizeof(unsigned int));
+    for (int i = 0; i < os; i++) {
+      if (!o[i * 2]) continue;
+      unsigned int h = (o[i * 2] * 2654435761U) & (f->wide_size - 1);
+      while (f->wide[h * 2]) h = (h + 1) & (f->wide_size - 1);
+      f->wide[h * 2] = o[i * 2];
+      f->wide[h * 2 + 1] = o[i * 2 + 1];
+    }
+    free(o);
+  }
+  unsigned int h = (ucs * 2654435761U) & (f->wide_size - 1);
+  while (f->wide[h * 2]) {
+    if (f->wide[h * 2] == ucs) return (int) f->wide[h * 2 + 1];
+    h = (h + 1) & (f->wide_size - 1);
+  }
+  f->wide[h * 2] = ucs;
+  f->wide[h * 2 + 1] = measure_ucs(ucs);
+  f->nb_wide++;
+  return (int) f->wide[h * 2 + 1];
+}
+
 double Fl_Fltk::width(const char* c, int n) {
-  return (double) XUtf8TextWidth(fl_xfont, c, n);
+  if (!fl_fontsize) return (double) XUtf8TextWidth(fl_xfont, c, n);
+  int w = 0;
+  while (n > 0) {
+    unsigned int ucs;
+    int l;
+    if (!(*c & 0x80)) {
+      ucs = (unsigned char) *c;
+      l = 1;
+    } else {
+      l = XFastConvertUtf8ToUcs((const unsigned char*)c, n, &ucs);
+      if (l < 1) l = 1;
+    }
+    w += ucs_width(ucs);
+    c += l;
+    n -= l;
+  }
+  return (double) w;
 }
 
 double Fl_Fltk::width(unsigned int c) {
-  return (double) XUtf8UcsWidth(fl_xfont, c);
+  if (!fl_fontsize) return (double) XUtf8UcsWidth(fl_xfont, c);
+  return (double) ucs_width(c);
 }
 
 void Fl_Fltk::draw(const char* c, int n, int x, int y) {
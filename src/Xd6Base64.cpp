@@ -38,111 +38,224 @@
  ******************************************************************************/
 
 #include "Xd6Std.h"
+#include "Xd6Base64.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <sys/stat.h>
 
-static char buffer[3];
-static short linelen;
-static short num;
-static char *str = 
+#define LINE_LEN 72
+#define BLOCK (64 * 1024)
+
+#define XX 0xFF
+#define EQ 0xFE
+
+static const char *str = 
 	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+/* value of each char, XX for the chars which are skipped */
+static const unsigned char tbl[256] = {
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, EQ, XX, XX,
+	XX, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+	XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+	XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
 
-void Xd6Decode_base64 (FILE *fpin, FILE *fout)
+Xd6Base64::Xd6Base64()
 {
- 	signed char buf[5];
-  	int c1, c2, c3, c4, ch, i;
-  	signed char tbl[256];
+	bits = 0;
+	nb_bits = 0;
+	done = 0;
+	nb_part = 0;
+	linelen = 0;
+}
 
-	if (!fpin || !fout) return;
-  	buf[4] = 0;
+/*
+ *  Size of the buffer needed to encode len bytes (end() included).
+ */
+int Xd6Base64::encode_size(int len)
+{
+	int l = (len + 2 + 3) / 3 * 4;
+	return l + l / LINE_LEN + 2;
+}
 
-  	for (i = 0; i < 256; i++) {
-		tbl[i] = -1;
-  	}
-  	for (i = 0; i < 64; i++) {
-		tbl[str[i]] = i;
-  	}
-  	for (;1;) {
-    		for (i = 0 ; i < 4; ) {
-      			if ((ch = fgetc(fpin)) == EOF) return;
-      			if (!isspace(ch)) buf[i++] = ch;
-    		}
-    		if (i != 4) return; 
+int Xd6Base64::decode_size(int len)
+{
+	return len / 4 * 3 + 3;
+}
 
-    		c1 = tbl[(unsigned int) buf[0]];
-    		c2 = tbl[(unsigned int) buf[1]];
-    		ch = (c1 << 2) | (c2 >> 4);
+/*
+ *  Encodes len bytes to out and returns the number of chars written.
+ *  Lines are LINE_LEN chars long, up to 2 bytes are kept for the next 
+ *  call or for end().
+ */
+int Xd6Base64::encode(const unsigned char *in, int len, char *out)
+{
+	char *o = out;
+	const unsigned char *end = in + len;
 
-    		putc(ch, fout);
+	while (nb_part > 0 && nb_part < 3 && in < end) {
+		part[nb_part++] = *in++;
+	}
+	if (nb_part == 3) {
+		nb_part = 0;
+		o += encode(part, 3, o);
+	}
+	while (end - in >= 3) {
+		unsigned int v = (in[0] << 16) | (in[1] << 8) | in[2];
+		if (linelen >= LINE_LEN) {
+			*o++ = '\n';
+			linelen = 0;
+		}
+		o[0] = str[v >> 18];
+		o[1] = str[(v >> 12) & 0x3F];
+		o[2] = str[(v >> 6) & 0x3F];
+		o[3] = str[v & 0x3F];
+		o += 4;
+		linelen += 4;
+		in += 3;
+	}
+	while (in < end) part[nb_part++] = *in++;
+	return o - out;
+}
 
-    		if (buf[2] == '=') break;
+/*
+ *  Writes the last bytes with the '=' padding.
+ */
+int Xd6Base64::end(char *out)
+{
+	char *o = out;
+	unsigned int v;
 
-    		c3 = tbl[(unsigned int) buf[2]];
-    		ch = ((c2 & 0xf) << 4) | (c3 >> 2);
+	if (nb_part < 1) return 0;
+	if (linelen >= LINE_LEN) {
+		*o++ = '\n';
+		linelen = 0;
+	}
+	v = part[0] << 16;
+	if (nb_part > 1) v |= part[1] << 8;
+	o[0] = str[v >> 18];
+	o[1] = str[(v >> 12) & 0x3F];
+	o[2] = nb_part > 1 ? str[(v >> 6) & 0x3F] : '=';
+	o[3] = '=';
+	o += 4;
+	linelen += 4;
+	nb_part = 0;
+	return o - out;
+}
 
-    		putc(ch, fout);
+/*
+ *  Decodes len chars to out and returns the number of bytes written. 
+ *  Line breaks and any other char out of the alphabet are skipped, the 
+ *  decoding stops at the first '='.
+ */
+int Xd6Base64::decode(const char *in, int len, unsigned char *out)
+{
+	const unsigned char *i = (const unsigned char*) in;
+	const unsigned char *end = i + len;
+	unsigned char *o = out;
 
-    		if (buf[3] == '=') break;
-    		c4 = tbl[(unsigned int) buf[3]];
-    		ch = ((c3 & 0x3) << 6) | c4;
+	while (i < end && !done) {
+		/* 4 chars at a time while there is nothing to skip */
+		if (nb_bits == 0) {
+			while (end - i >= 4) {
+				unsigned int a = tbl[i[0]];
+				unsigned int b = tbl[i[1]];
+				unsigned int c = tbl[i[2]];
+				unsigned int d = tbl[i[3]];
+				unsigned int v;
+				if ((a | b | c | d) & 0xC0) break;
+				v = (a << 18) | (b << 12) | (c << 6) | d;
+				o[0] = (unsigned char) (v >> 16);
+				o[1] = (unsigned char) (v >> 8);
+				o[2] = (unsigned char) v;
+				o += 3;
+				i += 4;
+			}
+			if (i >= end) break;
+		}
+		if (tbl[*i] == EQ) {
+			done = 1;
+			nb_bits = 0;
+			break;
+		}
+		if (tbl[*i] != XX) {
+			bits = (bits << 6) | tbl[*i];
+			nb_bits += 6;
+			if (nb_bits >= 8) {
+				nb_bits -= 8;
+				*o++ = (unsigned char) (bits >> nb_bits);
+				bits &= (1 << nb_bits) - 1;
+			}
+		}
+		i++;
+	}
+	return o - out;
+}
 
-    		putc(ch, fout);
-  	}
+/*
+ *  One shot versions : out must hold encode_size(len) or 
+ *  decode_size(len) bytes.
+ */
+int Xd6Base64::encode_buffer(const unsigned char *in, int len, char *out)
+{
+	Xd6Base64 b;
+	int l = b.encode(in, len, out);
+	return l + b.end(out + l);
 }
 
-static void flush(FILE *fout)
+int Xd6Base64::decode_buffer(const char *in, int len, unsigned char *out)
 {
-  	int i;
+	Xd6Base64 b;
+	return b.decode(in, len, out);
+}
 
-  	if(num < 1) return;
+void Xd6Decode_base64 (FILE *fpin, FILE *fout)
+{
+	Xd6Base64 b;
+	char *in;
+	unsigned char *out;
+	int l;
 
-  	if(linelen >= 72) {
-    		putc('\n', fout);
-    		linelen = 0;
-  	}
-  
-  	for(i = num; i < 3; i++) buffer[i] = '\0';
-  
-  	putc(str[(*buffer >> 2) & 0x3f], fout); 
-  	linelen++;
-  	putc(str[((buffer[0] & 0x3) << 4) | 
-	           ((buffer[1] >> 4) & 0xf) ], fout);
-  	linelen++;
-  
-  	if(num > 1) {
-    		putc(str[((buffer[1] & 0x0f) << 2) | 
-		     	((buffer[2] >> 6) & 0x03) ], fout);
-    		linelen++;
-    		if(num > 2) {
-      			putc(str[buffer[2] & 0x3f], fout);
-      			linelen++;
-    		}
-  	}
-  
-  	while(linelen % 4) {
-    		putc('=', fout);
-    		linelen++;
-  	}
-  
-  	num = 0;
+	if (!fpin || !fout) return;
+	in = (char*) malloc(BLOCK);
+	out = (unsigned char*) malloc(Xd6Base64::decode_size(BLOCK));
+	while (!b.done && (l = fread(in, 1, BLOCK, fpin)) > 0) {
+		l = b.decode(in, l, out);
+		if (l > 0) fwrite(out, 1, l, fout);
+	}
+	free(in);
+	free(out);
 }
-    
-  
+
 void Xd6Encode_base64 (FILE * fin, FILE *fout)
 {
-  	int ch;
+	Xd6Base64 b;
+	unsigned char *in;
+	char *out;
+	int l;
   
 	if (!fin || !fout) return;
-
-  	num = linelen = 0;
-  
-  	while ((ch = fgetc(fin)) != EOF) {
-    		if(num == 3) flush(fout);
-    		buffer[num++] = ch;
-  	}
-  	flush(fout);
-  	putc('\n', fout);
+	in = (unsigned char*) malloc(BLOCK);
+	out = (char*) malloc(Xd6Base64::encode_size(BLOCK));
+	while ((l = fread(in, 1, BLOCK, fin)) > 0) {
+		l = b.encode(in, l, out);
+		if (l > 0) fwrite(out, 1, l, fout);
+	}
+	l = b.end(out);
+	if (l > 0) fwrite(out, 1, l, fout);
+	putc('\n', fout);
+	free(in);
+	free(out);
 }
-
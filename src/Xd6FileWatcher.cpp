@@ -0,0 +1,464 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#include "Xd6Std.h"
+#include "Xd6FileWatcher.h"
+#include <FL/Fl.H>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#endif
+
+#define WATCH_MAX_EVENTS 1024
+
+#ifdef __linux__
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | \
+	IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | \
+	IN_ONLYDIR)
+#endif
+
+int Xd6FileWatcher::inotify_fd = -1;
+Xd6FileWatcher *Xd6FileWatcher::first = NULL;
+
+/*
+ *  False for the file systems where the changes made by other hosts 
+ *  never reach inotify.
+ */
+static int can_notify(const char *dir)
+{
+#ifdef __linux__
+	struct statfs fs;
+
+	if (statfs(dir, &fs)) return 0;
+	switch ((unsigned long) fs.f_type & 0xFFFFFFFFUL) {
+	case 0x6969UL:		/* NFS */
+	case 0x517BUL:		/* SMB */
+	case 0xFF534D42UL:	/* CIFS */
+	case 0xFE534D42UL:	/* SMB2 */
+	case 0x65735546UL:	/* FUSE */
+	case 0x73757245UL:	/* CODA */
+	case 0x5346414FUL:	/* AFS */
+	case 0x01021997UL:	/* 9P */
+	case 0x564CUL:		/* NCP */
+	case 0x00C36400UL:	/* CEPH */
+		return 0;
+	}
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static int entry_sort(const void *a, const void *b)
+{
+	return strcmp(((Xd6WatchEntry*)a)->name, ((Xd6WatchEntry*)b)->name);
+}
+
+static void free_entries(Xd6WatchEntry *e, int nb)
+{
+	while (nb > 0) {
+		nb--;
+		free(e[nb].name);
+	}
+	free(e);
+}
+
+Xd6FileWatcher::Xd6FileWatcher(const char *path, Xd6WatchCallback *c, 
+	void *d)
+{
+	struct stat st;
+	const char *ptr;
+
+	cb = c;
+	data = d;
+	wd = -1;
+	proc_fd = -1;
+	polling = 0;
+	delay = 0.1;
+	interval = 2.0;
+	events = NULL;
+	nb_events = 0;
+	max_events = 0;
+	entries = NULL;
+	nb_entries = 0;
+	living = NULL;
+
+	if (!stat(path, &st) && S_ISDIR(st.st_mode)) {
+		dir = strdup(path);
+		file = NULL;
+	} else {
+		ptr = strrchr(path, '/');
+		if (!ptr) {
+			dir = strdup(".");
+			file = strdup(path);
+		} else {
+			file = strdup(ptr + 1);
+			dir = (char*) malloc(ptr - path + 2);
+			memcpy(dir, path, ptr - path + 1);
+			dir[ptr == path ? 1 : ptr - path] = '\0';
+		}
+	}
+	next = first;
+	first = this;
+
+#ifdef __linux__
+	if (file) {
+		char *real = realpath(path, NULL);
+		if (real && !strncmp(real, "/proc/", 6)) {
+			proc_fd = open(real, O_RDONLY);
+		}
+		free(real);
+		if (proc_fd >= 0) {
+			Fl::add_fd(proc_fd, FL_EXCEPT, proc_cb, this);
+			return;
+		}
+	}
+	if (can_notify(dir)) {
+		if (inotify_fd < 0) {
+			inotify_fd = inotify_init();
+			if (inotify_fd >= 0) {
+				fcntl(inotify_fd, F_SETFL, O_NONBLOCK);
+				fcntl(inotify_fd, F_SETFD, FD_CLOEXEC);
+				Fl::add_fd(inotify_fd, FL_READ, inotify_cb, 
+					NULL);
+			}
+		}
+		if (inotify_fd >= 0) {
+			wd = inotify_add_watch(inotify_fd, dir, WATCH_MASK);
+		}
+	}
+#endif
+	if (wd < 0) start_polling();
+}
+
+Xd6FileWatcher::~Xd6FileWatcher()
+{
+	Xd6FileWatcher **p;
+	Xd6FileWatcher *w;
+	int shared = 0;
+
+	p = &first;
+	while (*p && *p != this) p = &(*p)->next;
+	if (*p) *p = next;
+	for (w = first; w; w = w->next) {
+		if (wd >= 0 && w->wd == wd) shared = 1;
+	}
+#ifdef __linux__
+	if (wd >= 0 && !shared) inotify_rm_watch(inotify_fd, wd);
+	if (!first && inotify_fd >= 0) {
+		Fl::remove_fd(inotify_fd);
+		close(inotify_fd);
+		inotify_fd = -1;
+	}
+#endif
+	if (proc_fd >= 0) {
+		Fl::remove_fd(proc_fd);
+		close(proc_fd);
+	}
+	Fl::remove_timeout(deliver_cb, this);
+	Fl::remove_timeout(poll_cb, this);
+	while (nb_events > 0) {
+		nb_events--;
+		free(events[nb_events].name);
+	}
+	free(events);
+	free_entries(entries, nb_entries);
+	free(dir);
+	free(file);
+	if (living) *living = 0;
+}
+
+/*
+ *  Queues a change of name, merged with the changes of the same name
+ *  already queued. Past WATCH_MAX_EVENTS names a single rescan is 
+ *  cheaper for the application.
+ */
+void Xd6FileWatcher::add_event(const char *name, int what)
+{
+	int i;
+
+	if (!nb_events) Fl::add_timeout(delay, deliver_cb, this);
+	if (nb_events && events[0].what & XD6_WATCH_RESCAN) return;
+	if (!(what & XD6_WATCH_RESCAN)) {
+		for (i = 0; i < nb_events; i++) {
+			if (!strcmp(events[i].name, name)) {
+				events[i].what |= what;
+				return;
+			}
+		}
+	}
+	if ((what & XD6_WATCH_RESCAN) || nb_events >= WATCH_MAX_EVENTS) {
+		while (nb_events > 0) {
+			nb_events--;
+			free(events[nb_events].name);
+		}
+		name = NULL;
+		what = XD6_WATCH_RESCAN;
+	}
+	if (nb_events >= max_events) {
+		max_events = max_events * 2 + 16;
+		events = (Xd6WatchEvent*) realloc(events, 
+			sizeof(Xd6WatchEvent) * max_events);
+	}
+	events[nb_events].name = name ? strdup(name) : NULL;
+	events[nb_events].what = what;
+	nb_events++;
+}
+
+/*
+ *  Calls the callback for each queued change. The callback may delete
+ *  the watcher, the remaining changes are then dropped.
+ */
+void Xd6FileWatcher::deliver()
+{
+	Xd6WatchEvent *ev = events;
+	int nb = nb_events;
+	int alive = 1;
+	int i;
+
+	events = NULL;
+	nb_events = 0;
+	max_events = 0;
+	living = &alive;
+	for (i = 0; i < nb; i++) {
+		if (alive) cb(this, ev[i].name, ev[i].what, data);
+		free(ev[i].name);
+	}
+	if (alive) living = NULL;
+	free(ev);
+}
+
+void Xd6FileWatcher::deliver_cb(void *d)
+{
+	((Xd6FileWatcher*)d)->deliver();
+}
+
+void Xd6FileWatcher::inotify_cb(int fd, void *d)
+{
+#ifdef __linux__
+	char buf[4096] __attribute__ ((aligned(8)));
+	struct inotify_event *ev;
+	Xd6FileWatcher *w;
+	const char *name;
+	long n, i;
+	int what;
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		for (i = 0; i < n; i += sizeof(struct inotify_event) + ev->len) {
+			ev = (struct inotify_event*) (buf + i);
+			name = ev->len ? ev->name : NULL;
+			what = 0;
+			if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+				what |= XD6_WATCH_CREATE;
+			}
+			if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				what |= XD6_WATCH_DELETE;
+			}
+			if (ev->mask & (IN_MODIFY | IN_ATTRIB)) {
+				what |= XD6_WATCH_MODIFY;
+			}
+			if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | 
+				IN_UNMOUNT | IN_Q_OVERFLOW)) 
+			{
+				what = XD6_WATCH_RESCAN;
+				name = NULL;
+			}
+			for (w = first; w; w = w->next) {
+				if (ev->mask & IN_Q_OVERFLOW) {
+					if (w->wd >= 0) w->add_event(NULL, what);
+					continue;
+				}
+				if (w->wd != ev->wd) continue;
+				if (ev->mask & IN_IGNORED) {
+					w->wd = -1;
+					continue;
+				}
+				if (!what) continue;
+				if (name && w->file && strcmp(name, w->file)) {
+					continue;
+				}
+				if (!name && !(what & XD6_WATCH_RESCAN)) {
+					continue;
+				}
+				w->add_event(name, what);
+			}
+		}
+	}
+#endif
+}
+
+/*
+ *  The mount table and its friends in /proc raise an exception on 
+ *  their fd when they change.
+ */
+void Xd6FileWatcher::proc_cb(int fd, void *d)
+{
+	Xd6FileWatcher *w = (Xd6FileWatcher*) d;
+
+	w->add_event(w->file, XD6_WATCH_MODIFY);
+}
+
+void Xd6FileWatcher::start_polling()
+{
+	polling = 1;
+	list(&entries, &nb_entries);
+	Fl::add_timeout(interval, poll_cb, this);
+}
+
+/*
+ *  Lists the entries of the directory (or only the watched file) sorted 
+ *  by name.
+ */
+void Xd6FileWatcher::list(Xd6WatchEntry **e, int *nb)
+{
+	struct dirent *de;
+	struct stat st;
+	DIR *d = NULL;
+	int size = 0;
+	const char *name;
+	char *path;
+
+	*e = NULL;
+	*nb = 0;
+	if (!file) d = opendir(dir);
+	path = (char*) malloc(strlen(dir) + 258);
+	for (;;) {
+		if (file) {
+			if (*nb) break;
+			name = file;
+		} else {
+			if (!d || !(de = readdir(d))) break;
+			name = de->d_name;
+			if (name[0] == '.' && (!name[1] || 
+				(name[1] == '.' && !name[2]))) 
+			{
+				continue;
+			}
+		}
+		snprintf(path, strlen(dir) + 258, "%s/%s", dir, name);
+		if (lstat(path, &st)) {
+			if (file) break;
+			continue;
+		}
+		if (*nb >= size) {
+			size = size * 2 + 64;
+			*e = (Xd6WatchEntry*) realloc(*e, 
+				sizeof(Xd6WatchEntry) * size);
+		}
+		(*e)[*nb].name = strdup(name);
+		(*e)[*nb].ino = st.st_ino;
+		(*e)[*nb].size = st.st_size;
+		(*e)[*nb].mtime = st.st_mtime;
+#ifdef __linux__
+		(*e)[*nb].mtime_ns = st.st_mtim.tv_nsec;
+#else
+		(*e)[*nb].mtime_ns = 0;
+#endif
+		(*e)[*nb].ctime = st.st_ctime;
+		(*nb)++;
+	}
+	if (d) closedir(d);
+	free(path);
+	if (*nb > 1) qsort(*e, *nb, sizeof(Xd6WatchEntry), entry_sort);
+}
+
+/*
+ *  Compares a new listing with the previous one.
+ */
+void Xd6FileWatcher::poll()
+{
+	Xd6WatchEntry *e;
+	int nb;
+	int i = 0, j = 0;
+	int r;
+
+	list(&e, &nb);
+	while (i < nb_entries || j < nb) {
+		if (i >= nb_entries) {
+			r = 1;
+		} else if (j >= nb) {
+			r = -1;
+		} else {
+			r = strcmp(entries[i].name, e[j].name);
+		}
+		if (r < 0) {
+			add_event(entries[i].name, XD6_WATCH_DELETE);
+			i++;
+		} else if (r > 0) {
+			add_event(e[j].name, XD6_WATCH_CREATE);
+			j++;
+		} else {
+			if (entries[i].ino != e[j].ino) {
+				add_event(e[j].name, XD6_WATCH_DELETE | 
+					XD6_WATCH_CREATE);
+			} else if (entries[i].size != e[j].size ||
+				entries[i].mtime != e[j].mtime ||
+				entries[i].mtime_ns != e[j].mtime_ns ||
+				entries[i].ctime != e[j].ctime)
+			{
+				add_event(e[j].name, XD6_WATCH_MODIFY);
+			}
+			i++;
+			j++;
+		}
+	}
+	free_entries(entries, nb_entries);
+	entries = e;
+	nb_entries = nb;
+}
+
+void Xd6FileWatcher::poll_cb(void *d)
+{
+	Xd6FileWatcher *w = (Xd6FileWatcher*) d;
+
+	w->poll();
+	Fl::repeat_timeout(w->interval, poll_cb, d);
+}
+
+/*
+ * "$Id: $"
+ */
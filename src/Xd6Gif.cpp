@@ -67,14 +67,8 @@ const char *Xd6Gif::mime()
 
 int Xd6Gif::load(const char *name)
 {
-	if (file) free(file);
-        file = strdup(name ? name : "");
-	png = new Fl_GIF_Image(file);
-	data = (unsigned char*)png->data();
-	w = png->w();
-	h = png->h();
-	d = png->d();
-	return 1;
+	/* the cache looks at the content to pick the decoder */
+	return Xd6Png::load(name);
 }
 
 void Xd6Gif::draw(int XP, int YP, int WP, int HP, int cx, int cy) {
@@ -65,6 +65,13 @@ Xd6HtmlBlock::Xd6HtmlBlock(int i, int mw)
 	lines = NULL;
 	nb_lines = 0;
 	stl = &Xd6XmlStl::def;
+
+	layout_key = 0;
+	text_width = 0;
+	paged = 0;
+	has_display = 0;
+	dirty = 1;
+	spelled = 0;
 }
 
 Xd6HtmlBlock::~Xd6HtmlBlock()
@@ -104,6 +111,7 @@ void Xd6HtmlBlock::measure()
 	
 	max_width = 0;
 	min_width = 0;
+	spelled = 0;
 	for (i = 0; i < nb_segs; i++) {
 		int w;
 		segs[i]->measure();
@@ -126,6 +134,8 @@ void Xd6HtmlBlock::create_lines()
 	lines = NULL;
 	width = 0;
 	height = 0;
+	paged = 0;
+	has_display = 0;
 
 	fw = frame_width - stl->blockquote * BLOCKQUOTEWIDTH;
 	add_line();
@@ -133,6 +143,7 @@ void Xd6HtmlBlock::create_lines()
 	l->begin = 0;
 	for (i = 0; i < nb_segs; i++) {
 		Xd6HtmlSegment *s = segs[i];
+		if (s->stl->display) has_display = 1;
 		if ((s->stl->display) && 
 			(((Xd6HtmlDisplay*)s)->display == DISPLAY_TAB)) 
 		{
@@ -163,6 +174,38 @@ void Xd6HtmlBlock::create_lines()
 	if (l->width > width) width = l->width;
 	l->end = i - 1;
 	width += stl->blockquote * BLOCKQUOTEWIDTH;
+	text_width = width;
+}
+
+/*
+ *  Returns a hash of everything measure() and create_lines() depend on :
+ *  frame width, zoom, styles and text of the segments.
+ *  Returns 0 if the block contains special elements (images, tables...)
+ *  which must always be measured again.
+ */
+unsigned int Xd6HtmlBlock::layout_signature()
+{
+	unsigned int h = 2166136261U;
+	int i, j;
+
+#define HASH_WORD(w) h = (h ^ (unsigned int) (w)) * 16777619U
+
+	HASH_WORD(frame_width);
+	HASH_WORD((unsigned long) Xd6HtmlSegment::sizes);
+	HASH_WORD((unsigned long) stl);
+	HASH_WORD(nb_segs);
+	for (i = 0; i < nb_segs; i++) {
+		Xd6HtmlSegment *s = segs[i];
+		if (s->stl->display) return 0;
+		HASH_WORD((unsigned long) s->stl);
+		HASH_WORD(s->len);
+		for (j = 0; j < s->len; j++) {
+			HASH_WORD((unsigned char) s->text[j]);
+		}
+	}
+#undef HASH_WORD
+	if (h == 0) h = 1;
+	return h;
 }
 
 void Xd6HtmlBlock::align_lines()
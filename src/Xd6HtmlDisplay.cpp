@@ -51,6 +51,7 @@
 #include "Xd6HtmlTagForm.h"
 #include "Xd6HtmlTagButton.h"
 #include "Xd6HtmlTagInputText.h"
+#include "Xd6ConfigFile.h"
 
 Xd6HtmlDisplay::Xd6HtmlDisplay(int i, char *txt, int l, Xd6XmlStl *s) : 
 	Xd6HtmlSegment(i, txt, l, s)
@@ -183,6 +184,7 @@ Xd6HtmlDisplay *Xd6HtmlDisplay::create(int id, Xd6XmlTreeElement *elem, Xd6HtmlF
 		s->text = (char*) malloc(2);
 		s->text[0] = ' ';
 		s->len = 1;
+		s->max_len = 0;
 	}
 	if (!s->parent) s->parent = u;
 	s->display = elem->display;
@@ -238,6 +240,27 @@ void Xd6HtmlDisplay::load(const char *url, const char *file)
 
 }
 
+/*
+ *  Called with the decoded content of a data: URL. Displays that can 
+ *  read it from memory override this, the others get it in a temp file.
+ */
+void Xd6HtmlDisplay::load_data(const char *url, unsigned char *data, 
+	long length)
+{
+	char *loc;
+	FILE *fp;
+
+	loc = Xd6ConfigFile::temp();
+	fp = fl_fopen(loc, "w");
+	if (fp) {
+		fwrite(data, 1, length, fp);
+		fclose(fp);
+		load(url, loc);
+	}
+	free(loc);
+	free(data);
+}
+
 void Xd6HtmlDisplay::redraw()
 {
 	if (parent) parent->redraw();
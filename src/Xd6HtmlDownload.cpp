@@ -68,7 +68,7 @@ const char *Xd6HtmlDownload::request(const char *url, const char *target,
 	if (!url || !frame) return NULL;
 
 	if (!strncmp("data:", url, 5)) {
-		ret = data_download(url);
+		return data_request(url, wi);
 	} else if (!strncmp("file:", url, 5) || (!strstr(url, ":")
 		&& (!frame->url || !strncmp("file:", frame->url, 5)))) 
 	{
@@ -120,37 +120,93 @@ const char *Xd6HtmlDownload::file_download(char *file)
 	return loc;
 }
 
+static int from_hex(int c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
 /*
- * FIXME: only supports base64 data: url !
+ *  Decodes the payload of a base64 or %-escaped data: URL to a malloc'ed
+ *  buffer, without going through the disk.
  */
-const char *Xd6HtmlDownload::data_download(const char *url)
+unsigned char *Xd6HtmlDownload::data_decode(const char *url, long *length)
 {
-	char *tmp, *loc;
-	FILE *t;
-	FILE *l;
+	const char *p;
+	unsigned char *data;
+	int base64 = 0;
+	long l;
+
+	*length = 0;
+	p = url;
+	while (*p && *p != ',') p++;
+	if (!*p) return NULL;
+	if (p - url >= 7 && !strncmp(p - 7, ";base64", 7)) base64 = 1;
+	p++;
+	l = strlen(p);
 
-	while(*url && *url != ',') url++;
-	if (!*url) return NULL;
+	if (base64) {
+		data = (unsigned char*) malloc(Xd6Base64::decode_size(l) + 1);
+		if (!data) return NULL;
+		*length = Xd6Base64::decode_buffer(p, l, data);
+		return data;
+	}
 
-	url++;
-	tmp = Xd6ConfigFile::temp();
-	t = fl_fopen(tmp, "w");
-	if (!t) { free(tmp); return NULL; }
+	data = (unsigned char*) malloc(l + 1);
+	if (!data) return NULL;
+	l = 0;
+	while (*p) {
+		if (*p == '%' && from_hex(p[1]) >= 0 && from_hex(p[2]) >= 0) {
+			data[l++] = (from_hex(p[1]) << 4) | from_hex(p[2]);
+			p += 3;
+		} else {
+			data[l++] = *p++;
+		}
+	}
+	*length = l;
+	return data;
+}
+
+/*
+ *  Hands the content of a data: URL to wi in memory. Returns url, or 
+ *  NULL if it cannot be decoded.
+ */
+const char *Xd6HtmlDownload::data_request(const char *url, 
+	Xd6HtmlDisplay *wi)
+{
+	unsigned char *data;
+	long length;
 
-	while(*url) {
-		putc(*url, t);
-		url++;
+	data = data_decode(url, &length);
+	if (!data) return NULL;
+	if (wi) {
+		wi->load_data(url, data, length);
+	} else {
+		free(data);
 	}
-	fclose(t);
-	t = fopen(tmp, "r");
-	if (!t) { free(tmp); return NULL; }
+	return url;
+}
+
+/*
+ *  Decodes a data: URL to a temp file, for the callers that need a path.
+ */
+const char *Xd6HtmlDownload::data_download(const char *url)
+{
+	unsigned char *data;
+	char *loc;
+	long length;
+	FILE *l;
+
+	data = data_decode(url, &length);
+	if (!data) return NULL;
 	loc = Xd6ConfigFile::temp();
-	l = fopen(loc, "w");
-	if (!t) { free(tmp);  free(loc); fclose(t); return NULL; }
-	Xd6Decode_base64(t, l);
-	fclose(t);
+	l = fl_fopen(loc, "w");
+	if (!l) { free(loc); free(data); return NULL; }
+	fwrite(data, 1, length, l);
 	fclose(l);
-	fl_unlink(tmp);
+	free(data);
 
 	return loc; 
 }
@@ -72,6 +72,8 @@ Xd6HtmlFrame::Xd6HtmlFrame(int i) : Xd6HtmlScroll(i)
 
 	blocks = NULL;
 	nb_blocks = 0;
+	max_blocks = 0;
+	keep_blocks = 0;
 	
 	wysiwyg = 1;
 	editor = 1;
@@ -87,6 +89,9 @@ Xd6HtmlFrame::Xd6HtmlFrame(int i) : Xd6HtmlScroll(i)
 	footer_height = 25;
 
 	flags = 0;
+	need_paging = 1;
+	paged_height = 0;
+	load_depth = 0;
 	add_block();
 
 	sel_block = NULL;
@@ -149,8 +154,11 @@ int Xd6HtmlFrame::def_text_engine(int e, Xd6HtmlFrame *frame,
 
 void Xd6HtmlFrame::add_block() 
 {
-	blocks = (Xd6HtmlBlock**) realloc(blocks, 
-			sizeof(Xd6HtmlBlock*) * (nb_blocks + 1));
+	if (nb_blocks >= max_blocks) {
+		max_blocks = max_blocks ? max_blocks * 2 : 16;
+		blocks = (Xd6HtmlBlock**) realloc(blocks, 
+			sizeof(Xd6HtmlBlock*) * max_blocks);
+	}
 	blocks[nb_blocks] = new Xd6HtmlBlock(nb_blocks, page_width);
 	nb_blocks += 1;
 }
@@ -197,11 +205,20 @@ void Xd6HtmlFrame::page_size(int W, int H, int FH)
 	page_height = H;
 	page_width = W;
 	footer_height = FH;
+	need_paging = 1;
 }
 
+/*
+ *  Only the blocks that changed since the last call (see 
+ *  Xd6HtmlBlock::layout_signature()) are measured and broken into lines
+ *  again, the pages are then created from the first changed block.
+ */
 void Xd6HtmlFrame::measure()
 {
 	int i;
+	unsigned int key;
+	Xd6HtmlBlock *first = NULL;
+	int old_height = height;
 
 	height = 0;
 	width = 0;
@@ -215,13 +232,55 @@ void Xd6HtmlFrame::measure()
 		Fl::flush();
 	}
 	for (i = 0; i < nb_blocks; i++) {
-		blocks[i]->frame_width = page_width;
-		blocks[i]->measure();
-		blocks[i]->create_lines();
-		if (blocks[i]->width > width) width = blocks[i]->width;
+		Xd6HtmlBlock *b = blocks[i];
+		b->frame_width = page_width;
+		key = b->layout_signature();
+		if (b->dirty || !key || key != b->layout_key) {
+			b->measure();
+			b->create_lines();
+			b->layout_key = key;
+			b->dirty = 0;
+			if (!first) first = b;
+		}
+		if (b->text_width > width) width = b->text_width;
 	}
 	width += 2;
-	create_pages();
+	if (need_paging) {
+		create_pages(NULL, 0);
+	} else if (first) {
+		create_pages(first, 0);
+	} else {
+		height = old_height;
+	}
+	if (cur_chr) set_cut_cursor(cur_chr, cur_seg, cur_block);
+}
+
+/*
+ *  Measures again the blocks from b to e that the edit functions marked
+ *  dirty, then pages the document from b. Unlike measure(), the text of
+ *  the other blocks is not looked at.
+ */
+void Xd6HtmlFrame::measure_dirty(Xd6HtmlBlock *b, Xd6HtmlBlock *e)
+{
+	int i;
+	Xd6HtmlBlock *first = NULL;
+
+	for (i = b->id; i <= e->id; i++) {
+		Xd6HtmlBlock *bk = blocks[i];
+		if (!bk->dirty && bk->frame_width == page_width) continue;
+		bk->frame_width = page_width;
+		bk->measure();
+		bk->create_lines();
+		bk->layout_key = bk->layout_signature();
+		bk->dirty = 0;
+		if (!first) first = bk;
+		if (bk->text_width + 2 > width) width = bk->text_width + 2;
+	}
+	if (need_paging) {
+		create_pages(NULL, 0);
+	} else if (first) {
+		create_pages(first, 0);
+	}
 	if (cur_chr) set_cut_cursor(cur_chr, cur_seg, cur_block);
 }
 
@@ -248,7 +307,13 @@ int  Xd6HtmlFrame::break_line(Xd6HtmlLine *l, int height)
 	return ret;
 }
 
-void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
+/*
+ *  Put the blocks on pages. If b is not NULL, the layout is only redone
+ *  from the block before b : until height exceeds 4000 pixels if limit 
+ *  is set (need_paging tells that the rest must be done later), and until
+ *  an unchanged block lands where it was in the previous complete layout.
+ */
+void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b, int limit)
 {
 	int i;
 	int p = 0;
@@ -258,6 +323,9 @@ void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
 	int max_h = 0x7FFFFFFF;
 	int list_depth = 0;
 	unsigned short list_num[128];
+	int start = 0;
+	int converge;
+	int last_unpaged;
 
 	list_num[list_depth] = 0;
  
@@ -276,7 +344,14 @@ void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
 	blks = blocks;
 	nb_blks = nb_blocks;
 	i = 0;
+	converge = !need_paging;
 	if (b && display == DISPLAY_TOP_FRAME) {
+		if (b->id > 0 && b->id < nb_blks && blks[b->id] == b) {
+			/* list numbering restarts after each block which is
+			   not in a blockquote, no need to scan from the top */
+			i = b->id - 1;
+			while (i > 0 && blks[i - 1]->stl->blockquote > 0) i--;
+		}
 		while (b != blks[i]) {
 			if (blks[i]->stl->blockquote > 0) {
 				Xd6XmlStl *bs = blks[i]->stl;
@@ -298,10 +373,11 @@ void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
 		}
 		if (i > 0) {
 			i--;
-			height = blks[i]->top;
+			if (i > 0) {
+				height = blks[i - 1]->top + blks[i - 1]->height;
+			}
 			op = height / page_height;
-			max_h = height + 4000;
-			need_paging = 1;
+			if (limit) max_h = height + 4000;
 			if (blks[i]->stl->blockquote > 0) {
 				Xd6XmlStl *bs = blks[i]->stl;
 				if (bs->list != LIST_NONE) {
@@ -310,7 +386,15 @@ void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
 			}
 		}
 	} else {
-		need_paging = 0;
+		converge = 0;
+	}
+	need_paging = 0;
+	start = i;
+	last_unpaged = nb_blks - 1;
+	if (converge) {
+		while (last_unpaged > start && blks[last_unpaged]->paged) {
+			last_unpaged--;
+		}
 	}
 	for (; i < nb_blks; i++) {
 		int ii;
@@ -339,6 +423,7 @@ void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
 
 		if (height > max_h) {
 			height += b->height;
+			need_paging = 1;
 			continue;
 		}
 
@@ -348,6 +433,14 @@ void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
 			height += pad;
 			op = height  / page_height;
 		}
+
+		if (converge && i > last_unpaged && i > start + 1 && 
+			b->paged && b->top == height && b->stl->blockquote == 0) 
+		{
+			/* the rest of the document did not move */
+			height = paged_height;
+			break;
+		}
 		b->left = b->stl->blockquote * BLOCKQUOTEWIDTH;
 		b->top = height;
 		b->height = 0;
@@ -384,7 +477,9 @@ void Xd6HtmlFrame::create_pages(Xd6HtmlBlock *b)
 			b->height += l->height;
 			op = height / page_height;
 		}
+		b->paged = !b->has_display;
 	}
+	paged_height = height;
 	if (wysiwyg) {
 		height += page_height - height % page_height;
 	}
@@ -497,19 +592,37 @@ void Xd6HtmlFrame::text_tree2block(Xd6XmlTreeElement *elem)
 	}
 }
 
+/*
+ *  Converts the element and its children to blocks. The work is split in
+ *  tree2block_open(), tree2block_child() and tree2block_close() so that a
+ *  document can also be converted while it is parsed, one completed
+ *  child at a time.
+ */
 void Xd6HtmlFrame::tree2block(Xd6XmlTreeElement *elem, Xd6HtmlDisplay *cp)
 {
 	int i;
 
 	if (!elem) return;
+	if (!tree2block_open(elem, cp)) return;
+	for (i = 0; i < elem->nb_children; i++) {
+		tree2block_child(elem, i, cp);
+	}
+	tree2block_close(elem);
+}
 
+/*
+ *  Starts the blocks of elem. Returns 0 if its children must not be
+ *  converted.
+ */
+int Xd6HtmlFrame::tree2block_open(Xd6XmlTreeElement *elem, Xd6HtmlDisplay *cp)
+{
 	if (!cp) cp = this;
 
 	if (elem->display) {
 		Xd6HtmlDisplay::pre_process(elem, this);
 	}
 
-	if (!(elem->stl->is_block || elem->stl->is_inline)) return;
+	if (!(elem->stl->is_block || elem->stl->is_inline)) return 0;
 
 	if (nb_blocks < 1) {
 		add_block();
@@ -588,69 +701,84 @@ void Xd6HtmlFrame::tree2block(Xd6XmlTreeElement *elem, Xd6HtmlDisplay *cp)
 	if ((elem->stl->display) && (elem->display != DISPLAY_TABLE_CELL)) {
 		special_elements(elem, (Xd6HtmlFrame*)cp);
 		if (elem->display == DISPLAY_TAB) {
-			return;
+			return 0;
 		}
 	}
 
-	for (i = 0; i < elem->nb_children; i++) {
-		Xd6XmlTreeText *txt;
-		Xd6XmlTreeElement *e;
-		Xd6HtmlBlock *b;
-		switch(elem->children[i]->type) {
-		case Xd6XmlTreeSegment_none:
-			break;
-		case Xd6XmlTreeSegment_element:
-			e = (Xd6XmlTreeElement*)elem->children[i];
-			tree2block(e, cp);
-			if (nb_blocks < 1) add_block();
-			b = blocks[nb_blocks - 1];
-		
-			if (b->nb_segs == 0) {
-				Xd6XmlStl *s = elem->stl;
-				s->para.copy(s);
-				s->para.top_margin = 0;
-				b->stl = s->get_style(&s->para);
-			}
-			if (e->stl->is_block && (b->nb_segs > 1 ||
-				(b->nb_segs == 1 && b->segs[0]->len > 0) ||
-				e->stl->display)) 
-			{
-				add_block();
-				elem->stl->para.copy(elem->stl);
-				elem->stl->para.display = 0;
-				elem->stl->para.page_break = 0;
-				elem->stl->para.list = LIST_NONE;
-				elem->stl->para.top_margin = 0;
-				blocks[nb_blocks - 1]->stl = 
-					elem->stl->get_style(&elem->stl->para);
+	return 1;
+}
 
-				if (e->stl->top_margin) {
-					elem->stl->para.copy(elem->stl);
-					elem->stl->para.display = 0;
-					elem->stl->para.top_margin = 0;
-					elem->stl->para.page_break = 0;
-					elem->stl->para.list = LIST_NONE;
-					elem->stl->para.a_link = 0;
-					elem->stl->para.is_block = 0;
-					add_segment(blocks[nb_blocks - 1], 
-						(char*)malloc(1), 0,
-						elem->stl->get_style(
-							&elem->stl->para));
-					add_block();
-				}
-			}
-			
+void Xd6HtmlFrame::tree2block_child(Xd6XmlTreeElement *elem, int i, 
+	Xd6HtmlDisplay *cp)
+{
+	Xd6XmlTreeText *txt;
+	Xd6XmlTreeElement *e;
+
+	if (!cp) cp = this;
+
+	switch(elem->children[i]->type) {
+	case Xd6XmlTreeSegment_none:
+		break;
+	case Xd6XmlTreeSegment_element:
+		e = (Xd6XmlTreeElement*)elem->children[i];
+		tree2block(e, cp);
+		tree2block_next(elem, e);
+		break;
+	default:
+		if (nb_blocks < 1) add_block();
+		txt = (Xd6XmlTreeText*)elem->children[i];
+		if ((blocks[nb_blocks - 1]->nb_segs == 0 ||
+			(blocks[nb_blocks - 1]->nb_segs == 1 &&
+			blocks[nb_blocks - 1]->segs[0]->len == 0)) &&
+			txt->len == 1 && txt->data[0] == ' ')
+		{
 			break;
-		default:
-			if (nb_blocks < 1) add_block();
-			txt = (Xd6XmlTreeText*)elem->children[i];
-			if ((blocks[nb_blocks - 1]->nb_segs == 0 ||
-				(blocks[nb_blocks - 1]->nb_segs == 1 &&
-				blocks[nb_blocks - 1]->segs[0]->len == 0)) &&
-				txt->len == 1 && txt->data[0] == ' ')
-			{
-				break;
-			}
+		}
+		elem->stl->para.copy(elem->stl);
+		elem->stl->para.display = 0;
+		elem->stl->para.top_margin = 0;
+		elem->stl->para.page_break = 0;
+		elem->stl->para.list = LIST_NONE;
+		elem->stl->para.a_link = 0;
+		elem->stl->para.is_block = 0;
+		add_segment(blocks[nb_blocks - 1], txt->data, txt->len,
+				elem->stl->get_style(&elem->stl->para));
+		txt->data = NULL;
+		txt->len = 0;
+	}
+}
+
+/*
+ *  Separates the blocks of the child element e from what follows it.
+ */
+void Xd6HtmlFrame::tree2block_next(Xd6XmlTreeElement *elem, 
+	Xd6XmlTreeElement *e)
+{
+	Xd6HtmlBlock *b;
+
+	if (nb_blocks < 1) add_block();
+	b = blocks[nb_blocks - 1];
+
+	if (b->nb_segs == 0) {
+		Xd6XmlStl *s = elem->stl;
+		s->para.copy(s);
+		s->para.top_margin = 0;
+		b->stl = s->get_style(&s->para);
+	}
+	if (e->stl->is_block && (b->nb_segs > 1 ||
+		(b->nb_segs == 1 && b->segs[0]->len > 0) ||
+		e->stl->display)) 
+	{
+		add_block();
+		elem->stl->para.copy(elem->stl);
+		elem->stl->para.display = 0;
+		elem->stl->para.page_break = 0;
+		elem->stl->para.list = LIST_NONE;
+		elem->stl->para.top_margin = 0;
+		blocks[nb_blocks - 1]->stl = 
+			elem->stl->get_style(&elem->stl->para);
+
+		if (e->stl->top_margin) {
 			elem->stl->para.copy(elem->stl);
 			elem->stl->para.display = 0;
 			elem->stl->para.top_margin = 0;
@@ -658,15 +786,17 @@ void Xd6HtmlFrame::tree2block(Xd6XmlTreeElement *elem, Xd6HtmlDisplay *cp)
 			elem->stl->para.list = LIST_NONE;
 			elem->stl->para.a_link = 0;
 			elem->stl->para.is_block = 0;
-			add_segment(blocks[nb_blocks - 1], txt->data, txt->len,
-					elem->stl->get_style(&elem->stl->para));
-			txt->data = NULL;
-			txt->len = 0;
+			add_segment(blocks[nb_blocks - 1], 
+				(char*)malloc(1), 0,
+				elem->stl->get_style(
+					&elem->stl->para));
+			add_block();
 		}
 	}
-	if (elem->stl->is_block && elem->nb_children > 0) {
-//		add_block();
-	}
+}
+
+void Xd6HtmlFrame::tree2block_close(Xd6XmlTreeElement *elem)
+{
         while (elem->display == 0 && elem->nb_children > 0) {
                 elem->nb_children--;
                 if (!elem->children[elem->nb_children]) continue;
@@ -687,6 +817,155 @@ void Xd6HtmlFrame::tree2block(Xd6XmlTreeElement *elem, Xd6HtmlDisplay *cp)
 
 }
 
+/*
+ *  Gets ready to convert the tree of a document while it is parsed by
+ *  load_chunk().
+ */
+void Xd6HtmlFrame::load_start(Xd6XmlTree *tree)
+{
+	load_elem[0] = tree->root;
+	load_child[0] = 0;
+	load_depth = 0;
+}
+
+/*
+ *  Parses the next piece of a document, converts what it completed and
+ *  lays out the blocks it added. Returns 1 if the blocks changed.
+ */
+int Xd6HtmlFrame::load_chunk(Xd6XmlParser *parser, const char *buf, int len)
+{
+	int *tabs;
+	int first;
+
+	parser->parse_string(buf, len);
+	first = nb_blocks - 1;
+	load_tree(parser->tree, 0);
+	tabs = Xd6XmlStyle::get_tabs();
+	if (tabs) tab_stop = tabs;
+	if (first < 0) first = 0;
+	if (nb_blocks <= first) return 0;
+
+	/* the last block may have got more segments */
+	blocks[first]->dirty = 1;
+	measure_dirty(blocks[first], blocks[nb_blocks - 1]);
+	return 1;
+}
+
+/*
+ *  Returns true if the parser may still add something to c.
+ */
+static int still_open(Xd6XmlTree *tree, Xd6XmlTreeSegment *c)
+{
+	Xd6XmlTreeElement *e = tree->cur_element;
+
+	if (c == tree->cur_text) return 1;
+	while (e) {
+		if (e == c) return 1;
+		e = e->parent;
+	}
+	return 0;
+}
+
+/*
+ *  Returns true if e is an open element which load_tree() enters.
+ */
+static int is_container(Xd6XmlTree *tree, Xd6XmlTreeSegment *c)
+{
+	Xd6XmlTreeElement *e = (Xd6XmlTreeElement*) c;
+
+	if (c->type != Xd6XmlTreeSegment_element) return 0;
+	if (e == tree->cur_element || !e->name) return 0;
+	return !strcasecmp(e->name, "html") || !strcasecmp(e->name, "body");
+}
+
+/*
+ *  Converts the parts of the tree completed by the parser to blocks. The
+ *  root, <html> and <body> elements are entered while they are still 
+ *  open, any other element is converted once it is closed and followed
+ *  by another closed one : the parser looks back at the last one to
+ *  drop white space.
+ */
+void Xd6HtmlFrame::load_tree(Xd6XmlTree *tree, int eof)
+{
+	Xd6XmlTreeElement *elem;
+	Xd6XmlTreeSegment *c;
+	Xd6XmlTreeSegment *n;
+	int d;
+
+	if (load_depth == 0) {
+		if (!eof && tree->root->nb_children == 0) return;
+		load_open[0] = tree2block_open(tree->root, NULL);
+		load_depth = 1;
+	}
+	for (;;) {
+		d = load_depth - 1;
+		elem = load_elem[d];
+		while (load_child[d] < elem->nb_children) {
+			c = elem->children[load_child[d]];
+			if (!eof) {
+				if (still_open(tree, c)) break;
+				if (load_child[d] + 1 >= elem->nb_children) break;
+				n = elem->children[load_child[d] + 1];
+				if (still_open(tree, n) && 
+					!(load_open[d] && load_depth < 3 &&
+					is_container(tree, n)))
+				{
+					break;
+				}
+			}
+			if (load_open[d]) {
+				tree2block_child(elem, load_child[d], NULL);
+			}
+			load_child[d]++;
+		}
+		if (load_child[d] < elem->nb_children) {
+			c = elem->children[load_child[d]];
+			if (load_open[d] && load_depth < 3 && 
+				still_open(tree, c) && is_container(tree, c))
+			{
+				Xd6XmlTreeElement *e = (Xd6XmlTreeElement*) c;
+				load_elem[load_depth] = e;
+				load_child[load_depth] = 0;
+				load_open[load_depth] = 
+					tree2block_open(e, NULL);
+				load_depth++;
+				continue;
+			}
+			return;
+		}
+		if (!eof && still_open(tree, elem)) return;
+		if (load_open[d]) tree2block_close(elem);
+		if (d == 0) return;
+		load_depth--;
+		if (load_open[d - 1]) tree2block_next(load_elem[d - 1], elem);
+		load_child[d - 1]++;
+	}
+}
+
+
+/*
+ *  Returns the index of the first block which ends below y (nb_blocks if
+ *  there is none). The blocks are sorted by position once create_pages()
+ *  has been called, so a binary search is enough.
+ */
+int Xd6HtmlFrame::find_block(int y)
+{
+	int lo = 0;
+	int hi = nb_blocks;
+
+	while (lo < hi) {
+		int m = (lo + hi) / 2;
+		if (blocks[m]->top + blocks[m]->height > y) {
+			hi = m;
+		} else {
+			lo = m + 1;
+		}
+	}
+	while (lo > 0 && blocks[lo - 1]->top + blocks[lo - 1]->height > y) {
+		lo--;
+	}
+	return lo;
+}
 
 void Xd6HtmlFrame::find_pos(int X, int Y, Xd6HtmlBlock **b, Xd6HtmlLine **l,
 	Xd6HtmlSegment **s, char **c)
@@ -701,20 +980,12 @@ void Xd6HtmlFrame::find_pos(int X, int Y, Xd6HtmlBlock **b, Xd6HtmlLine **l,
 	*s = NULL;
 	*c = NULL;
 */	
-	for (i = 0; i < nb_blocks; i++) {
-		if (Y <= blocks[i]->top + blocks[i]->height + y) 
-		{
-			/*
-			while ((i > 0) && (Y < top)) {
-				i--;
-				if (blocks[i]->height) break;
-			}
-			*/
-			if (blocks[i]->nb_segs < 1) return;
-			blocks[i]->find_pos(X, Y, x, y, l, s, c);
-			*b = blocks[i];
-			return;
-		}
+	i = find_block(Y - y - 1);
+	if (i < nb_blocks) {
+		if (blocks[i]->nb_segs < 1) return;
+		blocks[i]->find_pos(X, Y, x, y, l, s, c);
+		*b = blocks[i];
+		return;
 	}
 	i = nb_blocks;
 	while (i > 0) {
@@ -841,7 +1112,7 @@ void Xd6HtmlFrame::cut(int fast)
 	cursor_block->create_lines();
 	cursor_block->align_lines();
 	if (cursor_block->width > width - 2) width = cursor_block->width + 2;
-	if (!fast) create_pages();
+	if (!fast) create_pages(cursor_block, 0);
 	set_cut_cursor(cursor, cursor_seg, cursor_block);
 }
 
@@ -253,7 +253,7 @@ void Xd6HtmlFrame::draw_clipped(int x, int y, int mw, int mh)
 		fl_color(background);
 		fl_rectf(x, y, mw, mh);
 	}
-	for (i = 0; i < nb_blocks; i++) {
+	for (i = find_block(top_draw - Y); i < nb_blocks; i++) {
 		Xd6HtmlBlock *b;
 		b = blocks[i];
 		b->flags |= dm;
@@ -49,6 +49,7 @@
 #include "Xd6HtmlTagTable.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <FL/Fl_Window.h>
 
@@ -117,18 +118,19 @@ void Xd6HtmlFrame::insert_frame(Xd6HtmlFrame *f)
 	int nb;
 	int shift_done = 0;
 	int bid;
+	int first;
 
 	cut();
 	if (!cur_chr) return;
+	first = cur_block->id;
 	printf("DAMAGE_ALL insert_frame\n");
 	damage(DAMAGE_ALL);
 	if (cur_seg->stl->display && 
 		((Xd6HtmlDisplay*)cur_seg)->display == DISPLAY_TABLE)
 	{
 		((Xd6HtmlTagTable*)cur_seg)->insert_frame(f);
-		measure();
-		create_pages();
-		set_cut_cursor(cur_chr, cur_seg, cur_block);
+		cur_block->dirty = 1;
+		measure_dirty(cur_block, cur_block);
 		return;
 	}
 	
@@ -198,15 +200,17 @@ void Xd6HtmlFrame::insert_frame(Xd6HtmlFrame *f)
 		}
 		clean_block(cur_block, &cur_seg, &cur_chr);
 		check_parent();		
-		measure();
-		create_pages();
-		set_cut_cursor(cur_chr, cur_seg, cur_block);
+		for (i = first; i <= cur_block->id; i++) blocks[i]->dirty = 1;
+		measure_dirty(blocks[first], cur_block);
 		return;
 	}
 
 	split_block(cur_block, cur_seg, cur_chr);
-	blocks = (Xd6HtmlBlock**) realloc(blocks, 
-			sizeof(Xd6HtmlBlock*) * (nb_blocks + nbb));
+	if (nb_blocks + nbb > max_blocks) {
+		max_blocks = nb_blocks + nbb;
+		blocks = (Xd6HtmlBlock**) realloc(blocks, 
+			sizeof(Xd6HtmlBlock*) * max_blocks);
+	}
 
 	nb_blocks += nbb - 2;
 	nb = 0;
@@ -262,9 +266,8 @@ void Xd6HtmlFrame::insert_frame(Xd6HtmlFrame *f)
 		}
 	}	
 	check_parent();		
-	measure();
-	create_pages();
-	set_cut_cursor(cur_chr, cur_seg, cur_block);
+	for (i = first; i <= cur_block->id; i++) blocks[i]->dirty = 1;
+	measure_dirty(blocks[first], cur_block);
 }
 
 void Xd6HtmlFrame::split_segment(Xd6HtmlBlock *b, Xd6HtmlSegment *s, char *c)
@@ -327,20 +330,26 @@ void Xd6HtmlFrame::split_block(Xd6HtmlBlock *b, Xd6HtmlSegment *s, char *c)
 	set_cut_cursor(b1->segs[0]->text, b1->segs[0], b1);
 }
 
+/*
+ *  Inserts len bytes of txt at c. The text buffer of the segment grows
+ *  geometrically so that typing does not realloc on every keystroke.
+ */
 void Xd6HtmlFrame::insert_char(Xd6HtmlSegment *s, char *c, const char *txt, int len)
 {
-	int i, ii;
+	int ii, need;
 
 	ii = c - s->text;
-	s->text = (char*) realloc(s->text, s->len + len + 1);
-	
-	for (i = s->len + len - 1; i - len >= ii; i--) {
-		s->text[i] = s->text[i - len];
-	}
-
-	for (i = 0; i < len; i++) {
-		s->text[ii + i] = txt[i];
+	need = s->len + len + 1;
+	if (need > s->max_len) {
+		int m = need * 2;
+		if (m < 16) m = 16;
+		if (m > 0xFFFF) m = need;
+		s->text = (char*) realloc(s->text, m);
+		s->max_len = m > 0xFFFF ? 0 : m;
 	}
+	
+	memmove(s->text + ii + len, s->text + ii, s->len - ii);
+	memcpy(s->text + ii, txt, len);
 
 	s->len += len;
 
@@ -392,7 +401,8 @@ void Xd6HtmlFrame::restore_padding()
 		}
 	} else {
 		if (nb_blk < nb_blocks - 1) {
-			create_pages();
+			/* the new blocks all follow the one typed in */
+			create_pages(blk_current, 0);
 		} else {
 			create_pages(cur_block);
 		}
@@ -417,9 +427,8 @@ void Xd6HtmlFrame::insert_segment(Xd6HtmlSegment *s)
 		((Xd6HtmlDisplay*)cur_seg)->display == DISPLAY_TABLE)
 	{
 		((Xd6HtmlTagTable*)cur_seg)->insert_segment(s);
-		measure();
-		create_pages();
-		set_cut_cursor(cur_chr, cur_seg, cur_block);
+		cur_block->dirty = 1;
+		measure_dirty(cur_block, cur_block);
 		return;
 	}
 	split_segment(cur_block, cur_seg, cur_chr);
@@ -741,6 +750,7 @@ void Xd6HtmlFrame::merge_segments(Xd6HtmlBlock *b, Xd6HtmlSegment *s1,
 		return;
 	}
 	s1->text = (char*) realloc(s1->text, s1->len + s2->len + 1);
+	s1->max_len = 0;
 	for (int j = 0; j < s2->len; j++) {
 		s1->text[j + s1->len] = s2->text[j];
 	}
@@ -778,6 +788,7 @@ void Xd6HtmlFrame::merge_blocks(Xd6HtmlBlock *b, Xd6HtmlBlock *b2, char **cursor
 			selc = *cursor - s1->text;
 			s1->text = (char*) realloc(s1->text,
 				s1->len + s2->len + 1);
+			s1->max_len = 0;
 			*cursor = s1->text + selc;
 			jj = s1->len;
 			for (j = 0; j < s2->len; j++) {
@@ -1017,7 +1028,7 @@ void Xd6HtmlFrame::change_style(Xd6XmlStl *n)
 		b2->create_lines();
 		b1->align_lines();
 		b2->align_lines();
-		create_pages();
+		create_pages(b1, 0);
 		set_cut_cursor(c2, s2, b2);
 		b2 = cur_block;
 		l2 = cur_line;
@@ -1055,11 +1066,105 @@ void Xd6HtmlFrame::change_style(Xd6XmlStl *n)
 		cur_block->measure();
 		cur_block->create_lines();
 		cur_block->align_lines();
-		create_pages();
+		create_pages(cur_block, 0);
 		set_cut_cursor(cur_chr, cur_seg, cur_block);
 	}
 }
 
+/*
+ *  Moves n blocks (taken from another frame) to the end of the document.
+ *  Only the new blocks are measured and paged, so appending to a long log
+ *  costs the same as appending to a short one. If keep_blocks is set, the
+ *  oldest blocks are dropped, a quarter of keep_blocks at a time.
+ *  A frame scrolled to the bottom stays at the bottom.
+ */
+void Xd6HtmlFrame::append_blocks(Xd6HtmlBlock **b, int n)
+{
+	int i, j;
+	int first;
+	int drop = 0;
+	int at_end;
+	int ovs = vscroll;
+
+	if (n < 1) return;
+	at_end = height <= max_height || 
+		vscroll <= -(height - max_height + 15);
+
+	if (nb_blocks + n > max_blocks) {
+		max_blocks = (nb_blocks + n) * 2;
+		blocks = (Xd6HtmlBlock**) realloc(blocks, 
+			sizeof(Xd6HtmlBlock*) * max_blocks);
+	}
+	first = nb_blocks;
+	for (i = 0; i < n; i++) {
+		Xd6HtmlBlock *bk = b[i];
+		bk->id = nb_blocks;
+		bk->frame_width = page_width;
+		bk->flags |= DAMAGE_ALL;
+		bk->measure();
+		bk->create_lines();
+		bk->layout_key = bk->layout_signature();
+		bk->dirty = 0;
+		if (bk->text_width + 2 > width) width = bk->text_width + 2;
+		for (j = 0; j < bk->nb_segs; j++) {
+			Xd6HtmlTagTable *s = (Xd6HtmlTagTable*)bk->segs[j];
+			if (s->stl->display && s->display == DISPLAY_TABLE) {
+				s->parent = this;
+			}
+		}
+		blocks[nb_blocks++] = bk;
+	}
+
+	if (keep_blocks > 0 && nb_blocks > keep_blocks + keep_blocks / 4) {
+		drop = nb_blocks - keep_blocks;
+	}
+	if (drop > 0) {
+		if (drop < first) {
+			vscroll += blocks[drop]->top;
+		} else {
+			vscroll = 0;
+		}
+		if (vscroll > 0) vscroll = 0;
+		for (i = 0; i < drop; i++) {
+			Xd6HtmlBlock *bk = blocks[i];
+			if (bk == cur_block || bk == sel_block) {
+				cur_chr = sel_chr = NULL;
+				cur_seg = sel_seg = NULL;
+				cur_line = sel_line = NULL;
+				cur_block = sel_block = NULL;
+			}
+			for (j = 0; j < bk->nb_segs; j++) {
+				if (bk->segs[j] == focus) focus = NULL;
+			}
+			delete(bk);
+		}
+		nb_blocks -= drop;
+		memmove(blocks, blocks + drop, 
+			sizeof(Xd6HtmlBlock*) * nb_blocks);
+		for (i = 0; i < nb_blocks; i++) {
+			blocks[i]->id = i;
+		}
+		create_pages(NULL, 0);
+	} else if (need_paging) {
+		create_pages(NULL, 0);
+	} else {
+		create_pages(blocks[first], 0);
+	}
+
+	if (at_end) {
+		if (height > max_height) {
+			vscroll = -(height - max_height + 15);
+		} else {
+			vscroll = 0;
+		}
+	}
+	if (drop > 0 || vscroll != ovs) {
+		damage(DAMAGE_ALL);
+	} else {
+		damage(DAMAGE_CHILD);
+	}
+}
+
 void Xd6HtmlFrame::cursor_to_end()
 {
 	int i;
@@ -54,6 +54,7 @@ Xd6HtmlLine::Xd6HtmlLine(int i)
 	descent = 0;
 	segs = NULL;
 	nb_segs = 0;
+	max_segs = 0;
 	begin = 0;
 	end = -1;
 	flags = DAMAGE_CHILD;
@@ -68,8 +69,11 @@ Xd6HtmlLine::~Xd6HtmlLine()
 
 void Xd6HtmlLine::add_segment(Xd6HtmlSegment *s)
 {
-	segs = (Xd6HtmlSegment**) realloc(segs, 
-			sizeof(Xd6HtmlSegment*) * (nb_segs + 1));
+	if (nb_segs >= max_segs) {
+		max_segs = max_segs ? max_segs * 2 : 8;
+		segs = (Xd6HtmlSegment**) realloc(segs, 
+			sizeof(Xd6HtmlSegment*) * max_segs);
+	}
 	segs[nb_segs] = s;
 	nb_segs++;
 	if (s->stl->display) {
@@ -119,6 +123,7 @@ void Xd6HtmlLine::sort_segments()
 	}
 	free(segs);
 	segs = s;
+	max_segs = nb_segs + 1;
 	
 	if (stl->text_align == TEXT_ALIGN_JUSTIFY) {
 		int nb_space = 0;
@@ -386,8 +391,11 @@ void Xd6HtmlLine::split_segment(Xd6HtmlSegment* sg, char* ch)
 	sg->len = ch - sg->text;
 	seg = new Xd6HtmlSegment(sg->id + 1, buf, i, sg->stl);
 
-	segs = (Xd6HtmlSegment**) realloc(segs,
-		sizeof(Xd6HtmlSegment*) * (nb_segs + 1));
+	if (nb_segs >= max_segs) {
+		max_segs = max_segs ? max_segs * 2 : 8;
+		segs = (Xd6HtmlSegment**) realloc(segs,
+			sizeof(Xd6HtmlSegment*) * max_segs);
+	}
 	for (i = nb_segs; i > seg->id; i--) {
 		segs[i] = segs[i - 1];
 		segs[i]->flags |= (DAMAGE_ALL);
@@ -74,6 +74,7 @@ Xd6HtmlSegment::Xd6HtmlSegment(int i, char *txt, int l, Xd6XmlStl *s)
 	text = txt;
 	if (!text) text = (char*) malloc(1);
 	len = l;
+	max_len = 0;
 	flags = DAMAGE_ALL;
 	
 	if (!s) s = &Xd6XmlStl::def;
@@ -90,6 +91,7 @@ Xd6HtmlSegment::Xd6HtmlSegment()
 	descent = 0;
 	text = (char*) malloc(1);
 	len = 0;
+	max_len = 0;
 	flags = DAMAGE_ALL;
 	stl = &Xd6XmlStl::def;
 }
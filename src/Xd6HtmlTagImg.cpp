@@ -58,6 +58,8 @@ Xd6HtmlTagImg::Xd6HtmlTagImg(int i, Xd6XmlTreeElement *e, Xd6HtmlFrame *u) :
 	len = 1;
 	gif = new Xd6Png();
 	source = NULL;
+	source_data = NULL;
+	source_length = 0;
 	attr_w = attr_h = attr_border = 0;
 	if (e) {
 		ptr = e->get_attr_value("width");
@@ -87,6 +89,7 @@ void Xd6HtmlTagImg::destroy()
 {
 	if (source) fl_unlink(source);
 	free(source);
+	free(source_data);
 	delete(gif);
 }
 
@@ -97,8 +100,12 @@ void Xd6HtmlTagImg::load(const char *url, const char *file)
 
 //	printf("url %s file %s\n", url, file);
 
+	if (!file) return;
 	free(source);
 	source = strdup(file);
+	free(source_data);
+	source_data = NULL;
+	source_length = 0;
 
 	fp = fl_fopen(file, "r");
 	if (!fp) {
@@ -124,6 +131,36 @@ void Xd6HtmlTagImg::load(const char *url, const char *file)
 	damage(FL_DAMAGE_ALL);
 }
 
+/*
+ *  Loads the image from the content of a data: URL, data is owned by the
+ *  tag from now on.
+ */
+void Xd6HtmlTagImg::load_data(const char *url, unsigned char *data, 
+	long length)
+{
+	if (length < 6) { free(data); return; }
+	if (source) fl_unlink(source);
+	free(source);
+	source = NULL;
+	free(source_data);
+	source_data = data;
+	source_length = length;
+
+	delete(gif);
+	if (memcmp(data, "GIF87a", 6) == 0 ||
+		memcmp(data, "GIF89a", 6) == 0)
+	{
+		gif = new Xd6Gif();
+	} else if (memcmp(data, "\211PNG", 4) == 0) {
+		gif = new Xd6Png();
+	} else {
+		gif = new Xd6Jpeg();
+	}
+	gif->load_data(data, length);
+
+	damage(FL_DAMAGE_ALL);
+}
+
 void Xd6HtmlTagImg::measure() 
 {
 	width = height = 0;
@@ -239,7 +276,7 @@ void Xd6HtmlTagImg::print(Xd6HtmlPrint *p, int X, int Y)
 	int i, w = 0, h = 0, d = 3;
 	const unsigned char *data = NULL;
 	if (gif) {
-		gif->load(source);
+		gif->reset_size();
 		w = gif->w;
 		h = gif->h;
 		d = gif->d;
@@ -280,39 +317,36 @@ void Xd6HtmlTagImg::print(Xd6HtmlPrint *p, int X, int Y)
 
 void Xd6HtmlTagImg::to_html(FILE *fp)
 {
-	int l;
-	char buf[1024];
-	char *out;
-	FILE *fi, *fo;
+	FILE *fi = NULL;
 
 	if (!gif) return;
 
-	fi = fl_fopen(source, "r");
-	if (!fi) return;
-	out = Xd6ConfigFile::temp();
-	fo = fl_fopen(out, "w");
-	if (!fo) { fclose(fi); free(out); return; }
-	Xd6Encode_base64(fi, fo);
-	fclose(fi);
-	fclose(fo);
-
-	fi = fopen(out, "r");
-	if (!fi) { free(out); return; }
-	l = fread(buf, 1, 1024, fi);
-
-	if (l < 6) { fclose(fi); free(out); return; }
+	if (source_data) {
+		if (source_length < 4) return;
+	} else {
+		if (!source) return;
+		fi = fl_fopen(source, "r");
+		if (!fi) return;
+		fseek(fi, 0, SEEK_END);
+		if (ftell(fi) < 4) { fclose(fi); return; }
+		rewind(fi);
+	}
 
 	fprintf(fp, "<img src=\"data:%s;base64,\n", gif->mime());
-
-	while (l > 0) {
-		fwrite(buf, l, 1, fp);
-		l = fread(buf, 1, 1024, fi);
+	if (fi) {
+		Xd6Encode_base64(fi, fp);
+		fclose(fi);
+	} else {
+		char *out;
+		int l;
+		out = (char*) malloc(Xd6Base64::encode_size(source_length));
+		l = Xd6Base64::encode_buffer(source_data, source_length, out);
+		fwrite(out, 1, l, fp);
+		putc('\n', fp);
+		free(out);
 	}
-	fclose(fi);
 	fprintf(fp, "\" border=\"%d\" width=\"%d\" height=\"%d\" \n/>",
 		attr_border, attr_w, attr_h);
-	fl_unlink(out);
-	free(out);
 }
 
 static char to_hex(int i)
@@ -401,7 +435,7 @@ void Xd6HtmlTagImg::to_rtf(FILE *fp)
 
 	if (!gif) return;
 	
-	gif->load(source);
+	gif->reset_size();
 	if (!gif->data) return;
 	gif->set_size(attr_w, attr_h);
 	fprintf(fp, "{\\pict\n\\wmetafile8\\picw%d\\pich%d"
@@ -324,6 +324,7 @@ void Xd6HtmlTagInputText::insert_text(char *txt, int len)
 	new_str[l] = '\0';
 	free(text);
 	text = new_str;
+	max_len = 0;
 	sel_chr = NULL;
 }
 
@@ -57,9 +57,23 @@
 #include <FL/fl_ask.H>
 #include <FL/Fl_File_Chooser.H>
 #include <ctype.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+/* files bigger than this are shown while they are parsed */
+#define LOAD_PROGRESSIVE_SIZE (512 * 1024)
+#define LOAD_CHUNK (64 * 1024)
 
 #define _(String) gettext((String))
 
+Xd6SpellDict *Xd6HtmlView::spell_dict = NULL;
+char *Xd6HtmlView::spell_dict_name = NULL;
+
 Xd6HtmlView::Xd6HtmlView(int X, int Y, int W, int H) : Fl_Widget(X, Y, W, H)
 {
 	new_frame(W, H);
@@ -145,12 +159,22 @@ void Xd6HtmlView::new_frame(int W, int H)
 	spell_replace_word = NULL;
 	spell_nb_i = 0;
 	spell_nb_r = 0;
-
+	spell_modal = 0;
+	spell_count = 0;
+	spell_live = 0;
+	spell_pending = 0;
+	spell_pos = 0;
+	spell_left = 0;
+
+	progressive = 0;
+	load_fd = -1;
 }
 
 
 Xd6HtmlView::~Xd6HtmlView()
 {
+	if (spell_pending) Fl::remove_idle(spell_idle, this);
+	load_stop();
 	while (spell_nb_i > 0) {
 		free(spell_ignore[--spell_nb_i]);
 	}
@@ -382,6 +406,9 @@ int Xd6HtmlView::handle(int e)
 	if (lock) return 1;
 
 	ret = frame->handle(e, x(), y());
+	if (ret && spell_live && (e == FL_KEYBOARD || e == FL_PASTE)) {
+		spell_later();
+	}
 	if (e == FL_ENTER) {
 		if (Fl::focus() != this) take_focus();
 	}
@@ -413,20 +440,85 @@ int Xd6HtmlView::handle(int e)
 	return Fl_Widget::handle(e);
 }
 
-void Xd6HtmlView::load(const char *n)
+/*
+ *  When progressive is set, a big file is parsed a chunk at a time : the
+ *  first screen is shown at once and the rest is laid out from an idle
+ *  callback. url is the address of the document when n is a downloaded
+ *  copy of it.
+ */
+void Xd6HtmlView::load(const char *n, const char *url)
 {
+	struct stat st;
+	char *u;
+
+	load_stop();
 	Xd6XmlStyle::clean_tab();
-	parser->parse_file(n);
+	if (progressive && !stat(n, &st) && S_ISREG(st.st_mode) &&
+		st.st_size > LOAD_PROGRESSIVE_SIZE)
+	{
+		load_fd = open(n, O_RDONLY);
+		load_size = (int) st.st_size;
+		load_done = 0;
+	}
+	if (load_fd < 0) parser->parse_file(n);
 	frame->sel_chr = NULL;
 	frame->cur_chr = NULL;
 	while (frame->nb_blocks > 0) {
 		frame->nb_blocks = frame->nb_blocks - 1;
 		delete(frame->blocks[frame->nb_blocks]);
 	}
-	frame->tab_stop = Xd6XmlStyle::get_tabs();
 	Xd6HtmlFrame::rule_width = frame->page_width;
-	frame->url = strdup(n);
-	frame->tree2block(parser->tree->root);
+	u = strdup(url ? url : n);
+	free(frame->url);
+	frame->url = u;
+	if (load_fd < 0) {
+		frame->tab_stop = Xd6XmlStyle::get_tabs();
+		frame->tree2block(parser->tree->root);
+		load_end();
+		return;
+	}
+
+	frame->height = 0;
+	frame->load_start(parser->tree);
+	while (load_step() && frame->height < h()) continue;
+	if (load_fd >= 0) Fl::add_idle(load_idle, this);
+}
+
+/*
+ *  Parses the next chunk of the file and lays out the blocks it added,
+ *  the whole document is measured once by load_end().
+ *  Returns 0 once the whole file is loaded.
+ */
+int Xd6HtmlView::load_step()
+{
+	char *buf;
+	int r;
+
+	buf = (char*) malloc(LOAD_CHUNK);
+	r = read(load_fd, buf, LOAD_CHUNK);
+	if (r <= 0) {
+		free(buf);
+		frame->load_tree(parser->tree, 1);
+		Fl::remove_idle(load_idle, this);
+		close(load_fd);
+		load_fd = -1;
+		load_end();
+		return 0;
+	}
+	load_done += r;
+	if (frame->load_chunk(parser, buf, r)) redraw();
+	free(buf);
+	if (Xd6HtmlFrame::status_bar) {
+		char txt[64];
+		snprintf(txt, 64, "%d%%", (int) ((double) load_done * 100.0 /
+			(load_size > 0 ? load_size : 1)));
+		Xd6HtmlFrame::status_bar->value(txt);
+	}
+	return 1;
+}
+
+void Xd6HtmlView::load_end()
+{
 	if (!frame->nb_blocks) {
 		frame->add_block();
 	}
@@ -437,11 +529,32 @@ void Xd6HtmlView::load(const char *n)
 	frame->measure();
 	delete(parser);
 	parser = new Xd6XmlParser();
+	if (Xd6HtmlFrame::status_bar) Xd6HtmlFrame::status_bar->value(" ");
 	redraw();
 }
 
+void Xd6HtmlView::load_idle(void *d)
+{
+	Xd6HtmlView *self = (Xd6HtmlView*) d;
+	self->load_step();
+}
+
+/*
+ *  Drops a progressive load which is still running.
+ */
+void Xd6HtmlView::load_stop()
+{
+	if (load_fd < 0) return;
+	Fl::remove_idle(load_idle, this);
+	close(load_fd);
+	load_fd = -1;
+	delete(parser);
+	parser = new Xd6XmlParser();
+}
+
 void Xd6HtmlView::blank()
 {
+	load_stop();
 	frame->cur_chr = NULL;
 	while (frame->nb_blocks > 0) {
 		delete(frame->blocks[--frame->nb_blocks]);
@@ -514,17 +627,15 @@ void Xd6HtmlView::find_word(Xd6HtmlSegment *s, char **txt, int *len)
 void Xd6HtmlView::spell_cb(Xd6HtmlSegment *s, Xd6HtmlLine *line, Xd6HtmlBlock *blk)
 {
 	int l;
-	char buf[1024];
 	int ok = 0;
 	char *text;
-	long pos = 0;
-	unsigned int b, u;
-	unsigned int ucs;
 
 	if (cancel_spelling) return;
-	if (!word_file) return;
-	Fl::check();
-	Fl::flush();
+	if (!spell_dict) return;
+	if (spell_modal && !(++spell_count & 63)) {
+		Fl::check();
+		if (cancel_spelling) return;
+	}
 	if (s->stl->display) {
 		Xd6HtmlDisplay *d = (Xd6HtmlDisplay*) s;
 		if (d->display == DISPLAY_TABLE) {
@@ -546,48 +657,8 @@ void Xd6HtmlView::spell_cb(Xd6HtmlSegment *s, Xd6HtmlLine *line, Xd6HtmlBlock *b
 	find_word(s, &text, &l);
 	if (l < 2) return;
 
-	/* is the word in the dictionary file ? */
-	rewind(word_file);
-	fl_utf2ucs((unsigned char *)text, l, &ucs);
-	//fl_ucs2utf(fl_tolower(ucs), buf);
-	b = fl_tolower(ucs);
-	u = ucs;
-	ucs = 0;
-	buf[0] = 0;
-	while (!feof(word_file) && ucs  < b) {
-		pos = ftell(word_file);
-		fseek(word_file, 20000, SEEK_CUR);
-		fgets(buf, 1024, word_file);
-		fgets(buf, 1024, word_file);
-		fl_utf2ucs((unsigned char *)buf, l, &ucs);
-		ucs = fl_tolower(ucs);
-	}
-	pos -= 2048;
-	if (pos < 0) pos = 0;
-	fseek(word_file, pos, SEEK_SET);
-	if (pos > 0) fgets(buf, 1024, word_file);
-	while (!ok && fgets(buf, 1024, word_file)) {
-		fl_utf2ucs((unsigned char *)buf, l, &ucs);
-		if ((u == ucs || u != b) && 
-			!fl_utf_strncasecmp(buf, text, l) && 
-			(buf[l] == '\n' || buf[l] == '\0')) 
-		{
-			ok = 1;
-		}
-		if (ucs > b) ok = -1;
-	}
-
-	/* is the word in the personal dictionary file ? */
-	if (ok != 1 && pword_file) {
-		rewind(pword_file);
-		while (ok != 1 && fgets(buf, 1024, pword_file)) {
-			if (!fl_utf_strncasecmp(buf, text, l) &&
-				(buf[l] == '\n' || buf[l] == '\0'))
-			{
-				ok = 1;
-			}
-		}
-	}
+	/* is the word in the dictionary or in the personal dictionary ? */
+	ok = spell_dict->find(text, l);
 
 	if (ok != 1) {
 		/* it isn't in the dictionary */
@@ -602,6 +673,67 @@ void Xd6HtmlView::spell_cb(Xd6HtmlSegment *s, Xd6HtmlLine *line, Xd6HtmlBlock *b
 	}	
 }
 
+/*
+ *  Checks the changed blocks again from an idle callback, beginning with
+ *  the block of the cursor.
+ */
+void Xd6HtmlView::spell_later()
+{
+	if (frame->cur_block) spell_pos = frame->cur_block->id;
+	spell_left = frame->nb_blocks;
+	if (!spell_pending) {
+		Fl::add_idle(spell_idle, this);
+		spell_pending = 1;
+	}
+}
+
+/*
+ *  Visits up to 256 blocks and checks the ones changed since their last
+ *  check (Xd6HtmlBlock::measure() clears their spelled flag). The word 
+ *  being typed is left alone. Stops after a turn of the document which
+ *  found nothing to check.
+ */
+void Xd6HtmlView::spell_idle(void *d)
+{
+	Xd6HtmlView *v = (Xd6HtmlView*) d;
+	Xd6HtmlFrame *f = v->frame;
+	int nb = 256;
+
+	while (nb > 0) {
+		Xd6HtmlBlock *b;
+		int changed = 0;
+
+		if (v->spell_left <= 0 || f->nb_blocks < 1 || !v->spell_live) {
+			Fl::remove_idle(spell_idle, d);
+			v->spell_pending = 0;
+			return;
+		}
+		if (v->spell_pos >= f->nb_blocks) v->spell_pos = 0;
+		b = f->blocks[v->spell_pos++];
+		v->spell_left--;
+		nb--;
+		if (b->spelled) continue;
+		b->spelled = 1;
+		for (int i = 0; i < b->nb_segs; i++) {
+			Xd6HtmlSegment *s = b->segs[i];
+			Xd6XmlStl *st = s->stl;
+			if (st->display) continue;
+			if (s == f->cur_seg && f->cur_chr == s->text + s->len) {
+				continue;
+			}
+			v->spell_cb(s, NULL, b);
+			if (s->stl != st) changed = 1;
+		}
+		if (changed) {
+			b->flags |= DAMAGE_ALL;
+			f->damage(DAMAGE_CHILD);
+			v->damage(FL_DAMAGE_CHILD);
+		}
+		v->spell_left = f->nb_blocks;
+		nb -= 32;
+	}
+}
+
 static void cancel_cb (Fl_Widget *, void *d)
 {
 	((Xd6HtmlView*)d)->cancel_spelling = 1;
@@ -633,8 +765,24 @@ void Xd6HtmlView::spell()
 		itm->set_value(buf);
 		cfg->write_xd640_section(sec);
 	}
+	if (word_file) fclose(word_file);
 	word_file = fopen(buf, "r");
-	if (!word_file) return;
+	if (!word_file) {
+		delete(cfg);
+		return;
+	}
+
+	/* the dictionaries are read once and shared by all the views */
+	if (!spell_dict || strcmp(spell_dict_name, buf)) {
+		delete(spell_dict);
+		free(spell_dict_name);
+		spell_dict = new Xd6SpellDict();
+		spell_dict_name = strdup(buf);
+		spell_dict->load(buf);
+		snprintf(buf, 1024, "%s/.xd640/dict/personal.utf8", 
+			cfg->home_dir);
+		spell_dict->load(buf, 1);
+	}
 
 	Xd6Cancel cancel(cancel_cb, this);
 	cancel.set_modal();
@@ -646,9 +794,7 @@ void Xd6HtmlView::spell()
 #else
 	fl_mkdir(buf, S_IWUSR|S_IXUSR|S_IRUSR);
 #endif
-	snprintf(buf, 1024, "%s/.xd640/dict/personal.utf8", cfg->home_dir);
 	delete(cfg);
-	pword_file = fopen(buf, "a+");
 
 	if (!frame->sel_chr) {
 		int i = 0;
@@ -673,11 +819,14 @@ void Xd6HtmlView::spell()
 	
 	Fl::flush();
 
+	spell_modal = 1;
+	spell_count = 0;
 	frame->scan_selection(scan_cb, this);
+	spell_modal = 0;
+	spell_live = !cancel_spelling;
 	frame->sel_chr = frame->cur_chr = NULL;
 	frame->cur_seg = frame->sel_seg = NULL;
 	//fclose(word_file);
-	fclose(pword_file);
 	//frame->measure();
 	//frame->create_pages();
 	redraw();
@@ -700,6 +849,13 @@ void Xd6HtmlView::add_to_dict(const char *w)
 	pword_file = fopen(buf, "a");
 	fprintf(pword_file, "%s\n", w);
 	fclose(pword_file);
+	if (spell_dict) {
+		spell_dict->add(w, strlen(w), 1);
+		for (int i = 0; i < frame->nb_blocks; i++) {
+			frame->blocks[i]->spelled = 0;
+		}
+		if (spell_live) spell_later();
+	}
 	snprintf(buf, 2048, "cd  ~/.xd640/dict/; "
 		"sort personal.utf8 |uniq > p; /bin/rm personal.utf8; "
 		"/bin/mv p personal.utf8");
@@ -782,6 +938,7 @@ void Xd6HtmlView::replace_by(const char *w, Xd6HtmlFrame *f, Xd6HtmlBlock *b,
 	if (wl > len) {
 		s->text = (char*) realloc(s->text, sizeof(char) * 
 			(s->len + 1));
+		s->max_len = 0;
 		i = s->len;
 		while (i > 0 && i > p) {
 			i--;
@@ -0,0 +1,281 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+#include "Xd6Std.h"
+#include "Xd6ImageCache.h"
+#include "Xd6ImageScale.h"
+#include <FL/fl_utf8.h>
+#include <FL/Fl_GIF_Image.h>
+#include <FL/Fl_PNG_Image.h>
+#include <FL/Fl_JPEG_Image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TABLE_SIZE 256
+
+Xd6ImageCacheEntry **Xd6ImageCache::table = NULL;
+int Xd6ImageCache::table_size = 0;
+unsigned int Xd6ImageCache::clock = 0;
+long Xd6ImageCache::bytes = 0;
+long Xd6ImageCache::max_bytes = 32 * 1024 * 1024;
+int Xd6ImageCache::nb_entries = 0;
+int Xd6ImageCache::hits = 0;
+int Xd6ImageCache::misses = 0;
+
+/*
+ *  Decodes the image of file, or of data when it is not NULL.
+ */
+static Fl_Image *decode(const char *file, const unsigned char *data,
+	const char *header, long len)
+{
+	if (len >= 6 && (!memcmp(header, "GIF87a", 6) ||
+		!memcmp(header, "GIF89a", 6)))
+	{
+		if (data) return new Fl_GIF_Image(NULL, data, (int) len);
+		return new Fl_GIF_Image(file);
+	} else if (len >= 4 && !memcmp(header, "\211PNG", 4)) {
+		if (data) return new Fl_PNG_Image(NULL, data, (int) len);
+		return new Fl_PNG_Image(file);
+	}
+	if (data) return new Fl_JPEG_Image(NULL, data, (int) len);
+	return new Fl_JPEG_Image(file);
+}
+
+static unsigned long long hash(unsigned long long key, 
+	const unsigned char *buf, long len)
+{
+	long i;
+
+	for (i = 0; i < len; i++) {
+		key ^= buf[i];
+		key *= 1099511628211ULL;
+	}
+	return key;
+}
+
+static long image_bytes(Fl_Image *img)
+{
+	if (!img || !img->data()) return 0;
+	return (long) img->w() * img->h() * (img->d() > 0 ? img->d() : 4);
+}
+
+Xd6ImageCacheEntry *Xd6ImageCache::find(unsigned long long key, long length,
+	int w, int h)
+{
+	Xd6ImageCacheEntry *e;
+
+	if (!table) return NULL;
+	e = table[(key ^ w ^ (h << 16)) & (table_size - 1)];
+	while (e) {
+		if (e->key == key && e->length == length && e->w == w && 
+			e->h == h) 
+		{
+			return e;
+		}
+		e = e->next;
+	}
+	return NULL;
+}
+
+Xd6ImageCacheEntry *Xd6ImageCache::insert(unsigned long long key, 
+	long length, int w, int h, Fl_Image *img)
+{
+	Xd6ImageCacheEntry *e;
+	int i;
+
+	if (!table) {
+		table_size = TABLE_SIZE;
+		table = (Xd6ImageCacheEntry**) calloc(table_size, 
+			sizeof(Xd6ImageCacheEntry*));
+	}
+	e = new Xd6ImageCacheEntry();
+	e->key = key;
+	e->length = length;
+	e->w = w;
+	e->h = h;
+	e->image = img;
+	e->refs = 0;
+	e->bytes = image_bytes(img);
+	e->last_use = clock;
+	i = (key ^ w ^ (h << 16)) & (table_size - 1);
+	e->next = table[i];
+	table[i] = e;
+	bytes += e->bytes;
+	nb_entries++;
+	return e;
+}
+
+void Xd6ImageCache::remove(Xd6ImageCacheEntry *e)
+{
+	Xd6ImageCacheEntry **p;
+
+	p = &table[(e->key ^ e->w ^ (e->h << 16)) & (table_size - 1)];
+	while (*p && *p != e) p = &(*p)->next;
+	if (*p) *p = e->next;
+	bytes -= e->bytes;
+	nb_entries--;
+	delete(e->image);
+	delete(e);
+}
+
+/*
+ *  Returns the cached image of this content, decoding it from file or 
+ *  data on a miss.
+ */
+Xd6ImageCacheEntry *Xd6ImageCache::get(unsigned long long key, long length,
+	const char *file, const unsigned char *data, const char *header)
+{
+	Xd6ImageCacheEntry *e;
+
+	clock++;
+	e = find(key, length, 0, 0);
+	if (e) {
+		hits++;
+	} else {
+		misses++;
+		e = insert(key, length, 0, 0, decode(file, data, header, 
+			length));
+	}
+	e->refs++;
+	e->last_use = clock;
+	purge();
+	return e;
+}
+
+/*
+ *  Returns the image of file at its own size. The file is read to hash
+ *  its content and decoded only if no image with this content is cached.
+ */
+Xd6ImageCacheEntry *Xd6ImageCache::load(const char *file)
+{
+	unsigned long long key = 14695981039346656037ULL;
+	unsigned char buf[4096];
+	char header[6];
+	long length = 0;
+	FILE *fp;
+	int r;
+
+	fp = fl_fopen(file, "rb");
+	if (!fp) return NULL;
+	while ((r = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		if (length == 0) memcpy(header, buf, r < 6 ? r : 6);
+		key = hash(key, buf, r);
+		length += r;
+	}
+	fclose(fp);
+
+	return get(key, length, file, NULL, header);
+}
+
+/*
+ *  Same as load() for an image already in memory, such as the content
+ *  of a data: URL. data is not kept.
+ */
+Xd6ImageCacheEntry *Xd6ImageCache::load_data(const unsigned char *data,
+	long length)
+{
+	if (!data || length < 1) return NULL;
+	return get(hash(14695981039346656037ULL, data, length), length,
+		NULL, data, (const char*) data);
+}
+
+/*
+ *  Returns the image of e scaled to w x h.
+ */
+Xd6ImageCacheEntry *Xd6ImageCache::scale(Xd6ImageCacheEntry *e, int w, int h)
+{
+	Xd6ImageCacheEntry *s;
+
+	if (!e || !e->image) return NULL;
+	if (w == e->image->w() && h == e->image->h()) {
+		e->refs++;
+		e->last_use = ++clock;
+		return e;
+	}
+	clock++;
+	s = find(e->key, e->length, w, h);
+	if (s) {
+		hits++;
+	} else {
+		misses++;
+		s = insert(e->key, e->length, w, h, Xd6ScaleImage(e->image, w, h));
+	}
+	s->refs++;
+	s->last_use = clock;
+	purge();
+	return s;
+}
+
+void Xd6ImageCache::release(Xd6ImageCacheEntry *e)
+{
+	if (!e) return;
+	e->refs--;
+	purge();
+}
+
+/*
+ *  Frees the least recently used images nobody holds until the cache 
+ *  fits in max_bytes.
+ */
+void Xd6ImageCache::purge()
+{
+	while (bytes > max_bytes) {
+		Xd6ImageCacheEntry *old = NULL;
+		int i;
+		for (i = 0; i < table_size; i++) {
+			Xd6ImageCacheEntry *e = table[i];
+			while (e) {
+				if (e->refs < 1 && (!old || 
+					e->last_use < old->last_use)) 
+				{
+					old = e;
+				}
+				e = e->next;
+			}
+		}
+		if (!old) return;
+		remove(old);
+	}
+}
+
+/*
+ * "$Id: $"
+ */
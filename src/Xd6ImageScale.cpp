@@ -0,0 +1,218 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+#include "Xd6Std.h"
+#include "Xd6ImageScale.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* weights are fixed point numbers : ONE is a weight of 1.0 */
+#define SHIFT 14
+#define ONE (1 << SHIFT)
+
+/*
+ *  Weights of the source pixels for each of the m destination pixels
+ *  of an axis of n source pixels. Destination pixel i is the sum of 
+ *  taps weights from first[i].
+ */
+class ScaleAxis {
+public:
+	int taps;
+	int *first;
+	int *weight;
+
+	ScaleAxis(int n, int m);
+	~ScaleAxis();
+};
+
+ScaleAxis::ScaleAxis(int n, int m)
+{
+	int i, j;
+
+	if (m < n) {
+		taps = n / m + 2;
+	} else {
+		taps = 2;
+	}
+	if (taps > n) taps = n;
+	first = (int*) malloc(sizeof(int) * m);
+	weight = (int*) calloc(m * taps, sizeof(int));
+
+	for (i = 0; i < m; i++) {
+		int *w = weight + i * taps;
+		if (m < n) {
+			/* source pixel j covers [j * m, (j + 1) * m) and
+			   destination pixel i covers [i * n, (i + 1) * n) */
+			long long start = (long long) i * n;
+			long long end = start + n;
+			int left = ONE;
+			first[i] = (int) (start / m);
+			for (j = 0; j < taps && first[i] + j < n; j++) {
+				long long s = (long long) (first[i] + j) * m;
+				long long e = s + m;
+				if (s < start) s = start;
+				if (e > end) e = end;
+				if (e <= s) break;
+				w[j] = (int) ((e - s) * ONE / n);
+				left -= w[j];
+			}
+			if (j > 0) w[j - 1] += left;
+		} else {
+			/* center of i in source coordinates, minus 1/2 */
+			long long fx = ((long long) (2 * i + 1) * n - m) * 
+				ONE / (2 * m);
+			int f;
+			if (fx < 0) fx = 0;
+			first[i] = (int) (fx >> SHIFT);
+			f = (int) (fx & (ONE - 1));
+			if (first[i] >= n - 1) {
+				first[i] = n - 1;
+				f = 0;
+			}
+			w[0] = ONE - f;
+			if (taps > 1) w[1] = f;
+		}
+		if (first[i] + taps > n) {
+			/* keep the taps inside the row : move the weights */
+			int shift = first[i] + taps - n;
+			for (j = 0; j < taps; j++) {
+				if (j + shift < taps) {
+					w[taps - 1 - j] = w[taps - 1 - j - shift];
+				} else {
+					w[taps - 1 - j] = 0;
+				}
+			}
+			first[i] -= shift;
+		}
+	}
+}
+
+ScaleAxis::~ScaleAxis()
+{
+	free(first);
+	free(weight);
+}
+
+/*
+ *  Rows are first scaled horizontally to 16 bit values (8 bits of
+ *  fraction), then the columns are scaled, so each pass is a short 
+ *  run of multiply-adds over contiguous memory.
+ */
+void Xd6ScalePixels(const unsigned char *src, int sw, int sh, int stride,
+	unsigned char *dst, int dw, int dh, int d)
+{
+	ScaleAxis *ax, *ay;
+	unsigned short *tmp;
+	unsigned int *acc;
+	int x, y, c, t;
+	int rl = dw * d;
+
+	if (sw < 1 || sh < 1 || dw < 1 || dh < 1 || d < 1) return;
+	ax = new ScaleAxis(sw, dw);
+	ay = new ScaleAxis(sh, dh);
+	tmp = (unsigned short*) malloc(sizeof(unsigned short) * rl * sh);
+	acc = (unsigned int*) malloc(sizeof(unsigned int) * rl);
+
+	for (y = 0; y < sh; y++) {
+		const unsigned char *s = src + y * stride;
+		unsigned short *o = tmp + y * rl;
+		for (x = 0; x < dw; x++) {
+			const unsigned char *p = s + ax->first[x] * d;
+			const int *w = ax->weight + x * ax->taps;
+			for (c = 0; c < d; c++) {
+				unsigned int v = 0;
+				for (t = 0; t < ax->taps; t++) {
+					v += p[t * d + c] * w[t];
+				}
+				o[x * d + c] = (unsigned short) 
+					((v + (1 << (SHIFT - 9))) >> (SHIFT - 8));
+			}
+		}
+	}
+
+	for (y = 0; y < dh; y++) {
+		const int *w = ay->weight + y * ay->taps;
+		unsigned char *o = dst + y * rl;
+		memset(acc, 0, sizeof(unsigned int) * rl);
+		for (t = 0; t < ay->taps; t++) {
+			const unsigned short *r = tmp + (ay->first[y] + t) * rl;
+			unsigned int wt = w[t];
+			if (!wt) continue;
+			for (x = 0; x < rl; x++) acc[x] += r[x] * wt;
+		}
+		for (x = 0; x < rl; x++) {
+			unsigned int v = (acc[x] + (1 << (SHIFT + 7))) >> 
+				(SHIFT + 8);
+			o[x] = (unsigned char) (v > 255 ? 255 : v);
+		}
+	}
+
+	free(acc);
+	free(tmp);
+	delete(ax);
+	delete(ay);
+}
+
+Fl_Image *Xd6ScaleImage(Fl_Image *img, int W, int H)
+{
+	Fl_RGB_Image *rgb;
+	Fl_RGB_Image *n;
+	unsigned char *a;
+	int d;
+
+	if (!img) return NULL;
+	d = img->d();
+	if (W < 1 || H < 1 || img->count() != 1 || d < 1 || d > 4 || 
+		img->w() < 1 || img->h() < 1 || !img->data()) 
+	{
+		return img->copy(W, H);
+	}
+	rgb = (Fl_RGB_Image*) img;
+	a = new unsigned char[W * H * d];
+	Xd6ScalePixels(rgb->array, img->w(), img->h(), 
+		img->w() * d + img->ld(), a, W, H, d);
+	n = new Fl_RGB_Image(a, W, H, d);
+	n->alloc_array = 1;
+	return n;
+}
+
+/*
+ * "$Id: $"
+ */
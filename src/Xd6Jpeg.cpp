@@ -68,15 +68,8 @@ const char *Xd6Jpeg::mime()
 
 int Xd6Jpeg::load(const char *name)
 {
-	if (file) free(file);
-        file = strdup(name ? name : "");
-	printf("load jpeg %s\n", file);
-	png = new Fl_JPEG_Image(file);
-	data = (unsigned char*)png->data();
-	w = png->w();
-	h = png->h();
-	d = png->d();
-	return 1;
+	/* the cache looks at the content to pick the decoder */
+	return Xd6Png::load(name);
 }
 
 void Xd6Jpeg::draw(int XP, int YP, int WP, int HP, int cx, int cy) {
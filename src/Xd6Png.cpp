@@ -79,26 +79,70 @@ Xd6Png::Xd6Png()
 	png = NULL;
 	data = NULL;
 	id = 0;
+	w = h = d = 0;
+	orig = NULL;
+	cur = NULL;
 }
 
 Xd6Png::~Xd6Png() {
-  if (png) delete((Fl_PNG_Image*)png);
+  Xd6ImageCache::release(cur);
+  Xd6ImageCache::release(orig);
   if (file) free(file);
 }
 
+/*
+ *  The images are owned by Xd6ImageCache, png points to the one of the
+ *  current size.
+ */
+void Xd6Png::set_image(Xd6ImageCacheEntry *e)
+{
+	Xd6ImageCache::release(cur);
+	cur = e;
+	png = e ? e->image : NULL;
+	if (png) {
+		data = (unsigned char*)png->data();
+		w = png->w();
+		h = png->h();
+		d = png->d();
+	} else {
+		data = NULL;
+		w = h = d = 0;
+	}
+}
+
 int Xd6Png::load(const char *name)
 {
         if (file) free(file);
 	file = strdup(name ? name : "");
-        if (png) delete((Fl_PNG_Image*)png);
-	png = new Fl_PNG_Image(file);
-	data = (unsigned char*)png->data();
-	w = png->w();
-	h = png->h();
-	d = png->d();
+	set_image(NULL);
+	Xd6ImageCache::release(orig);
+	orig = Xd6ImageCache::load(file);
+	if (orig) orig->refs++;
+	set_image(orig);
+	return 1;
+}
+
+int Xd6Png::load_data(const unsigned char *buf, long length)
+{
+        if (file) free(file);
+	file = NULL;
+	set_image(NULL);
+	Xd6ImageCache::release(orig);
+	orig = Xd6ImageCache::load_data(buf, length);
+	if (orig) orig->refs++;
+	set_image(orig);
 	return 1;
 }
 
+/*
+ *  Goes back to the size of the image file after set_size().
+ */
+void Xd6Png::reset_size()
+{
+	if (!orig || !orig->image) return;
+	set_size(orig->image->w(), orig->image->h());
+}
+
 const char *Xd6Png::mime()
 {
 	return "image/png";
@@ -155,16 +199,14 @@ int Xd6Png::save(const char *name)
 	return 1;
 }
 
+/*
+ *  Scales from the image of the file, the scaled copies are shared.
+ */
 void Xd6Png::set_size(int width, int height)
 {
-	if (!png) return;
-	Fl_Image *npng = png->copy(width, height);
-	delete(png);
-	png = npng;
-	data = (unsigned char*)png->data();
-	w = png->w();
-	h = png->h();
-	d = png->d();
+	if (!png || !orig) return;
+	if (png->w() == width && png->h() == height) return;
+	set_image(Xd6ImageCache::scale(orig, width, height));
 }
 
 
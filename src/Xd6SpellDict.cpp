@@ -0,0 +1,217 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+#include "Xd6Std.h"
+#include "Xd6SpellDict.h"
+#include <FL/fl_utf8.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_WORD 256
+
+/*
+ *  Each word is stored in the pool as a flag byte followed by the lower
+ *  case word and a '\0'. The table holds the offset of the word + 1 : 0
+ *  is an empty slot. The flag is set if the word may also be written
+ *  with a lower case first letter ("paris" is wrong, "Paris" is not).
+ */
+
+static unsigned int hash_word(const char *w, int len)
+{
+	unsigned int h = 2166136261U;
+
+	while (len > 0) {
+		h ^= (unsigned char) *w++;
+		h *= 16777619U;
+		len--;
+	}
+	return h;
+}
+
+Xd6SpellDict::Xd6SpellDict()
+{
+	pool = NULL;
+	pool_len = 0;
+	pool_size = 0;
+	table = NULL;
+	table_size = 0;
+	nb_words = 0;
+}
+
+Xd6SpellDict::~Xd6SpellDict()
+{
+	free(pool);
+	free(table);
+}
+
+unsigned int *Xd6SpellDict::lookup(const char *w, int len)
+{
+	unsigned int mask = table_size - 1;
+	unsigned int i = hash_word(w, len) & mask;
+
+	while (table[i]) {
+		const char *e = pool + table[i];
+		if (!strncmp(e, w, len) && e[len] == '\0') break;
+		i = (i + 1) & mask;
+	}
+	return table + i;
+}
+
+void Xd6SpellDict::grow()
+{
+	unsigned int *old = table;
+	int old_size = table_size;
+	int i;
+
+	table_size = table_size ? table_size * 2 : 1024;
+	table = (unsigned int*) calloc(table_size, sizeof(unsigned int));
+	for (i = 0; i < old_size; i++) {
+		if (old[i]) {
+			const char *e = pool + old[i];
+			*lookup(e, strlen(e)) = old[i];
+		}
+	}
+	free(old);
+}
+
+/*
+ *  Adds a word. If any_case is set the word matches whatever the case of
+ *  its first letter (personal dictionary).
+ */
+void Xd6SpellDict::add(const char *w, int len, int any_case)
+{
+	char low[MAX_WORD * 3];
+	unsigned int ucs;
+	unsigned int *slot;
+	int l;
+	char lower_first;
+
+	if (len < 1 || len > MAX_WORD) return;
+	l = fl_utf_tolower((const unsigned char*) w, len, low);
+	fl_utf2ucs((const unsigned char*) w, len, &ucs);
+	lower_first = any_case || (unsigned int) fl_tolower(ucs) == ucs;
+
+	if ((nb_words + 1) * 2 > table_size) grow();
+	slot = lookup(low, l);
+	if (*slot) {
+		if (lower_first) pool[*slot - 1] = 1;
+		return;
+	}
+	if (pool_len + l + 2 > pool_size) {
+		pool_size = pool_size ? pool_size * 2 : 65536;
+		while (pool_len + l + 2 > pool_size) pool_size *= 2;
+		pool = (char*) realloc(pool, pool_size);
+	}
+	pool[pool_len] = lower_first;
+	memcpy(pool + pool_len + 1, low, l);
+	pool[pool_len + 1 + l] = '\0';
+	*slot = pool_len + 1;
+	pool_len += l + 2;
+	nb_words++;
+}
+
+/*
+ *  Returns 1 if the word is in the dictionary. Letters are compared
+ *  without case, except that a word written with a lower case first
+ *  letter does not match a dictionary word which begins upper case.
+ */
+int Xd6SpellDict::find(const char *w, int len)
+{
+	char low[MAX_WORD * 3];
+	unsigned int ucs;
+	unsigned int *slot;
+	int l;
+
+	if (len < 1 || len > MAX_WORD || !table) return 0;
+	l = fl_utf_tolower((const unsigned char*) w, len, low);
+	slot = lookup(low, l);
+	if (!*slot) return 0;
+	fl_utf2ucs((const unsigned char*) w, len, &ucs);
+	if ((unsigned int) fl_tolower(ucs) != ucs) return 1;
+	return pool[*slot - 1];
+}
+
+/*
+ *  Adds all the words (one per line) of a file. Returns the number of 
+ *  lines read or -1 if the file cannot be read.
+ */
+int Xd6SpellDict::load(const char *file, int any_case)
+{
+	FILE *fp;
+	char *buf;
+	long size;
+	int nb = 0;
+	char *ptr, *end;
+
+	fp = fopen(file, "rb");
+	if (!fp) return -1;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	rewind(fp);
+	if (size < 0) {
+		fclose(fp);
+		return -1;
+	}
+	buf = (char*) malloc(size + 1);
+	size = fread(buf, 1, size, fp);
+	fclose(fp);
+	buf[size] = '\0';
+
+	ptr = buf;
+	end = buf + size;
+	while (ptr < end) {
+		char *e = ptr;
+		while (e < end && *e != '\n') e++;
+		if (e > ptr && e[-1] == '\r') {
+			add(ptr, e - ptr - 1, any_case);
+		} else {
+			add(ptr, e - ptr, any_case);
+		}
+		nb++;
+		ptr = e + 1;
+	}
+	free(buf);
+	return nb;
+}
+
+/*
+ * "$Id: $"
+ */
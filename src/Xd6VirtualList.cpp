@@ -0,0 +1,439 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#include "Xd6Std.h"
+#include "Xd6VirtualList.h"
+#include <FL/fl_draw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCROLLBAR_W 16
+
+Xd6VirtualList *Xd6VirtualList::sorting = NULL;
+
+Xd6VirtualList::Xd6VirtualList(int X, int Y, int W, int H, const char *l) :
+	Fl_Group(X, Y, W, H, l)
+{
+	int i;
+
+	box(FL_DOWN_BOX);
+	color(FL_WHITE);
+	selection_color(FL_SELECTION_COLOR);
+	scrollbar = new Fl_Scrollbar(X + W - SCROLLBAR_W - Fl::box_dx(box()),
+		Y + Fl::box_dy(box()), SCROLLBAR_W, H - Fl::box_dh(box()));
+	scrollbar->callback(scrollbar_cb, this);
+	end();
+	count_cb = NULL;
+	row_cb = NULL;
+	compare_cb = NULL;
+	cb_data = NULL;
+	nb_rows = 0;
+	top = 0;
+	selected = -1;
+	selected_pos = -1;
+	titles = NULL;
+	widths = NULL;
+	nb_columns = 0;
+	sort_column = -1;
+	sort_reverse = 0;
+	orders = NULL;
+	row_height = 18;
+	header_height = 20;
+	cache = (Xd6VirtualListCache*) malloc(sizeof(Xd6VirtualListCache) * 
+		XD6_LIST_CACHE);
+	for (i = 0; i < XD6_LIST_CACHE; i++) cache[i].row = -1;
+}
+
+Xd6VirtualList::~Xd6VirtualList(void)
+{
+	int i;
+
+	for (i = 0; i < nb_columns && orders; i++) free(orders[i]);
+	free(orders);
+	free(cache);
+}
+
+void Xd6VirtualList::source(Xd6VirtualListCount c, Xd6VirtualListRow r, 
+	Xd6VirtualListCompare s, void *d)
+{
+	count_cb = c;
+	row_cb = r;
+	compare_cb = s;
+	cb_data = d;
+	selected = -1;
+	selected_pos = -1;
+	top = 0;
+	update();
+}
+
+/*
+ *  t and w must stay valid as long as the list. The last column takes
+ *  the remaining width.
+ */
+void Xd6VirtualList::columns(const char **t, const int *w, int nb)
+{
+	int i;
+
+	for (i = 0; i < nb_columns && orders; i++) free(orders[i]);
+	free(orders);
+	titles = t;
+	widths = w;
+	nb_columns = nb;
+	orders = (int**) calloc(nb, sizeof(int*));
+	if (sort_column >= nb) sort_column = -1;
+	redraw();
+}
+
+/*
+ *  To be called when rows were added or removed. The sort orders are 
+ *  computed again when needed.
+ */
+void Xd6VirtualList::update(void)
+{
+	int i;
+
+	nb_rows = count_cb ? count_cb(cb_data) : 0;
+	for (i = 0; i < nb_columns && orders; i++) {
+		free(orders[i]);
+		orders[i] = NULL;
+	}
+	clear_cache();
+	if (selected >= nb_rows) selected = -1;
+	selected_pos = position_of(selected);
+	update_scrollbar();
+	redraw();
+}
+
+void Xd6VirtualList::clear_cache(void)
+{
+	int i;
+
+	for (i = 0; i < XD6_LIST_CACHE; i++) cache[i].row = -1;
+}
+
+/*
+ *  To be called when the content of a row changed.
+ */
+void Xd6VirtualList::invalidate(int row)
+{
+	if (row < 0) return;
+	if (cache[row % XD6_LIST_CACHE].row == row) {
+		cache[row % XD6_LIST_CACHE].row = -1;
+	}
+	redraw();
+}
+
+int Xd6VirtualList::sort_cmp(const void *a, const void *b)
+{
+	Xd6VirtualList *l = sorting;
+	int r;
+
+	r = l->compare_cb(*(const int*)a, *(const int*)b, l->sort_column,
+		l->cb_data);
+	if (r) return r;
+	return *(const int*)a - *(const int*)b;
+}
+
+/*
+ *  Returns the rows sorted on the sort column, or NULL for the natural
+ *  order.
+ */
+int *Xd6VirtualList::order(void)
+{
+	int *o;
+	int i;
+
+	if (sort_column < 0 || !compare_cb || !orders) return NULL;
+	if (orders[sort_column]) return orders[sort_column];
+	o = (int*) malloc(sizeof(int) * (nb_rows + 1));
+	for (i = 0; i < nb_rows; i++) o[i] = i;
+	sorting = this;
+	qsort(o, nb_rows, sizeof(int), sort_cmp);
+	sorting = NULL;
+	orders[sort_column] = o;
+	return o;
+}
+
+int Xd6VirtualList::row_at(int pos)
+{
+	int *o;
+
+	if (pos < 0 || pos >= nb_rows) return -1;
+	if (sort_reverse) pos = nb_rows - 1 - pos;
+	o = order();
+	if (!o) return pos;
+	return o[pos];
+}
+
+int Xd6VirtualList::position_of(int row)
+{
+	int *o;
+	int i;
+
+	if (row < 0 || row >= nb_rows) return -1;
+	o = order();
+	if (o) {
+		for (i = 0; i < nb_rows; i++) {
+			if (o[i] == row) break;
+		}
+	} else {
+		i = row;
+	}
+	if (sort_reverse) return nb_rows - 1 - i;
+	return i;
+}
+
+void Xd6VirtualList::sort(int column, int reverse)
+{
+	if (column >= nb_columns) column = -1;
+	sort_column = column;
+	sort_reverse = reverse;
+	selected_pos = position_of(selected);
+	if (selected_pos >= 0) show_position(selected_pos);
+	redraw();
+}
+
+void Xd6VirtualList::select(int row)
+{
+	if (row >= nb_rows) row = -1;
+	selected = row;
+	selected_pos = position_of(row);
+	if (selected_pos >= 0) show_position(selected_pos);
+	redraw();
+}
+
+void Xd6VirtualList::select_position(int pos)
+{
+	if (pos >= nb_rows) pos = nb_rows - 1;
+	if (pos < 0) pos = 0;
+	selected = row_at(pos);
+	selected_pos = selected >= 0 ? pos : -1;
+	if (selected_pos >= 0) show_position(selected_pos);
+	redraw();
+}
+
+int Xd6VirtualList::visible_rows(void)
+{
+	int n;
+
+	n = (h() - Fl::box_dh(box()) - header_height) / row_height;
+	if (n < 1) n = 1;
+	return n;
+}
+
+void Xd6VirtualList::show_position(int pos)
+{
+	int n = visible_rows();
+
+	if (pos < top) {
+		top = pos;
+	} else if (pos >= top + n) {
+		top = pos - n + 1;
+	}
+	update_scrollbar();
+}
+
+void Xd6VirtualList::update_scrollbar(void)
+{
+	int n = visible_rows();
+
+	if (top > nb_rows - n) top = nb_rows - n;
+	if (top < 0) top = 0;
+	scrollbar->value(top, n, 0, nb_rows);
+	scrollbar->linesize(1);
+}
+
+/*
+ *  Returns the text of row, formatting it only if it is not cached.
+ */
+const char *Xd6VirtualList::row_text(int row, int *flags)
+{
+	Xd6VirtualListCache *c = cache + (row % XD6_LIST_CACHE);
+
+	if (c->row != row) {
+		c->text[0] = '\0';
+		c->flags = row_cb ? row_cb(row, c->text, XD6_LIST_ROW_LEN, 
+			cb_data) : 0;
+		c->text[XD6_LIST_ROW_LEN - 1] = '\0';
+		c->row = row;
+	}
+	*flags = c->flags;
+	return c->text;
+}
+
+void Xd6VirtualList::draw(void)
+{
+	int X, Y, W, H, cx, cw, i, n, row, flags;
+	const char *t, *e;
+	char title[256];
+
+	X = x() + Fl::box_dx(box());
+	Y = y() + Fl::box_dy(box());
+	W = w() - Fl::box_dw(box()) - SCROLLBAR_W;
+	H = h() - Fl::box_dh(box());
+	draw_box();
+	fl_push_clip(X, Y, W, H);
+
+	fl_font(labelfont(), labelsize());
+	row_height = fl_height() + 2;
+	header_height = row_height + 2;
+	cx = X;
+	for (i = 0; i < nb_columns; i++) {
+		cw = i < nb_columns - 1 ? widths[i] : X + W - cx;
+		fl_draw_box(FL_THIN_UP_BOX, cx, Y, cw, header_height, FL_GRAY);
+		snprintf(title, 256, "%s%s", titles[i], i != sort_column ? "" :
+			(sort_reverse ? " ^" : " v"));
+		fl_color(FL_BLACK);
+		fl_push_clip(cx + 2, Y, cw - 4, header_height);
+		fl_draw(title, cx + 4, Y + header_height - fl_descent() - 2);
+		fl_pop_clip();
+		cx += cw;
+	}
+
+	n = visible_rows() + 1;
+	for (i = 0; i < n; i++) {
+		int ry = Y + header_height + i * row_height;
+		row = row_at(top + i);
+		if (row < 0) {
+			fl_color(color());
+			fl_rectf(X, ry, W, Y + H - ry);
+			break;
+		}
+		t = row_text(row, &flags);
+		fl_color(row == selected ? selection_color() : color());
+		fl_rectf(X, ry, W, row_height);
+		fl_font(flags & XD6_ROW_BOLD ? labelfont() | FL_BOLD : 
+			labelfont(), labelsize());
+		fl_color(row == selected ? fl_contrast(FL_BLACK, 
+			selection_color()) : FL_BLACK);
+		cx = X;
+		for (int c = 0; c < nb_columns || c == 0; c++) {
+			e = strchr(t, '\t');
+			if (!e) e = t + strlen(t);
+			cw = c < nb_columns - 1 ? widths[c] : X + W - cx;
+			fl_push_clip(cx + 2, ry, cw - 4, row_height);
+			fl_draw(t, e - t, cx + 4, ry + row_height - 
+				fl_descent() - 1);
+			fl_pop_clip();
+			cx += cw;
+			if (!*e) break;
+			t = e + 1;
+		}
+	}
+	fl_pop_clip();
+	draw_child(*scrollbar);
+}
+
+int Xd6VirtualList::handle(int e)
+{
+	int X, Y, pos, n;
+
+	X = x() + Fl::box_dx(box());
+	Y = y() + Fl::box_dy(box());
+	switch (e) {
+	case FL_PUSH:
+		if (Fl::event_inside(scrollbar)) break;
+		take_focus();
+		if (Fl::event_y() < Y + header_height) {
+			int cx = X;
+			for (n = 0; n < nb_columns - 1; n++) {
+				cx += widths[n];
+				if (Fl::event_x() < cx) break;
+			}
+			if (n < nb_columns) {
+				sort(n, n == sort_column ? !sort_reverse : 0);
+			}
+			return 1;
+		}
+		pos = top + (Fl::event_y() - Y - header_height) / row_height;
+		if (pos < nb_rows) {
+			select_position(pos);
+			do_callback();
+		}
+		return 1;
+	case FL_MOUSEWHEEL:
+		top += Fl::event_dy() * 3;
+		update_scrollbar();
+		redraw();
+		return 1;
+	case FL_FOCUS:
+	case FL_UNFOCUS:
+		return 1;
+	case FL_KEYBOARD:
+		n = visible_rows();
+		pos = selected_pos;
+		switch (Fl::event_key()) {
+		case FL_Up: pos--; break;
+		case FL_Down: pos++; break;
+		case FL_Page_Up: pos -= n; break;
+		case FL_Page_Down: pos += n; break;
+		case FL_Home: pos = 0; break;
+		case FL_End: pos = nb_rows - 1; break;
+		default: return Fl_Group::handle(e);
+		}
+		if (nb_rows < 1) return 1;
+		select_position(pos);
+		do_callback();
+		return 1;
+	}
+	return Fl_Group::handle(e);
+}
+
+void Xd6VirtualList::resize(int X, int Y, int W, int H)
+{
+	Fl_Widget::resize(X, Y, W, H);
+	scrollbar->resize(X + W - SCROLLBAR_W - Fl::box_dx(box()),
+		Y + Fl::box_dy(box()), SCROLLBAR_W, H - Fl::box_dh(box()));
+	update_scrollbar();
+}
+
+void Xd6VirtualList::scrollbar_cb(Fl_Widget *w, void *d)
+{
+	Xd6VirtualList *l = (Xd6VirtualList*) d;
+
+	l->top = ((Fl_Scrollbar*)w)->value();
+	l->redraw();
+}
+
+/*
+ * "$Id: $"
+ */
@@ -45,6 +45,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <ctype.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 #include "Xd6XmlParser.h"
 
 enum {
@@ -89,6 +92,11 @@ Xd6XmlParser::~Xd6XmlParser()
 	free(entity);
 }
 
+/*
+ *  Regular files are mapped in memory and parsed in a single pass, so that
+ *  the text runs can be given to the tree without being copied.
+ *  Pipes, devices and systems without mmap() use the read() loop.
+ */
 int Xd6XmlParser::parse_file(const char *name)
 {
 	char buf[1024];
@@ -97,12 +105,13 @@ int Xd6XmlParser::parse_file(const char *name)
 	fd = open(name, O_RDONLY);
 	if (fd < 1) return -1;
 
-	read_len = read(fd, buf, 1023);
-	while (read_len > 0) {
-		buf[read_len] = '\0';
-		parse_string(buf, read_len);
+	if (parse_mapped_file() < 0) {
 		read_len = read(fd, buf, 1023);
-		
+		while (read_len > 0) {
+			buf[read_len] = '\0';
+			parse_string(buf, read_len);
+			read_len = read(fd, buf, 1023);
+		}
 	}
 	close(fd);
 
@@ -115,6 +124,33 @@ int Xd6XmlParser::parse_file(const char *name)
 	return 0;
 }
 
+/*
+ *  Parse the whole file opened on fd through a read only mapping.
+ *  Returns -1 if the file cannot be mapped (nothing has been parsed).
+ */
+int Xd6XmlParser::parse_mapped_file()
+{
+#ifndef WIN32
+	struct stat st;
+	void *map;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode)) return -1;
+	if (st.st_size < 1) return 0;
+	if ((off_t)(int) st.st_size != st.st_size) return -1;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) return -1;
+#ifdef MADV_SEQUENTIAL
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+	parse_string((const char*) map, (int) st.st_size);
+	munmap(map, st.st_size);
+	return 0;
+#else
+	return -1;
+#endif
+}
+
 int Xd6XmlParser::scan_file(const char *name, Xd6XmlTreeCallback *func, void *data)
 {
 	int ret;
@@ -126,6 +162,20 @@ int Xd6XmlParser::scan_file(const char *name, Xd6XmlTreeCallback *func, void *da
 	return ret;
 }
 
+/*
+ *  Same as scan_file() for a document which arrives in pieces : buf is
+ *  the next piece.
+ */
+void Xd6XmlParser::scan_string(const char *buf, int buf_len,
+	Xd6XmlTreeCallback *func, void *data)
+{
+	callback = func;
+	userdata = data;
+	parse_string(buf, buf_len);
+	callback = NULL;
+	userdata = NULL;
+}
+
 /*
  *  returns true if the char is valid in an attribute name
  */
@@ -177,34 +227,79 @@ void Xd6XmlParser::add_char_to_entity()
 	}
 }
 
+/*
+ *  Returns a pointer to the first '<' or '&' of str, or str + len if 
+ *  there is none.
+ *  The string is tested a machine word at a time : a byte of the word 
+ *  xor'ed with the pattern is zero when it matches the delimiter.
+ */
+static const char *scan_text_run(const char *str, int len)
+{
+	typedef unsigned long word;
+	const word ones = ((word)-1) / 0xFF;
+	const word highs = ones * 0x80;
+	const word lts = ones * '<';
+	const word amps = ones * '&';
+	const char *end = str + len;
+
+	while (str < end && ((unsigned long) str & (sizeof(word) - 1))) {
+		if (*str == '<' || *str == '&') return str;
+		str++;
+	}
+	while (end - str >= (int) sizeof(word)) {
+		word w = *(const word*) str;
+		word l = w ^ lts;
+		word a = w ^ amps;
+		if (((l - ones) & ~l & highs) | ((a - ones) & ~a & highs)) {
+			break;
+		}
+		str += sizeof(word);
+	}
+	while (str < end) {
+		if (*str == '<' || *str == '&') return str;
+		str++;
+	}
+	return end;
+}
+
 /*
  *  Plain text parsing :
- *  - Copy the input string to the output buffer.
- *  - If an entity or a tag is found then flush the output buffer and
- *    switch the status. 
- *  - flush the output buffer when the end of the input string is reached.
+ *  - Find the whole text run up to the next tag or entity.
+ *  - If an entity or a tag is found then flush the run to the tree and
+ *    switch the status. The run is given directly from the input string
+ *    unless some text is pending in the output buffer.
+ *  - Keep the run in the output buffer when the end of the input string 
+ *    is reached.
  */
 void Xd6XmlParser::text()
 {
-	while (string_len > 0) {
-		if (*string == '<') {
-			status = IN_TAG_NAME;
-			tree->add_text(buffer, buffer_pos);
-			buffer_pos = 0;
-			string++; string_len--;
-			return;
-		} else if (*string == '&') {
-			status = IN_TEXT_ENTITY;
-			tree->add_text(buffer, buffer_pos);
-			entity_pos = 0;
-			buffer_pos = 0;
-			string++; string_len--;
-			return;
-		} else {
-			add_char_to_buffer();
-		}
-		string++; string_len--;
+	const char *end;
+	int run_len;
+
+	end = scan_text_run(string, string_len);
+	run_len = end - string;
+
+	if (run_len == string_len) {
+		copy_string_to_buffer(string, run_len);
+		string = end; string_len = 0;
+		return;
 	}
+
+	if (buffer_pos > 0) {
+		copy_string_to_buffer(string, run_len);
+		tree->add_text(buffer, buffer_pos);
+	} else {
+		tree->add_text(string, run_len);
+	}
+	buffer_pos = 0;
+	if (*end == '<') {
+		status = IN_TAG_NAME;
+	} else {
+		status = IN_TEXT_ENTITY;
+		entity_pos = 0;
+	}
+	string = end + 1; 
+	string_len -= run_len + 1;
 }
 
 void Xd6XmlParser::text_entity()
@@ -302,7 +397,10 @@ void Xd6XmlParser::copy_string_to_buffer(const char *str, int len)
 {
 	const char *ptr;
 	if (buffer_pos + len + 2 >= buffer_len) {
-		buffer_len += len + 4;
+		buffer_len *= 2;
+		if (buffer_pos + len + 2 >= buffer_len) {
+			buffer_len = buffer_pos + len + 4;
+		}
 		buffer = (char*) realloc(buffer, buffer_len);
 	}
 
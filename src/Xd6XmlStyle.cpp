@@ -1324,12 +1324,111 @@ Xd6XmlStl *Xd6XmlStyle::get_style(Xd6XmlTreeElement *e, int rtl)
 	
 }
 
+/*
+ *  Open addressing table of all the styles created by get_style().
+ *  A style is found by its parent and the values compared by is_equal(),
+ *  so get_style() does not have to scan the siblings.
+ */
+static Xd6XmlStl **style_table = NULL;
+static unsigned int style_table_size = 0;
+static unsigned int style_table_count = 0;
+
+static void style_table_insert(Xd6XmlStl *s);
+
+static void style_table_grow()
+{
+	Xd6XmlStl **old = style_table;
+	unsigned int old_size = style_table_size;
+	unsigned int i;
+
+	style_table_size = old_size ? old_size * 2 : 256;
+	style_table = (Xd6XmlStl**) calloc(style_table_size, 
+		sizeof(Xd6XmlStl*));
+	style_table_count = 0;
+	for (i = 0; i < old_size; i++) {
+		if (old[i]) style_table_insert(old[i]);
+	}
+	free(old);
+}
+
+static void style_table_insert(Xd6XmlStl *s)
+{
+	unsigned int i;
+
+	if ((style_table_count + 1) * 4 > style_table_size * 3) {
+		style_table_grow();
+	}
+	i = s->hash_key & (style_table_size - 1);
+	while (style_table[i]) i = (i + 1) & (style_table_size - 1);
+	style_table[i] = s;
+	style_table_count++;
+	s->interned = 1;
+}
+
+static Xd6XmlStl *style_table_find(Xd6XmlStl *p, Xd6XmlStl *owner)
+{
+	unsigned int i;
+	unsigned int h;
+
+	if (!style_table) return NULL;
+	h = p->hash(owner);
+	i = h & (style_table_size - 1);
+	while (style_table[i]) {
+		Xd6XmlStl *s = style_table[i];
+		if (s->hash_key == h && s->parent == owner && s->is_equal(p)) {
+			return s;
+		}
+		i = (i + 1) & (style_table_size - 1);
+	}
+	return NULL;
+}
+
+/*
+ *  Remove s and move back the following entries of its cluster.
+ */
+static void style_table_remove(Xd6XmlStl *s)
+{
+	unsigned int mask = style_table_size - 1;
+	unsigned int i, j, k;
+
+	i = s->hash_key & mask;
+	while (style_table[i] && style_table[i] != s) i = (i + 1) & mask;
+	if (!style_table[i]) return;
+
+	style_table[i] = NULL;
+	style_table_count--;
+	s->interned = 0;
+	j = i;
+	for (;;) {
+		j = (j + 1) & mask;
+		if (!style_table[j]) break;
+		k = style_table[j]->hash_key & mask;
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+			style_table[i] = style_table[j];
+			style_table[j] = NULL;
+			i = j;
+		}
+	}
+}
+
+/*
+ *  Number of interned styles and size of the table, for the tests.
+ */
+void Xd6XmlStl::table_stats(unsigned int *nb, unsigned int *size)
+{
+	*nb = style_table_count;
+	*size = style_table_size;
+}
+
 Xd6XmlStl::Xd6XmlStl(Xd6XmlStl *p)
 {
 	static int been_here = 0;
 
 	child = NULL;
 	nb_child = 0;
+	max_child = 0;
+	hash_key = 0;
+	interned = 0;
 
 	flags[0] = 0;
 	flags[1] = 0;
@@ -1382,7 +1481,9 @@ Xd6XmlStl::~Xd6XmlStl()
 {
 	if (child) {
 		for (int i = 0; i < nb_child; i++) delete(child[i]);
+		free(child);
 	}
+	if (interned) style_table_remove(this);
 }
 
 void Xd6XmlStl::copy(Xd6XmlStl *p)
@@ -1418,26 +1519,27 @@ void Xd6XmlStl::copy(Xd6XmlStl *p)
 Xd6XmlStl *Xd6XmlStl::get_style(Xd6XmlStl *p)
 {
 	Xd6XmlStl *rstl = NULL;
-	int i;
 
 	if (is_equal(p)) return this;
 
-	for (i = 0; i < nb_child; i++) {
-		if (child[i]->is_equal(p)) return child[i];
-	}
+	rstl = style_table_find(p, this);
+	if (rstl) return rstl;
 
 	if (parent) {
-		int nbc = parent->nb_child;
-		Xd6XmlStl **c = parent->child;
-		for (i = 0; i < nbc; i++) {
-			if (c[i]->is_equal(p)) return c[i];
-		}
+		rstl = style_table_find(p, parent);
+		if (rstl) return rstl;
 	}
 
 	rstl = new Xd6XmlStl(p);
 	rstl->parent = this;
+	rstl->hash_key = rstl->hash(this);
+	style_table_insert(rstl);
 
-	child = (Xd6XmlStl**)realloc(child, sizeof(Xd6XmlStl*) * (nb_child+1));
+	if (nb_child >= max_child) {
+		max_child = max_child ? max_child * 2 : 4;
+		child = (Xd6XmlStl**)realloc(child, 
+			sizeof(Xd6XmlStl*) * max_child);
+	}
 	child[nb_child++] = rstl;
 
 	return rstl;
@@ -1533,6 +1635,39 @@ int Xd6XmlStl::is_equal(Xd6XmlStl *p)
 	return 1;
 }
 
+/*
+ *  Hash of the values compared by is_equal() and of the style that owns 
+ *  this one in the style tree.
+ */
+unsigned int Xd6XmlStl::hash(Xd6XmlStl *owner)
+{
+	unsigned int w[6];
+	unsigned int h = 2166136261U;
+	int i;
+
+	w[0] = (is_block & 1) | (is_inline & 1) << 1 | 
+		(text_align & 7) << 2 | (page_break & 1) << 5 | 
+		(list & 3) << 6 | (preformated & 1) << 8 | 
+		(rtl_direction & 1) << 9 | (font_bold & 1) << 10 | 
+		(font_italic & 1) << 11 | (underline & 1) << 12 | 
+		(double_under & 1) << 13 | (strike & 1) << 14 | 
+		(sup_text & 1) << 15 | (sub_text & 1) << 16 | 
+		(a_link & 1) << 17 | (bad_spell & 1) << 18 | 
+		(display & 1) << 19 | (blockquote & 0xFF) << 20;
+	w[1] = (top_margin & 0xFFFF) | (unsigned int) font_size << 16;
+	w[2] = font;
+	w[3] = bg_color;
+	w[4] = fg_color;
+	w[5] = (unsigned int) (unsigned long) owner;
+
+	for (i = 0; i < 6; i++) {
+		h = (h ^ w[i]) * 16777619U;
+		h ^= h >> 15;
+	}
+	h *= 0x9E3779B1U;
+	return h ^ (h >> 16);
+}
+
 /*
  * "$Id: $"
  */
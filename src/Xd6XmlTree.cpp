@@ -79,6 +79,64 @@ void Xd6XmlAttribute::set_value(const char *v, int v_len)
 	value[v_len] = '\0';
 }
 
+/*
+ *  Tree nodes are carved out of slabs and recycled through one free list
+ *  per node class, instead of being malloc'ed one by one.
+ *  Bigger (derived) objects use malloc.
+ */
+#define NODE_SLAB_SIZE	256
+
+struct Xd6XmlNodeSlot {
+	Xd6XmlNodeSlot *next;
+};
+
+static Xd6XmlNodeSlot *node_free_list[2] = {NULL, NULL};
+
+static int node_class(size_t size)
+{
+	if (size == sizeof(Xd6XmlTreeText)) return 0;
+	if (size == sizeof(Xd6XmlTreeElement)) return 1;
+	return -1;
+}
+
+void *Xd6XmlTreeSegment::operator new(size_t size)
+{
+	Xd6XmlNodeSlot *slot;
+	char *slab;
+	int c, i;
+
+	c = node_class(size);
+	if (c < 0) return malloc(size);
+
+	if (!node_free_list[c]) {
+		slab = (char*) malloc(size * NODE_SLAB_SIZE);
+		for (i = NODE_SLAB_SIZE - 1; i >= 0; i--) {
+			slot = (Xd6XmlNodeSlot*) (slab + i * size);
+			slot->next = node_free_list[c];
+			node_free_list[c] = slot;
+		}
+	}
+	slot = node_free_list[c];
+	node_free_list[c] = slot->next;
+	return slot;
+}
+
+void Xd6XmlTreeSegment::operator delete(void *ptr, size_t size)
+{
+	Xd6XmlNodeSlot *slot;
+	int c;
+
+	if (!ptr) return;
+	c = node_class(size);
+	if (c < 0) {
+		free(ptr);
+		return;
+	}
+	slot = (Xd6XmlNodeSlot*) ptr;
+	slot->next = node_free_list[c];
+	node_free_list[c] = slot;
+}
+
 Xd6XmlTreeSegment::Xd6XmlTreeSegment(Xd6XmlTreeElement *p, int i)
 {
 	parent = p;
@@ -120,8 +178,10 @@ Xd6XmlTreeElement::Xd6XmlTreeElement(Xd6XmlTreeElement *p, int i) : Xd6XmlTreeSe
 	stl = &Xd6XmlStl::def;
 	attributes = NULL;
 	nb_attributes = 0;
+	max_attributes = 0;
 	children = NULL;
 	nb_children = 0;
+	max_children = 0;
 }
 
 Xd6XmlTreeElement::~Xd6XmlTreeElement()
@@ -146,26 +206,38 @@ Xd6XmlTreeElement::~Xd6XmlTreeElement()
 	if (children) free(children);
 }
 
+/*
+ *  Append a child, the children array grows geometrically.
+ *  (other modules may steal the array and reset it to NULL)
+ */
+void Xd6XmlTreeElement::add_child(Xd6XmlTreeSegment *child)
+{
+	if (!children) max_children = 0;
+	if (nb_children >= max_children) {
+		max_children = max_children ? max_children * 2 : 4;
+		if (max_children <= nb_children) max_children = nb_children + 1;
+		children = (Xd6XmlTreeSegment**) realloc(children, 
+			max_children * sizeof(Xd6XmlTreeSegment*));
+	}
+	children[nb_children] = child;
+	nb_children++;
+}
+
 Xd6XmlTreeText *Xd6XmlTreeElement::create_child_text()
 {
 	Xd6XmlTreeText *text;
 
-	children = (Xd6XmlTreeSegment**) realloc(children, 
-		(nb_children + 1) * sizeof(Xd6XmlTreeSegment*));
 	text = new Xd6XmlTreeText(this, nb_children);
-	children[nb_children] = text;
-	nb_children++;
+	add_child(text);
 	return text;
 }
 
 Xd6XmlTreeElement *Xd6XmlTreeElement::create_child_element()
 {
 	Xd6XmlTreeElement *elem;
-	children = (Xd6XmlTreeSegment**) realloc(children, 
-		(nb_children + 1) * sizeof(Xd6XmlTreeSegment*));
+
 	elem = new Xd6XmlTreeElement(this, nb_children);
-	children[nb_children] = elem;
-	nb_children++;
+	add_child(elem);
 	return elem;
 }
 
@@ -186,8 +258,12 @@ void Xd6XmlTreeElement::unref_child(int c_id)
 
 void Xd6XmlTreeElement::add_attribute(Xd6XmlAttribute *attr)
 {
-	attributes = (Xd6XmlAttribute **) realloc(attributes, 
-		sizeof(Xd6XmlAttribute*) * (nb_attributes + 1));
+	if (!attributes) max_attributes = 0;
+	if (nb_attributes >= max_attributes) {
+		max_attributes = max_attributes ? max_attributes * 2 : 2;
+		attributes = (Xd6XmlAttribute **) realloc(attributes, 
+			sizeof(Xd6XmlAttribute*) * max_attributes);
+	}
 	attributes[nb_attributes] = attr;
 	nb_attributes++;
 }
@@ -235,6 +311,8 @@ Xd6XmlTree::Xd6XmlTree()
 	txt = NULL;
 	len = 0;
 	attribute = NULL;
+	open_callback = NULL;
+	open_data = NULL;
 }
 
 Xd6XmlTree::~Xd6XmlTree()
@@ -640,6 +718,9 @@ void Xd6XmlTree::set_element_style()
 	sty = Xd6XmlStyle::get_style(cur_element, right_to_left);
 	preformated = sty->preformated;
 	right_to_left = sty->rtl_direction;
+	/* the start tag is complete : let the caller look at it while 
+	   the rest of the file is parsed */
+	if (open_callback) open_callback(cur_element, open_data);
 }
 
 void Xd6XmlTree::close_element(const char *tag, int len, 
@@ -47,6 +47,7 @@ public:
 		display = new Xd6HtmlView(0, 0, w(), h() / 2);
 		display->frame->editor = 0;
 		display->frame->wysiwyg = 0;
+		display->frame->keep_blocks = 10000;
 		input = new command(0, h() / 2, w(), h() / 2);
 		input->cb = cb_add_text;
 	}
@@ -54,6 +55,25 @@ public:
 
 chat *chater;
 
+void append_frame(Xd6HtmlFrame *f)
+{
+	int i, n = 0;
+
+	for (i = 0; i < f->nb_blocks; i++) {
+		Xd6HtmlBlock *b = f->blocks[i];
+		if (b->nb_segs > 1 || (b->nb_segs == 1 &&
+			(b->segs[0]->len > 0 || b->segs[0]->stl->display)))
+		{
+			f->blocks[n++] = b;
+		} else {
+			delete(b);
+		}
+	}
+	f->nb_blocks = 0;
+	chater->display->frame->append_blocks(f->blocks, n);
+	delete(f);
+}
+
 void auto_text(void *)
 {
 	char *str = "<html><body><font color=\"red\">ME&gt; Hello it's "
@@ -65,10 +85,7 @@ void auto_text(void *)
 	p->parse_string(str, strlen(str));
 	f = new Xd6HtmlFrame(0);
 	f->tree2block(p->tree->root);
-	chater->display->frame->cursor_to_end();
-	chater->display->frame->insert_frame(f);
-	chater->display->frame->cursor_to_end();
-	chater->display->frame->insert_text("\r", 1);
+	append_frame(f);
 	chater->redraw();
 	delete(p);
 	Fl::add_timeout(2, auto_text, NULL);
@@ -79,10 +96,7 @@ void cb_add_text(Fl_Widget*, void*)
 {
 	chater->input->frame->cursor_to_begin();
 	chater->input->frame->insert_text("YOU> ", 5);
-	chater->display->frame->cursor_to_end();
-	chater->display->frame->insert_frame(chater->input->frame);
-	chater->display->frame->cursor_to_end();
-	chater->display->frame->insert_text("\r", 1);
+	append_frame(chater->input->frame);
 	chater->input->frame = NULL;
 	chater->input->new_frame(chater->input->w(), chater->input->h());
 	chater->input->frame->wysiwyg = 0;
@@ -0,0 +1,218 @@
+/*
+ *  flfm directory scanner test.
+ *
+ *  usage: dirscan [number of files]
+ *
+ *  Fills a temporary directory with files (20000 by default) of various
+ *  sizes, sub directories, symbolic links and hidden files, and reads it
+ *  with DirScanner as flfm does, then with scandir() and stat() as flfm
+ *  did before. Prints the time until the first files can be shown and
+ *  the time of the whole scan. Exits with 1 if the scanner misses a
+ *  file, shows a hidden one, or gets another size or mode than stat().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include "../flfm/DirScanner.h"
+#include "../flfm/IconCanvas.h"
+
+#define _(str) (str)
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int make_files(const char *dir, int nb)
+{
+	char name[1024], target[64];
+	int i, n = 0;
+
+	for (i = 0; i < nb; i++) {
+		if (i % 100 == 99) {
+			snprintf(name, sizeof(name), "%s/dir%d", dir, i);
+			if (mkdir(name, 0700)) return -1;
+		} else if (i % 50 == 49) {
+			snprintf(name, sizeof(name), "%s/link%d", dir, i);
+			snprintf(target, sizeof(target), "file%d", i - 1);
+			if (symlink(i % 200 == 149 ? "nowhere" : target, name)) {
+				return -1;
+			}
+		} else {
+			int fd;
+			snprintf(name, sizeof(name), "%s/%sfile%d", dir,
+				i % 10 == 3 ? "." : "", i);
+			fd = open(name, O_WRONLY | O_CREAT, 0600);
+			if (fd < 0 || ftruncate(fd, (i * 37) % 5000)) return -1;
+			close(fd);
+		}
+		n++;
+	}
+	return n;
+}
+
+static int namesort(const void *a, const void *b)
+{
+	return strcmp((*(struct file_info**) a)->real_name,
+		(*(struct file_info**) b)->real_name);
+}
+
+/*
+ *  Reads dir with a DirScanner into *out, sorted by name. Returns the
+ *  number of files.
+ */
+static int scan(const char *dir, int hidden, double *first, double *total,
+	struct file_info ***out)
+{
+	DirScanner *s;
+	struct file_info **all = NULL;
+	int nb = 0;
+	double t;
+
+	t = now();
+	*first = -1;
+	s = new DirScanner(dir, hidden);
+	for (;;) {
+		struct pollfd p;
+		DirScanChunk *c, *n;
+
+		p.fd = s->fd();
+		p.events = POLLIN;
+		p.revents = 0;
+		poll(&p, 1, 1000);
+		for (c = s->get(); c; c = n) {
+			n = c->next;
+			if (*first < 0 && c->nb > 0) *first = now() - t;
+			all = (struct file_info**) realloc(all,
+				sizeof(struct file_info*) * (nb + c->nb));
+			memcpy(all + nb, c->info, sizeof(struct file_info*) * c->nb);
+			nb += c->nb;
+			free(c->info);
+			free(c);
+		}
+		if (s->finished()) break;
+	}
+	*total = now() - t;
+	delete(s);
+	qsort(all, nb, sizeof(struct file_info*), namesort);
+	*out = all;
+	return nb;
+}
+
+/*
+ *  The old way : everything before the first file is shown.
+ */
+static int scan_sync(const char *dir, double *total)
+{
+	struct dirent **list;
+	struct stat st;
+	char name[1024];
+	double t;
+	int i, nb;
+
+	t = now();
+	nb = scandir(dir, &list, NULL, alphasort);
+	for (i = 0; i < nb; i++) {
+		snprintf(name, sizeof(name), "%s/%s", dir, list[i]->d_name);
+		stat(name, &st);
+		free(list[i]);
+	}
+	free(list);
+	*total = now() - t;
+	return nb;
+}
+
+/*
+ *  Returns the number of files of dir which are not in info or differ
+ *  from what stat() says.
+ */
+static int check(const char *dir, int hidden, struct file_info **info,
+	int nb)
+{
+	struct dirent **list;
+	struct stat st;
+	char name[1024];
+	int i, k = 0, n, bad = 0;
+
+	n = scandir(dir, &list, NULL, alphasort);
+	for (i = 0; i < n; i++) {
+		const char *d = list[i]->d_name;
+		if (d[0] == '.' && (!hidden || !d[1] ||
+			(d[1] == '.' && !d[2])))
+		{
+			free(list[i]);
+			continue;
+		}
+		snprintf(name, sizeof(name), "%s/%s", dir, d);
+		if (stat(name, &st)) {
+			st.st_mode = 0;
+			st.st_size = 0;
+		}
+		if (k >= nb || strcmp(info[k]->real_name, d) ||
+			info[k]->st.st_mode != st.st_mode ||
+			info[k]->st.st_size != st.st_size)
+		{
+			bad++;
+		} else {
+			k++;
+		}
+		free(list[i]);
+	}
+	free(list);
+	return bad + nb - k;
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/dirscan-XXXXXX";
+	char buf[256];
+	struct file_info **info;
+	DirScanner *s;
+	int nb_files = 20000;
+	int i, nb, bad, ret = 0;
+	double first, total;
+
+	if (argc > 1) nb_files = atoi(argv[1]);
+	if (nb_files < 1) nb_files = 1;
+	if (!mkdtemp(dir) || make_files(dir, nb_files) < 0) {
+		perror("dirscan");
+		return 1;
+	}
+
+	nb = scan_sync(dir, &total);
+	printf("scandir    %6d files, shown after %8.1f ms\n", nb - 2,
+		total * 1000.0);
+
+	for (i = 0; i < 2; i++) {
+		nb = scan(dir, i, &first, &total, &info);
+		printf("DirScanner %6d files, first after %8.1f ms, all after "
+			"%8.1f ms%s\n", nb, first * 1000.0, total * 1000.0,
+			i ? ", with hidden files" : "");
+		bad = check(dir, i, info, nb);
+		if (bad) {
+			printf(_("FAILED: %d files missing or wrong\n"), bad);
+			ret = 1;
+		}
+		while (nb > 0) free(info[--nb]);
+		free(info);
+	}
+
+	/* a scan dropped at once, as when the user changes directory */
+	first = now();
+	s = new DirScanner(dir, 0);
+	delete(s);
+	printf("cancel     %8.1f ms\n", (now() - first) * 1000.0);
+
+	snprintf(buf, sizeof(buf), "rm -rf %s", dir);
+	system(buf);
+	return ret;
+}
@@ -0,0 +1,280 @@
+/*
+ *  flfm directory watcher test.
+ *
+ *  usage: filewatch [number of files]
+ *
+ *  Shows a temporary directory of files (20000 by default) in an
+ *  IconCanvas and watches it with an Xd6FileWatcher calling flfm's
+ *  cb_directory(), as flfm does. Files are created, grown, renamed and
+ *  removed, and once the events are delivered the icons must be the
+ *  files of the directory in the order of the view. Then prints the
+ *  time to look up every file with find_file() and with a walk over
+ *  all the files, and the wakeups of the watcher of an idle directory.
+ *  Exits with 1 if the icons differ from the directory or find_file()
+ *  gets a file wrong.
+ *
+ *  Nothing is drawn, no X display is needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <FL/Fl.H>
+#include <FL/x.H>
+#include <FL/Fl_Output.H>
+#include <xd640/Xd6FileWatcher.h>
+#include "../flfm/IconCanvas.h"
+#include "../flfm/gui.h"
+#include "../flfm/callbacks.h"
+
+#define _(str) (str)
+
+#define NB_CHANGES 300
+
+/* defined by flfm's main.cpp */
+GUI *gui;
+Xd6ConfigFile *cfg;
+Xd6ConfigFileSection *cfg_sec;
+Atom XdndActionAsk;
+Atom XdndActionMove;
+Atom XdndActionLink;
+Atom XdndActionCopy;
+
+static int nb_events;
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void touch(const char *dir, const char *name, int size)
+{
+	char path[1024];
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fd = open(path, O_WRONLY | O_CREAT, 0600);
+	if (fd < 0) return;
+	if (ftruncate(fd, size)) perror("filewatch");
+	close(fd);
+}
+
+static void watch_cb(Xd6FileWatcher *w, const char *name, int what, void *d)
+{
+	nb_events++;
+	cb_directory(w, name, what, d);
+}
+
+/*
+ *  Runs the event loop until nothing has come for a while.
+ */
+static void settle(void)
+{
+	int last;
+	double t = now();
+
+	do {
+		last = nb_events;
+		while (now() - t < 0.3) Fl::wait(0.05);
+		t = now();
+	} while (nb_events != last);
+}
+
+/*
+ *  The files of dir the way flfm reads them.
+ */
+static int list_files(const char *dir, struct file_info ***out)
+{
+	struct file_info **fi = NULL;
+	struct dirent *e;
+	char path[1024];
+	DIR *d;
+	int nb = 0;
+
+	d = opendir(dir);
+	if (!d) return 0;
+	while ((e = readdir(d)) != NULL) {
+		struct file_info *f;
+		int l;
+		if (e->d_name[0] == '.') continue;
+		l = strlen(e->d_name);
+		f = (struct file_info*) malloc(sizeof(struct file_info) + l + 1);
+		memcpy(f + 1, e->d_name, l + 1);
+		f->real_name = (const char*) (f + 1);
+		snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+		if (stat(path, &f->st)) memset(&f->st, 0, sizeof(f->st));
+		fi = (struct file_info**) realloc(fi,
+			sizeof(struct file_info*) * (nb + 1));
+		fi[nb++] = f;
+	}
+	closedir(d);
+	*out = fi;
+	return nb;
+}
+
+static int namesort(const void *a, const void *b)
+{
+	return strcmp((*(struct file_info**) a)->real_name,
+		(*(struct file_info**) b)->real_name);
+}
+
+/*
+ *  Returns the number of files of dir which are not shown with their
+ *  size, plus the icons out of the view order.
+ */
+static int check(IconCanvas *c, const char *dir)
+{
+	struct file_info **fi, **shown;
+	int i, nb, bad = 0;
+
+	nb = list_files(dir, &fi);
+	shown = (struct file_info**) malloc(sizeof(struct file_info*) *
+		(c->nbf + 1));
+	memcpy(shown, c->info, sizeof(struct file_info*) * c->nbf);
+	for (i = 1; i < c->nbf; i++) {
+		if (strcoll(shown[i - 1]->real_name, shown[i]->real_name) > 0) {
+			bad++;
+		}
+	}
+	qsort(fi, nb, sizeof(struct file_info*), namesort);
+	qsort(shown, c->nbf, sizeof(struct file_info*), namesort);
+	if (nb != c->nbf || c->group->nb_entries != c->nbf) bad++;
+	for (i = 0; i < nb && i < c->nbf; i++) {
+		if (strcmp(fi[i]->real_name, shown[i]->real_name) ||
+			fi[i]->st.st_size != shown[i]->st.st_size)
+		{
+			bad++;
+		}
+	}
+	for (i = 0; i < nb; i++) free(fi[i]);
+	free(fi);
+	free(shown);
+	return bad;
+}
+
+/*
+ *  Looks up every file with find_file() and by a walk over the files.
+ */
+static int lookups(IconCanvas *c)
+{
+	char **names;
+	double tf, tw;
+	int i, k, nb = c->nbf, bad = 0;
+
+	names = (char**) malloc(sizeof(char*) * nb);
+	for (i = 0; i < nb; i++) names[i] = strdup(c->info[i]->real_name);
+	tf = now();
+	for (i = 0; i < nb; i++) {
+		if (c->find_file(names[i]) != i) bad++;
+	}
+	tf = now() - tf;
+	if (c->find_file("no such file") != -1) bad++;
+	tw = now();
+	for (i = 0; i < nb; i++) {
+		for (k = 0; k < nb; k++) {
+			if (!strcmp(c->info[k]->real_name, names[i])) break;
+		}
+		if (k != i) bad++;
+	}
+	tw = now() - tw;
+	printf("lookup     %d files: find_file %.1f ms, every file %.1f ms\n",
+		nb, tf * 1000.0, tw * 1000.0);
+	for (i = 0; i < nb; i++) free(names[i]);
+	free(names);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/filewatch-XXXXXX";
+	char name[64], to[64], buf[256];
+	struct file_info **fi;
+	IconCanvas *canvas;
+	Xd6FileWatcher *w;
+	int nb_files = 20000;
+	int i, nb, bad, ret = 0;
+	double t;
+
+	if (argc > 1) nb_files = atoi(argv[1]);
+	if (nb_files < NB_CHANGES) nb_files = NB_CHANGES;
+	if (!mkdtemp(dir)) {
+		perror("filewatch");
+		return 1;
+	}
+	for (i = 0; i < nb_files; i++) {
+		snprintf(name, sizeof(name), "file%d", i);
+		touch(dir, name, i % 1000);
+	}
+
+	gui = new GUI(0, 0, 640, 480);
+	gui->stat_bar = new Fl_Output(0, 460, 640, 20);
+	canvas = new IconCanvas(0, 0, 640, 460);
+	canvas->end();
+	gui->end();
+	gui->icon_can = canvas;
+	StatesValues.url = strdup(dir);
+	nb = list_files(dir, &fi);
+	canvas->add_files(fi, nb);
+	free(fi);
+	canvas->show_files();
+
+	w = new Xd6FileWatcher(dir, watch_cb, NULL);
+	t = now();
+	for (i = 0; i < NB_CHANGES; i++) {
+		switch (i % 4) {
+		case 0:
+			snprintf(name, sizeof(name), "new%d", i);
+			touch(dir, name, i);
+			break;
+		case 1:
+			snprintf(name, sizeof(name), "file%d", i);
+			touch(dir, name, 5000 + i);
+			break;
+		case 2:
+			snprintf(name, sizeof(name), "%s/file%d", dir, i);
+			snprintf(to, sizeof(to), "%s/moved%d", dir, i);
+			rename(name, to);
+			break;
+		default:
+			snprintf(name, sizeof(name), "%s/file%d", dir, i);
+			unlink(name);
+		}
+	}
+	settle();
+	t = now() - t;
+	printf("watch      %d changes in %d files, %d events, shown after "
+		"%.1f ms\n", NB_CHANGES, nb_files, nb_events, t * 1000.0);
+	bad = check(canvas, dir);
+	if (bad) {
+		printf(_("FAILED: %d icons differ from the directory\n"), bad);
+		ret = 1;
+	}
+
+	bad = lookups(canvas);
+	if (bad) {
+		printf(_("FAILED: find_file() gets %d files wrong\n"), bad);
+		ret = 1;
+	}
+
+	/* nothing changes : the watcher must not wake up */
+	nb_events = 0;
+	t = now();
+	while (now() - t < 2.0) Fl::wait(1.0);
+	printf("idle       %d events in 2 s\n", nb_events);
+	if (nb_events) {
+		printf(_("FAILED: the watcher wakes up for nothing\n"));
+		ret = 1;
+	}
+
+	delete(w);
+	snprintf(buf, sizeof(buf), "rm -rf %s", dir);
+	system(buf);
+	return ret;
+}
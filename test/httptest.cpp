@@ -0,0 +1,417 @@
+/*
+ *  flspider download test against a local HTTP server.
+ *
+ *  usage: httptest
+ *
+ *  Forks a small HTTP/1.1 server on 127.0.0.1 which serves a page with
+ *  NB_IMAGES images, then loads the page in a frame through flspider's
+ *  Download and runs the FLTK event loop until the page and its images
+ *  are in. The page is loaded again by a new Download, as after a
+ *  restart, to check that it is revalidated (304) and taken from the
+ *  cache, and a third time with its cache entry dropped before the 304
+ *  comes, which must make Download ask for the whole page again. Exits
+ *  with 1 if a file differs from what the server sent, if the
+ *  connections are not reused or if the page is not revalidated or not
+ *  asked again.
+ *
+ *  No window is shown: a fixed pitch device stands for the X fonts
+ *  when the page is laid out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <FL/Fl.h>
+#include <FL/Fl_Fltk.H>
+#include <xd640/Xd6HtmlFrame.h>
+#include "../flspider/Download.h"
+
+#define _(str) (str)
+
+#define NB_IMAGES 12
+#define PAGE_TEXT (128 * 1024)
+#define IMAGE_SIZE (16 * 1024)
+
+class FixedPitch : public Fl_Fltk {
+public:
+	void font(int face, int size) { fl_font_ = face; fl_size_ = size; }
+	int height() { return fl_size_ + 2; }
+	int descent() { return fl_size_ / 4; }
+	double width(const char *s) { return width(s, strlen(s)); }
+	double width(const char *s, int n) { return n * fl_size_ * 0.55; }
+	double width(unsigned int) { return fl_size_ * 0.55; }
+};
+
+static const unsigned char png[] = {
+	0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
+	0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+	0x08, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x15, 0xC4, 0x89, 0x00, 0x00, 0x00,
+	0x0A, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0x00, 0x01, 0x00, 0x00,
+	0x05, 0x00, 0x01, 0x0D, 0x0A, 0x2D, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x49,
+	0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
+};
+
+static char *page;
+static int page_len;
+static char *images[NB_IMAGES];
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void make_bodies(void)
+{
+	int i, n = 0;
+
+	page = (char*) malloc(PAGE_TEXT + NB_IMAGES * 64 + 256);
+	n += sprintf(page + n, "<html><head><title>test</title></head>"
+		"<body>\n<p>");
+	for (i = 0; i < NB_IMAGES; i++) {
+		n += sprintf(page + n, "<img src=\"img%d.png\" width=\"8\" "
+			"height=\"8\" />\n", i);
+	}
+	while (n < PAGE_TEXT) {
+		n += sprintf(page + n, "some text to make the page long %d\n", n);
+	}
+	n += sprintf(page + n, "</p></body></html>\n");
+	page_len = n;
+
+	/* a 1x1 PNG, made different by what follows its IEND chunk */
+	for (i = 0; i < NB_IMAGES; i++) {
+		int j;
+		images[i] = (char*) malloc(IMAGE_SIZE);
+		memcpy(images[i], png, sizeof(png));
+		for (j = sizeof(png); j < IMAGE_SIZE; j++) {
+			images[i][j] = (char) (i * 7 + j);
+		}
+	}
+}
+
+static void send_all(int fd, const char *b, int len)
+{
+	while (len > 0) {
+		int w = write(fd, b, len);
+		if (w <= 0) return;
+		b += w;
+		len -= w;
+	}
+}
+
+/*
+ *  Answers the requests of one connection until the client closes it.
+ *  A byte is written to report for each request, '3' for a 304.
+ */
+static void serve_connection(int fd, int report)
+{
+	char buf[8192];
+	char head[512];
+	int len = 0;
+
+	for (;;) {
+		char *end, *path;
+		const char *body = NULL;
+		int body_len = 0;
+		int r;
+
+		buf[len] = '\0';
+		end = strstr(buf, "\r\n\r\n");
+		if (!end) {
+			if (len >= (int) sizeof(buf) - 1) return;
+			r = read(fd, buf + len, sizeof(buf) - 1 - len);
+			if (r <= 0) return;
+			len += r;
+			continue;
+		}
+		end += 4;
+		path = buf + 4;
+		if (!strncmp(path, "/page.html ", 11)) {
+			if (strstr(buf, "If-None-Match: \"page1\"")) {
+				/* slow, so that the test can drop the
+				   cache entry before the answer */
+				write(report, "r", 1);
+				usleep(100000);
+				r = sprintf(head, "HTTP/1.1 304 Not Modified\r\n"
+					"ETag: \"page1\"\r\n\r\n");
+				send_all(fd, head, r);
+				write(report, "3", 1);
+				len -= end - buf;
+				memmove(buf, end, len);
+				continue;
+			}
+			body = page;
+			body_len = page_len;
+			r = sprintf(head, "HTTP/1.1 200 OK\r\n"
+				"Content-Type: text/html\r\n"
+				"ETag: \"page1\"\r\n"
+				"Cache-Control: max-age=0\r\n"
+				"Content-Length: %d\r\n\r\n", body_len);
+		} else if (!strncmp(path, "/img", 4)) {
+			int i = atoi(path + 4);
+			if (i < 0 || i >= NB_IMAGES) i = 0;
+			body = images[i];
+			body_len = IMAGE_SIZE;
+			r = sprintf(head, "HTTP/1.1 200 OK\r\n"
+				"Content-Type: image/png\r\n"
+				"Cache-Control: max-age=3600\r\n"
+				"Content-Length: %d\r\n\r\n", body_len);
+		} else {
+			r = sprintf(head, "HTTP/1.1 404 Not Found\r\n"
+				"Content-Length: 0\r\n\r\n");
+		}
+		write(report, "r", 1);
+		send_all(fd, head, r);
+		/* the page goes in pieces, like from a real network */
+		while (body_len > 0) {
+			int l = body_len > 8192 ? 8192 : body_len;
+			send_all(fd, body, l);
+			body += l;
+			body_len -= l;
+			if (body_len > 0) usleep(1000);
+		}
+		len -= end - buf;
+		memmove(buf, end, len);
+	}
+}
+
+static void serve(int ls, int report)
+{
+	signal(SIGCHLD, SIG_IGN);
+	for (;;) {
+		int fd = accept(ls, NULL, NULL);
+		if (fd < 0) continue;
+		write(report, "c", 1);
+		if (fork() == 0) {
+			close(ls);
+			serve_connection(fd, report);
+			_exit(0);
+		}
+		close(fd);
+	}
+}
+
+static int same_file(const char *name, const char *data, int len)
+{
+	char *buf;
+	FILE *fp;
+	int r;
+
+	fp = fopen(name, "r");
+	if (!fp) return 0;
+	buf = (char*) malloc(len + 1);
+	r = fread(buf, 1, len + 1, fp);
+	fclose(fp);
+	r = (r == len && !memcmp(buf, data, len));
+	free(buf);
+	return r;
+}
+
+/*
+ *  Runs the event loop until the page and all its images are loaded.
+ */
+static int wait_loaded(Download *dl)
+{
+	double end = now() + 20.0;
+	int i;
+
+	while (now() < end) {
+		Fl::wait(0.01);
+		if (dl->nb_requests < NB_IMAGES + 1) continue;
+		for (i = 0; i < dl->nb_requests; i++) {
+			Xd6HtmlRequest *r = dl->requests[i];
+			if (r->status == DNL_STARTED || r->prefetch) break;
+		}
+		if (i == dl->nb_requests) return 0;
+	}
+	return -1;
+}
+
+/*
+ *  Checks the files of the page and of its images.
+ */
+static int check_files(Download *dl)
+{
+	int i, ret = 0;
+
+	if (dl->nb_requests != NB_IMAGES + 1 ||
+		!same_file(dl->requests[0]->file, page, page_len))
+	{
+		printf(_("FAILED: the page is not what was sent\n"));
+		ret = 1;
+	}
+	for (i = 1; i < dl->nb_requests; i++) {
+		Xd6HtmlRequest *r = dl->requests[i];
+		const char *n = strstr(r->href, "/img");
+		int k = n ? atoi(n + 4) : 0;
+		if (!n || k < 0 || k >= NB_IMAGES ||
+			!same_file(r->file, images[k], IMAGE_SIZE))
+		{
+			printf(_("FAILED: %s is not what was sent\n"), r->href);
+			ret = 1;
+		}
+	}
+	return ret;
+}
+
+/*
+ *  Adds what the server did since the last call to the counts.
+ */
+static void count_report(int report, int *conn, int *req, int *not_mod)
+{
+	char buf[256];
+	int r, i;
+
+	while ((r = read(report, buf, sizeof(buf))) > 0) {
+		for (i = 0; i < r; i++) {
+			if (buf[i] == 'c') (*conn)++;
+			else if (buf[i] == 'r') (*req)++;
+			else if (buf[i] == '3') (*not_mod)++;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static FixedPitch pitch;
+	struct sockaddr_in addr;
+	socklen_t alen = sizeof(addr);
+	char home[] = "/tmp/httptest-XXXXXX";
+	char base[256];
+	char buf[512];
+	int ls, report[2];
+	pid_t server;
+	Download *dl;
+	Xd6HtmlFrame *frame;
+	HttpCacheEntry *e;
+	int conn, req, not_mod, ret = 0;
+	double t;
+
+	make_bodies();
+
+	ls = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	if (ls < 0 || bind(ls, (struct sockaddr*) &addr, sizeof(addr)) ||
+		listen(ls, 16) || getsockname(ls, (struct sockaddr*) &addr, &alen))
+	{
+		perror("httptest");
+		return 1;
+	}
+	pipe(report);
+	server = fork();
+	if (server == 0) {
+		setpgid(0, 0);
+		close(report[0]);
+		serve(ls, report[1]);
+		_exit(0);
+	}
+	close(ls);
+	close(report[1]);
+	fcntl(report[0], F_SETFL, O_NONBLOCK);
+	snprintf(base, sizeof(base), "http://127.0.0.1:%d/",
+		ntohs(addr.sin_port));
+
+	if (!mkdtemp(home)) {
+		perror("httptest");
+		return 1;
+	}
+	setenv("HOME", home, 1);
+
+	fl = &pitch;
+	dl = new Download();
+	downloader = dl;
+	frame = new Xd6HtmlFrame(0);
+	frame->url = strdup(base);
+
+	conn = req = not_mod = 0;
+	t = now();
+	dl->request("page.html", "", NULL, frame);
+	if (wait_loaded(dl)) {
+		printf(_("FAILED: the page is not loaded after 20 s\n"));
+		ret = 1;
+	}
+	t = now() - t;
+	count_report(report[0], &conn, &req, &not_mod);
+	printf("first load  %.3f s, %d requests over %d connections\n",
+		t, req, conn);
+
+	ret |= check_files(dl);
+	if (conn < 1 || conn >= req) {
+		printf(_("FAILED: connections are not reused\n"));
+		ret = 1;
+	}
+
+	/* the page again after a restart : what was fetched in the first
+	   session is revalidated, the images are fresh for an hour */
+	delete(dl);
+	sleep(1);
+	dl = new Download();
+	downloader = dl;
+	conn = req = not_mod = 0;
+	t = now();
+	dl->request("page.html", "", NULL, frame);
+	if (wait_loaded(dl)) {
+		printf(_("FAILED: the page is not loaded again after 20 s\n"));
+		ret = 1;
+	}
+	t = now() - t;
+	count_report(report[0], &conn, &req, &not_mod);
+	printf("reload      %.3f s, %d requests over %d connections, "
+		"%d not modified\n", t, req, conn, not_mod);
+	ret |= check_files(dl);
+	if (not_mod != 1) {
+		printf(_("FAILED: the page is not taken from the cache\n"));
+		ret = 1;
+	}
+
+	/* once more, but the entry is dropped while the server is asked
+	   if the page changed : the 304 must not leave an empty page */
+	delete(dl);
+	sleep(1);
+	dl = new Download();
+	downloader = dl;
+	conn = req = not_mod = 0;
+	t = now();
+	dl->request("page.html", "", NULL, frame);
+	while (!req && now() < t + 20.0) {
+		Fl::wait(0.01);
+		count_report(report[0], &conn, &req, &not_mod);
+	}
+	snprintf(buf, sizeof(buf), "%spage.html", base);
+	e = dl->cache->find(buf);
+	if (e) dl->cache->remove(e);
+	if (wait_loaded(dl)) {
+		printf(_("FAILED: the page is not loaded again after 20 s\n"));
+		ret = 1;
+	}
+	t = now() - t;
+	count_report(report[0], &conn, &req, &not_mod);
+	printf("evicted     %.3f s, %d requests over %d connections, "
+		"%d not modified\n", t, req, conn, not_mod);
+	ret |= check_files(dl);
+	if (!e || not_mod != 1 || req != 2) {
+		printf(_("FAILED: the page is not asked again\n"));
+		ret = 1;
+	}
+
+	delete(frame);
+	delete(dl);
+	kill(-server, SIGTERM);
+	waitpid(server, NULL, 0);
+	snprintf(buf, sizeof(buf), "rm -rf %s", home);
+	system(buf);
+	return ret;
+}
@@ -0,0 +1,187 @@
+/*
+ *  flfm icon grid test.
+ *
+ *  usage: icongrid [number of layouts]
+ *
+ *  Lays out an IconGroup with random origins, cell and icon sizes and
+ *  numbers of files (200000 layouts by default) and checks the cells
+ *  that cell_range() gives for a random rectangle, and the file that
+ *  entry_at() finds under a random point, against a walk over every
+ *  cell. Then prints the time to find the cells of a rubber band over a
+ *  view of 100000 files both ways. Exits with 1 if a cell differs.
+ *
+ *  Nothing is drawn, no X display is needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <FL/Fl.H>
+#include <FL/x.H>
+#include "../flfm/IconCanvas.h"
+#include "../flfm/IconGroup.h"
+
+#define _(str) (str)
+
+#define MAX_FILES 60
+#define BIG_VIEW 100000
+
+/* defined by flfm's main.cpp */
+class GUI;
+class Xd6ConfigFile;
+class Xd6ConfigFileSection;
+GUI *gui;
+Xd6ConfigFile *cfg;
+Xd6ConfigFileSection *cfg_sec;
+Atom XdndActionAsk;
+Atom XdndActionMove;
+Atom XdndActionLink;
+Atom XdndActionCopy;
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ *  Returns 1 if the cell of file i touches the rectangle.
+ */
+static int in_rect(IconGroup *g, int i, int x0, int y0, int x1, int y1)
+{
+	int bx = g->ox + (i % g->cols) * g->cw;
+	int by = g->oy + (i / g->cols) * g->ch;
+
+	return bx + g->bw > x0 && bx < x1 && by + g->bh > y0 && by < y1;
+}
+
+static void random_layout(IconGroup *g, int nb)
+{
+	g->ox = rand() % 20;
+	g->oy = rand() % 40;
+	g->bw = 1 + rand() % 100;
+	g->bh = 1 + rand() % 60;
+	g->cw = g->bw + rand() % 20;
+	g->ch = g->bh + rand() % 20;
+	g->cols = 1 + rand() % 8;
+	g->nb_entries = nb;
+	g->rows = (nb + g->cols - 1) / g->cols;
+}
+
+/*
+ *  Returns the number of cells cell_range() and entry_at() get wrong
+ *  for a random rectangle and point.
+ */
+static int check_layout(IconGroup *g)
+{
+	char want[MAX_FILES], got[MAX_FILES];
+	int x0, y0, x1, y1, px, py;
+	int r0, r1, c0, c1, r, c, i, e;
+	int bad = 0;
+
+	g->position(rand() % 200, rand() % 200);
+	x0 = rand() % 900 - 100;
+	y0 = rand() % 900 - 100;
+	x1 = x0 + rand() % 400;
+	y1 = y0 + rand() % 400;
+	for (i = 0; i < g->nb_entries; i++) {
+		want[i] = in_rect(g, i, x0, y0, x1, y1);
+		got[i] = 0;
+	}
+	g->cell_range(x0, y0, x1, y1, &r0, &r1, &c0, &c1);
+	for (r = r0; r <= r1; r++) {
+		for (c = c0; c <= c1; c++) {
+			i = r * g->cols + c;
+			if (i >= g->nb_entries) break;
+			got[i] = 1;
+		}
+	}
+	for (i = 0; i < g->nb_entries; i++) {
+		if (want[i] != got[i]) bad++;
+	}
+
+	px = rand() % 900 - 100;
+	py = rand() % 900 - 100;
+	e = -1;
+	for (i = 0; i < g->nb_entries; i++) {
+		if (in_rect(g, i, px, py, px + 1, py + 1)) e = i;
+	}
+	if (e != g->entry_at(px + g->x(), py + g->y())) bad++;
+	return bad;
+}
+
+/*
+ *  A rubber band in the middle of a big view : the cells found by
+ *  cell_range() and by a walk over all the files must be the same.
+ */
+static int big_band(IconGroup *g)
+{
+	int x0, y0, x1, y1;
+	int r0, r1, c0, c1, r, c, i;
+	int n_range = 0, n_walk = 0;
+	double tr, tw;
+
+	g->ox = 8;
+	g->oy = 8;
+	g->bw = 90;
+	g->bh = 70;
+	g->cw = 100;
+	g->ch = 80;
+	g->cols = 8;
+	g->nb_entries = BIG_VIEW;
+	g->rows = (BIG_VIEW + g->cols - 1) / g->cols;
+	x0 = 150;
+	x1 = 560;
+	y0 = g->rows / 2 * g->ch;
+	y1 = y0 + 600;
+
+	tr = now();
+	g->cell_range(x0, y0, x1, y1, &r0, &r1, &c0, &c1);
+	for (r = r0; r <= r1; r++) {
+		for (c = c0; c <= c1; c++) {
+			i = r * g->cols + c;
+			if (i >= g->nb_entries) break;
+			n_range++;
+		}
+	}
+	tr = now() - tr;
+
+	tw = now();
+	for (i = 0; i < g->nb_entries; i++) {
+		if (in_rect(g, i, x0, y0, x1, y1)) n_walk++;
+	}
+	tw = now() - tw;
+	printf("band over  %d files, %d cells: cell_range %.1f us, "
+		"every cell %.1f us\n", BIG_VIEW, n_range, tr * 1e6, tw * 1e6);
+	return n_range != n_walk;
+}
+
+int main(int argc, char **argv)
+{
+	IconCanvas *canvas;
+	IconGroup *g;
+	int nb_layouts = 200000;
+	int i, bad = 0;
+
+	if (argc > 1) nb_layouts = atoi(argv[1]);
+	canvas = new IconCanvas(0, 0, 640, 480);
+	canvas->end();
+	canvas->nbf = MAX_FILES;
+	g = new IconGroup(0, 0, 640, 480, canvas);
+
+	srand(1);
+	for (i = 0; i < nb_layouts; i++) {
+		random_layout(g, rand() % MAX_FILES);
+		bad += check_layout(g);
+	}
+	printf("checked    %d layouts, %d cells wrong\n", nb_layouts, bad);
+	bad += big_band(g);
+
+	delete(g);
+	canvas->nbf = 0;
+	delete(canvas);
+	if (bad) printf(_("FAILED: the grid does not find the right cells\n"));
+	return bad != 0;
+}
@@ -0,0 +1,231 @@
+/*
+ *  Time to first paint benchmark.
+ *
+ *  usage: loadbench [megabytes]
+ *
+ *  Writes an XHTML document of the given size (50 MB by default) and
+ *  loads it in a frame as Xd6HtmlView::load() does : in one go, parsing
+ *  the whole file before converting and measuring it, and progressively,
+ *  64KB at a time through Xd6HtmlFrame::load_chunk() until the first
+ *  screen is laid out. Prints the time until a screen can be painted and
+ *  the time of the whole load for both. Exits with 1 if the two loads
+ *  do not give the same blocks.
+ *
+ *  The frame is not shown, so the text widths come from a fixed pitch
+ *  device instead of the X server and drawing is not timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <FL/Fl.h>
+#include <FL/Fl_Fltk.H>
+#include <xd640/Xd6HtmlFrame.h>
+#include <xd640/Xd6HtmlBlock.h>
+#include <xd640/Xd6HtmlSegment.h>
+#include <xd640/Xd6XmlParser.h>
+#include <xd640/Xd6XmlStyle.h>
+
+#define _(str) (str)
+
+#define LOAD_CHUNK (64 * 1024)
+#define SCREEN_W 640
+#define SCREEN_H 480
+
+class FixedPitch : public Fl_Fltk {
+public:
+	void font(int face, int size) { fl_font_ = face; fl_size_ = size; }
+	int height() { return fl_size_ + 2; }
+	int descent() { return fl_size_ / 4; }
+	double width(const char *s) { return width(s, strlen(s)); }
+	double width(const char *s, int n) { return n * fl_size_ * 0.55; }
+	double width(unsigned int) { return fl_size_ * 0.55; }
+};
+
+struct Digest {
+	int blocks;
+	long bytes;
+	unsigned long sum;
+	int height;
+};
+
+static const char *words[] = {
+	"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+	"caf\xc3\xa9", "&amp;", "lorem", "ipsum", "dolor", "sit", "amet"
+};
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static long make_document(const char *name, long size)
+{
+	FILE *fp;
+	long len = 0;
+	int n = 0;
+
+	fp = fopen(name, "w");
+	if (!fp) return -1;
+	srand(1);
+	len += fprintf(fp, "<html><head><title>bench</title></head><body>\n");
+	while (len < size) {
+		int i, nb = 20 + rand() % 200;
+		if (n % 7 == 0) {
+			len += fprintf(fp, "<h2>Section %d</h2>\n", n);
+		}
+		len += fprintf(fp, "<p>");
+		for (i = 0; i < nb; i++) {
+			const char *w = words[rand() %
+				(sizeof(words) / sizeof(*words))];
+			if (i % 37 == 36) {
+				len += fprintf(fp, "<b>%s</b> ", w);
+			} else {
+				len += fprintf(fp, "%s ", w);
+			}
+		}
+		len += fprintf(fp, "</p>\n");
+		n++;
+	}
+	len += fprintf(fp, "</body></html>\n");
+	fclose(fp);
+	return len;
+}
+
+static Xd6HtmlFrame *new_frame(void)
+{
+	Xd6HtmlFrame *frame;
+
+	frame = new Xd6HtmlFrame(0);
+	frame->page_width = 595 - 84 - 28;
+	frame->page_height = 842 - 56 - 56;
+	frame->resize(SCREEN_W, SCREEN_H);
+	frame->editor = 0;
+	while (frame->nb_blocks > 0) {
+		delete(frame->blocks[--frame->nb_blocks]);
+	}
+	Xd6XmlStyle::clean_tab();
+	Xd6HtmlFrame::rule_width = frame->page_width;
+	return frame;
+}
+
+static void digest(Xd6HtmlFrame *frame, Digest *d)
+{
+	int i, j, k;
+
+	memset(d, 0, sizeof(*d));
+	d->blocks = frame->nb_blocks;
+	d->height = frame->height;
+	for (i = 0; i < frame->nb_blocks; i++) {
+		Xd6HtmlBlock *b = frame->blocks[i];
+		for (j = 0; j < b->nb_segs; j++) {
+			Xd6HtmlSegment *s = b->segs[j];
+			d->bytes += s->len;
+			for (k = 0; k < s->len; k++) {
+				d->sum = d->sum * 31 + (unsigned char) s->text[k];
+			}
+		}
+	}
+}
+
+/*
+ *  The first screen can only be painted once everything is in.
+ */
+static double load_full(const char *name, double *first, Digest *d)
+{
+	Xd6HtmlFrame *frame;
+	Xd6XmlParser *parser;
+	double t;
+
+	frame = new_frame();
+	t = now();
+	parser = new Xd6XmlParser();
+	parser->parse_file(name);
+	frame->tab_stop = Xd6XmlStyle::get_tabs();
+	frame->tree2block(parser->tree->root);
+	frame->measure();
+	delete(parser);
+	t = now() - t;
+	*first = t;
+	digest(frame, d);
+	delete(frame);
+	return t;
+}
+
+/*
+ *  As Xd6HtmlView::load() and load_step() : chunks until the first screen
+ *  is full, then the rest as the idle callback would.
+ */
+static double load_progressive(const char *name, double *first, Digest *d)
+{
+	Xd6HtmlFrame *frame;
+	Xd6XmlParser *parser;
+	char *buf;
+	int fd, r;
+	double t;
+
+	frame = new_frame();
+	buf = (char*) malloc(LOAD_CHUNK);
+	t = now();
+	*first = -1;
+	parser = new Xd6XmlParser();
+	fd = open(name, O_RDONLY);
+	if (fd < 0) return -1;
+	frame->height = 0;
+	frame->load_start(parser->tree);
+	while ((r = read(fd, buf, LOAD_CHUNK)) > 0) {
+		frame->load_chunk(parser, buf, r);
+		if (*first < 0 && frame->height >= SCREEN_H) *first = now() - t;
+	}
+	close(fd);
+	frame->load_tree(parser->tree, 1);
+	frame->measure();
+	delete(parser);
+	t = now() - t;
+	if (*first < 0) *first = t;
+	free(buf);
+	digest(frame, d);
+	delete(frame);
+	return t;
+}
+
+int main(int argc, char **argv)
+{
+	static FixedPitch pitch;
+	char name[256];
+	long size = 50;
+	double mb, ff, tf, fp, tp;
+	Digest df, dp;
+	int ret = 0;
+
+	if (argc > 1) size = atol(argv[1]);
+	if (size < 1) size = 1;
+
+	snprintf(name, sizeof(name), "/tmp/loadbench-%d.html", getpid());
+	mb = make_document(name, size * 1024 * 1024) / (1024.0 * 1024.0);
+	if (mb < 0) {
+		fprintf(stderr, _("can't write %s\n"), name);
+		return 1;
+	}
+
+	fl = &pitch;
+	tf = load_full(name, &ff, &df);
+	tp = load_progressive(name, &fp, &dp);
+	unlink(name);
+
+	printf("%.1f MB, %d blocks, %d pixels high\n", mb, df.blocks, df.height);
+	printf("full:        first paint %8.3f s, loaded %8.3f s\n", ff, tf);
+	printf("progressive: first paint %8.3f s, loaded %8.3f s\n", fp, tp);
+
+	if (memcmp(&df, &dp, sizeof(df))) {
+		printf(_("FAILED: the blocks differ (%d and %d blocks)\n"),
+			df.blocks, dp.blocks);
+		ret = 1;
+	}
+	return ret;
+}
@@ -0,0 +1,161 @@
+/*
+ *  flmail message index test.
+ *
+ *  usage: mailindex [number of mails]
+ *
+ *  Adds mails (100000 by default) to a MailIndex in a temporary folder,
+ *  opens the folder again and walks all the records, as the message
+ *  list does, and prints the time of both. Then imports an index.txt
+ *  in the format of older flmail versions. Exits with 1 if a record
+ *  read back differs from what was added.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include "../flmail/MailIndex.h"
+
+#define _(str) (str)
+
+#define NB_IMPORT 1000
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void make_mail(int i, char *from, char *subject, char *file)
+{
+	sprintf(from, "Sender %d <user%d@example.org>", i % 977, i % 977);
+	sprintf(subject, "Re: message number %d about %s", i,
+		(i & 1) ? "caf\xc3\xa9" : "the weather");
+	sprintf(file, "mail.%d.html", i);
+}
+
+/*
+ *  Returns the number of records which are not the mails made up by
+ *  make_mail().
+ */
+static int check(MailIndex *idx, int nb)
+{
+	char from[128], subject[128], file[128];
+	int i, bad = 0;
+
+	if (idx->size() != nb) return nb;
+	for (i = 0; i < nb; i++) {
+		MailIndexRecord *r = idx->get(i);
+		make_mail(i, from, subject, file);
+		if (!r || strcmp(idx->string(r->from), from) ||
+			strcmp(idx->string(r->subject), subject) ||
+			strcmp(idx->string(r->file), file) ||
+			r->date != 1000000000LL + i || r->size != (unsigned) i ||
+			r->flags != (unsigned) (i % 3 ? 0 : MAIL_UNREAD) ||
+			r->id != (unsigned) i)
+		{
+			bad++;
+		}
+	}
+	return bad;
+}
+
+static int import(const char *dir)
+{
+	char path[1024];
+	MailIndex *idx;
+	FILE *fp;
+	int i, bad = 0;
+
+	snprintf(path, sizeof(path), "%s/index.txt", dir);
+	fp = fopen(path, "w");
+	if (!fp) return 1;
+	for (i = 0; i < NB_IMPORT; i++) {
+		fprintf(fp, "\v%c%s %d\f\vi%s %d\f%s\f\vC7mail.%d.html\n",
+			(i & 1) ? 'b' : 'r', "Subject", i, "Sender", i,
+			"Sun Sep  9 01:46:40 2001", i);
+	}
+	fclose(fp);
+
+	idx = new MailIndex(dir);
+	idx->import_txt(path);
+	if (idx->size() != NB_IMPORT) bad = NB_IMPORT;
+	for (i = 0; i < idx->size(); i++) {
+		MailIndexRecord *r = idx->get(i);
+		char s[64], f[64], m[64];
+		snprintf(s, sizeof(s), "Subject %d", i);
+		snprintf(f, sizeof(f), "Sender %d", i);
+		snprintf(m, sizeof(m), "mail.%d.html", i);
+		if (strcmp(idx->string(r->subject), s) ||
+			strcmp(idx->string(r->from), f) ||
+			strcmp(idx->string(r->file), m) ||
+			r->flags != (unsigned) ((i & 1) ? MAIL_UNREAD : 0) ||
+			r->date <= 0)
+		{
+			bad++;
+		}
+	}
+	delete(idx);
+	printf("import     %d mails from index.txt, %d wrong\n", NB_IMPORT, bad);
+	return bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/mailindex-XXXXXX";
+	char from[128], subject[128], file[128];
+	char buf[256];
+	MailIndex *idx;
+	int nb = 100000;
+	int i, bad, ret = 0;
+	double t;
+	long long sum = 0;
+
+	if (argc > 1) nb = atoi(argv[1]);
+	if (nb < 1) nb = 1;
+	if (!mkdtemp(dir)) {
+		perror("mailindex");
+		return 1;
+	}
+
+	idx = new MailIndex(dir);
+	t = now();
+	for (i = 0; i < nb; i++) {
+		make_mail(i, from, subject, file);
+		idx->add(from, subject, file, i, 1000000000 + i,
+			i % 3 ? 0 : MAIL_UNREAD, i);
+	}
+	t = now() - t;
+	printf("add        %d mails in %.3f s\n", nb, t);
+	delete(idx);
+
+	t = now();
+	idx = new MailIndex(dir);
+	for (i = 0; i < idx->size(); i++) {
+		MailIndexRecord *r = idx->get(i);
+		sum += r->date + strlen(idx->string(r->subject));
+	}
+	t = now() - t;
+	printf("open, walk %d mails in %.3f s (%lld)\n", idx->size(), t, sum);
+
+	bad = check(idx, nb);
+	if (bad) {
+		printf(_("FAILED: %d mails read back wrong\n"), bad);
+		ret = 1;
+	}
+	delete(idx);
+
+	snprintf(buf, sizeof(buf), "%s/import", dir);
+	mkdir(buf, 0700);
+	if (import(buf)) {
+		printf(_("FAILED: index.txt is not imported\n"));
+		ret = 1;
+	}
+
+	snprintf(buf, sizeof(buf), "rm -rf %s", dir);
+	system(buf);
+	return ret;
+}
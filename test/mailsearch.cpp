@@ -0,0 +1,212 @@
+/*
+ *  flmail full text search test.
+ *
+ *  usage: mailsearch [number of mails] [words per mail]
+ *
+ *  Indexes made up mails (5000 of 200 words by default) with MailSearch
+ *  in a temporary folder, flushing a segment every twentieth of them so
+ *  that the segments get merged, then opens the index again and prints
+ *  the time of some queries. Phrase and prefix queries are checked
+ *  against a scan of the words of the mails. Exits with 1 if a query
+ *  does not find the mails the scan finds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "../flmail/MailSearch.h"
+
+#define _(str) (str)
+
+#define NB_VOCAB 2000
+#define NB_SUBJECT 3
+#define NB_TRIALS 200
+
+static char *vocab[NB_VOCAB];
+static char *folded[NB_VOCAB];
+
+static const char *queries[] = {
+	"w5x", "w6xc", "\"w1xb w2xc\"", "subject:w7xd", "w7xd w3xd", "w12*",
+	"from:bob", "\xc3\xa4rger", "body:w1xb w900xb", "zzz", "", " , "
+};
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void make_vocab(void)
+{
+	char buf[32];
+	int i;
+
+	for (i = 0; i < NB_VOCAB; i++) {
+		char *p;
+		snprintf(buf, sizeof(buf), "W%dx%c", i, "aBcD"[i % 4]);
+		vocab[i] = strdup(buf);
+		for (p = buf; *p; p++) {
+			if (*p >= 'A' && *p <= 'Z') *p += 'a' - 'A';
+		}
+		folded[i] = strdup(buf);
+	}
+	free(vocab[5]);
+	free(folded[5]);
+	vocab[5] = strdup("\xc3\x84rger");
+	folded[5] = strdup("\xc3\xa4rger");
+}
+
+/*
+ *  The words of mail d as they were indexed : the subject, the three
+ *  words of the sender and the body. The sender words are -1.
+ */
+static int mail_words(int *subj, int *body, int nb_words, int d, int *all)
+{
+	int i, n = 0;
+
+	for (i = 0; i < NB_SUBJECT; i++) all[n++] = subj[d * NB_SUBJECT + i];
+	for (i = 0; i < 3; i++) all[n++] = -1;
+	for (i = 0; i < nb_words; i++) all[n++] = body[d * nb_words + i];
+	return n;
+}
+
+static int same_docs(const int *a, int na, const int *b, int nb)
+{
+	return na == nb && (!na || !memcmp(a, b, na * sizeof(int)));
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/mailsearch-XXXXXX";
+	char q[256];
+	MailSearch *s;
+	int nb_mails = 5000;
+	int nb_words = 200;
+	int *subj, *body, *all, *want, *r;
+	char *text;
+	double t;
+	long bytes = 0;
+	int d, i, k, n, nw, bad = 0;
+
+	if (argc > 1) nb_mails = atoi(argv[1]);
+	if (argc > 2) nb_words = atoi(argv[2]);
+	if (nb_mails < 20) nb_mails = 20;
+	if (nb_words < 2) nb_words = 2;
+	if (!mkdtemp(dir)) {
+		perror("mailsearch");
+		return 1;
+	}
+	make_vocab();
+	subj = (int*) malloc(sizeof(int) * nb_mails * NB_SUBJECT);
+	body = (int*) malloc(sizeof(int) * nb_mails * nb_words);
+	all = (int*) malloc(sizeof(int) * (nb_words + NB_SUBJECT + 3));
+	want = (int*) malloc(sizeof(int) * nb_mails);
+	text = (char*) malloc(nb_words * 32 + 1);
+
+	srand(1);
+	s = new MailSearch(dir, 0);
+	t = now();
+	for (d = 0; d < nb_mails; d++) {
+		s->begin(d);
+		n = 0;
+		for (i = 0; i < NB_SUBJECT; i++) {
+			subj[d * NB_SUBJECT + i] = rand() % NB_VOCAB;
+			n += sprintf(text + n, "%s ", vocab[subj[d * NB_SUBJECT + i]]);
+		}
+		s->start_field(SEARCH_SUBJECT);
+		s->add_text(text, n, 0);
+		s->start_field(SEARCH_FROM);
+		s->add_text("bob@example.com", 15, 0);
+		s->start_field(SEARCH_BODY);
+		n = 0;
+		for (i = 0; i < nb_words; i++) {
+			/* a few words are much more frequent than the others */
+			double u = (double) rand() / RAND_MAX;
+			k = (int) (NB_VOCAB * u * u * u);
+			if (k >= NB_VOCAB) k = NB_VOCAB - 1;
+			body[d * nb_words + i] = k;
+			n += sprintf(text + n, "%s%s", vocab[k],
+				i % 10 == 9 ? ",\n" : " ");
+		}
+		bytes += n;
+		/* words split across pieces of text */
+		for (i = 0; i < n; i += 777) {
+			s->add_text(text + i, n - i < 777 ? n - i : 777, 0);
+		}
+		s->end();
+		if (d % (nb_mails / 20) == nb_mails / 20 - 1) s->flush();
+	}
+	s->flush();
+	t = now() - t;
+	printf("index      %d mails, %.1f MB in %.3f s, %d segments\n",
+		nb_mails, bytes / 1e6, t, s->nb_segs);
+	delete(s);
+
+	t = now();
+	s = new MailSearch(dir, nb_mails);
+	printf("open       %.3f ms\n", (now() - t) * 1000.0);
+	for (i = 0; i < (int) (sizeof(queries) / sizeof(*queries)); i++) {
+		t = now();
+		n = s->query(queries[i], &r);
+		t = now() - t;
+		printf("%-22s %6d mails %8.3f ms\n", queries[i], n, t * 1000.0);
+		free(r);
+	}
+
+	for (i = 0; i < NB_TRIALS; i++) {
+		int a = rand() % 50;
+		int b = rand() % 50;
+		char prefix[4];
+
+		/* a phrase of two frequent words */
+		snprintf(q, sizeof(q), "\"%s %s\"", folded[a], folded[b]);
+		n = s->query(q, &r);
+		nw = 0;
+		for (d = 0; d < nb_mails; d++) {
+			int len = mail_words(subj, body, nb_words, d, all);
+			for (k = 0; k + 1 < len; k++) {
+				if (all[k] == a && all[k + 1] == b) break;
+			}
+			if (k + 1 < len) want[nw++] = d;
+		}
+		if (!same_docs(r, n, want, nw)) {
+			printf(_("FAILED: %s finds %d mails instead of %d\n"),
+				q, n, nw);
+			bad++;
+		}
+		free(r);
+
+		/* the subjects with a word starting like a */
+		snprintf(prefix, sizeof(prefix), "%s", folded[a]);
+		snprintf(q, sizeof(q), "subject:%s*", prefix);
+		n = s->query(q, &r);
+		nw = 0;
+		for (d = 0; d < nb_mails; d++) {
+			for (k = 0; k < NB_SUBJECT; k++) {
+				if (!strncmp(folded[subj[d * NB_SUBJECT + k]],
+					prefix, strlen(prefix))) break;
+			}
+			if (k < NB_SUBJECT) want[nw++] = d;
+		}
+		if (!same_docs(r, n, want, nw)) {
+			printf(_("FAILED: %s finds %d mails instead of %d\n"),
+				q, n, nw);
+			bad++;
+		}
+		free(r);
+	}
+	printf("checked    %d phrase and prefix queries, %d wrong\n",
+		NB_TRIALS * 2, bad);
+	delete(s);
+
+	snprintf(q, sizeof(q), "rm -rf %s", dir);
+	system(q);
+	free(subj);
+	free(body);
+	free(all);
+	free(want);
+	free(text);
+	return bad != 0;
+}
@@ -0,0 +1,191 @@
+/*
+ *  Parser throughput benchmark.
+ *
+ *  usage: parsebench [megabytes] [minimum MB/s]
+ *
+ *  Writes an XHTML document of the given size (8 MB by default) and
+ *  parses it with Xd6XmlParser::parse_file() and with the old loop that
+ *  feeds parse_string() 1023 bytes at a time. Both trees must be the
+ *  same. Exits with 1 if they differ or if parse_file() is slower than
+ *  the minimum.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <xd640/Xd6XmlParser.h>
+
+#define _(str) (str)
+
+static const char *words[] = {
+	"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+	"caf\xc3\xa9", "na\xc3\xafve", "&amp;", "&lt;tag&gt;", "&#233;",
+	"lorem", "ipsum", "dolor", "sit", "amet", "consectetur"
+};
+
+struct Digest {
+	long elements;
+	long texts;
+	long bytes;
+	unsigned long sum;
+};
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static long make_document(const char *name, long size)
+{
+	FILE *fp;
+	long len = 0;
+	int n = 0;
+
+	fp = fopen(name, "w");
+	if (!fp) return -1;
+	srand(1);
+	len += fprintf(fp, "<html><head><title>bench</title></head><body>\n");
+	while (len < size) {
+		int i, nb = 20 + rand() % 200;
+		if (n % 7 == 0) {
+			len += fprintf(fp, "<h2 class=\"t%d\">Section %d</h2>\n",
+				n % 5, n);
+		}
+		len += fprintf(fp, "<p>");
+		for (i = 0; i < nb; i++) {
+			const char *w = words[rand() %
+				(sizeof(words) / sizeof(*words))];
+			if (i % 37 == 36) {
+				len += fprintf(fp, "<b>%s</b> ", w);
+			} else if (i % 53 == 52) {
+				len += fprintf(fp,
+					"<a href=\"page%d.html\">%s</a> ", i, w);
+			} else {
+				len += fprintf(fp, "%s ", w);
+			}
+		}
+		len += fprintf(fp, "</p>\n");
+		n++;
+	}
+	len += fprintf(fp, "</body></html>\n");
+	fclose(fp);
+	return len;
+}
+
+static void digest(Xd6XmlTreeElement *e, Digest *d)
+{
+	int i;
+
+	d->elements++;
+	for (i = 0; i < e->name_len; i++) d->sum = d->sum * 31 + e->name[i];
+	for (i = 0; i < e->nb_children; i++) {
+		Xd6XmlTreeSegment *s = e->children[i];
+		if (s->type & Xd6XmlTreeSegment_element) {
+			digest((Xd6XmlTreeElement*) s, d);
+		} else {
+			Xd6XmlTreeText *t = (Xd6XmlTreeText*) s;
+			int j;
+			d->texts++;
+			d->sum = d->sum * 31 + s->type;
+			if (s->type != Xd6XmlTreeSegment_text) continue;
+			d->bytes += t->len;
+			for (j = 0; j < t->len; j++) {
+				d->sum = d->sum * 31 + (unsigned char) t->data[j];
+			}
+		}
+	}
+}
+
+static double parse_mapped(const char *name, Digest *d)
+{
+	Xd6XmlParser *parser;
+	double t;
+
+	parser = new Xd6XmlParser();
+	t = now();
+	parser->parse_file(name);
+	t = now() - t;
+	memset(d, 0, sizeof(*d));
+	digest(parser->tree->root, d);
+	delete(parser);
+	return t;
+}
+
+static double parse_chunks(const char *name, Digest *d)
+{
+	Xd6XmlParser *parser;
+	char buf[1024];
+	int fd, read_len;
+	double t;
+
+	parser = new Xd6XmlParser();
+	t = now();
+	fd = open(name, O_RDONLY);
+	if (fd < 0) return -1;
+	read_len = read(fd, buf, 1023);
+	while (read_len > 0) {
+		buf[read_len] = '\0';
+		parser->parse_string(buf, read_len);
+		read_len = read(fd, buf, 1023);
+	}
+	close(fd);
+	t = now() - t;
+	memset(d, 0, sizeof(*d));
+	digest(parser->tree->root, d);
+	delete(parser);
+	return t;
+}
+
+int main(int argc, char **argv)
+{
+	char name[256];
+	long size = 8;
+	double min = 0;
+	double tm, tc, mb;
+	Digest dm, dc;
+	int i, ret = 0;
+
+	if (argc > 1) size = atol(argv[1]);
+	if (argc > 2) min = atof(argv[2]);
+	if (size < 1) size = 1;
+
+	snprintf(name, sizeof(name), "/tmp/parsebench-%d.html", getpid());
+	mb = make_document(name, size * 1024 * 1024) / (1024.0 * 1024.0);
+	if (mb < 0) {
+		fprintf(stderr, _("can't write %s\n"), name);
+		return 1;
+	}
+
+	/* first run to get the file in the page cache and grow the heap */
+	parse_mapped(name, &dm);
+
+	/* best of three, alternating so neither path gets a warmer heap */
+	tm = tc = 1e9;
+	for (i = 0; i < 3; i++) {
+		double t = parse_mapped(name, &dm);
+		if (t < tm) tm = t;
+		t = parse_chunks(name, &dc);
+		if (t < tc) tc = t;
+	}
+	unlink(name);
+
+	printf("%.1f MB, %ld elements, %ld text segments\n",
+		mb, dm.elements, dm.texts);
+	printf("parse_file:        %8.3f s %8.1f MB/s\n", tm, mb / tm);
+	printf("parse_string 1023: %8.3f s %8.1f MB/s\n", tc, mb / tc);
+
+	if (memcmp(&dm, &dc, sizeof(dm))) {
+		printf(_("FAILED: the trees differ\n"));
+		ret = 1;
+	}
+	if (min > 0 && mb / tm < min) {
+		printf(_("FAILED: parse_file is under %.1f MB/s\n"), min);
+		ret = 1;
+	}
+	return ret;
+}
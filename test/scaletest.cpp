@@ -0,0 +1,281 @@
+/*
+ *  Image scaler benchmark and quality test.
+ *
+ *  usage: scaletest [-w] [golden file]
+ *
+ *  Scales made up RGB images with Xd6ScaleImage() and with the nearest
+ *  neighbour Fl_RGB_Image::copy() and prints the megapixels per second
+ *  of both. The quality check compares the results with a floating
+ *  point area average (shrinking) or bilinear interpolation (enlarging)
+ *  and with the golden file, scalegold.ppm by default : a shrunk and an
+ *  enlarged image stacked in one binary PPM. -w writes the golden file
+ *  instead of reading it. Exits with 1 if a pixel is more than 1 off
+ *  the floating point result or differs from the golden file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <FL/Fl.h>
+#include <FL/Fl_Image.h>
+#include <xd640/Xd6ImageScale.h>
+
+#define _(str) (str)
+
+#define GOLD_W 80
+#define GOLD_H 50
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ *  A ramp, a fine checker board and a high frequency pattern.
+ */
+static unsigned char *make_image(int w, int h)
+{
+	unsigned char *a;
+	int x, y;
+
+	a = new unsigned char[w * h * 3];
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			unsigned char *p = a + (y * w + x) * 3;
+			p[0] = (unsigned char) (w > 1 ? x * 255 / (w - 1) : 0);
+			p[1] = ((x / 3 + y / 3) & 1) ? 230 : 20;
+			p[2] = (unsigned char) ((x * x + y * y * 3) & 255);
+		}
+	}
+	return a;
+}
+
+/*
+ *  Floating point weights of the n source pixels for the m destination
+ *  pixels of an axis, m * n values.
+ */
+static double *axis_weights(int n, int m)
+{
+	double *w;
+	int i, j;
+
+	w = (double*) calloc(m * n, sizeof(double));
+	for (i = 0; i < m; i++) {
+		if (m < n) {
+			double start = (double) i * n / m;
+			double end = (double) (i + 1) * n / m;
+			for (j = (int) start; j < n && j < end; j++) {
+				double s = j > start ? j : start;
+				double e = j + 1 < end ? j + 1 : end;
+				if (e > s) w[i * n + j] = (e - s) * m / n;
+			}
+		} else {
+			double fx = ((2.0 * i + 1) * n - m) / (2.0 * m);
+			int f;
+			if (fx < 0) fx = 0;
+			f = (int) fx;
+			if (f >= n - 1) {
+				w[i * n + n - 1] = 1.0;
+			} else {
+				w[i * n + f] = 1.0 - (fx - f);
+				w[i * n + f + 1] = fx - f;
+			}
+		}
+	}
+	return w;
+}
+
+/*
+ *  Largest and mean distance of img to the floating point result.
+ */
+static void compare_float(const unsigned char *src, int sw, int sh,
+	const unsigned char *img, int dw, int dh, int *max, double *mean)
+{
+	double *wx, *wy;
+	double sum = 0;
+	int x, y, c, i, j;
+
+	wx = axis_weights(sw, dw);
+	wy = axis_weights(sh, dh);
+	*max = 0;
+	for (y = 0; y < dh; y++) {
+		for (x = 0; x < dw; x++) {
+			for (c = 0; c < 3; c++) {
+				double v = 0;
+				int d;
+				for (j = 0; j < sh; j++) {
+					double r = 0;
+					if (wy[y * sh + j] == 0) continue;
+					for (i = 0; i < sw; i++) {
+						if (wx[x * sw + i] == 0) continue;
+						r += wx[x * sw + i] *
+							src[(j * sw + i) * 3 + c];
+					}
+					v += wy[y * sh + j] * r;
+				}
+				d = abs(img[(y * dw + x) * 3 + c] - (int) floor(v + 0.5));
+				if (d > *max) *max = d;
+				sum += d;
+			}
+		}
+	}
+	*mean = sum / (dw * dh * 3);
+	free(wx);
+	free(wy);
+}
+
+static const unsigned char *pixels(Fl_Image *img)
+{
+	return (const unsigned char*) img->data()[0];
+}
+
+/*
+ *  Scales a sw x sh image to dw x dh with both scalers, prints their
+ *  speed and their distance to the floating point result. Returns 1 if
+ *  Xd6ScaleImage() is more than 1 off.
+ */
+static int bench(int sw, int sh, int dw, int dh, int check)
+{
+	Fl_RGB_Image *src;
+	Fl_Image *img;
+	unsigned char *a;
+	double ts, tn, mpix;
+	int i, nb, max_s = 0, max_n = 0;
+	double mean_s = 0, mean_n = 0;
+
+	a = make_image(sw, sh);
+	src = new Fl_RGB_Image(a, sw, sh, 3);
+	src->alloc_array = 1;
+	nb = (int) (200e6 / ((double) sw * sh + (double) dw * dh)) + 1;
+	mpix = (dw > sw ? (double) dw * dh : (double) sw * sh) / 1e6;
+
+	ts = tn = 1e9;
+	for (i = 0; i < 3; i++) {
+		double t = now();
+		int k;
+		for (k = 0; k < nb; k++) delete(Xd6ScaleImage(src, dw, dh));
+		t = (now() - t) / nb;
+		if (t < ts) ts = t;
+		t = now();
+		for (k = 0; k < nb; k++) delete(src->copy(dw, dh));
+		t = (now() - t) / nb;
+		if (t < tn) tn = t;
+	}
+	if (check) {
+		img = Xd6ScaleImage(src, dw, dh);
+		compare_float(a, sw, sh, pixels(img), dw, dh, &max_s, &mean_s);
+		delete(img);
+		img = src->copy(dw, dh);
+		compare_float(a, sw, sh, pixels(img), dw, dh, &max_n, &mean_n);
+		delete(img);
+	}
+	printf("%4dx%-4d -> %4dx%-4d  scaler %7.1f Mpix/s  nearest %7.1f Mpix/s",
+		sw, sh, dw, dh, mpix / ts, mpix / tn);
+	if (check) {
+		printf("  error max %d mean %.2f, nearest max %d mean %.2f",
+			max_s, mean_s, max_n, mean_n);
+	}
+	printf("\n");
+	delete(src);
+	if (max_s > 1) {
+		printf(_("FAILED: %dx%d to %dx%d is %d off\n"),
+			sw, sh, dw, dh, max_s);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ *  The golden image : a 256x160 image shrunk to GOLD_W x GOLD_H above
+ *  a 16x10 one enlarged to the same size.
+ */
+static unsigned char *make_golden(void)
+{
+	Fl_RGB_Image *src;
+	Fl_Image *img;
+	unsigned char *g;
+	int half = GOLD_W * GOLD_H * 3;
+
+	g = (unsigned char*) malloc(half * 2);
+	src = new Fl_RGB_Image(make_image(256, 160), 256, 160, 3);
+	src->alloc_array = 1;
+	img = Xd6ScaleImage(src, GOLD_W, GOLD_H);
+	memcpy(g, pixels(img), half);
+	delete(img);
+	delete(src);
+	src = new Fl_RGB_Image(make_image(16, 10), 16, 10, 3);
+	src->alloc_array = 1;
+	img = Xd6ScaleImage(src, GOLD_W, GOLD_H);
+	memcpy(g + half, pixels(img), half);
+	delete(img);
+	delete(src);
+	return g;
+}
+
+static int golden(const char *name, int write)
+{
+	unsigned char *g, *f;
+	FILE *fp;
+	int len = GOLD_W * GOLD_H * 3 * 2;
+	int w, h, m, i, nb = 0;
+
+	g = make_golden();
+	if (write) {
+		fp = fopen(name, "wb");
+		if (!fp) {
+			fprintf(stderr, _("can't write %s\n"), name);
+			return 1;
+		}
+		fprintf(fp, "P6\n%d %d\n255\n", GOLD_W, GOLD_H * 2);
+		fwrite(g, 1, len, fp);
+		fclose(fp);
+		free(g);
+		return 0;
+	}
+	fp = fopen(name, "rb");
+	if (!fp || fscanf(fp, "P6 %d %d %d", &w, &h, &m) != 3 ||
+		w != GOLD_W || h != GOLD_H * 2 || m != 255)
+	{
+		fprintf(stderr, _("can't read %s\n"), name);
+		if (fp) fclose(fp);
+		free(g);
+		return 1;
+	}
+	fgetc(fp);
+	f = (unsigned char*) malloc(len);
+	if ((int) fread(f, 1, len, fp) != len) memset(f, 0, len);
+	fclose(fp);
+	for (i = 0; i < len; i++) if (f[i] != g[i]) nb++;
+	printf("golden     %d bytes differ from %s\n", nb, name);
+	free(f);
+	free(g);
+	if (nb) printf(_("FAILED: the scaled images changed\n"));
+	return nb != 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *name = "scalegold.ppm";
+	int write = 0;
+	int i, ret = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-w")) write = 1;
+		else name = argv[i];
+	}
+	if (write) return golden(name, 1);
+
+	ret |= bench(256, 160, 80, 50, 1);
+	ret |= bench(97, 61, 40, 25, 1);
+	ret |= bench(16, 10, 80, 50, 1);
+	ret |= bench(64, 48, 64, 48, 1);
+	ret |= bench(3000, 2000, 640, 427, 0);
+	ret |= bench(3000, 2000, 1500, 1000, 0);
+	ret |= bench(640, 480, 2560, 1920, 0);
+	ret |= golden(name, 0);
+	return ret;
+}
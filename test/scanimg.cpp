@@ -0,0 +1,160 @@
+/*
+ *  Image scanning test.
+ *
+ *  usage: scanimg [html file]
+ *
+ *  Feeds a page to Xd6XmlParser::scan_string() in pieces of 1, 3, 7 and
+ *  64 bytes and in one piece, as flspider does while the page body
+ *  downloads, and lists the <img src> found by the open callback. Every
+ *  split must find the same images, and those of the made up page when
+ *  no file is given. Exits with 1 if a list differs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xd640/Xd6Std.h>
+#include <xd640/Xd6XmlParser.h>
+#include <xd640/Xd6XmlTree.h>
+#include <xd640/Xd6XmlStyle.h>
+
+#define _(str) (str)
+
+#define NB_IMAGES 200
+
+struct Found {
+	char **src;
+	int nb;
+};
+
+static const int pieces[] = { 1, 3, 7, 64, 0 };
+
+static void found_img(Xd6XmlTreeElement *e, void *d)
+{
+	Found *f = (Found*) d;
+	const char *s;
+
+	if (e->display != DISPLAY_IMG) return;
+	s = e->get_attr_value("src");
+	if (!s) return;
+	f->src = (char**) realloc(f->src, sizeof(char*) * (f->nb + 1));
+	f->src[f->nb++] = strdup(s);
+}
+
+static void drop(Xd6XmlTreeElement *, void *)
+{
+}
+
+/*
+ *  A page with images in all the places a split can fall : between
+ *  attributes, in a quoted value, next to comments and entities.
+ */
+static int make_page(char *page, Found *want)
+{
+	int i, n = 0;
+
+	n += sprintf(page + n, "<html><head><title>scan &amp; test</title>"
+		"</head>\n<body>\n<!-- <img src=\"no.png\"> -->\n");
+	for (i = 0; i < NB_IMAGES; i++) {
+		char src[64];
+		snprintf(src, sizeof(src), "images/picture-%d.png", i);
+		switch (i % 4) {
+		case 0:
+			n += sprintf(page + n, "<p>text &lt;%d&gt; <img src=\"%s\"/>"
+				"</p>\n", i, src);
+			break;
+		case 1:
+			n += sprintf(page + n, "<IMG\n  width=\"%d\"\n  src='%s'"
+				"  alt=\"a &quot;b&quot;\" >\n", i, src);
+			break;
+		case 2:
+			n += sprintf(page + n, "<div><b>bold</b><img alt=\"\" "
+				"src=\"%s\" height=\"1\" /></div>\n", src);
+			break;
+		default:
+			n += sprintf(page + n, "<table><tr><td><img src=\"%s\">"
+				"</td></tr></table>\n", src);
+			break;
+		}
+		want->src = (char**) realloc(want->src,
+			sizeof(char*) * (want->nb + 1));
+		want->src[want->nb++] = strdup(src);
+	}
+	n += sprintf(page + n, "</body></html>\n");
+	return n;
+}
+
+static void scan(const char *page, int len, int piece, Found *f)
+{
+	Xd6XmlParser *p;
+	int i;
+
+	if (piece <= 0) piece = len;
+	p = new Xd6XmlParser();
+	p->tree->open_callback = found_img;
+	p->tree->open_data = f;
+	for (i = 0; i < len; i += piece) {
+		p->scan_string(page + i, len - i < piece ? len - i : piece,
+			drop, NULL);
+	}
+	delete(p);
+}
+
+static int same(Found *a, Found *b)
+{
+	int i;
+
+	if (a->nb != b->nb) return 0;
+	for (i = 0; i < a->nb; i++) {
+		if (strcmp(a->src[i], b->src[i])) return 0;
+	}
+	return 1;
+}
+
+static void clear(Found *f)
+{
+	while (f->nb > 0) free(f->src[--f->nb]);
+	free(f->src);
+	f->src = NULL;
+}
+
+int main(int argc, char **argv)
+{
+	Found want, got;
+	char *page;
+	int i, len, ret = 0;
+
+	memset(&want, 0, sizeof(want));
+	memset(&got, 0, sizeof(got));
+	if (argc > 1) {
+		FILE *fp = fopen(argv[1], "rb");
+		if (!fp) {
+			fprintf(stderr, _("can't read %s\n"), argv[1]);
+			return 1;
+		}
+		fseek(fp, 0, SEEK_END);
+		len = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		page = (char*) malloc(len + 1);
+		len = fread(page, 1, len, fp);
+		fclose(fp);
+		scan(page, len, 0, &want);
+	} else {
+		page = (char*) malloc(NB_IMAGES * 256 + 256);
+		len = make_page(page, &want);
+	}
+
+	for (i = 0; i < (int) (sizeof(pieces) / sizeof(*pieces)); i++) {
+		scan(page, len, pieces[i], &got);
+		printf("pieces of %5d bytes: %d images\n",
+			pieces[i] ? pieces[i] : len, got.nb);
+		if (!same(&want, &got)) {
+			printf(_("FAILED: the images differ\n"));
+			ret = 1;
+		}
+		clear(&got);
+	}
+	clear(&want);
+	free(page);
+	return ret;
+}
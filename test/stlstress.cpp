@@ -0,0 +1,97 @@
+/*
+ *  Style interning stress test.
+ *
+ *  usage: stlstress [number of styles]
+ *
+ *  Interns distinct styles (two millions by default) under a few hundred
+ *  owners, looks each one up again and prints the lookups per second
+ *  and the load factor of the style table. Exits with 1 if a lookup
+ *  does not return the style that was interned or if the table is not
+ *  empty once the styles are destroyed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <xd640/Xd6XmlStyle.h>
+
+#define _(str) (str)
+
+#define NB_OWNERS 256
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void make_style(Xd6XmlStl *p, int i)
+{
+	p->copy(&Xd6XmlStl::def);
+	p->font_size = i % 7;
+	p->font_bold = (i >> 3) & 1;
+	p->font_italic = (i >> 4) & 1;
+	p->fg_color = i / NB_OWNERS;
+}
+
+static void print_table(const char *when)
+{
+	unsigned int nb, size;
+
+	Xd6XmlStl::table_stats(&nb, &size);
+	printf("%-10s %9u styles, table of %9u, load factor %.2f\n",
+		when, nb, size, size ? (double) nb / size : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+	Xd6XmlStl *root;
+	Xd6XmlStl *owners[NB_OWNERS];
+	Xd6XmlStl **styles;
+	Xd6XmlStl p;
+	unsigned int nb, size;
+	int nb_styles = 2000000;
+	int i, bad = 0;
+	double t;
+
+	if (argc > 1) nb_styles = atoi(argv[1]);
+	if (nb_styles < NB_OWNERS) nb_styles = NB_OWNERS;
+	styles = (Xd6XmlStl**) malloc(sizeof(Xd6XmlStl*) * nb_styles);
+
+	root = new Xd6XmlStl();
+	for (i = 0; i < NB_OWNERS; i++) {
+		p.copy(root);
+		p.font = i;
+		owners[i] = root->get_style(&p);
+	}
+
+	t = now();
+	for (i = 0; i < nb_styles; i++) {
+		make_style(&p, i);
+		styles[i] = owners[i % NB_OWNERS]->get_style(&p);
+	}
+	t = now() - t;
+	printf("insert     %9d styles in %.3f s, %.0f/s\n",
+		nb_styles, t, nb_styles / t);
+	print_table(_("inserted"));
+
+	t = now();
+	for (i = 0; i < nb_styles; i++) {
+		int k = (int) (((unsigned int) i * 2654435761U) % nb_styles);
+		make_style(&p, k);
+		if (owners[k % NB_OWNERS]->get_style(&p) != styles[k]) bad++;
+	}
+	t = now() - t;
+	printf("lookup     %9d styles in %.3f s, %.0f/s\n",
+		nb_styles, t, nb_styles / t);
+
+	delete(root);
+	print_table(_("destroyed"));
+	Xd6XmlStl::table_stats(&nb, &size);
+	free(styles);
+
+	if (bad) printf(_("FAILED: %d lookups missed\n"), bad);
+	if (nb) printf(_("FAILED: %u styles left in the table\n"), nb);
+	return bad || nb;
+}
@@ -0,0 +1,447 @@
+/*
+ *  flfm thumbnailer test.
+ *
+ *  usage: thumbs [number of images]
+ *
+ *  Writes GIF images (400 by default, plus a few special ones :
+ *  interlaced, transparent, a frame smaller than the screen, a cut and
+ *  a broken file) in a temporary home and makes their thumbnails with
+ *  the Thumbnailer workers, as flfm does. The icons must have the
+ *  colors the images were made of. Prints the time of the first pass
+ *  and of a second one reading the cache. The failure marks of a
+ *  made up old cache must be trimmed. Exits with 1 if an icon is wrong
+ *  or the old marks stay.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <FL/Fl.H>
+#include <FL/Fl_Image.H>
+#include "../flfm/Thumbnailer.h"
+
+#define _(str) (str)
+
+#define BLOCK_SIZE 128
+#define NB_OLD_MARKS 2000
+#define NB_NEW_MARKS 8000
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ *  LZW codes packed in data sub-blocks.
+ */
+struct gif_writer {
+	FILE *fp;
+	unsigned char block[255];
+	int nb;
+	unsigned long acc;
+	int bits;
+};
+
+static void put_code(struct gif_writer *g, int code, int size)
+{
+	g->acc |= (unsigned long) code << g->bits;
+	g->bits += size;
+	while (g->bits >= 8) {
+		g->block[g->nb++] = (unsigned char) (g->acc & 255);
+		g->acc >>= 8;
+		g->bits -= 8;
+		if (g->nb == 255) {
+			fputc(255, g->fp);
+			fwrite(g->block, 1, 255, g->fp);
+			g->nb = 0;
+		}
+	}
+}
+
+static void put_lzw(FILE *fp, const unsigned char *idx, long nb, int min)
+{
+	struct gif_writer g;
+	unsigned short *table;
+	int clear = 1 << min;
+	int next, size, cur, c;
+	long i;
+
+	table = (unsigned short*) calloc(4096 * 256, sizeof(unsigned short));
+	g.fp = fp;
+	g.nb = 0;
+	g.acc = 0;
+	g.bits = 0;
+	fputc(min, fp);
+	size = min + 1;
+	next = clear + 2;
+	put_code(&g, clear, size);
+	cur = idx[0];
+	for (i = 1; i < nb; i++) {
+		c = table[cur * 256 + idx[i]];
+		if (c) {
+			cur = c;
+			continue;
+		}
+		put_code(&g, cur, size);
+		if (next < 4096) {
+			table[cur * 256 + idx[i]] = next++;
+			if (next > 1 << size && size < 12) size++;
+		} else {
+			put_code(&g, clear, size);
+			memset(table, 0, 4096 * 256 * sizeof(unsigned short));
+			size = min + 1;
+			next = clear + 2;
+		}
+		cur = idx[i];
+	}
+	put_code(&g, cur, size);
+	put_code(&g, clear + 1, size);
+	if (g.bits) put_code(&g, 0, 8 - g.bits);
+	if (g.nb) {
+		fputc(g.nb, fp);
+		fwrite(g.block, 1, g.nb, fp);
+	}
+	fputc(0, fp);
+	free(table);
+}
+
+static void put16(FILE *fp, int v)
+{
+	fputc(v & 255, fp);
+	fputc(v >> 8, fp);
+}
+
+/*
+ *  A GIF of a sw x sh screen with one frame of fw x fh pixels at fx,
+ *  fy. The 1 << bits colors of map are the global colormap, or the
+ *  local one of the frame with local. Rows are written in the
+ *  interlaced order with interlace.
+ */
+static int write_gif(const char *name, int sw, int sh, int fx, int fy,
+	int fw, int fh, const unsigned char *idx, const unsigned char *map,
+	int bits, int local, int interlace, int trans)
+{
+	static const int start[4] = {0, 4, 2, 1};
+	static const int step[4] = {8, 8, 4, 2};
+	unsigned char *rows;
+	FILE *fp;
+	int p, y, n = 0;
+
+	fp = fopen(name, "wb");
+	if (!fp) return -1;
+	fwrite("GIF89a", 1, 6, fp);
+	put16(fp, sw);
+	put16(fp, sh);
+	fputc(local ? 0 : 0x80 | (bits - 1), fp);
+	fputc(0, fp);
+	fputc(0, fp);
+	if (!local) fwrite(map, 3, 1 << bits, fp);
+	if (trans >= 0) {
+		fwrite("!\xf9\x04\x01\0\0", 1, 6, fp);
+		fputc(trans, fp);
+		fputc(0, fp);
+	}
+	fputc(',', fp);
+	put16(fp, fx);
+	put16(fp, fy);
+	put16(fp, fw);
+	put16(fp, fh);
+	fputc((local ? 0x80 | (bits - 1) : 0) | (interlace ? 0x40 : 0), fp);
+	if (local) fwrite(map, 3, 1 << bits, fp);
+	rows = (unsigned char*) malloc(fw * fh);
+	for (p = 0; p < (interlace ? 4 : 1); p++) {
+		for (y = interlace ? start[p] : 0; y < fh;
+			y += interlace ? step[p] : 1)
+		{
+			memcpy(rows + n * fw, idx + y * fw, fw);
+			n++;
+		}
+	}
+	put_lzw(fp, rows, (long) fw * fh, bits < 2 ? 2 : bits);
+	free(rows);
+	fputc(';', fp);
+	fclose(fp);
+	return 0;
+}
+
+static void random_map(unsigned char *map, int nb)
+{
+	int i;
+
+	for (i = 0; i < nb * 3; i++) map[i] = rand() & 255;
+}
+
+/*
+ *  The pixels of the sw x sh screen, with an alpha if d is 4.
+ */
+static unsigned char *expect(int sw, int sh, int fx, int fy, int fw,
+	int fh, const unsigned char *idx, const unsigned char *map,
+	int trans, int d)
+{
+	unsigned char *e, *o;
+	int x, y;
+
+	e = (unsigned char*) calloc(sw * sh, d);
+	for (y = 0; y < fh; y++) {
+		for (x = 0; x < fw; x++) {
+			int i = idx[y * fw + x];
+			o = e + ((fy + y) * sw + fx + x) * d;
+			memcpy(o, map + i * 3, 3);
+			if (d == 4) o[3] = i == trans ? 0 : 255;
+		}
+	}
+	return e;
+}
+
+/*
+ *  A BLOCK_SIZE image of 4x4 blocks of 256 colors. Its 32x32 icon is
+ *  the colors of the blocks.
+ */
+static void write_blocks(const char *name, unsigned char **icon)
+{
+	unsigned char map[256 * 3], blocks[32 * 32];
+	unsigned char *idx;
+	int x, y;
+
+	random_map(map, 256);
+	for (x = 0; x < 32 * 32; x++) blocks[x] = rand() & 255;
+	idx = (unsigned char*) malloc(BLOCK_SIZE * BLOCK_SIZE);
+	for (y = 0; y < BLOCK_SIZE; y++) {
+		for (x = 0; x < BLOCK_SIZE; x++) {
+			idx[y * BLOCK_SIZE + x] = blocks[(y / 4) * 32 + x / 4];
+		}
+	}
+	write_gif(name, BLOCK_SIZE, BLOCK_SIZE, 0, 0, BLOCK_SIZE, BLOCK_SIZE,
+		idx, map, 8, 0, 0, -1);
+	*icon = expect(32, 32, 0, 0, 32, 32, blocks, map, -1, 3);
+	free(idx);
+}
+
+/*
+ *  Waits for the thumbnails of the nb files.
+ */
+static void wait_all(Thumbnailer *t, char **files, int nb)
+{
+	struct stat st;
+	int i, got = 0;
+
+	for (i = 0; i < nb; i++) {
+		stat(files[i], &st);
+		t->get(files[i], &st);
+	}
+	while (got < nb) {
+		usleep(1000);
+		got += t->collect();
+	}
+}
+
+/*
+ *  Returns 1 if the icon of file is not w x h x d pixels at most
+ *  tolerance off, NULL pixels means no icon.
+ */
+static int check(Thumbnailer *t, const char *file, int w, int h, int d,
+	const unsigned char *pixels, int tolerance)
+{
+	struct stat st;
+	Fl_Image *img;
+	const unsigned char *p;
+	int i;
+
+	stat(file, &st);
+	img = t->get(file, &st);
+	if (!pixels) return img != NULL;
+	if (!img || img->w() != w || img->h() != h || img->d() != d) return 1;
+	p = (const unsigned char*) img->data()[0];
+	for (i = 0; i < w * h * d; i++) {
+		if (abs(p[i] - pixels[i]) > tolerance) return 1;
+	}
+	return 0;
+}
+
+static int copy_half(const char *from, const char *to)
+{
+	struct stat st;
+	char *buf;
+	FILE *fp;
+	int n;
+
+	if (stat(from, &st) || !(fp = fopen(from, "rb"))) return -1;
+	n = st.st_size / 2;
+	buf = (char*) malloc(n);
+	n = fread(buf, 1, n, fp);
+	fclose(fp);
+	fp = fopen(to, "wb");
+	if (!fp) {
+		free(buf);
+		return -1;
+	}
+	fwrite(buf, 1, n, fp);
+	fclose(fp);
+	free(buf);
+	return 0;
+}
+
+static void make_marks(const char *dir, const char *prefix, int nb,
+	time_t mtime)
+{
+	struct utimbuf u;
+	char name[1024];
+	char data[200];
+	FILE *fp;
+	int i;
+
+	memset(data, 0, sizeof(data));
+	u.actime = u.modtime = mtime;
+	for (i = 0; i < nb; i++) {
+		snprintf(name, sizeof(name), "%s/%s%d.png", dir, prefix, i);
+		fp = fopen(name, "wb");
+		if (!fp) continue;
+		fwrite(data, 1, sizeof(data), fp);
+		fclose(fp);
+		utime(name, &u);
+	}
+}
+
+/*
+ *  Counts the marks of the fail directory and those made up as old.
+ */
+static int count_marks(const char *dir, int *old, long *bytes)
+{
+	struct dirent *de;
+	struct stat st;
+	DIR *d;
+	int nb = 0;
+
+	*old = 0;
+	*bytes = 0;
+	d = opendir(dir);
+	while (d && (de = readdir(d))) {
+		if (de->d_name[0] == '.') continue;
+		nb++;
+		if (!strncmp(de->d_name, "old", 3)) (*old)++;
+		if (!fstatat(dirfd(d), de->d_name, &st, 0)) *bytes += st.st_size;
+	}
+	if (d) closedir(d);
+	return nb;
+}
+
+int main(int argc, char **argv)
+{
+	char home[] = "/tmp/thumbs-XXXXXX";
+	char name[1024], fail[1024];
+	unsigned char map[16 * 3], idx[32 * 24], small[30 * 20];
+	unsigned char *e, **icons;
+	char **files;
+	Thumbnailer *t;
+	int nb_images = 400;
+	int i, nb, old, bad = 0, ret = 0;
+	long bytes;
+	double t1, t2;
+	FILE *fp;
+
+	if (argc > 1) nb_images = atoi(argv[1]);
+	if (nb_images < 1) nb_images = 1;
+	if (!mkdtemp(home)) {
+		perror("thumbs");
+		return 1;
+	}
+	srand(1);
+	files = (char**) malloc(sizeof(char*) * (nb_images + 5));
+	icons = (unsigned char**) malloc(sizeof(char*) * nb_images);
+	for (i = 0; i < nb_images; i++) {
+		snprintf(name, sizeof(name), "%s/blocks%d.gif", home, i);
+		write_blocks(name, icons + i);
+		files[i] = strdup(name);
+	}
+	nb = nb_images;
+
+	/* interlaced, the color 3 is transparent */
+	random_map(map, 16);
+	for (i = 0; i < 30 * 20; i++) small[i] = rand() & 15;
+	snprintf(name, sizeof(name), "%s/small.gif", home);
+	write_gif(name, 30, 20, 0, 0, 30, 20, small, map, 4, 0, 1, 3);
+	files[nb++] = strdup(name);
+
+	/* a frame of 10x8 in a screen of 32x24, with its own colormap */
+	for (i = 0; i < 10 * 8; i++) idx[i] = rand() & 3;
+	snprintf(name, sizeof(name), "%s/frame.gif", home);
+	write_gif(name, 32, 24, 5, 7, 10, 8, idx, map, 2, 1, 0, -1);
+	files[nb++] = strdup(name);
+
+	/* the first half of an image */
+	snprintf(name, sizeof(name), "%s/cut.gif", home);
+	if (copy_half(files[0], name)) {
+		perror("thumbs");
+		return 1;
+	}
+	files[nb++] = strdup(name);
+	snprintf(name, sizeof(name), "%s/bad.gif", home);
+	fp = fopen(name, "wb");
+	fwrite("GIF89a\x20\0\x20\0\xff\0\0garbage", 1, 20, fp);
+	fclose(fp);
+	files[nb++] = strdup(name);
+
+	/* the marks of a cache used for long */
+	snprintf(fail, sizeof(fail), "%s/.xd640/thumbnails/fail/flfm", home);
+	t = new Thumbnailer(home);
+	delete(t);
+	make_marks(fail, "old", NB_OLD_MARKS, time(NULL) - THUMB_FAIL_AGE - 60);
+	make_marks(fail, "new", NB_NEW_MARKS, time(NULL) - 60);
+
+	t1 = now();
+	t = new Thumbnailer(home);
+	wait_all(t, files, nb);
+	t1 = now() - t1;
+	for (i = 0; i < nb_images; i++) {
+		if (check(t, files[i], 32, 32, 3, icons[i], 1)) bad++;
+	}
+	e = expect(30, 20, 0, 0, 30, 20, small, map, 3, 4);
+	if (check(t, files[nb_images], 30, 20, 4, e, 0)) bad++;
+	free(e);
+	e = expect(32, 24, 5, 7, 10, 8, idx, map, -1, 4);
+	if (check(t, files[nb_images + 1], 32, 24, 4, e, 0)) bad++;
+	free(e);
+	/* any icon or none, but no crash */
+	check(t, files[nb_images + 2], 0, 0, 0, NULL, 0);
+	if (check(t, files[nb_images + 3], 0, 0, 0, NULL, 0)) bad++;
+	delete(t);
+
+	t2 = now();
+	t = new Thumbnailer(home);
+	wait_all(t, files, nb);
+	t2 = now() - t2;
+	for (i = 0; i < nb_images; i++) {
+		if (check(t, files[i], 32, 32, 3, icons[i], 1)) bad++;
+	}
+	delete(t);
+	printf("gif        %d images of %dx%d: made in %.3f s, from the cache "
+		"in %.3f s, %d icons wrong\n", nb, BLOCK_SIZE, BLOCK_SIZE, t1, t2,
+		bad);
+	if (bad) {
+		printf(_("FAILED: %d icons differ from the images\n"), bad);
+		ret = 1;
+	}
+
+	nb = count_marks(fail, &old, &bytes);
+	printf("fail marks %d made up, %d old: %d left, %d old, %ld bytes\n",
+		NB_OLD_MARKS + NB_NEW_MARKS, NB_OLD_MARKS, nb, old, bytes);
+	if (old || bytes > THUMB_FAIL_MAX) {
+		printf(_("FAILED: the failure marks are not trimmed\n"));
+		ret = 1;
+	}
+
+	snprintf(name, sizeof(name), "rm -rf %s", home);
+	system(name);
+	for (i = 0; i < nb_images; i++) free(icons[i]);
+	for (i = 0; i < nb_images + 4; i++) free(files[i]);
+	free(icons);
+	free(files);
+	return ret;
+}
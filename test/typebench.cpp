@@ -0,0 +1,203 @@
+/*
+ *  Keystroke replay benchmark.
+ *
+ *  usage: typebench [session file]
+ *
+ *  Replays a typing session in an editable frame through insert_text(),
+ *  one keystroke at a time, and prints the keystrokes per second. A
+ *  session file holds the keys as typed, '\b' for BackSpace, 0x7F for
+ *  Delete and '\n' for Enter. Without one, a session of 100000 keys
+ *  with typos, corrections and auto-repeated BackSpace is made up.
+ *
+ *  The frame is not shown, so the text widths come from a fixed pitch
+ *  device instead of the X server: the timings are those of the
+ *  editing and the layout code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <FL/Fl.h>
+#include <FL/Fl_Fltk.H>
+#include <xd640/Xd6HtmlFrame.h>
+#include <xd640/Xd6HtmlBlock.h>
+#include <xd640/Xd6HtmlSegment.h>
+#include <xd640/Xd6XmlStyle.h>
+
+#define _(str) (str)
+
+#define NB_KEYS 100000
+
+class FixedPitch : public Fl_Fltk {
+public:
+	void font(int face, int size) { fl_font_ = face; fl_size_ = size; }
+	int height() { return fl_size_ + 2; }
+	int descent() { return fl_size_ / 4; }
+	double width(const char *s) { return width(s, strlen(s)); }
+	double width(const char *s, int n) { return n * fl_size_ * 0.55; }
+	double width(unsigned int) { return fl_size_ * 0.55; }
+};
+
+static const char *words[] = {
+	"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+	"lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+	"adipiscing", "elit", "sed", "do", "eiusmod", "tempor"
+};
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int make_session(char *keys, int max)
+{
+	int n = 0;
+	int nb_words = 0;
+
+	srand(7);
+	while (n < max - 64) {
+		const char *w = words[rand() % (sizeof(words) / sizeof(*words))];
+		if (rand() % 12 == 0) {
+			keys[n++] = 'x';
+			keys[n++] = 'q';
+			keys[n++] = '\b';
+			keys[n++] = '\b';
+		}
+		while (*w) keys[n++] = *w++;
+		nb_words++;
+		if (nb_words % 60 == 0) {
+			keys[n++] = '.';
+			keys[n++] = '\n';
+		} else {
+			keys[n++] = ' ';
+		}
+		if (nb_words % 90 == 0) {
+			int i;
+			for (i = 0; i < 20; i++) keys[n++] = '\b';
+		}
+	}
+	return n;
+}
+
+static int read_session(const char *name, char *keys, int max)
+{
+	FILE *fp;
+	int n;
+
+	fp = fopen(name, "r");
+	if (!fp) return -1;
+	n = fread(keys, 1, max, fp);
+	fclose(fp);
+	return n;
+}
+
+/*
+ *  What the document must hold once the keys are replayed.
+ */
+static int expected_text(const char *keys, int nb, char *out)
+{
+	int i, n = 0;
+
+	for (i = 0; i < nb; i++) {
+		if (keys[i] == '\b') {
+			if (n > 0) n--;
+		} else if (keys[i] != '\x7F') {
+			out[n++] = keys[i];
+		}
+	}
+	out[n] = '\0';
+	return n;
+}
+
+static int document_text(Xd6HtmlFrame *frame, char *out, int max)
+{
+	int i, j, n = 0;
+
+	for (i = 0; i < frame->nb_blocks; i++) {
+		Xd6HtmlBlock *b = frame->blocks[i];
+		if (i > 0 && n < max) out[n++] = '\n';
+		for (j = 0; j < b->nb_segs; j++) {
+			Xd6HtmlSegment *s = b->segs[j];
+			if (n + s->len >= max) return -1;
+			memcpy(out + n, s->text, s->len);
+			n += s->len;
+		}
+	}
+	out[n] = '\0';
+	return n;
+}
+
+static void replay(Xd6HtmlFrame *frame, const char *keys, int nb,
+	const char *where)
+{
+	double t, worst = 0;
+	int i;
+
+	t = now();
+	for (i = 0; i < nb; i++) {
+		double k = now();
+		frame->insert_text(keys + i, 1);
+		k = now() - k;
+		if (k > worst) worst = k;
+	}
+	t = now() - t;
+	printf("%-10s %d keys in %.3f s, %.0f keys/s, slowest %.3f ms, "
+		"%d blocks\n", where, nb, t, nb / t, worst * 1000.0,
+		frame->nb_blocks);
+}
+
+int main(int argc, char **argv)
+{
+	static FixedPitch pitch;
+	Xd6HtmlFrame *frame;
+	char *keys, *want, *got;
+	int nb, len, ret;
+
+	keys = (char*) malloc(NB_KEYS * 10);
+	if (argc > 1) {
+		nb = read_session(argv[1], keys, NB_KEYS * 10);
+		if (nb < 0) {
+			fprintf(stderr, _("can't read %s\n"), argv[1]);
+			return 1;
+		}
+	} else {
+		nb = make_session(keys, NB_KEYS);
+	}
+	want = (char*) malloc(nb * 2 + 1);
+	got = (char*) malloc(nb * 2 + 1024);
+
+	fl = &pitch;
+	frame = new Xd6HtmlFrame(0);
+	frame->page_width = 595 - 84 - 28;
+	frame->page_height = 842 - 56 - 56;
+	frame->resize(640, 480);
+	frame->editor = 1;
+	while (frame->nb_blocks > 0) {
+		delete(frame->blocks[--frame->nb_blocks]);
+	}
+	frame->add_block();
+	frame->blocks[0]->add_segment((char*)malloc(1), 0, &Xd6XmlStl::def);
+	frame->measure();
+	frame->cursor_to_end();
+
+	len = expected_text(keys, nb, want);
+	replay(frame, keys, nb, _("at the end"));
+	document_text(frame, got, nb * 2 + 1024);
+	ret = strcmp(want, got);
+
+	/* once more, in front of what was typed */
+	memcpy(want + len, want, len + 1);
+	frame->cursor_to_begin();
+	replay(frame, keys, nb, _("in front"));
+	document_text(frame, got, nb * 2 + 1024);
+	ret |= strcmp(want, got);
+
+	if (ret) {
+		printf(_("FAILED: the document does not hold the typed text\n"));
+	}
+	return ret;
+}
@@ -41,6 +41,32 @@
 #ifndef base64_h
 #define base64_h
 
+#include <stdio.h>
+
+/*
+ *  Streaming Base64 codec : encode() and decode() may be called with 
+ *  any slice of the input, the state is kept between the calls.
+ */
+class Xd6Base64 {
+public:
+	unsigned int bits;
+	int nb_bits;
+	int done;
+	unsigned char part[3];
+	int nb_part;
+	int linelen;
+
+	Xd6Base64();
+	int encode(const unsigned char *in, int len, char *out);
+	int end(char *out);
+	int decode(const char *in, int len, unsigned char *out);
+
+	static int encode_size(int len);
+	static int decode_size(int len);
+	static int encode_buffer(const unsigned char *in, int len, char *out);
+	static int decode_buffer(const char *in, int len, unsigned char *out);
+};
+
 void Xd6Decode_base64 (FILE *fpin, FILE *fout);
 void Xd6Encode_base64 (FILE * fin, FILE *fout);
 
@@ -0,0 +1,125 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#ifndef Xd6FileWatcher_h
+#define Xd6FileWatcher_h
+
+#include <sys/types.h>
+#include <time.h>
+
+#define XD6_WATCH_CREATE	1
+#define XD6_WATCH_DELETE	2
+#define XD6_WATCH_MODIFY	4
+#define XD6_WATCH_RESCAN	8
+
+class Xd6FileWatcher;
+
+/*
+ *  name is the entry of the directory that has changed, what is an or
+ *  of XD6_WATCH_*. With XD6_WATCH_RESCAN name is NULL : too much has 
+ *  changed (or the directory itself) and all must be read again.
+ */
+typedef void (Xd6WatchCallback)(Xd6FileWatcher *w, const char *name, 
+	int what, void *data);
+
+struct Xd6WatchEvent {
+	char *name;
+	int what;
+};
+
+struct Xd6WatchEntry {
+	char *name;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	long mtime_ns;
+	time_t ctime;
+};
+
+/*
+ *  Watches a directory, or a single file through its directory. The
+ *  kernel events of all the watchers come from one inotify fd given to
+ *  Fl::add_fd(). They are collected for a short delay and delivered once
+ *  per name. Files of /proc which signal their changes with poll() (like
+ *  the mount table) are watched through their own fd, and the
+ *  directories inotify can't follow (network or FUSE file systems) are 
+ *  polled and compared to the previous listing.
+ */
+class Xd6FileWatcher {
+public:
+	static int inotify_fd;
+	static Xd6FileWatcher *first;
+	Xd6FileWatcher *next;
+	char *dir;
+	char *file;
+	int wd;
+	int proc_fd;
+	int polling;
+	double delay;
+	double interval;
+	Xd6WatchCallback *cb;
+	void *data;
+	Xd6WatchEvent *events;
+	int nb_events;
+	int max_events;
+	Xd6WatchEntry *entries;
+	int nb_entries;
+	int *living;
+
+	Xd6FileWatcher(const char *path, Xd6WatchCallback *c, void *d);
+	~Xd6FileWatcher();
+	void add_event(const char *name, int what);
+	void deliver(void);
+	void start_polling(void);
+	void list(Xd6WatchEntry **e, int *nb);
+	void poll(void);
+
+	static void inotify_cb(int fd, void *d);
+	static void proc_cb(int fd, void *d);
+	static void deliver_cb(void *d);
+	static void poll_cb(void *d);
+};
+
+#endif
+
+/*
+ * "$Id: $"
+ */
@@ -63,6 +63,13 @@ public:
 	int frame_width;
 	unsigned short list_id;
 
+	unsigned int layout_key;
+	int text_width;
+	char paged;
+	char has_display;
+	char dirty;		/* changed by an edit, see measure_dirty() */
+	char spelled;
+
 	Xd6HtmlSegment **segs;
 	int nb_segs;
 	Xd6HtmlLine **lines;
@@ -76,6 +83,7 @@ public:
 	void draw(int X, int Y);
 	void create_lines(void);
 	void align_lines(void);
+	unsigned int layout_signature(void);
 
 	void find_pos(int X, int Y, int x, int y, Xd6HtmlLine **line, 
 			Xd6HtmlSegment **seg, char **chr);
@@ -75,6 +75,8 @@ public:
 	virtual void destroy(void);
 	virtual void break_line(int h, int ph, int fh);
 	virtual void load(const char *url, const char *file);
+	virtual void load_data(const char *url, unsigned char *data, 
+		long length);
 	int event_is_inside(int x, int y);
 	static Xd6HtmlDisplay *create(int id, Xd6XmlTreeElement *elem,
 				Xd6HtmlFrame *u);
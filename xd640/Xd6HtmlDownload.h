@@ -60,6 +60,8 @@ public:
 		Xd6HtmlTagForm *form, Xd6HtmlFrame *frame, 
 		Xd6HtmlDisplay *wi = NULL);
 	static char *create_url(const char *base, const char *u);
+	static unsigned char *data_decode(const char *url, long *length);
+	const char *data_request(const char *url, Xd6HtmlDisplay *wi);
 	const char *data_download(const char *url);
 	const char *file_download(char *url);
 };
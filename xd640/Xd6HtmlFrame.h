@@ -65,6 +65,8 @@ public:
 
 	Xd6HtmlBlock **blocks;
 	int nb_blocks;
+	int max_blocks;
+	int keep_blocks;	/* append_blocks() drops older blocks, 0: never */
 
 	int page_margin_top;
 	int page_margin_left;
@@ -129,6 +131,11 @@ public:
 
 	char need_paging;
 	char modified;
+	int paged_height;
+	int load_depth;
+	Xd6XmlTreeElement *load_elem[3];
+	int load_child[3];
+	int load_open[3];
 
 	int hot_x, hot_y;
 	char is_hot;
@@ -144,12 +151,22 @@ public:
 	Xd6HtmlDisplay* special_elements(Xd6XmlTreeElement *elem, 
 		Xd6HtmlFrame *cp);
 	void tree2block(Xd6XmlTreeElement *elem, Xd6HtmlDisplay *cp = NULL);
+	int tree2block_open(Xd6XmlTreeElement *elem, Xd6HtmlDisplay *cp);
+	void tree2block_child(Xd6XmlTreeElement *elem, int i, 
+		Xd6HtmlDisplay *cp);
+	void tree2block_next(Xd6XmlTreeElement *elem, Xd6XmlTreeElement *e);
+	void tree2block_close(Xd6XmlTreeElement *elem);
 	void text_tree2block(Xd6XmlTreeElement *elem);
 	void measure(void);
+	void measure_dirty(Xd6HtmlBlock *b, Xd6HtmlBlock *e);
+	void load_start(Xd6XmlTree *tree);
+	int load_chunk(class Xd6XmlParser *parser, const char *buf, int len);
+	void load_tree(Xd6XmlTree *tree, int eof);
 	void resize(int W, int H);
 	void page_size(int W, int H, int FH);
 	int break_line(Xd6HtmlLine *l, int height);
-	void create_pages(Xd6HtmlBlock *b = NULL);
+	void create_pages(Xd6HtmlBlock *b = NULL, int limit = 1);
+	int find_block(int y);
 	void find_pos(int X, int Y, Xd6HtmlBlock **b, Xd6HtmlLine **l, 
 		Xd6HtmlSegment **s, char **c);
 	void cut(int fast = 0);
@@ -182,6 +199,7 @@ public:
 	void insert_text(const char *txt, int len);
 	void insert_segment(Xd6HtmlSegment *s);
 	void insert_frame(Xd6HtmlFrame *f);
+	void append_blocks(Xd6HtmlBlock **b, int n);
 	Xd6HtmlFrame *get_cursor_frame(void);
 	void cursor_to_end(void);
 	void cursor_to_begin(void);
@@ -62,6 +62,7 @@ public:
 
 	Xd6HtmlSegment **segs;
 	short nb_segs;
+	short max_segs;
 
 	Xd6HtmlLine(int i);
 	~Xd6HtmlLine();
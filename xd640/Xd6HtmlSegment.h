@@ -64,6 +64,7 @@ public:
 
 	char *text;
 	unsigned short len;
+	unsigned short max_len;	/* bytes allocated for text, 0 if unknown */
 	
 	static int *sizes;
 	static int sizes1[];
@@ -94,6 +94,8 @@ public:
 	int attr_h;
 	int attr_border;
 	char *source;
+	unsigned char *source_data;
+	long source_length;
 
 	Xd6HtmlTagImg(int i, Xd6XmlTreeElement *e, Xd6HtmlFrame *u);
 	~Xd6HtmlTagImg();
@@ -105,6 +107,7 @@ public:
 	void to_html(FILE *fp);
 	void to_rtf(FILE *fp);
 	void load(const char *url, const char *file);
+	void load_data(const char *url, unsigned char *data, long length);
 };
 
 #endif
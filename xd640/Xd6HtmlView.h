@@ -46,6 +46,7 @@
 #include "Xd6FindDialog.h"
 #include <FL/Fl_Widget.h>
 #include "Xd6XmlParser.h"
+#include "Xd6SpellDict.h"
 #include <stdio.h>
 
 class Xd6HtmlView : public Fl_Widget {
@@ -68,7 +69,20 @@ public:
 	int spell_nb_i;
 	int spell_nb_r;
 	int cancel_spelling;
+	int spell_modal;
+	int spell_count;
+	int spell_live;
+	int spell_pending;
+	int spell_pos;
+	int spell_left;
 	int inch;
+	int progressive;
+	int load_fd;
+	int load_size;
+	int load_done;
+
+	static Xd6SpellDict *spell_dict;
+	static char *spell_dict_name;
 
 	Xd6FindDialog *find_dialog;
 	Xd6HtmlView(int X, int Y, int W, int H);
@@ -83,12 +97,18 @@ public:
 	void measure(void);
 	void print(void);
 	void draw(void);
-	void load(const char *n);
+	void load(const char *n, const char *url = NULL);
+	int load_step(void);
+	void load_end(void);
+	void load_stop(void);
+	static void load_idle(void *d);
 	void blank(void);
 	int handle(int e);
 	void resize(int X, int Y, int W, int H);
 	void spell(void);
 	void spell_cb(Xd6HtmlSegment *s, Xd6HtmlLine *line, Xd6HtmlBlock *b);
+	void spell_later(void);
+	static void spell_idle(void *d);
 	void find_word(Xd6HtmlSegment *, char **, int *);
 	void spell_choice(Xd6HtmlFrame *f, Xd6HtmlBlock *b, Xd6HtmlSegment *s);
 	void add_spell_ignore(const char *w);
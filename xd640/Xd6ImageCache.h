@@ -0,0 +1,98 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+#ifndef Xd6ImageCache_h
+#define Xd6ImageCache_h
+
+#include <FL/Fl.h>
+#include <FL/Fl_Image.h>
+
+/*
+ *  Decoded images shared by all the documents of the process. An entry
+ *  is found by a hash of the file content and the size it is scaled to
+ *  (0 x 0 for the size of the file), so the same bullet or logo is
+ *  decoded and scaled once whatever file it was downloaded to.
+ */
+class Xd6ImageCacheEntry {
+public:
+	unsigned long long key;
+	long length;
+	int w;
+	int h;
+	Fl_Image *image;
+	int refs;
+	long bytes;
+	unsigned int last_use;
+	Xd6ImageCacheEntry *next;
+};
+
+class Xd6ImageCache {
+public:
+	static Xd6ImageCacheEntry **table;
+	static int table_size;
+	static unsigned int clock;
+	static long bytes;
+	static long max_bytes;
+	static int nb_entries;
+	static int hits;
+	static int misses;
+
+	static Xd6ImageCacheEntry *load(const char *file);
+	static Xd6ImageCacheEntry *load_data(const unsigned char *data, 
+		long length);
+	static Xd6ImageCacheEntry *scale(Xd6ImageCacheEntry *e, int w, int h);
+	static void release(Xd6ImageCacheEntry *e);
+	static void purge(void);
+
+	static Xd6ImageCacheEntry *find(unsigned long long key, long length, 
+		int w, int h);
+	static Xd6ImageCacheEntry *insert(unsigned long long key, 
+		long length, int w, int h, Fl_Image *img);
+	static void remove(Xd6ImageCacheEntry *e);
+	static Xd6ImageCacheEntry *get(unsigned long long key, long length,
+		const char *file, const unsigned char *data, 
+		const char *header);
+};
+
+#endif
+
+/*
+ * "$Id: $"
+ */
@@ -43,6 +43,7 @@
 
 #include <FL/Fl.h>
 #include <FL/Fl_PNG_Image.h>
+#include "Xd6ImageCache.h"
 
 class Xd6Png {
 public:
@@ -53,13 +54,18 @@ public:
   int bit;
 
   Fl_Image *png;
+  Xd6ImageCacheEntry *orig;
+  Xd6ImageCacheEntry *cur;
   Xd6Png();
   virtual ~Xd6Png();
   virtual void draw(int X, int Y, int W, int H, int cx=0, int cy=0);
   virtual void draw(int X, int Y) {draw(X, Y, w, h, 0, 0);}
   virtual int load(const char *name);
+  int load_data(const unsigned char *buf, long length);
   virtual int save(const char *name);
   virtual void set_size(int w, int h);
+  void set_image(Xd6ImageCacheEntry *e);
+  void reset_size(void);
   virtual const char *mime(void);
 };
 
@@ -0,0 +1,132 @@
+/******************************************************************************
+ *   "$Id:  $"
+ *
+ *                 Copyright (c) 2000-2001  O'ksi'D
+ *
+ *                      All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      Neither the name of O'ksi'D nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER 
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *   Author : Jean-Marc Lienher ( http://oksid.ch )
+ *
+ ******************************************************************************/
+
+
+
+#ifndef Xd6VirtualList_h
+#define Xd6VirtualList_h
+
+#include <FL/Fl.h>
+#include <FL/Fl_Group.h>
+#include <FL/Fl_Scrollbar.h>
+
+#define XD6_LIST_CACHE 256
+#define XD6_LIST_ROW_LEN 512
+
+enum {
+	XD6_ROW_BOLD = 1,
+};
+
+/*
+ *  count returns the number of rows. row writes the columns of a row in
+ *  buf separated by '\t' and returns XD6_ROW_ flags. compare orders two
+ *  rows on a column like strcmp.
+ */
+typedef int (*Xd6VirtualListCount)(void *data);
+typedef int (*Xd6VirtualListRow)(int row, char *buf, int len, void *data);
+typedef int (*Xd6VirtualListCompare)(int a, int b, int column, 
+	void *data);
+
+struct Xd6VirtualListCache {
+	int row;
+	int flags;
+	char text[XD6_LIST_ROW_LEN];
+};
+
+/*
+ *  List which asks for its rows only when they are drawn, for lists too
+ *  long for Fl_Browser. A few hundred formatted rows are cached. The 
+ *  rows are numbered by the caller, the sort order of each column is a
+ *  permutation of these numbers computed the first time it is used.
+ */
+class Xd6VirtualList : public Fl_Group {
+public:
+	Fl_Scrollbar *scrollbar;
+	Xd6VirtualListCount count_cb;
+	Xd6VirtualListRow row_cb;
+	Xd6VirtualListCompare compare_cb;
+	void *cb_data;
+	int nb_rows;
+	int top;
+	int selected;
+	int selected_pos;
+	const char **titles;
+	const int *widths;
+	int nb_columns;
+	int sort_column;
+	int sort_reverse;
+	int **orders;
+	Xd6VirtualListCache *cache;
+	int row_height;
+	int header_height;
+	static Xd6VirtualList *sorting;
+
+	Xd6VirtualList(int X, int Y, int W, int H, const char *l = 0);
+	~Xd6VirtualList(void);
+
+	void source(Xd6VirtualListCount c, Xd6VirtualListRow r, 
+		Xd6VirtualListCompare s, void *d);
+	void columns(const char **t, const int *w, int nb);
+	void update(void);
+	void clear_cache(void);
+	void invalidate(int row);
+	int value(void) { return selected; }
+	void select(int row);
+	void select_position(int pos);
+	int row_at(int pos);
+	int position_of(int row);
+	void sort(int column, int reverse);
+	int *order(void);
+	void show_position(int pos);
+	const char *row_text(int row, int *flags);
+	int visible_rows(void);
+	void update_scrollbar(void);
+
+	void draw(void);
+	int handle(int e);
+	void resize(int X, int Y, int W, int H);
+	static void scrollbar_cb(Fl_Widget *w, void *d);
+	static int sort_cmp(const void *a, const void *b);
+};
+
+#endif
+
+/*
+ * "$Id: $"
+ */
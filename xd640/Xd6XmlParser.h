@@ -72,7 +72,10 @@ public:
 	void parse_string(const char *buf, int buf_len);
 	int is_name(const char c);
 	int scan_file(const char *name, Xd6XmlTreeCallback *func, void *data);
+	void scan_string(const char *buf, int buf_len, 
+		Xd6XmlTreeCallback *func, void *data);
 protected:
+	int parse_mapped_file();
 	inline void add_char_to_buffer();
 	inline void add_char_to_entity();
 	void text();
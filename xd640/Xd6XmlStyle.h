@@ -227,10 +227,15 @@ public:
 	void clear_flags();
 	int can_merge(Xd6XmlStl *o);
 	int is_equal(Xd6XmlStl *o);
+	unsigned int hash(Xd6XmlStl *owner);
+	static void table_stats(unsigned int *nb, unsigned int *size);
 
 	Xd6XmlStl **child;
 	int nb_child;
+	int max_child;
 	Xd6XmlStl *parent;
+	unsigned int hash_key;
+	int interned;
 
 	int flags[4];
 
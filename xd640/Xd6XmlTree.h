@@ -77,7 +77,9 @@ public:
 	Xd6XmlTreeElement *parent;
 
 	Xd6XmlTreeSegment(Xd6XmlTreeElement *p, int i);
-	~Xd6XmlTreeSegment();
+	virtual ~Xd6XmlTreeSegment();
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr, size_t size);
 };
 
 class Xd6XmlTreeText : public Xd6XmlTreeSegment {
@@ -100,14 +102,17 @@ public:
 	Xd6XmlStl *stl;
 	Xd6XmlAttribute **attributes;
 	int nb_attributes; 
+	int max_attributes; 
 	Xd6XmlTreeSegment **children;
 	int nb_children;
+	int max_children;
 	
 	Xd6XmlTreeElement(Xd6XmlTreeElement *p, int i);
 	virtual ~Xd6XmlTreeElement();
 	virtual Xd6XmlTreeText *create_child_text();
 	virtual Xd6XmlTreeElement *create_child_element();
 	void unref_child(int c_id);
+	void add_child(Xd6XmlTreeSegment *child);
 	void add_attribute(Xd6XmlAttribute *attr);
 	void set_name(const char *name, int len);
 	const char *get_attr_value(const char *name);
@@ -133,6 +138,8 @@ public:
 	Xd6XmlTreeElement *begin_element;
 	Xd6XmlTreeText *begin_text;
 	int begin_text_offset;
+	Xd6XmlTreeCallback *open_callback;
+	void *open_data;
 	
 	Xd6XmlTree();
 	virtual ~Xd6XmlTree();